@@ -325,6 +325,7 @@ int main (int argc, char** argv)
     fflush(stdout);
     printf("Time = %f\n",
            TIMER_DIFF_SECONDS(learnStartTime, learnStopTime));
+    timer_phasePrint();
     fflush(stdout);
 
     /*
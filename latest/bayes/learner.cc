@@ -129,6 +129,7 @@
 #include "query.h"
 #include "thread.h"
 #include "timer.h"
+#include "tm.h"
 #include "utility.h"
 #include "vector.h"
 #include "tm_transition.h"
@@ -249,19 +250,18 @@ compareTask (const void* aPtr, const void* bPtr)
 
 
 /* =============================================================================
- * compareQuery
+ * queryLess
  * -- Want smallest ID first
- * -- For vector_sort
+ * -- For vector_sortBy<query_t*>
  * =============================================================================
  */
-__attribute__((transaction_safe)) int
-compareQuery (const void* aPtr, const void* bPtr)
-{
-    query_t* aQueryPtr = (query_t*)(*(void**)aPtr);
-    query_t* bQueryPtr = (query_t*)(*(void**)bPtr);
-
-    return (aQueryPtr->index - bQueryPtr->index);
-}
+struct queryLess {
+    __attribute__((transaction_safe)) bool
+    operator() (query_t* aQueryPtr, query_t* bQueryPtr) const
+    {
+        return (aQueryPtr->index < bQueryPtr->index);
+    }
+};
 
 
 /* =============================================================================
@@ -420,6 +420,8 @@ createPartition (long min, long max, long id, long n,
 void
 createTaskList (void* argPtr)
 {
+    timer_phaseBegin("createTaskList");
+
     long myId = thread_getId();
     long numThread = thread_getNumThread();
 
@@ -479,11 +481,11 @@ createTaskList (void* argPtr)
 
     } /* foreach variable */
 
-    __transaction_atomic {
+    TM_BEGIN("learner_sumBaseLogLikelihood");
       float globalBaseLogLikelihood = learnerPtr->baseLogLikelihood;
       learnerPtr->baseLogLikelihood =
                         baseLogLikelihood + globalBaseLogLikelihood;
-   }
+   TM_END();
 
     /*
      * For each variable, find if the addition of any edge _to_ it is better
@@ -573,9 +575,9 @@ createTaskList (void* argPtr)
             taskPtr->fromId = bestLocalIndex;
             taskPtr->toId = v;
             taskPtr->score = score;
-            __transaction_atomic {
+            TM_BEGIN("learner_insertInitialTask");
               status = TMLIST_INSERT(taskListPtr, (void*)taskPtr);
-            }
+            TM_END();
             assert(status);
         }
 
@@ -584,6 +586,8 @@ createTaskList (void* argPtr)
     PVECTOR_FREE(queryVectorPtr);
     PVECTOR_FREE(parentQueryVectorPtr);
 
+    timer_phaseEnd("createTaskList");
+
 #ifdef TEST_LEARNER
     list_iter_t it;
     list_iter_reset(&it, taskListPtr);
@@ -702,7 +706,7 @@ TMpopulateQueryVectors (net_t* netPtr,
     assert(status);
     status = PVECTOR_PUSHBACK(queryVectorPtr, (void*)&queries[id]);
     assert(status);
-    vector_sort(queryVectorPtr, &compareQuery);
+    vector_sortBy<query_t*>(queryVectorPtr, queryLess());
 }
 
 
@@ -835,7 +839,7 @@ TMfindBestInsertTask (learner_task_t * dest,  findBestTaskArg_t* argPtr)
     assert(status);
 
     //[wer] was TM_PURE due to qsort(), now __attribute__((transaction_safe))
-    vector_sort(queryVectorPtr, &compareQuery);
+    vector_sortBy<query_t*>(queryVectorPtr, queryLess());
 
     /*
      * Search all possible valid operations for better local log likelihood
@@ -881,13 +885,13 @@ TMfindBestInsertTask (learner_task_t * dest,  findBestTaskArg_t* argPtr)
             status = PVECTOR_PUSHBACK(queryVectorPtr, (void*)&queries[fromId]);
             assert(status);
             //[wer] was TM_PURE due to qsort(), fixed
-            vector_sort(queryVectorPtr, &compareQuery);
+            vector_sortBy<query_t*>(queryVectorPtr, queryLess());
 
             status = PVECTOR_COPY(parentQueryVectorPtr, baseParentQueryVectorPtr);
             assert(status);
             status = PVECTOR_PUSHBACK(parentQueryVectorPtr, (void*)&queries[fromId]);
             assert(status);
-            vector_sort(parentQueryVectorPtr, &compareQuery);
+            vector_sortBy<query_t*>(parentQueryVectorPtr, queryLess());
 
             //[wer] in computeLocal...(), there's a function log(), which not __attribute__((transaction_safe))
             float newLocalLogLikelihood = computeLocalLogLikelihood(toId,
@@ -996,7 +1000,7 @@ TMfindBestRemoveTask (learner_task_t * dest,  findBestTaskArg_t* argPtr)
         assert(status);
         status = PVECTOR_PUSHBACK(queryVectorPtr, (void*)&queries[toId]);
         assert(status);
-        vector_sort(queryVectorPtr, &compareQuery);
+        vector_sortBy<query_t*>(queryVectorPtr, queryLess());
 
         /*
          * See if removing parent is better
@@ -1124,7 +1128,7 @@ TMfindBestReverseTask (learner_task_t * dest,  findBestTaskArg_t* argPtr)
       assert(status);
 
       //[wer]__attribute__((transaction_safe))
-      vector_sort(queryVectorPtr, &compareQuery);
+      vector_sortBy<query_t*>(queryVectorPtr, queryLess());
 
       /*
        * Get log likelihood for removing parent from toId
@@ -1145,13 +1149,13 @@ TMfindBestReverseTask (learner_task_t * dest,  findBestTaskArg_t* argPtr)
       assert(status);
       status = PVECTOR_PUSHBACK(parentQueryVectorPtr, (void*)&queries[toId]);
       assert(status);
-      vector_sort(parentQueryVectorPtr, &compareQuery);
+      vector_sortBy<query_t*>(parentQueryVectorPtr, queryLess());
 
       status = PVECTOR_COPY(queryVectorPtr, parentQueryVectorPtr);
       assert(status);
       status = PVECTOR_PUSHBACK(queryVectorPtr, (void*)&queries[fromId]);
       assert(status);
-      vector_sort(queryVectorPtr, &compareQuery);
+      vector_sortBy<query_t*>(queryVectorPtr, queryLess());
 
       newLocalLogLikelihood += computeLocalLogLikelihood(fromId,
                                                          adtreePtr,
@@ -1223,6 +1227,8 @@ TMfindBestReverseTask (learner_task_t * dest,  findBestTaskArg_t* argPtr)
 void
 learnStructure (void* argPtr)
 {
+    timer_phaseBegin("learnStructure");
+
     learner_t* learnerPtr = (learner_t*)argPtr;
     net_t* netPtr = learnerPtr->netPtr;
     adtree_t* adtreePtr = learnerPtr->adtreePtr;
@@ -1271,9 +1277,9 @@ learnStructure (void* argPtr)
     while (1) {
 
         learner_task_t* taskPtr;
-        __transaction_atomic {
+        TM_BEGIN("learner_popTask");
           taskPtr = TMpopTask(  taskListPtr);
-        }
+        TM_END();
 
         if (taskPtr == NULL) {
             break;
@@ -1283,9 +1289,11 @@ learnStructure (void* argPtr)
         long fromId = taskPtr->fromId;
         long toId = taskPtr->toId;
 
+        timer_phaseBegin("learn_applyTask");
+
         bool isTaskValid;
 
-        __transaction_atomic {
+        TM_BEGIN("learner_validateTask");
         /*
          * Check if task is still valid
          */
@@ -1344,13 +1352,13 @@ learnStructure (void* argPtr)
           TMNET_APPLYOPERATION(netPtr, op, fromId, toId);
         }
 
-        }
+        TM_END();
         float deltaLogLikelihood = 0.0;
         if (isTaskValid) {
             switch (op) {
                 float newBaseLogLikelihood;
                 case OPERATION_INSERT: {
-                  __transaction_atomic {
+                  TM_BEGIN("learner_scoreInsert");
                     TMpopulateQueryVectors(netPtr,
                                            toId,
                                            queries,
@@ -1366,17 +1374,17 @@ learnStructure (void* argPtr)
                     deltaLogLikelihood +=
                         toLocalBaseLogLikelihood - newBaseLogLikelihood;
                     localBaseLogLikelihoods[toId] = newBaseLogLikelihood;
-                  }
+                  TM_END();
 
-                  __transaction_atomic {
+                  TM_BEGIN("learner_incNumTotalParent");
                     long numTotalParent = learnerPtr->numTotalParent;
                     learnerPtr->numTotalParent = (numTotalParent + 1);
-                  }
+                  TM_END();
                   break;
                 }
 #ifdef LEARNER_TRY_REMOVE
                 case OPERATION_REMOVE: {
-                  __transaction_atomic {
+                  TM_BEGIN("learner_scoreRemove");
                     TMpopulateQueryVectors(netPtr,
                                            fromId,
                                            queries,
@@ -1392,18 +1400,18 @@ learnStructure (void* argPtr)
                     deltaLogLikelihood +=
                         fromLocalBaseLogLikelihood - newBaseLogLikelihood;
                     localBaseLogLikelihoods[fromId] = newBaseLogLikelihood;
-                  }
+                  TM_END();
 
-                  __transaction_atomic {
+                  TM_BEGIN("learner_decNumTotalParent");
                     long numTotalParent = learnerPtr->numTotalParent;
                     learnerPtr->numTotalParent = (numTotalParent - 1);
-                  }
+                  TM_END();
                   break;
                 }
 #endif /* LEARNER_TRY_REMOVE */
 #ifdef LEARNER_TRY_REVERSE
                 case OPERATION_REVERSE: {
-                  __transaction_atomic {
+                  TM_BEGIN("learner_scoreReverseFrom");
                     TMpopulateQueryVectors(netPtr,
                                          fromId,
                                          queries,
@@ -1419,9 +1427,9 @@ learnStructure (void* argPtr)
                     deltaLogLikelihood +=
                       fromLocalBaseLogLikelihood - newBaseLogLikelihood;
                     localBaseLogLikelihoods[fromId] =  newBaseLogLikelihood;
-                  }
+                  TM_END();
 
-                  __transaction_atomic {
+                  TM_BEGIN("learner_scoreReverseTo");
                     TMpopulateQueryVectors(netPtr,
                                            toId,
                                            queries,
@@ -1437,7 +1445,7 @@ learnStructure (void* argPtr)
                     deltaLogLikelihood +=
                         toLocalBaseLogLikelihood - newBaseLogLikelihood;
                     localBaseLogLikelihoods[toId] = newBaseLogLikelihood;
-                  }
+                  TM_END();
                   break;
                 }
 #endif /* LEARNER_TRY_REVERSE */
@@ -1454,18 +1462,22 @@ learnStructure (void* argPtr)
         float baseLogLikelihood;
         long numTotalParent;
 
-        __transaction_atomic {
+        TM_BEGIN("learner_updateBaseLogLikelihood");
           float oldBaseLogLikelihood = learnerPtr->baseLogLikelihood;
           float newBaseLogLikelihood = oldBaseLogLikelihood + deltaLogLikelihood;
           learnerPtr->baseLogLikelihood = newBaseLogLikelihood;
           baseLogLikelihood = newBaseLogLikelihood;
           numTotalParent = learnerPtr->numTotalParent;
-        }
+        TM_END();
+
+        timer_phaseEnd("learn_applyTask");
 
         /*
          * Find next task
          */
 
+        timer_phaseBegin("learn_findBestTask");
+
         float baseScore = ((float)numTotalParent * basePenalty)
                            + (numRecord * baseLogLikelihood);
 
@@ -1482,9 +1494,9 @@ learnStructure (void* argPtr)
         arg.basePenalty       = basePenalty;
         arg.baseLogLikelihood = baseLogLikelihood;
 
-        __transaction_atomic {
+        TM_BEGIN("learner_findBestInsertTask");
           TMfindBestInsertTask(&newTask, &arg);
-        }
+        TM_END();
 
         if ((newTask.fromId != newTask.toId) &&
             (newTask.score > (bestTask.score / operationQualityFactor)))
@@ -1493,9 +1505,9 @@ learnStructure (void* argPtr)
         }
 
 #ifdef LEARNER_TRY_REMOVE
-        __transaction_atomic {
+        TM_BEGIN("learner_findBestRemoveTask");
           TMfindBestRemoveTask(&newTask, &arg);
-        }
+        TM_END();
 
         if ((newTask.fromId != newTask.toId) &&
             (newTask.score > (bestTask.score / operationQualityFactor)))
@@ -1507,9 +1519,9 @@ learnStructure (void* argPtr)
 
 #ifdef LEARNER_TRY_REVERSE
         //[wer210] used to have problems, fixed(log, qsort)
-        __transaction_atomic {
+        TM_BEGIN("learner_findBestReverseTask");
           TMfindBestReverseTask(&newTask, &arg);
-        }
+        TM_END();
 
         if ((newTask.fromId != newTask.toId) &&
             (newTask.score > (bestTask.score / operationQualityFactor)))
@@ -1522,9 +1534,9 @@ learnStructure (void* argPtr)
         if (bestTask.toId != -1) {
             learner_task_t* tasks = learnerPtr->tasks;
             tasks[toId] = bestTask;
-            __transaction_atomic {
+            TM_BEGIN("learner_insertTask");
               TMLIST_INSERT(taskListPtr, (void*)&tasks[toId]);
-            }
+            TM_END();
 
 #ifdef TEST_LEARNER
             printf("[new]  op=%i from=%li to=%li score=%lf\n",
@@ -1533,6 +1545,8 @@ learnStructure (void* argPtr)
 #endif
         }
 
+        timer_phaseEnd("learn_findBestTask");
+
     } /* while (tasks) */
 
     TMBITMAP_FREE(visitedBitmapPtr);
@@ -1542,6 +1556,8 @@ learnStructure (void* argPtr)
     PVECTOR_FREE(queryVectorPtr);
     PVECTOR_FREE(parentQueryVectorPtr);
     free(queries);
+
+    timer_phaseEnd("learnStructure");
 }
 
 
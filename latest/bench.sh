@@ -0,0 +1,140 @@
+#!/bin/bash
+#
+# bench.sh -- run the STAMP benchmarks over a sweep of thread counts and
+# libitm methods, and write the timings as CSV and JSON.
+#
+# Every run's "Time = " line is collected; for each (benchmark, method,
+# threads) the mean, sample stddev, min, max and the speedup of the mean
+# over the 1-thread mean of the same benchmark and method are reported.
+#
+# Usage: ./bench.sh [options]   (or: make bench BENCH_ARGS="...")
+#
+#   -b "<benchmarks>"  benchmarks to run         (all eight)
+#   -t "<threads>"     thread counts             ("1 2 4 8")
+#   -m "<methods>"     ITM_DEFAULT_METHOD values ("ml_wt gl_wt serialirr")
+#   -r <n>             repeats per configuration (3)
+#   -i small|large     input set                 (small)
+#   -d <dir>           build directory           (obj); obj-stm is the
+#                      built-in STM (make TMBACKEND=stm), which ignores -m
+#   -o <prefix>        writes <prefix>.csv and <prefix>.json (bench)
+#
+
+cd "$(dirname "$0")" || exit 1
+
+BENCHS="bayes genome intruder kmeans labyrinth ssca2 vacation yada"
+THREADS="1 2 4 8"
+METHODS="ml_wt gl_wt serialirr"
+REPEATS=3
+INPUT=small
+BUILD=obj
+OUT=bench
+
+usage () {
+    sed -n '2,/^$/s/^# \{0,1\}//p' "$0"
+    exit 1
+}
+
+while getopts "b:t:m:r:i:d:o:h" opt; do
+    case $opt in
+        b) BENCHS=$OPTARG ;;
+        t) THREADS=$OPTARG ;;
+        m) METHODS=$OPTARG ;;
+        r) REPEATS=$OPTARG ;;
+        i) INPUT=$OPTARG ;;
+        d) BUILD=$OPTARG ;;
+        o) OUT=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+
+# Arguments for each benchmark, without -t; "large" matches validate.sh
+args () {
+    case $INPUT/$1 in
+        small/bayes)     echo "-v32 -r1024 -n2 -p20 -s0 -i2 -e2" ;;
+        small/genome)    echo "-g256 -s16 -n16384" ;;
+        small/intruder)  echo "-a10 -l16 -n4096 -s1" ;;
+        small/kmeans)    echo "-m15 -n15 -T0.00001 -i ../inputs/kmeans/random-n2048-d16-c16.txt" ;;
+        small/labyrinth) echo "-i ../inputs/labyrinth/random-x32-y32-z3-n96.txt" ;;
+        small/ssca2)     echo "-s13 -i1.0 -u1.0 -l3 -p3" ;;
+        small/vacation)  echo "-n2 -q90 -u98 -r16384 -T4096" ;;
+        small/yada)      echo "-a20 -i ../inputs/yada/633.2" ;;
+        large/bayes)     echo "-v32 -r4096 -n10 -p40 -i2 -e8 -s1" ;;
+        large/genome)    echo "-s64 -g16384 -n16777216" ;;
+        large/intruder)  echo "-a10 -l128 -n262144 -s1" ;;
+        large/kmeans)    echo "-m40 -n40 -T0.00001 -i ../inputs/kmeans/random-n65536-d32-c16.txt" ;;
+        large/labyrinth) echo "-i ../inputs/labyrinth/random-x512-y512-z7-n512.txt" ;;
+        large/ssca2)     echo "-s20 -i1.0 -u1.0 -l3 -p3" ;;
+        large/vacation)  echo "-n2 -q90 -u98 -r1048576 -T4194304" ;;
+        large/yada)      echo "-a15 -i ../inputs/yada/ttimeu1000000.2" ;;
+        *) echo "unknown benchmark or input set: $INPUT/$1" >&2; exit 1 ;;
+    esac
+}
+
+RAW=$(mktemp)
+trap 'rm -f "$RAW"' EXIT
+
+status=0
+for b in $BENCHS; do
+    prog=./$BUILD/$b/$b
+    if [ ! -x "$prog" ]; then
+        echo "$prog not found; run make first" >&2
+        exit 1
+    fi
+    a=$(args "$b") || exit 1
+    for m in $METHODS; do
+        for t in $THREADS; do
+            for r in $(seq "$REPEATS"); do
+                out=$(ITM_DEFAULT_METHOD=$m $prog $a -t$t 2>&1)
+                rc=$?
+                time=$(echo "$out" | sed -n 's/^Time *= *\([0-9.eE+-]*\).*/\1/p' | tail -1)
+                if [ $rc -ne 0 ] || [ -z "$time" ]; then
+                    echo "FAILED: ITM_DEFAULT_METHOD=$m $prog $a -t$t (exit $rc)" >&2
+                    echo "$out" | tail -5 >&2
+                    status=1
+                    continue
+                fi
+                printf "%-10s %-10s t=%-3s #%-3s %s\n" "$b" "$m" "$t" "$r" "$time"
+                echo "$b,$m,$t,$time" >> "$RAW"
+            done
+        done
+    done
+done
+
+# Aggregate: benchmark,method,threads,runs,mean,stddev,min,max,speedup
+awk -F, -v csv="$OUT.csv" -v json="$OUT.json" '
+    {
+        k = $1 "," $2 "," $3
+        if (!(k in n)) { keys[++numKey] = k; min[k] = $4; max[k] = $4 }
+        n[k]++; sum[k] += $4; sq[k] += $4 * $4
+        if ($4 < min[k]) min[k] = $4
+        if ($4 > max[k]) max[k] = $4
+    }
+    END {
+        print "benchmark,method,threads,runs,mean,stddev,min,max,speedup" > csv
+        print "[" > json
+        for (i = 1; i <= numKey; i++) {
+            k = keys[i]
+            split(k, f, ",")
+            mean = sum[k] / n[k]
+            var = (n[k] > 1) ? (sq[k] - n[k] * mean * mean) / (n[k] - 1) : 0
+            sd = (var > 0) ? sqrt(var) : 0
+            base = f[1] "," f[2] ",1"
+            speedup = (base in n && mean > 0) ? sprintf("%.3f", (sum[base] / n[base]) / mean) : ""
+            printf "%s,%d,%.6f,%.6f,%.6f,%.6f,%s\n", k, n[k], mean, sd, min[k], max[k], speedup > csv
+            printf "  {\"benchmark\": \"%s\", \"method\": \"%s\", \"threads\": %d, \"runs\": %d, " \
+                   "\"mean\": %.6f, \"stddev\": %.6f, \"min\": %.6f, \"max\": %.6f, \"speedup\": %s}%s\n",
+                   f[1], f[2], f[3], n[k], mean, sd, min[k], max[k],
+                   (speedup == "" ? "null" : speedup), (i < numKey ? "," : "") > json
+        }
+        print "]" > json
+    }' "$RAW"
+
+echo
+if command -v column > /dev/null; then
+    column -t -s, "$OUT.csv"
+else
+    cat "$OUT.csv"
+fi
+echo "Wrote $OUT.csv and $OUT.json"
+
+exit $status
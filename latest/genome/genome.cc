@@ -232,6 +232,7 @@ int main (int argc, char** argv)
     TIMER_READ(stop);
     puts("done.");
     printf("Time = %lf\n", TIMER_DIFF_SECONDS(start, stop));
+    timer_phasePrint();
     fflush(stdout);
 
     /* Check result */
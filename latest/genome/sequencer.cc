@@ -86,6 +86,8 @@
 #include "sequencer.h"
 #include "table.h"
 #include "thread.h"
+#include "timer.h"
+#include "tm.h"
 #include "utility.h"
 #include "vector.h"
 #include "tm_transition.h"
@@ -229,7 +231,7 @@ sequencer_alloc (long geneLength, long segmentLength, segments_t* segmentsPtr)
     }
 
     sequencerPtr->uniqueSegmentsPtr =
-        TMhashtable_alloc(geneLength, &hashSegment, &compareSegment, -1, -1);
+        SEGMENT_MAP_ALLOC(geneLength);
     if (sequencerPtr->uniqueSegmentsPtr == NULL) {
         return NULL;
     }
@@ -295,7 +297,7 @@ sequencer_run (void* argPtr)
 
     sequencer_t* sequencerPtr = (sequencer_t*)argPtr;
 
-    hashtable_t*      uniqueSegmentsPtr;
+    segment_map_t*    uniqueSegmentsPtr;
     endInfoEntry_t*   endInfoEntries;
     table_t**         startHashToConstructEntryTables;
     constructEntry_t* constructEntries;
@@ -324,6 +326,7 @@ sequencer_run (void* argPtr)
     /*
      * Step 1: Remove duplicate segments
      */
+    timer_phaseBegin("step1");
     long numThread = thread_getNumThread();
     {
         /* Choose disjoint segments [i_start,i_stop) for each thread */
@@ -337,18 +340,19 @@ sequencer_run (void* argPtr)
     }
 
     for (i = i_start; i < i_stop; i+=CHUNK_STEP1) {
-      __transaction_atomic {
+      TM_BEGIN("sequencer_dedupSegments");
         {
           long ii;
           long ii_stop = MIN(i_stop, (i+CHUNK_STEP1));
           for (ii = i; ii < ii_stop; ii++) {
             void* segment = vector_at(segmentsContentsPtr, ii);
-            TMHASHTABLE_INSERT(uniqueSegmentsPtr, segment, segment);
+            TMSEGMENT_MAP_INSERT(uniqueSegmentsPtr, segment);
           } /* ii */
         }
-      }
+      TM_END();
     }
 
+    timer_phaseEnd("step1");
     thread_barrier_wait();
 
     /*
@@ -371,13 +375,15 @@ sequencer_run (void* argPtr)
      *     a[tcg] + [tcg]g  = a[tcg]g    (overlap = "tcg")
      */
 
+    timer_phaseBegin("step2a");
+
     /* uniqueSegmentsPtr is constant now */
-    numUniqueSegment = TMhashtable_getSize(uniqueSegmentsPtr);
+    numUniqueSegment = SEGMENT_MAP_GETSIZE(uniqueSegmentsPtr);
     entryIndex = 0;
 
     {
         /* Choose disjoint segments [i_start,i_stop) for each thread */
-        long num = uniqueSegmentsPtr->numBucket;
+        long num = SEGMENT_MAP_GETNUMCHAIN(uniqueSegmentsPtr); /* with any old buckets */
         long partitionSize = (num + numThread/2) / numThread; /* with rounding */
         i_start = threadId * partitionSize;
         if (threadId == (numThread - 1)) {
@@ -394,27 +400,38 @@ sequencer_run (void* argPtr)
 
     for (i = i_start; i < i_stop; i++) {
 
-        list_t* chainPtr = uniqueSegmentsPtr->buckets[i];
-        list_iter_t it;
+#ifdef USE_TM_TEMPLATES
+        for (segment_map_t::node_t* nodePtr = uniqueSegmentsPtr->buckets[i];
+             nodePtr != NULL;
+             nodePtr = nodePtr->nextPtr)
+        {
+            char* segment = nodePtr->key;
+#else
+        smalllist_t* chainPtr = TMhashtable_getChain(uniqueSegmentsPtr, i);
+        if (chainPtr == NULL) {
+            continue; /* an old bucket already moved */
+        }
+        smalllist_iter_t it;
         list_iter_reset(&it, chainPtr);
 
         while (list_iter_hasNext(&it)) {
 
             char* segment =
                 (char*)((pair_t*)list_iter_next(&it))->firstPtr;
+#endif
             constructEntry_t* constructEntryPtr;
             long j;
             unsigned long startHash;
             bool status;
 
             /* Find an empty constructEntries entry */
-            __transaction_atomic {
+            TM_BEGIN("sequencer_claimConstructEntry");
               while (((void*)constructEntries[entryIndex].segment) != NULL) {
                 entryIndex = (entryIndex + 1) % numUniqueSegment; /* look for empty */
               }
               constructEntryPtr = &constructEntries[entryIndex];
               constructEntryPtr->segment = segment;
-            }
+            TM_END();
             entryIndex = (entryIndex + 1) % numUniqueSegment;
 
             /*
@@ -434,11 +451,11 @@ sequencer_run (void* argPtr)
             for (j = 1; j < segmentLength; j++) {
                 startHash = (unsigned long)segment[j-1] +
                             (startHash << 6) + (startHash << 16) - startHash;
-                __transaction_atomic {
+                TM_BEGIN("sequencer_insertStartHash");
                   status = TMTABLE_INSERT(startHashToConstructEntryTables[j],
                                           (unsigned long)startHash,
                                           (void*)constructEntryPtr );
-                }
+                TM_END();
                 assert(status);
             }
 
@@ -447,15 +464,16 @@ sequencer_run (void* argPtr)
              */
             startHash = (unsigned long)segment[j-1] +
                         (startHash << 6) + (startHash << 16) - startHash;
-            __transaction_atomic {
+            TM_BEGIN("sequencer_insertEndHash");
               status = TMTABLE_INSERT(hashToConstructEntryTable,
                                       (unsigned long)startHash,
                                       (void*)constructEntryPtr);
-            }
+            TM_END();
             assert(status);
         }
     }
 
+    timer_phaseEnd("step2a");
     thread_barrier_wait();
 
     /*
@@ -463,6 +481,8 @@ sequencer_run (void* argPtr)
      */
     for (substringLength = segmentLength-1; substringLength > 0; substringLength--) {
 
+        timer_phaseBegin("step2b");
+
         table_t* startHashToConstructEntryTablePtr =
             startHashToConstructEntryTables[substringLength];
         list_t** buckets = startHashToConstructEntryTablePtr->buckets;
@@ -510,7 +530,7 @@ sequencer_run (void* argPtr)
                 long newLength = 0;
 
                 /* endConstructEntryPtr is local except for properties startPtr/endPtr/length */
-                __transaction_atomic {
+                TM_BEGIN("sequencer_matchSegments");
                   /* Check if matches */
                   if (startConstructEntryPtr->isStart &&
                       (endConstructEntryPtr->startPtr != startConstructEntryPtr) &&
@@ -543,7 +563,7 @@ sequencer_run (void* argPtr)
                     endConstructEntry_startPtr->length = newLength;
                   } /* if (matched) */
 
-                } // TM_END
+                TM_END();
 
                 /* if there was a match */
                 if (!endInfoEntries[entryIndex].isEnd)
@@ -553,6 +573,7 @@ sequencer_run (void* argPtr)
 
         } /* for (endIndex < numUniqueSegment) */
 
+        timer_phaseEnd("step2b");
         thread_barrier_wait();
 
         /*
@@ -565,6 +586,7 @@ sequencer_run (void* argPtr)
 .        */
 
         if (threadId == 0) {
+            timer_phaseBegin("step2c");
             if (substringLength > 1) {
                 long index = segmentLength - substringLength + 1;
                 /* initialization if j and i: with i being the next end after j=0 */
@@ -590,6 +612,7 @@ sequencer_run (void* argPtr)
                 }
                 endInfoEntries[j].jumpToNext = i - j;
             }
+            timer_phaseEnd("step2c");
         }
 
         thread_barrier_wait();
@@ -604,6 +627,8 @@ sequencer_run (void* argPtr)
      */
     if (threadId == 0) {
 
+        timer_phaseBegin("step3");
+
         long totalLength = 0;
 
         for (i = 0; i < numUniqueSegment; i++) {
@@ -645,6 +670,8 @@ sequencer_run (void* argPtr)
 
         assert(sequence != NULL);
         sequence[sequenceLength] = '\0';
+
+        timer_phaseEnd("step3");
     }
 
 }
@@ -667,7 +694,7 @@ sequencer_free (sequencer_t* sequencerPtr)
     free(sequencerPtr->startHashToConstructEntryTables);
     free(sequencerPtr->endInfoEntries);
     /* TODO: fix mixed sequential/parallel allocation */
-    TMhashtable_free(sequencerPtr->uniqueSegmentsPtr);
+    SEGMENT_MAP_FREE(sequencerPtr->uniqueSegmentsPtr);
     if (sequencerPtr->sequence != NULL) {
         free(sequencerPtr->sequence);
     }
@@ -74,6 +74,44 @@
 #include "segments.h"
 #include "table.h"
 
+#ifdef USE_TM_TEMPLATES
+#  include "tmhashmap.h"
+
+__attribute__((transaction_safe))
+unsigned long
+hashSegment (const void* keyPtr);
+
+struct segment_hash {
+    __attribute__((transaction_safe))
+    unsigned long operator() (const char* segment) const {
+        return hashSegment(segment);
+    }
+};
+struct segment_eq {
+    __attribute__((transaction_safe))
+    bool operator() (const char* a, const char* b) const {
+        while (*a != '\0' && *a == *b) {
+            a++;
+            b++;
+        }
+        return (*a == *b);
+    }
+};
+typedef tmlib::hashmap<char*, char*, segment_hash, segment_eq> segment_map_t;
+#  define SEGMENT_MAP_ALLOC(n)          segment_map_t::alloc(n)
+#  define SEGMENT_MAP_FREE(m)           segment_map_t::free(m)
+#  define SEGMENT_MAP_GETSIZE(m)        (m)->getSize()
+#  define SEGMENT_MAP_GETNUMCHAIN(m)    ((m)->numBucket)
+#  define TMSEGMENT_MAP_INSERT(m, s)    (m)->insert((char*)(s), (char*)(s))
+#else
+typedef hashtable_t segment_map_t;
+#  define SEGMENT_MAP_ALLOC(n)          TMhashtable_alloc(n, &hashSegment, &compareSegment, -1, -1)
+#  define SEGMENT_MAP_FREE(m)           TMhashtable_free(m)
+#  define SEGMENT_MAP_GETSIZE(m)        TMhashtable_getSize(m)
+#  define SEGMENT_MAP_GETNUMCHAIN(m)    TMhashtable_getNumChain(m)
+#  define TMSEGMENT_MAP_INSERT(m, s)    TMHASHTABLE_INSERT(m, s, s)
+#endif
+
 struct endInfoEntry_t;
 struct constructEntry_t;
 
@@ -89,7 +127,7 @@ struct sequencer_t {
     segments_t* segmentsPtr;
 
     /* For removing duplicate segments */
-    hashtable_t* uniqueSegmentsPtr;
+    segment_map_t* uniqueSegmentsPtr;
 
     /* For matching segments */
     endInfoEntry_t* endInfoEntries;
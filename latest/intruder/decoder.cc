@@ -75,6 +75,7 @@
 #include "error.h"
 #include "list.h"
 #include "map.h"
+#include "memory.h"
 #include "packet.h"
 #include "queue.h"
 #include "tm_transition.h"
@@ -252,7 +253,7 @@ TMdecoder_process (  decoder_t* decoderPtr, char* bytes, long numByte)
             i++;
           }
 
-          char* data = (char*)malloc(numByte + 1);
+          char* data = (char*)memory_alloc(numByte + 1);
           assert(data);
           data[numByte] = '\0';
           char* dst = data;
@@ -276,7 +277,7 @@ TMdecoder_process (  decoder_t* decoderPtr, char* bytes, long numByte)
           }
           assert(dst == data + numByte);
 
-          decoded_t* decodedPtr = (decoded_t*)malloc(sizeof(decoded_t));
+          decoded_t* decodedPtr = (decoded_t*)memory_alloc(sizeof(decoded_t));
           assert(decodedPtr);
           decodedPtr->flowId = flowId;
           decodedPtr->data = data;
@@ -300,12 +301,12 @@ TMdecoder_process (  decoder_t* decoderPtr, char* bytes, long numByte)
           return ERROR_FRAGMENTID;
         }
 
-        char* data = (char*)malloc(length + 1);
+        char* data = (char*)memory_alloc(length + 1);
         assert(data);
         data[length] = '\0';
         memcpy(data, packetPtr->data, length);
 
-        decoded_t* decodedPtr = (decoded_t*)malloc(sizeof(decoded_t));
+        decoded_t* decodedPtr = (decoded_t*)memory_alloc(sizeof(decoded_t));
         assert(decodedPtr);
         decodedPtr->flowId = flowId;
         decodedPtr->data = data;
@@ -335,7 +336,7 @@ TMdecoder_getComplete (  decoder_t* decoderPtr, long* decodedFlowIdPtr)
     if (decodedPtr) {
         *decodedFlowIdPtr = decodedPtr->flowId;
         data = decodedPtr->data;
-        free(decodedPtr);
+        memory_free(decodedPtr);
     } else {
         *decodedFlowIdPtr = -1;
         data = NULL;
@@ -428,14 +429,14 @@ main ()
     assert(TMdecoder_process(decoderPtr, abcBytes, numPacketByte) == ERROR_NONE);
     char* str = TMdecoder_getComplete(decoderPtr, &flowId);
     assert(strcmp(str, "abcdef") == 0);
-    free(str);
+    memory_free(str);
     assert(flowId == 1);
 
     abcPacketPtr->numFragment = 1;
     assert(TMdecoder_process(decoderPtr, abcBytes, numPacketByte) == ERROR_NONE);
     str = TMdecoder_getComplete(decoderPtr, &flowId);
     assert(strcmp(str, "abc") == 0);
-    free(str);
+    memory_free(str);
     abcPacketPtr->numFragment = 2;
     assert(flowId == 1);
 
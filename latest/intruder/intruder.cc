@@ -76,10 +76,12 @@
 #include "decoder.h"
 #include "detector.h"
 #include "dictionary.h"
+#include "memory.h"
 #include "packet.h"
 #include "stream.h"
 #include "thread.h"
 #include "timer.h"
+#include "tm.h"
 
 __attribute__ ((transaction_pure))
 void TMprint(char* s)
@@ -122,6 +124,17 @@ typedef struct arg {
     vector_t** errorVectors;
 } arg_t;
 
+typedef struct process_local {
+    decoder_t*  decoderPtr;
+    detector_t* detectorPtr;
+    vector_t*   errorVectorPtr;
+} process_local_t;
+
+#ifdef USE_TASKS
+/* Per-thread state of the thread currently running processPackets() */
+static __thread process_local_t* process_myLocalPtr;
+#endif
+
 
 /* =============================================================================
  * displayUsage
@@ -181,74 +194,120 @@ parseArgs (long argc, char* const argv[])
 
 
 /* =============================================================================
- * processPackets
+ * processPacket
  * =============================================================================
  */
 static void
-processPackets (void* argPtr)
+processPacket (process_local_t* localPtr, char* bytes)
 {
+    decoder_t*  decoderPtr     = localPtr->decoderPtr;
+    detector_t* detectorPtr    = localPtr->detectorPtr;
+    vector_t*   errorVectorPtr = localPtr->errorVectorPtr;
+
+    packet_t* packetPtr = (packet_t*)bytes;
+    long flowId = packetPtr->flowId;
+
+    int_error_t error;
+    TM_BEGIN("intruder_decoderProcess");
+      error = TMDECODER_PROCESS(decoderPtr,
+                                bytes,
+                                (PACKET_HEADER_LENGTH + packetPtr->length));
+    TM_END();
+    //TMprint("2.\n");
+    if (error) {
+        /*
+         * Currently, stream_generate() does not create these errors.
+         */
+        assert(0);
+        bool status = PVECTOR_PUSHBACK(errorVectorPtr, (void*)flowId);
+        assert(status);
+    }
 
-    long threadId = thread_getId();
+    char* data;
+    long decodedFlowId;
+    TM_BEGIN("intruder_decoderGetComplete");
+      data = TMDECODER_GETCOMPLETE(decoderPtr, &decodedFlowId);
+    TM_END();
+    //TMprint("3.\n");
+    if (data) {
+        int_error_t error = PDETECTOR_PROCESS(detectorPtr, data);
+        memory_free(data);
+        if (error) {
+            bool status = PVECTOR_PUSHBACK(errorVectorPtr,
+                                             (void*)decodedFlowId);
+            assert(status);
+        }
+    }
+}
 
-    stream_t*   streamPtr    = ((arg_t*)argPtr)->streamPtr;
-    decoder_t*  decoderPtr   = ((arg_t*)argPtr)->decoderPtr;
-    vector_t**  errorVectors = ((arg_t*)argPtr)->errorVectors;
 
-    detector_t* detectorPtr = PDETECTOR_ALLOC();
-    assert(detectorPtr);
-    PDETECTOR_ADDPREPROCESSOR(detectorPtr, &preprocessor_toLower);
+#ifdef USE_TASKS
+/* =============================================================================
+ * processPacketTask
+ * =============================================================================
+ */
+static void
+processPacketTask (void* argPtr)
+{
+    processPacket(process_myLocalPtr, (char*)argPtr);
+}
+
+
+/* =============================================================================
+ * spawnPacketTasks
+ * -- Drains the stream into one task per packet; returns number of tasks
+ * =============================================================================
+ */
+static long
+spawnPacketTasks (stream_t* streamPtr)
+{
+    long numTask = 0;
+    char* bytes;
 
-    vector_t* errorVectorPtr = errorVectors[threadId];
+    while ((bytes = stream_getPacket(streamPtr))) {
+        thread_spawnTask(&processPacketTask, (void*)bytes);
+        numTask++;
+    }
 
-    while (1) {
+    return numTask;
+}
+#endif /* USE_TASKS */
 
-        char* bytes;
-        __transaction_atomic {
-          //[wer210] TMQUEUE_POP(streamPtr->packetQueuePtr);
-          bytes = TMSTREAM_GETPACKET(streamPtr);
-        }
-        if (!bytes) {
-            break;
-        }
 
-        packet_t* packetPtr = (packet_t*)bytes;
-        long flowId = packetPtr->flowId;
+/* =============================================================================
+ * processPackets
+ * =============================================================================
+ */
+static void
+processPackets (void* argPtr)
+{
 
-        int_error_t error;
-        __transaction_atomic {
-          error = TMDECODER_PROCESS(decoderPtr,
-                                    bytes,
-                                    (PACKET_HEADER_LENGTH + packetPtr->length));
-        }
-        //TMprint("2.\n");
-        if (error) {
-            /*
-             * Currently, stream_generate() does not create these errors.
-             */
-            assert(0);
-            bool status = PVECTOR_PUSHBACK(errorVectorPtr, (void*)flowId);
-            assert(status);
-        }
+    long threadId = thread_getId();
 
-        char* data;
-        long decodedFlowId;
-        __transaction_atomic {
-          data = TMDECODER_GETCOMPLETE(decoderPtr, &decodedFlowId);
-        }
-        //TMprint("3.\n");
-        if (data) {
-            int_error_t error = PDETECTOR_PROCESS(detectorPtr, data);
-            free(data);
-            if (error) {
-                bool status = PVECTOR_PUSHBACK(errorVectorPtr,
-                                                 (void*)decodedFlowId);
-                assert(status);
-            }
-        }
+    stream_t*   streamPtr    = ((arg_t*)argPtr)->streamPtr;
+    vector_t**  errorVectors = ((arg_t*)argPtr)->errorVectors;
 
+    process_local_t local;
+    local.decoderPtr     = ((arg_t*)argPtr)->decoderPtr;
+    local.errorVectorPtr = errorVectors[threadId];
+    local.detectorPtr    = PDETECTOR_ALLOC();
+    assert(local.detectorPtr);
+    PDETECTOR_ADDPREPROCESSOR(local.detectorPtr, &preprocessor_toLower);
+
+#ifdef USE_TASKS
+    (void)streamPtr; /* packets were handed out as tasks */
+    process_myLocalPtr = &local;
+    thread_waitAll();
+    process_myLocalPtr = NULL;
+#else
+    /* The packet queue is only drained, so popping needs no transaction */
+    char* bytes;
+    while ((bytes = stream_getPacket(streamPtr))) {
+        processPacket(&local, bytes);
     }
+#endif /* USE_TASKS */
 
-    PDETECTOR_FREE(detectorPtr);
+    PDETECTOR_FREE(local.detectorPtr);
 }
 
 
@@ -311,6 +370,9 @@ int main (int argc, char** argv)
     TIMER_T startTime;
     TIMER_READ(startTime);
 
+#ifdef USE_TASKS
+    spawnPacketTasks(streamPtr);
+#endif
 #ifdef OTM
 #pragma omp parallel
     {
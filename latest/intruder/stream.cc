@@ -77,6 +77,7 @@
 #include "detector.h"
 #include "dictionary.h"
 #include "map.h"
+#include "mpmcqueue.h"
 #include "packet.h"
 #include "queue.h"
 #include "stream.h"
@@ -87,7 +88,7 @@ struct stream_t {
     long percentAttack;
     std::mt19937* randomPtr;
     vector_t* allocVectorPtr;
-    queue_t* packetQueuePtr;
+    mpmcqueue_t* packetQueuePtr;
     MAP_T* attackMapPtr;
 };
 
@@ -109,7 +110,7 @@ stream_alloc (long percentAttack)
         assert(streamPtr->randomPtr);
         streamPtr->allocVectorPtr = vector_alloc(1);
         assert(streamPtr->allocVectorPtr);
-        streamPtr->packetQueuePtr = queue_alloc(-1);
+        streamPtr->packetQueuePtr = mpmcqueue_alloc(1);
         assert(streamPtr->packetQueuePtr);
         streamPtr->attackMapPtr = MAP_ALLOC(NULL, NULL);
         assert(streamPtr->attackMapPtr);
@@ -136,7 +137,7 @@ stream_free (stream_t* streamPtr)
     }
 
     MAP_FREE(streamPtr->attackMapPtr);
-    queue_free(streamPtr->packetQueuePtr);
+    mpmcqueue_free(streamPtr->packetQueuePtr);
     vector_free(streamPtr->allocVectorPtr);
     delete streamPtr->randomPtr;
     free(streamPtr);
@@ -147,9 +148,10 @@ stream_free (stream_t* streamPtr)
  * splitIntoPackets
  * -- Packets will be equal-size chunks except for last one, which will have
  *    all extra bytes
+ * -- Returns the number of packets
  * =============================================================================
  */
-static void
+static long
 splitIntoPackets (char* str,
                   long flowId,
                   std::mt19937* randomPtr,
@@ -192,6 +194,8 @@ splitIntoPackets (char* str,
     memcpy(packetPtr->data, (str + p * numDataByte), lastNumDataByte);
     status = queue_push(packetQueuePtr, (void*)packetPtr);
     assert(status);
+
+    return numPacket;
 }
 
 
@@ -212,7 +216,6 @@ stream_generate (stream_t* streamPtr,
     long      percentAttack  = streamPtr->percentAttack;
     std::mt19937* randomPtr      = streamPtr->randomPtr;
     vector_t* allocVectorPtr = streamPtr->allocVectorPtr;
-    queue_t*  packetQueuePtr = streamPtr->packetQueuePtr;
     MAP_T*    attackMapPtr   = streamPtr->attackMapPtr;
 
     detector_t* detectorPtr = detector_alloc();
@@ -220,7 +223,9 @@ stream_generate (stream_t* streamPtr,
     detector_addPreprocessor(detectorPtr, &preprocessor_toLower);
 
     randomPtr->seed(seed);
-    queue_clear(packetQueuePtr);
+    queue_t* packetQueuePtr = queue_alloc(-1);
+    assert(packetQueuePtr);
+    long numPacket = 0;
 
     long range = '~' - ' ' + 1;
     assert(range > 0);
@@ -262,11 +267,25 @@ stream_generate (stream_t* streamPtr,
             }
             free(str2);
         }
-        splitIntoPackets(str, f, randomPtr, allocVectorPtr, packetQueuePtr);
+        numPacket +=
+            splitIntoPackets(str, f, randomPtr, allocVectorPtr, packetQueuePtr);
     }
 
     queue_shuffle(packetQueuePtr, randomPtr);
 
+    /*
+     * Hand the shuffled packets to the queue the threads drain
+     */
+    mpmcqueue_free(streamPtr->packetQueuePtr);
+    streamPtr->packetQueuePtr = mpmcqueue_alloc(numPacket);
+    assert(streamPtr->packetQueuePtr);
+    void* packetPtr;
+    while ((packetPtr = queue_pop(packetQueuePtr))) {
+        bool status = mpmcqueue_push(streamPtr->packetQueuePtr, packetPtr);
+        assert(status);
+    }
+    queue_free(packetQueuePtr);
+
     detector_free(detectorPtr);
 
     return numAttack;
@@ -277,13 +296,13 @@ stream_generate (stream_t* streamPtr,
 /* =============================================================================
  * stream_getPacket
  * -- If none, returns NULL
+ * -- Lock-free; must not be called inside a transaction
  * =============================================================================
  */
-__attribute__((transaction_safe))
 char*
 stream_getPacket (stream_t* streamPtr)
 {
-    return (char*)TMQUEUE_POP(streamPtr->packetQueuePtr);
+    return (char*)mpmcqueue_pop(streamPtr->packetQueuePtr);
 }
 
 
@@ -108,9 +108,9 @@ stream_generate (stream_t* streamPtr,
 /* =============================================================================
  * stream_getPacket
  * -- If none, returns NULL
+ * -- Lock-free; must not be called inside a transaction
  * =============================================================================
  */
-__attribute__((transaction_safe))
 char*
 stream_getPacket (stream_t* streamPtr);
 
@@ -121,6 +121,3 @@ stream_getPacket (stream_t* streamPtr);
  */
 bool
 stream_isAttack (stream_t* streamPtr, long flowId);
-
-
-#define TMSTREAM_GETPACKET(s)           stream_getPacket( s)
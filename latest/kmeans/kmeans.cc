@@ -273,6 +273,9 @@ int main (int argc, char** argv)
 
     thread_startup(nthreads);
 
+    /* Place feature pages by first touch before the data is copied in */
+    thread_memset(attributes[0], 0, (numObjects * numAttributes * sizeof(float)));
+
     /*
      * The core of the clustering
      */
@@ -91,6 +91,7 @@
 #include "normal.h"
 #include "thread.h"
 #include "timer.h"
+#include "tm.h"
 #include "util.h"
 
 double global_time = 0.0;
@@ -102,7 +103,7 @@ typedef struct args {
     int     nclusters;
     int*    membership;
     float** clusters;
-    long**   new_centers_len;
+    long*   new_centers_len;
     float** new_centers;
 } args_t;
 
@@ -126,9 +127,11 @@ work (void* argPtr)
     int     nclusters       = args->nclusters;
     int*    membership      = args->membership;
     float** clusters        = args->clusters;
-    long**  new_centers_len = args->new_centers_len;
+    long*   new_centers_len = args->new_centers_len;
     float** new_centers     = args->new_centers;
     float delta = 0.0;
+    long* local_len;
+    float* local_centers;
     int index;
     int i;
     int j;
@@ -138,6 +141,11 @@ work (void* argPtr)
 
     myId = thread_getId();
 
+    /* Partial sums of this thread, combined in thread_reduceArray below */
+    local_len = (long*)calloc(nclusters, sizeof(long));
+    local_centers = (float*)calloc(nclusters * nfeatures, sizeof(float));
+    assert(local_len && local_centers);
+
     start = myId * CHUNK;
 
     while (start < npoints) {
@@ -162,31 +170,32 @@ work (void* argPtr)
 
 
             /* Update new cluster centers : sum of objects located within */
-            __transaction_atomic {
-                *new_centers_len[index] =
-                              *new_centers_len[index] + 1;
-              for (j = 0; j < nfeatures; j++) {
-                new_centers[index][j] += feature[i][j];
-              }
+            local_len[index]++;
+            for (j = 0; j < nfeatures; j++) {
+                local_centers[index * nfeatures + j] += feature[i][j];
             }
         }
 
         /* Update task queue */
         if (start + CHUNK < npoints) {
-          __transaction_atomic {
+          TM_BEGIN("normal_grabChunk");
             start = (int)global_i;
             global_i = (long)(start + CHUNK);
-          }
+          TM_END();
         } else {
             break;
         }
     }
 
-    __transaction_atomic {
-        global_delta = global_delta + delta;
-    }
-
+    thread_reduceArray_sum(local_len, new_centers_len, nclusters);
+    thread_reduceArray_sum(local_centers, new_centers[0], nclusters * nfeatures);
+    free(local_len);
+    free(local_centers);
 
+    delta = thread_reduce_sum(delta);
+    if (myId == 0) {
+        global_delta = delta;
+    }
 }
 
 
@@ -207,11 +216,10 @@ normal_exec (int       nthreads,
     int i;
     int j;
     int loop = 0;
-    long** new_centers_len; /* [nclusters]: no. of points in each cluster */
+    long* new_centers_len;  /* [nclusters]: no. of points in each cluster */
     float delta;
     float** clusters;      /* out: [nclusters][nfeatures] */
     float** new_centers;   /* [nclusters][nfeatures] */
-    void* alloc_memory = NULL;
     args_t args;
     TIMER_T start;
     TIMER_T stop;
@@ -238,23 +246,17 @@ normal_exec (int       nthreads,
     }
 
     /*
-     * Need to initialize new_centers_len and new_centers[0] to all 0.
-     * Allocate clusters on different cache lines to reduce false sharing.
+     * Every thread sums into its own arrays, and the work() threads then
+     * reduce those into new_centers_len and new_centers, so only the
+     * reduction writes these and they need no padding or zeroing.
      */
-    {
-        int cluster_size = sizeof(long) + sizeof(float) * nfeatures;
-        /* ??? it assumes a fixed cacheline size for all arch. */
-        /* ??? Cacheline size set to 64 bytes long to be safe with x86_64). */
-        const int cacheLineSize = 64;
-        cluster_size += (cacheLineSize-1) - ((cluster_size-1) % cacheLineSize);
-        alloc_memory = calloc(nclusters, cluster_size);
-        new_centers_len = (long**) malloc(nclusters * sizeof(long*));
-        new_centers = (float**) malloc(nclusters * sizeof(float*));
-        assert(alloc_memory && new_centers && new_centers_len);
-        for (i = 0; i < nclusters; i++) {
-            new_centers_len[i] = (long*)((char*)alloc_memory + cluster_size * i);
-            new_centers[i] = (float*)((char*)alloc_memory + cluster_size * i + sizeof(long));
-        }
+    new_centers_len = (long*)malloc(nclusters * sizeof(long));
+    new_centers = (float**)malloc(nclusters * sizeof(float*));
+    assert(new_centers_len && new_centers);
+    new_centers[0] = (float*)malloc(nclusters * nfeatures * sizeof(float));
+    assert(new_centers[0]);
+    for (i = 1; i < nclusters; i++) {
+        new_centers[i] = new_centers[i-1] + nfeatures;
     }
 
     TIMER_READ(start);
@@ -272,7 +274,6 @@ normal_exec (int       nthreads,
         args.new_centers     = new_centers;
 
         global_i = nthreads * CHUNK;
-        global_delta = delta;
 
 #ifdef OTM
 #pragma omp parallel
@@ -288,12 +289,10 @@ normal_exec (int       nthreads,
         /* Replace old cluster centers with new_centers */
         for (i = 0; i < nclusters; i++) {
             for (j = 0; j < nfeatures; j++) {
-                if (new_centers_len[i] != NULL && *new_centers_len[i] > 0) {
-                    clusters[i][j] = new_centers[i][j] / *new_centers_len[i];
+                if (new_centers_len[i] > 0) {
+                    clusters[i][j] = new_centers[i][j] / new_centers_len[i];
                 }
-                new_centers[i][j] = 0.0;   /* set back to 0 */
             }
-            *new_centers_len[i] = 0;   /* set back to 0 */
         }
 
         delta /= npoints;
@@ -303,7 +302,7 @@ normal_exec (int       nthreads,
     TIMER_READ(stop);
     global_time += TIMER_DIFF_SECONDS(start, stop);
 
-    free(alloc_memory);
+    free(new_centers[0]);
     free(new_centers);
     free(new_centers_len);
 
@@ -75,6 +75,7 @@
 #include <string.h>
 #include "coordinate.h"
 #include "grid.h"
+#include "thread.h"
 #include "vector.h"
 
 /* ??? Cacheline size is fixed (set to 64 bytes for x86_64). */
@@ -102,7 +103,8 @@ grid_alloc (long width, long height, long depth)
         gridPtr->points = (long*)((char*)(((unsigned long)points_unaligned
                                           & ~(CACHE_LINE_SIZE-1)))
                                   + CACHE_LINE_SIZE);
-        memset(gridPtr->points, GRID_POINT_EMPTY, (n * sizeof(long)));
+        /* Spread the shared grid's pages over the threads' NUMA nodes */
+        thread_memset(gridPtr->points, GRID_POINT_EMPTY, (n * sizeof(long)));
     }
 
     return gridPtr;
@@ -212,6 +212,9 @@ int main (int argc, char** argv)
     router_solve_arg_t routerArg = {routerPtr, mazePtr, pathVectorListPtr};
     TIMER_T startTime;
     TIMER_READ(startTime);
+#ifdef USE_TASKS
+    router_spawnTasks(mazePtr);
+#endif
 #ifdef OTM
 #pragma omp parallel
     {
@@ -70,12 +70,13 @@
 
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include "coordinate.h"
 #include "grid.h"
 #include "list.h"
 #include "maze.h"
-#include "queue.h"
+#include "mpmcqueue.h"
 #include "pair.h"
 #include "vector.h"
 
@@ -92,12 +93,11 @@ maze_alloc ()
     mazePtr = (maze_t*)malloc(sizeof(maze_t));
     if (mazePtr) {
         mazePtr->gridPtr = NULL;
-        mazePtr->workQueuePtr = queue_alloc(1024);
+        mazePtr->workQueuePtr = NULL; /* sized by maze_read */
         mazePtr->wallVectorPtr = vector_alloc(1);
         mazePtr->srcVectorPtr = vector_alloc(1);
         mazePtr->dstVectorPtr = vector_alloc(1);
-        assert(mazePtr->workQueuePtr &&
-               mazePtr->wallVectorPtr &&
+        assert(mazePtr->wallVectorPtr &&
                mazePtr->srcVectorPtr &&
                mazePtr->dstVectorPtr);
     }
@@ -116,7 +116,9 @@ maze_free (maze_t* mazePtr)
     if (mazePtr->gridPtr != NULL) {
         grid_free(mazePtr->gridPtr);
     }
-    queue_free(mazePtr->workQueuePtr);
+    if (mazePtr->workQueuePtr != NULL) {
+        mpmcqueue_free(mazePtr->workQueuePtr);
+    }
     vector_free(mazePtr->wallVectorPtr);
     while ((coordPtr = (coordinate_t *)vector_popBack (mazePtr->srcVectorPtr)) != NULL) {
         coordinate_free(coordPtr);
@@ -272,12 +274,18 @@ maze_read (maze_t* mazePtr, const char* inputFileName)
     /*
      * Initialize work queue
      */
-    queue_t* workQueuePtr = mazePtr->workQueuePtr;
+    if (mazePtr->workQueuePtr != NULL) {
+        mpmcqueue_free(mazePtr->workQueuePtr);
+    }
+    mpmcqueue_t* workQueuePtr = mpmcqueue_alloc(list_getSize(workListPtr));
+    assert(workQueuePtr);
+    mazePtr->workQueuePtr = workQueuePtr;
     list_iter_t it;
     list_iter_reset(&it, workListPtr);
     while (list_iter_hasNext(&it)) {
         pair_t* coordinatePairPtr = (pair_t*)list_iter_next(&it);
-        queue_push(workQueuePtr, (void*)coordinatePairPtr);
+        bool status = mpmcqueue_push(workQueuePtr, (void*)coordinatePairPtr);
+        assert(status);
     }
     list_free(workListPtr);
 
@@ -76,13 +76,13 @@
 #include "coordinate.h"
 #include "grid.h"
 #include "list.h"
+#include "mpmcqueue.h"
 #include "pair.h"
-#include "queue.h"
 #include "vector.h"
 
 typedef struct maze {
     grid_t* gridPtr;
-    queue_t* workQueuePtr;   /* contains source/destination pairs to route */
+    mpmcqueue_t* workQueuePtr; /* contains source/destination pairs to route */
     vector_t* wallVectorPtr; /* obstacles */
     vector_t* srcVectorPtr;  /* sources */
     vector_t* dstVectorPtr;  /* destinations */
@@ -73,8 +73,11 @@
 #include <stdlib.h>
 #include "coordinate.h"
 #include "grid.h"
+#include "mpmcqueue.h"
 #include "queue.h"
 #include "router.h"
+#include "thread.h"
+#include "tm.h"
 #include "vector.h"
 #include "tm_transition.h"
 
@@ -96,6 +99,14 @@ struct point_t {
     momentum_t momentum;
 };
 
+typedef struct router_local {
+    router_t* routerPtr;
+    grid_t* gridPtr;             /* shared */
+    grid_t* myGridPtr;           /* private copy for expansion */
+    queue_t* myExpansionQueuePtr;
+    vector_t* myPathVectorPtr;   /* paths routed by this thread */
+} router_local_t;
+
 point_t MOVE_POSX = { 1,  0,  0,  0, MOMENTUM_POSX};
 point_t MOVE_POSY = { 0,  1,  0,  0, MOMENTUM_POSY};
 point_t MOVE_POSZ = { 0,  0,  1,  0, MOMENTUM_POSZ};
@@ -356,6 +367,144 @@ PdoTraceback (grid_t* gridPtr, grid_t* myGridPtr,
 }
 
 
+/* =============================================================================
+ * routePath
+ * -- Route one source/destination pair; a successful path is kept in
+ *    myPathVectorPtr
+ * =============================================================================
+ */
+static void
+routePath (router_local_t* localPtr, pair_t* coordinatePairPtr)
+{
+    router_t* routerPtr = localPtr->routerPtr;
+    grid_t* gridPtr = localPtr->gridPtr;
+    grid_t* myGridPtr = localPtr->myGridPtr;
+    queue_t* myExpansionQueuePtr = localPtr->myExpansionQueuePtr;
+    long bendCost = routerPtr->bendCost;
+
+    coordinate_t* srcPtr = (coordinate_t*)coordinatePairPtr->firstPtr;
+    coordinate_t* dstPtr = (coordinate_t*)coordinatePairPtr->secondPtr;
+
+    pair_free(coordinatePairPtr);
+
+    bool success = false;
+    vector_t* pointVectorPtr = NULL;
+
+#if 0
+    TM_BEGIN("router_copyGrid");
+      grid_copy(myGridPtr, gridPtr); /* ok if not most up-to-date */
+      if (PdoExpansion(routerPtr, myGridPtr, myExpansionQueuePtr,
+                       srcPtr, dstPtr)) {
+        pointVectorPtr = PdoTraceback(gridPtr, myGridPtr, dstPtr, bendCost);
+        /*
+         * TODO: fix memory leak
+         *
+         * pointVectorPtr will be a memory leak if we abort this transaction
+         */
+        if (pointVectorPtr) {
+          // [wer210]__attribute__((transaction_safe)), abort inside
+          TMGRID_ADDPATH(gridPtr, pointVectorPtr);
+          TM_LOCAL_WRITE(success, true);
+        }
+      }
+    TM_END();
+
+#endif
+    //[wer210] change the control flow
+    while (true) {
+      success = false;
+      // get a snapshot of the grid... may be inconsistent, but that's OK
+      grid_copy(myGridPtr, gridPtr);
+      /* ok if not most up-to-date */
+      // see if there is a valid path we can use
+      if (PdoExpansion(routerPtr, myGridPtr, myExpansionQueuePtr, srcPtr, dstPtr)) {
+        pointVectorPtr = PdoTraceback(gridPtr, myGridPtr, dstPtr, bendCost);
+
+        if (pointVectorPtr) {
+          // we've got a valid path.  Use a transaction to validate and finalize it
+            bool validity = false;
+
+            TM_BEGIN("router_addPath");
+              validity = TMGRID_ADDPATH(pointVectorPtr);
+            TM_END();
+
+          // if the operation was valid, we just finalized the path
+          if (validity) {
+            success = true;
+            break;
+          }
+
+          // otherwise we need to resample the grid
+          else {
+            // NB: doing things this way means we can fix a memory
+            // leak from the original STAMP labyrinth
+            PVECTOR_FREE(pointVectorPtr);
+            continue;
+          }
+        }
+
+        // if the traceback failed, we need to resample the grid
+        else {
+          continue;
+        }
+      }
+      // if the traceback failed, then the current path is not possible, so
+      // we should skip it
+      else {
+        break;
+      }
+    }
+    //////// end of change
+    if (success) {
+        bool status = PVECTOR_PUSHBACK(localPtr->myPathVectorPtr,
+                                         (void*)pointVectorPtr);
+        assert(status);
+    }
+}
+
+
+#ifdef USE_TASKS
+
+/* Per-thread routing state of the thread currently running router_solve */
+static __thread router_local_t* router_myLocalPtr;
+
+
+/* =============================================================================
+ * routePathTask
+ * =============================================================================
+ */
+static void
+routePathTask (void* argPtr)
+{
+    routePath(router_myLocalPtr, (pair_t*)argPtr);
+}
+
+
+/* =============================================================================
+ * router_spawnTasks
+ * =============================================================================
+ */
+long
+router_spawnTasks (maze_t* mazePtr)
+{
+    mpmcqueue_t* workQueuePtr = mazePtr->workQueuePtr;
+    long numTask = 0;
+    void* coordinatePairPtrs[64];
+    long numPop;
+
+    while ((numPop = mpmcqueue_pop_n(workQueuePtr, coordinatePairPtrs, 64))) {
+        for (long p = 0; p < numPop; p++) {
+            thread_spawnTask(&routePathTask, coordinatePairPtrs[p]);
+        }
+        numTask += numPop;
+    }
+
+    return numTask;
+}
+
+#endif /* USE_TASKS */
+
+
 /* =============================================================================
  * router_solve
  * =============================================================================
@@ -369,120 +518,44 @@ router_solve (void* argPtr)
     vector_t* myPathVectorPtr = PVECTOR_ALLOC(1);
     assert(myPathVectorPtr);
 
-    queue_t* workQueuePtr = mazePtr->workQueuePtr;
     grid_t* gridPtr = mazePtr->gridPtr;
     grid_t* myGridPtr =
         PGRID_ALLOC(gridPtr->width, gridPtr->height, gridPtr->depth);
     assert(myGridPtr);
-    long bendCost = routerPtr->bendCost;
     queue_t* myExpansionQueuePtr = TMQUEUE_ALLOC(-1);
 
+    router_local_t local;
+    local.routerPtr           = routerPtr;
+    local.gridPtr             = gridPtr;
+    local.myGridPtr           = myGridPtr;
+    local.myExpansionQueuePtr = myExpansionQueuePtr;
+    local.myPathVectorPtr     = myPathVectorPtr;
+
     /*
      * Iterate over work list to route each path. This involves an
      * 'expansion' and 'traceback' phase for each source/destination pair.
      */
-    while (1) {
-
-        pair_t* coordinatePairPtr;
-        __transaction_atomic {
-          if (TMQUEUE_ISEMPTY(workQueuePtr)) {
-            coordinatePairPtr = NULL;
-          } else {
-            coordinatePairPtr = (pair_t*)TMQUEUE_POP(workQueuePtr);
-          }
-        }
-        if (coordinatePairPtr == NULL) {
-            break;
-        }
-
-        coordinate_t* srcPtr = (coordinate_t*)coordinatePairPtr->firstPtr;
-        coordinate_t* dstPtr = (coordinate_t*)coordinatePairPtr->secondPtr;
-
-        pair_free(coordinatePairPtr);
-
-        bool success = false;
-        vector_t* pointVectorPtr = NULL;
-
-#if 0
-        __transaction_atomic {
-          grid_copy(myGridPtr, gridPtr); /* ok if not most up-to-date */
-          if (PdoExpansion(routerPtr, myGridPtr, myExpansionQueuePtr,
-                           srcPtr, dstPtr)) {
-            pointVectorPtr = PdoTraceback(gridPtr, myGridPtr, dstPtr, bendCost);
-            /*
-             * TODO: fix memory leak
-             *
-             * pointVectorPtr will be a memory leak if we abort this transaction
-             */
-            if (pointVectorPtr) {
-              // [wer210]__attribute__((transaction_safe)), abort inside
-              TMGRID_ADDPATH(gridPtr, pointVectorPtr);
-              TM_LOCAL_WRITE(success, true);
-            }
-          }
-        }
-
-#endif
-        //[wer210] change the control flow
-        while (true) {
-          success = false;
-          // get a snapshot of the grid... may be inconsistent, but that's OK
-          grid_copy(myGridPtr, gridPtr);
-          /* ok if not most up-to-date */
-          // see if there is a valid path we can use
-          if (PdoExpansion(routerPtr, myGridPtr, myExpansionQueuePtr, srcPtr, dstPtr)) {
-            pointVectorPtr = PdoTraceback(gridPtr, myGridPtr, dstPtr, bendCost);
-
-            if (pointVectorPtr) {
-              // we've got a valid path.  Use a transaction to validate and finalize it
-                bool validity = false;
-
-                __transaction_atomic {
-                  validity = TMGRID_ADDPATH(pointVectorPtr);
-                }
-
-              // if the operation was valid, we just finalized the path
-              if (validity) {
-                success = true;
-                break;
-              }
-
-              // otherwise we need to resample the grid
-              else {
-                // NB: doing things this way means we can fix a memory
-                // leak from the original STAMP labyrinth
-                PVECTOR_FREE(pointVectorPtr);
-                continue;
-              }
-            }
-
-            // if the traceback failed, we need to resample the grid
-            else {
-              continue;
-            }
-          }
-          // if the traceback failed, then the current path is not possible, so
-          // we should skip it
-          else {
-            break;
-          }
-        }
-        //////// end of change
-        if (success) {
-            bool status = PVECTOR_PUSHBACK(myPathVectorPtr,
-                                             (void*)pointVectorPtr);
-            assert(status);
-        }
-
+#ifdef USE_TASKS
+    router_myLocalPtr = &local;
+    thread_waitAll();
+    router_myLocalPtr = NULL;
+#else
+    mpmcqueue_t* workQueuePtr = mazePtr->workQueuePtr;
+
+    /* The work queue is only drained, so popping needs no transaction */
+    pair_t* coordinatePairPtr;
+    while ((coordinatePairPtr = (pair_t*)mpmcqueue_pop(workQueuePtr))) {
+        routePath(&local, coordinatePairPtr);
     }
+#endif /* USE_TASKS */
 
     /*
      * Add my paths to global list
      */
     list_t* pathVectorListPtr = routerArgPtr->pathVectorListPtr;
-    __transaction_atomic {
+    TM_BEGIN("router_publishPaths");
       TMLIST_INSERT(pathVectorListPtr, (void*)myPathVectorPtr);
-    }
+    TM_END();
 
     grid_free(myGridPtr);
     TMQUEUE_FREE(myExpansionQueuePtr);
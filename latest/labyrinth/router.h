@@ -107,6 +107,19 @@ void
 router_free (router_t* routerPtr);
 
 
+#ifdef USE_TASKS
+/* =============================================================================
+ * router_spawnTasks
+ * -- Drains the maze work queue into one routing task per path
+ * -- Call from the primary thread before thread_start(router_solve, ...)
+ * -- Returns number of tasks spawned
+ * =============================================================================
+ */
+long
+router_spawnTasks (maze_t* mazePtr);
+#endif /* USE_TASKS */
+
+
 /* =============================================================================
  * router_solve
  * =============================================================================
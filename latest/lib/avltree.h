@@ -105,7 +105,7 @@ extern "C" {
     typedef struct jsw_avltrav jsw_avltrav_t;
 
     /* User-defined item handling */
-    typedef long  (*cmp_f) ( const void *p1, const void *p2 );
+    typedef __attribute__((transaction_safe)) long (*cmp_f) ( const void *p1, const void *p2 );
 #ifdef USE_DUP_AND_REL
     typedef void *(*dup_f) ( void *p );
     typedef void  (*rel_f) ( void *p );
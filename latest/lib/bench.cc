@@ -0,0 +1,925 @@
+/* =============================================================================
+ *
+ * bench.cc
+ * -- Throughput microbenchmark for the transactional containers in lib
+ *
+ * =============================================================================
+ *
+ * Each thread runs a fixed number of operations on one shared container,
+ * every operation its own transaction.  An operation is a lookup with
+ * probability 100 - u percent, else an update that keeps the container at
+ * about half of the key range: keyed containers remove the key if present
+ * and insert it if not, queue, heap and vector push or pop at random, and
+ * bitmap flips the bit.  Keys are uniform over [0, k), or Zipf-distributed
+ * with exponent z, the hottest keys scattered over the range.
+ *
+ * For each container the run prints operations per second and the number
+ * of retries: attempts of a transaction beyond the first, counted by a
+ * transaction_pure call at the top of every atomic block.  A cancelled or
+ * conflicting attempt runs that call again when it restarts, with libitm
+ * as with the built-in STM (make TMBACKEND=stm).
+ *
+ * Build with make bench in lib.
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "avltree.h"
+#include "bitmap.h"
+#include "flathash.h"
+#include "hashtable.h"
+#include "heap.h"
+#include "list.h"
+#include "pair.h"
+#include "queue.h"
+#include "rbtree.h"
+#include "skiplist.h"
+#include "thread.h"
+#include "timer.h"
+#include "tm.h"
+#include "vector.h"
+#include "xorshift.h"
+
+enum param_types {
+    PARAM_THREAD = (unsigned char)'t',
+    PARAM_KEY    = (unsigned char)'k',
+    PARAM_UPDATE = (unsigned char)'u',
+    PARAM_SKEW   = (unsigned char)'z',
+    PARAM_NUMBER = (unsigned char)'n',
+    PARAM_SEED   = (unsigned char)'s'
+};
+
+#define PARAM_DEFAULT_THREAD (1)
+#define PARAM_DEFAULT_KEY    (1 << 12)
+#define PARAM_DEFAULT_UPDATE (20)
+#define PARAM_DEFAULT_SKEW   (0.0)
+#define PARAM_DEFAULT_NUMBER (1 << 18)
+#define PARAM_DEFAULT_SEED   (1)
+
+#define BENCH_MAX_THREAD 256
+
+double global_params[256]; /* 256 = ascii limit */
+
+
+struct container_t {
+    const char* name;
+    void* (*alloc)(long numKey);       /* holds every even key on return */
+    void (*free)(void* containerPtr, long numKey);
+    void (*read)(void* containerPtr, long key);
+    void (*update)(void* containerPtr, long key, bool isAdd);
+};
+
+typedef struct bench_stats {
+    unsigned long numOp;
+    unsigned long numAttempt;
+} __attribute__((aligned(64))) bench_stats_t;
+
+static container_t* global_containerPtr;
+static void* global_dataPtr;
+static long* global_keys;       /* rank -> key */
+static double* global_zipfCdf;  /* rank -> P(rank or hotter); NULL if uniform */
+static bench_stats_t global_stats[BENCH_MAX_THREAD];
+static __thread unsigned long global_numAttempt = 0;
+static __thread unsigned long global_randomSeed = 0;
+
+
+/* =============================================================================
+ * countAttempt
+ * -- Called first thing in every atomic block, so once per attempt
+ * =============================================================================
+ */
+TM_PURE
+static void
+countAttempt ()
+{
+    global_numAttempt++;
+}
+
+
+/* =============================================================================
+ * randomNext
+ * -- xorshift64; the calling thread's generator
+ * =============================================================================
+ */
+static unsigned long
+randomNext ()
+{
+    return xorshift_next(&global_randomSeed);
+}
+
+
+/* =============================================================================
+ * randomKey
+ * =============================================================================
+ */
+static long
+randomKey (long numKey)
+{
+    if (global_zipfCdf == NULL) {
+        return (long)(randomNext() % (unsigned long)numKey);
+    }
+
+    double u = (double)(randomNext() >> 11) / (double)(1UL << 53);
+    long lo = 0;
+    long hi = numKey - 1;
+    while (lo < hi) {
+        long mid = (lo + hi) / 2;
+        if (global_zipfCdf[mid] < u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return global_keys[lo];
+}
+
+
+/* #############################################################################
+ * Containers; keys are stored as key + 1, so no key is NULL or 0
+ * #############################################################################
+ */
+
+/* =============================================================================
+ * list
+ * =============================================================================
+ */
+static void*
+listAlloc (long numKey)
+{
+    list_t* listPtr = list_alloc(NULL);
+    assert(listPtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bool status = list_insert(listPtr, (void*)(k + 1));
+        assert(status);
+    }
+
+    return listPtr;
+}
+
+static void
+listFree (void* containerPtr, long)
+{
+    list_free((list_t*)containerPtr);
+}
+
+static void
+listRead (void* containerPtr, long key)
+{
+    TM_BEGIN("bench_listRead");
+      countAttempt();
+      TMLIST_FIND((list_t*)containerPtr, (void*)(key + 1));
+    TM_END();
+}
+
+static void
+listUpdate (void* containerPtr, long key, bool)
+{
+    list_t* listPtr = (list_t*)containerPtr;
+    TM_BEGIN("bench_listUpdate");
+      countAttempt();
+      if (TMLIST_FIND(listPtr, (void*)(key + 1)) != NULL) {
+          TMLIST_REMOVE(listPtr, (void*)(key + 1));
+      } else {
+          TMLIST_INSERT(listPtr, (void*)(key + 1));
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * hashtable
+ * =============================================================================
+ */
+TM_SAFE
+static unsigned long
+hashKey (const void* keyPtr)
+{
+    return (unsigned long)keyPtr * 0x9e3779b97f4a7c15UL >> 32;
+}
+
+TM_SAFE
+static long
+comparePairKeys (const pair_t* aPtr, const pair_t* bPtr)
+{
+    return ((long)aPtr->firstPtr - (long)bPtr->firstPtr);
+}
+
+static void*
+hashtableAlloc (long numKey)
+{
+    hashtable_t* hashtablePtr =
+        TMhashtable_alloc(numKey / 2, &hashKey, &comparePairKeys, -1, -1);
+    assert(hashtablePtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bool status = TMhashtable_insert(hashtablePtr, (void*)(k + 1),
+                                         (void*)(k + 1));
+        assert(status);
+    }
+
+    return hashtablePtr;
+}
+
+static void
+hashtableFree (void* containerPtr, long)
+{
+    TMhashtable_free((hashtable_t*)containerPtr);
+}
+
+static void
+hashtableRead (void* containerPtr, long key)
+{
+    TM_BEGIN("bench_hashtableRead");
+      countAttempt();
+      TMhashtable_find((hashtable_t*)containerPtr, (void*)(key + 1));
+    TM_END();
+}
+
+static void
+hashtableUpdate (void* containerPtr, long key, bool)
+{
+    hashtable_t* hashtablePtr = (hashtable_t*)containerPtr;
+    TM_BEGIN("bench_hashtableUpdate");
+      countAttempt();
+      if (!TMhashtable_remove(hashtablePtr, (void*)(key + 1))) {
+          TMhashtable_insert(hashtablePtr, (void*)(key + 1), (void*)(key + 1));
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * flathash
+ * =============================================================================
+ */
+static void*
+flathashAlloc (long numKey)
+{
+    flathash_t* hashPtr = flathash_alloc();
+    assert(hashPtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bool status = flathash_insert(hashPtr, k + 1, (void*)(k + 1));
+        assert(status);
+    }
+
+    return hashPtr;
+}
+
+static void
+flathashFree (void* containerPtr, long)
+{
+    flathash_free((flathash_t*)containerPtr);
+}
+
+static void
+flathashRead (void* containerPtr, long key)
+{
+    TM_BEGIN("bench_flathashRead");
+      countAttempt();
+      TMFLATHASH_FIND((flathash_t*)containerPtr, key + 1);
+    TM_END();
+}
+
+static void
+flathashUpdate (void* containerPtr, long key, bool)
+{
+    flathash_t* hashPtr = (flathash_t*)containerPtr;
+    TM_BEGIN("bench_flathashUpdate");
+      countAttempt();
+      if (!TMFLATHASH_REMOVE(hashPtr, key + 1)) {
+          TMFLATHASH_INSERT(hashPtr, key + 1, key + 1);
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * rbtree
+ * =============================================================================
+ */
+static void*
+rbtreeAlloc (long numKey)
+{
+    rbtree_t* treePtr = rbtree_alloc(NULL);
+    assert(treePtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bool status = rbtree_insert(treePtr, (void*)(k + 1), (void*)(k + 1));
+        assert(status);
+    }
+
+    return treePtr;
+}
+
+static void
+rbtreeFree (void* containerPtr, long)
+{
+    rbtree_free((rbtree_t*)containerPtr);
+}
+
+static void
+rbtreeRead (void* containerPtr, long key)
+{
+    TM_BEGIN("bench_rbtreeRead");
+      countAttempt();
+      TMRBTREE_GET((rbtree_t*)containerPtr, key + 1);
+    TM_END();
+}
+
+static void
+rbtreeUpdate (void* containerPtr, long key, bool)
+{
+    rbtree_t* treePtr = (rbtree_t*)containerPtr;
+    TM_BEGIN("bench_rbtreeUpdate");
+      countAttempt();
+      if (!TMRBTREE_DELETE(treePtr, key + 1)) {
+          TMRBTREE_INSERT(treePtr, key + 1, key + 1);
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * skiplist
+ * =============================================================================
+ */
+static void*
+skiplistAlloc (long numKey)
+{
+    skiplist_t* listPtr = skiplist_alloc(NULL);
+    assert(listPtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bool status = skiplist_insert(listPtr, (void*)(k + 1), (void*)(k + 1));
+        assert(status);
+    }
+
+    return listPtr;
+}
+
+static void
+skiplistFree (void* containerPtr, long)
+{
+    skiplist_free((skiplist_t*)containerPtr);
+}
+
+static void
+skiplistRead (void* containerPtr, long key)
+{
+    TM_BEGIN("bench_skiplistRead");
+      countAttempt();
+      TMSKIPLIST_GET((skiplist_t*)containerPtr, key + 1);
+    TM_END();
+}
+
+static void
+skiplistUpdate (void* containerPtr, long key, bool)
+{
+    skiplist_t* listPtr = (skiplist_t*)containerPtr;
+    TM_BEGIN("bench_skiplistUpdate");
+      countAttempt();
+      if (!TMSKIPLIST_DELETE(listPtr, key + 1)) {
+          TMSKIPLIST_INSERT(listPtr, key + 1, key + 1);
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * avltree
+ * -- Holds pair_t*s ordered by firstPtr, as MAP_USE_AVLTREE does
+ * =============================================================================
+ */
+TM_SAFE
+static long
+compareItemKeys (const void* aPtr, const void* bPtr)
+{
+    return ((long)((const pair_t*)aPtr)->firstPtr -
+            (long)((const pair_t*)bPtr)->firstPtr);
+}
+
+static void*
+avltreeAlloc (long numKey)
+{
+    jsw_avltree_t* treePtr = jsw_avlnew((cmp_f)&compareItemKeys);
+    assert(treePtr);
+    for (long k = 0; k < numKey; k += 2) {
+        pair_t* pairPtr = pair_alloc((void*)(k + 1), (void*)(k + 1));
+        assert(pairPtr);
+        long status = jsw_avlinsert(treePtr, (void*)pairPtr);
+        assert(status);
+    }
+
+    return treePtr;
+}
+
+static void
+avltreeFree (void* containerPtr, long numKey)
+{
+    jsw_avltree_t* treePtr = (jsw_avltree_t*)containerPtr;
+    for (long k = 0; k < numKey; k++) {
+        pair_t searchPair;
+        searchPair.firstPtr = (void*)(k + 1);
+        pair_t* pairPtr = (pair_t*)jsw_avlfind(treePtr, (void*)&searchPair);
+        if (pairPtr != NULL) {
+            jsw_avlerase(treePtr, (void*)&searchPair);
+            pair_free(pairPtr);
+        }
+    }
+    jsw_avldelete(treePtr);
+}
+
+static void
+avltreeRead (void* containerPtr, long key)
+{
+    pair_t searchPair;
+    searchPair.firstPtr = (void*)(key + 1);
+    TM_BEGIN("bench_avltreeRead");
+      countAttempt();
+      jsw_avlfind((jsw_avltree_t*)containerPtr, (void*)&searchPair);
+    TM_END();
+}
+
+static void
+avltreeUpdate (void* containerPtr, long key, bool)
+{
+    jsw_avltree_t* treePtr = (jsw_avltree_t*)containerPtr;
+    pair_t searchPair;
+    searchPair.firstPtr = (void*)(key + 1);
+    TM_BEGIN("bench_avltreeUpdate");
+      countAttempt();
+      pair_t* pairPtr = (pair_t*)jsw_avlfind(treePtr, (void*)&searchPair);
+      if (pairPtr != NULL) {
+          jsw_avlerase(treePtr, (void*)&searchPair);
+          pair_free(pairPtr);
+      } else {
+          pairPtr = pair_alloc((void*)(key + 1), (void*)(key + 1));
+          jsw_avlinsert(treePtr, (void*)pairPtr);
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * queue
+ * =============================================================================
+ */
+static void*
+queueAlloc (long numKey)
+{
+    queue_t* queuePtr = queue_alloc(numKey);
+    assert(queuePtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bool status = queue_push(queuePtr, (void*)(k + 1));
+        assert(status);
+    }
+
+    return queuePtr;
+}
+
+static void
+queueFree (void* containerPtr, long)
+{
+    queue_free((queue_t*)containerPtr);
+}
+
+static void
+queueRead (void* containerPtr, long)
+{
+    TM_BEGIN("bench_queueRead");
+      countAttempt();
+      TMQUEUE_ISEMPTY((queue_t*)containerPtr);
+    TM_END();
+}
+
+static void
+queueUpdate (void* containerPtr, long key, bool isAdd)
+{
+    queue_t* queuePtr = (queue_t*)containerPtr;
+    TM_BEGIN("bench_queueUpdate");
+      countAttempt();
+      if (isAdd) {
+          TMQUEUE_PUSH(queuePtr, key + 1);
+      } else {
+          TMQUEUE_POP(queuePtr);
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * heap
+ * =============================================================================
+ */
+static void*
+heapAlloc (long numKey)
+{
+    heap_t* heapPtr = heap_alloc(numKey);
+    assert(heapPtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bool status = heap_insert(heapPtr, k, (void*)(k + 1));
+        assert(status);
+    }
+
+    return heapPtr;
+}
+
+static void
+heapFree (void* containerPtr, long)
+{
+    heap_free((heap_t*)containerPtr);
+}
+
+static void
+heapRead (void* containerPtr, long)
+{
+    TM_BEGIN("bench_heapRead");
+      countAttempt();
+      TMHEAP_PEEKKEY((heap_t*)containerPtr);
+    TM_END();
+}
+
+static void
+heapUpdate (void* containerPtr, long key, bool isAdd)
+{
+    heap_t* heapPtr = (heap_t*)containerPtr;
+    TM_BEGIN("bench_heapUpdate");
+      countAttempt();
+      if (isAdd) {
+          TMHEAP_INSERT(heapPtr, key, key + 1);
+      } else {
+          TMHEAP_REMOVE(heapPtr);
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * bitmap
+ * =============================================================================
+ */
+static void*
+bitmapAlloc (long numKey)
+{
+    bitmap_t* bitmapPtr = bitmap_alloc(numKey);
+    assert(bitmapPtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bitmap_set(bitmapPtr, k);
+    }
+
+    return bitmapPtr;
+}
+
+static void
+bitmapFree (void* containerPtr, long)
+{
+    bitmap_free((bitmap_t*)containerPtr);
+}
+
+static void
+bitmapRead (void* containerPtr, long key)
+{
+    TM_BEGIN("bench_bitmapRead");
+      countAttempt();
+      TMBITMAP_ISSET((bitmap_t*)containerPtr, key);
+    TM_END();
+}
+
+static void
+bitmapUpdate (void* containerPtr, long key, bool)
+{
+    bitmap_t* bitmapPtr = (bitmap_t*)containerPtr;
+    TM_BEGIN("bench_bitmapUpdate");
+      countAttempt();
+      if (TMBITMAP_ISSET(bitmapPtr, key)) {
+          TMBITMAP_CLEAR(bitmapPtr, key);
+      } else {
+          TMBITMAP_SET(bitmapPtr, key);
+      }
+    TM_END();
+}
+
+
+/* =============================================================================
+ * vector
+ * =============================================================================
+ */
+static void*
+vectorAlloc (long numKey)
+{
+    vector_t* vectorPtr = vector_alloc(numKey);
+    assert(vectorPtr);
+    for (long k = 0; k < numKey; k += 2) {
+        bool status = vector_pushBack(vectorPtr, (void*)(k + 1));
+        assert(status);
+    }
+
+    return vectorPtr;
+}
+
+static void
+vectorFree (void* containerPtr, long)
+{
+    vector_free((vector_t*)containerPtr);
+}
+
+static void
+vectorRead (void* containerPtr, long key)
+{
+    vector_t* vectorPtr = (vector_t*)containerPtr;
+    TM_BEGIN("bench_vectorRead");
+      countAttempt();
+      long size = vector_getSize(vectorPtr);
+      if (size > 0) {
+          vector_at(vectorPtr, key % size);
+      }
+    TM_END();
+}
+
+static void
+vectorUpdate (void* containerPtr, long key, bool isAdd)
+{
+    vector_t* vectorPtr = (vector_t*)containerPtr;
+    TM_BEGIN("bench_vectorUpdate");
+      countAttempt();
+      if (isAdd) {
+          vector_pushBack(vectorPtr, (void*)(key + 1));
+      } else {
+          vector_popBack(vectorPtr);
+      }
+    TM_END();
+}
+
+
+static container_t global_containers[] = {
+    {"list",      &listAlloc,      &listFree,      &listRead,      &listUpdate},
+    {"hashtable", &hashtableAlloc, &hashtableFree, &hashtableRead, &hashtableUpdate},
+    {"flathash",  &flathashAlloc,  &flathashFree,  &flathashRead,  &flathashUpdate},
+    {"rbtree",    &rbtreeAlloc,    &rbtreeFree,    &rbtreeRead,    &rbtreeUpdate},
+    {"skiplist",  &skiplistAlloc,  &skiplistFree,  &skiplistRead,  &skiplistUpdate},
+    {"avltree",   &avltreeAlloc,   &avltreeFree,   &avltreeRead,   &avltreeUpdate},
+    {"queue",     &queueAlloc,     &queueFree,     &queueRead,     &queueUpdate},
+    {"heap",      &heapAlloc,      &heapFree,      &heapRead,      &heapUpdate},
+    {"bitmap",    &bitmapAlloc,    &bitmapFree,    &bitmapRead,    &bitmapUpdate},
+    {"vector",    &vectorAlloc,    &vectorFree,    &vectorRead,    &vectorUpdate}
+};
+
+static const long global_numContainer =
+    sizeof(global_containers) / sizeof(global_containers[0]);
+
+
+/* =============================================================================
+ * runOps
+ * -- Executed by every thread
+ * =============================================================================
+ */
+static void
+runOps (void*)
+{
+    long threadId = thread_getId();
+    long numKey = (long)global_params[PARAM_KEY];
+    long numOp = (long)global_params[PARAM_NUMBER];
+    long updatePercent = (long)global_params[PARAM_UPDATE];
+    container_t* containerPtr = global_containerPtr;
+    void* dataPtr = global_dataPtr;
+
+    global_randomSeed = ((unsigned long)global_params[PARAM_SEED] + 1) *
+                        0x9e3779b97f4a7c15UL * (threadId + 1) | 1;
+    global_numAttempt = 0;
+
+    for (long i = 0; i < numOp; i++) {
+        long key = randomKey(numKey);
+        unsigned long r = randomNext();
+        if ((long)(r % 100) < updatePercent) {
+            containerPtr->update(dataPtr, key, ((r >> 32) & 1));
+        } else {
+            containerPtr->read(dataPtr, key);
+        }
+    }
+
+    global_stats[threadId].numOp = numOp;
+    global_stats[threadId].numAttempt = global_numAttempt;
+}
+
+
+/* =============================================================================
+ * initializeKeys
+ * -- Ranks are shuffled onto keys, so the hottest keys are not neighbors
+ * =============================================================================
+ */
+static void
+initializeKeys (long numKey, double skew)
+{
+    unsigned long seed = (unsigned long)global_params[PARAM_SEED];
+
+    global_keys = (long*)malloc(numKey * sizeof(long));
+    assert(global_keys);
+    for (long k = 0; k < numKey; k++) {
+        global_keys[k] = k;
+    }
+    for (long k = numKey - 1; k > 0; k--) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        long j = (long)((seed >> 33) % (unsigned long)(k + 1));
+        long tmp = global_keys[k];
+        global_keys[k] = global_keys[j];
+        global_keys[j] = tmp;
+    }
+
+    global_zipfCdf = NULL;
+    if (skew > 0.0) {
+        global_zipfCdf = (double*)malloc(numKey * sizeof(double));
+        assert(global_zipfCdf);
+        double sum = 0.0;
+        for (long r = 0; r < numKey; r++) {
+            sum += 1.0 / pow((double)(r + 1), skew);
+            global_zipfCdf[r] = sum;
+        }
+        for (long r = 0; r < numKey; r++) {
+            global_zipfCdf[r] /= sum;
+        }
+    }
+}
+
+
+/* =============================================================================
+ * displayUsage
+ * =============================================================================
+ */
+static void
+displayUsage (const char* appName)
+{
+    printf("Usage: %s [options] [container ...]\n", appName);
+    puts("\nOptions:                                             (defaults)\n");
+    printf("    t <UINT>   Number of [t]hreads                   (%i)\n",
+           PARAM_DEFAULT_THREAD);
+    printf("    k <UINT>   Number of [k]eys                      (%i)\n",
+           PARAM_DEFAULT_KEY);
+    printf("    u <UINT>   Percentage of [u]pdates               (%i)\n",
+           PARAM_DEFAULT_UPDATE);
+    printf("    z <FLT>    Zipf exponent of key ske[z]; 0 is uniform (%g)\n",
+           PARAM_DEFAULT_SKEW);
+    printf("    n <UINT>   [n]umber of operations per thread     (%i)\n",
+           PARAM_DEFAULT_NUMBER);
+    printf("    s <UINT>   Random [s]eed                         (%i)\n",
+           PARAM_DEFAULT_SEED);
+    printf("\nContainers (all if none given):");
+    for (long c = 0; c < global_numContainer; c++) {
+        printf(" %s", global_containers[c].name);
+    }
+    puts("");
+    exit(1);
+}
+
+
+/* =============================================================================
+ * parseArgs
+ * -- Returns the number of containers named after the options
+ * =============================================================================
+ */
+static long
+parseArgs (long argc, char* const argv[], container_t** containerPtrs)
+{
+    long opt;
+    long numSelected = 0;
+
+    opterr = 0;
+
+    global_params[PARAM_THREAD] = PARAM_DEFAULT_THREAD;
+    global_params[PARAM_KEY]    = PARAM_DEFAULT_KEY;
+    global_params[PARAM_UPDATE] = PARAM_DEFAULT_UPDATE;
+    global_params[PARAM_SKEW]   = PARAM_DEFAULT_SKEW;
+    global_params[PARAM_NUMBER] = PARAM_DEFAULT_NUMBER;
+    global_params[PARAM_SEED]   = PARAM_DEFAULT_SEED;
+
+    while ((opt = getopt(argc, argv, "t:k:u:z:n:s:")) != -1) {
+        switch (opt) {
+            case 't':
+            case 'k':
+            case 'u':
+            case 'n':
+            case 's':
+                global_params[(unsigned char)opt] = atol(optarg);
+                break;
+            case 'z':
+                global_params[PARAM_SKEW] = atof(optarg);
+                break;
+            case '?':
+            default:
+                opterr++;
+                break;
+        }
+    }
+
+    for (long i = optind; i < argc; i++) {
+        long c;
+        for (c = 0; c < global_numContainer; c++) {
+            if (strcmp(argv[i], global_containers[c].name) == 0) {
+                containerPtrs[numSelected++] = &global_containers[c];
+                break;
+            }
+        }
+        if (c == global_numContainer) {
+            fprintf(stderr, "Unknown container: %s\n", argv[i]);
+            opterr++;
+        }
+    }
+
+    if (global_params[PARAM_THREAD] < 1 ||
+        global_params[PARAM_THREAD] > BENCH_MAX_THREAD ||
+        global_params[PARAM_KEY] < 2 ||
+        global_params[PARAM_UPDATE] < 0 ||
+        global_params[PARAM_UPDATE] > 100 ||
+        global_params[PARAM_SKEW] < 0.0)
+    {
+        opterr++;
+    }
+
+    if (opterr) {
+        displayUsage(argv[0]);
+    }
+
+    if (numSelected == 0) {
+        for (long c = 0; c < global_numContainer; c++) {
+            containerPtrs[numSelected++] = &global_containers[c];
+        }
+    }
+
+    return numSelected;
+}
+
+
+/* =============================================================================
+ * main
+ * =============================================================================
+ */
+int
+main (int argc, char** argv)
+{
+    container_t* containerPtrs[sizeof(global_containers) /
+                               sizeof(global_containers[0])];
+    long numSelected = parseArgs(argc, argv, containerPtrs);
+    long numThread = (long)global_params[PARAM_THREAD];
+    long numKey = (long)global_params[PARAM_KEY];
+
+    printf("Threads    = %li\n", numThread);
+    printf("Keys       = %li\n", numKey);
+    printf("Updates    = %li%%\n", (long)global_params[PARAM_UPDATE]);
+    printf("Skew       = %g\n", global_params[PARAM_SKEW]);
+    printf("Operations = %li per thread\n", (long)global_params[PARAM_NUMBER]);
+
+    initializeKeys(numKey, global_params[PARAM_SKEW]);
+    thread_startup(numThread);
+
+    printf("\n%-10s %14s %11s %12s %10s\n",
+           "Container", "Ops/sec", "Time", "Retries", "Retries/op");
+
+    for (long s = 0; s < numSelected; s++) {
+        global_containerPtr = containerPtrs[s];
+        global_dataPtr = global_containerPtr->alloc(numKey);
+        memset(global_stats, 0, sizeof(global_stats));
+
+        TIMER_T start;
+        TIMER_T stop;
+        TIMER_READ(start);
+        thread_start(runOps, NULL);
+        TIMER_READ(stop);
+        double seconds = TIMER_DIFF_SECONDS(start, stop);
+
+        unsigned long numOp = 0;
+        unsigned long numAttempt = 0;
+        for (long t = 0; t < numThread; t++) {
+            numOp += global_stats[t].numOp;
+            numAttempt += global_stats[t].numAttempt;
+        }
+        unsigned long numRetry = numAttempt - numOp;
+        printf("%-10s %14.0f %11.6f %12lu %10.4f\n",
+               global_containerPtr->name,
+               numOp / seconds,
+               seconds,
+               numRetry,
+               (double)numRetry / numOp);
+        fflush(stdout);
+
+        global_containerPtr->free(global_dataPtr, numKey);
+    }
+
+    thread_shutdown();
+
+    free(global_keys);
+    free(global_zipfCdf);
+
+    return 0;
+}
+
+
+/* =============================================================================
+ *
+ * End of bench.cc
+ *
+ * =============================================================================
+ */
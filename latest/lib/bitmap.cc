@@ -79,6 +79,27 @@
 
 #define NUM_BIT_PER_BYTE (8L)
 #define NUM_BIT_PER_WORD (sizeof(unsigned long) * NUM_BIT_PER_BYTE)
+#define LOG_BIT_PER_WORD (6)
+static_assert(sizeof(unsigned long) == 8, "LOG_BIT_PER_WORD assumes 64-bit words");
+
+#define WORD_OF(i)       ((i) >> LOG_BIT_PER_WORD)
+#define BIT_OF(i)        (1UL << ((i) & (NUM_BIT_PER_WORD - 1)))
+
+
+/* =============================================================================
+ * getLastMask
+ * -- Mask of the bits of the last word that are below numBit
+ * -- Bits above numBit may be set (see bitmap_toggleAll), so every scan
+ *    and count applies this to the last word
+ * =============================================================================
+ */
+TM_SAFE
+static inline unsigned long
+getLastMask (long numBit)
+{
+    long numTail = numBit & (NUM_BIT_PER_WORD - 1);
+    return ((numTail == 0) ? ~0UL : ((1UL << numTail) - 1));
+}
 
 
 /* =============================================================================
@@ -107,11 +128,8 @@ bitmap_alloc (long numBit)
         return NULL;
     }
 
-    //memset(bitmapPtr->bits, 0, (numWord * sizeof(ulong_t)));
-    int i;
-    for (i = 0; i < bitmapPtr->numWord; i++) {
-      bitmapPtr->bits[i] = 0;
-    }
+    memset(bitmapPtr->bits, 0, (numWord * sizeof(unsigned long)));
+
     return bitmapPtr;
 }
 
@@ -139,7 +157,7 @@ bitmap_set (bitmap_t* bitmapPtr, long i)
 {
     if ((i < 0) || (i >= bitmapPtr->numBit))
         return false;
-    bitmapPtr->bits[i/NUM_BIT_PER_WORD] |= (1UL << (i % NUM_BIT_PER_WORD));
+    bitmapPtr->bits[WORD_OF(i)] |= BIT_OF(i);
     return true;
 }
 
@@ -156,7 +174,7 @@ bitmap_clear (bitmap_t* bitmapPtr, long i)
 {
     if ((i < 0) || (i >= bitmapPtr->numBit))
         return false;
-    bitmapPtr->bits[i/NUM_BIT_PER_WORD] &= ~(1UL << (i % NUM_BIT_PER_WORD));
+    bitmapPtr->bits[WORD_OF(i)] &= ~BIT_OF(i);
     return true;
 }
 
@@ -164,17 +182,15 @@ bitmap_clear (bitmap_t* bitmapPtr, long i)
 /* =============================================================================
  * bitmap_clearAll
  * -- Clears all bit to 0
+ * -- A vectorized memset outside transactions; inside, the TM's memset
+ *    barrier logs whole words
  * =============================================================================
  */
 TM_SAFE
 void
 bitmap_clearAll (bitmap_t* bitmapPtr)
 {
-  //memset(bitmapPtr->bits, 0, (bitmapPtr->numWord * sizeof(ulong_t)));
-  int i;
-  for (i = 0; i < bitmapPtr->numWord; i++) {
-    bitmapPtr->bits[i] = 0;
-  }
+    memset(bitmapPtr->bits, 0, (bitmapPtr->numWord * sizeof(unsigned long)));
 }
 
 
@@ -188,7 +204,7 @@ bool
 bitmap_isClear (bitmap_t* bitmapPtr, long i)
 {
     if ((i >= 0) && (i < bitmapPtr->numBit) &&
-        !(bitmapPtr->bits[i/NUM_BIT_PER_WORD] & (1UL << (i % NUM_BIT_PER_WORD)))) {
+        !(bitmapPtr->bits[WORD_OF(i)] & BIT_OF(i))) {
         return true;
     }
 
@@ -206,7 +222,7 @@ bool
 bitmap_isSet (bitmap_t* bitmapPtr, long i)
 {
     if ((i >= 0) && (i < bitmapPtr->numBit) &&
-        (bitmapPtr->bits[i/NUM_BIT_PER_WORD] & (1UL << (i % NUM_BIT_PER_WORD)))) {
+        (bitmapPtr->bits[WORD_OF(i)] & BIT_OF(i))) {
         return true;
     }
 
@@ -215,27 +231,57 @@ bitmap_isSet (bitmap_t* bitmapPtr, long i)
 
 
 /* =============================================================================
- * bitmap_findClear
- * -- Returns index of first clear bit
- * -- If start index is negative, will start from beginning
- * -- If all bits are set, returns -1
+ * findBit
+ * -- Returns index of first bit at or after startIndex that is set in
+ *    (word ^ flip), i.e., set for flip 0 and clear for flip ~0, or -1
  * =============================================================================
  */
 TM_SAFE
-long
-bitmap_findClear (bitmap_t* bitmapPtr, long startIndex)
+static long
+findBit (bitmap_t* bitmapPtr, long startIndex, unsigned long flip)
 {
-    long i;
     long numBit = bitmapPtr->numBit;
     unsigned long* bits = bitmapPtr->bits;
 
-    for (i = MAX(startIndex, 0); i < numBit; i++) {
-        if (!(bits[i/NUM_BIT_PER_WORD] & (1UL << (i % NUM_BIT_PER_WORD)))) {
-            return i;
+    if (startIndex < 0) {
+        startIndex = 0;
+    }
+    if (startIndex >= numBit) {
+        return -1;
+    }
+
+    long w = WORD_OF(startIndex);
+    long numWord = bitmapPtr->numWord;
+    /* Drop the bits below startIndex in its word */
+    unsigned long word = (bits[w] ^ flip) & (~0UL << (startIndex & (NUM_BIT_PER_WORD - 1)));
+
+    while (1) {
+        if (w == numWord - 1) {
+            word &= getLastMask(numBit);
+        }
+        if (word != 0) {
+            return (w << LOG_BIT_PER_WORD) + __builtin_ctzl(word);
         }
+        if (++w >= numWord) {
+            return -1;
+        }
+        word = bits[w] ^ flip;
     }
+}
+
 
-    return -1;
+/* =============================================================================
+ * bitmap_findClear
+ * -- Returns index of first clear bit
+ * -- If start index is negative, will start from beginning
+ * -- If all bits are set, returns -1
+ * =============================================================================
+ */
+TM_SAFE
+long
+bitmap_findClear (bitmap_t* bitmapPtr, long startIndex)
+{
+    return findBit(bitmapPtr, startIndex, ~0UL);
 }
 
 
@@ -250,17 +296,7 @@ TM_SAFE
 long
 bitmap_findSet (bitmap_t* bitmapPtr, long startIndex)
 {
-    long i;
-    long numBit = bitmapPtr->numBit;
-    unsigned long* bits = bitmapPtr->bits;
-
-    for (i = MAX(startIndex, 0); i < numBit; i++) {
-        if (bits[i/NUM_BIT_PER_WORD] & (1UL << (i % NUM_BIT_PER_WORD))) {
-            return i;
-        }
-    }
-
-    return -1;
+    return findBit(bitmapPtr, startIndex, 0UL);
 }
 
 
@@ -285,21 +321,37 @@ TM_SAFE
 long
 bitmap_getNumSet (bitmap_t* bitmapPtr)
 {
-    long i;
-    long numBit = bitmapPtr->numBit;
+    long numWord = bitmapPtr->numWord;
     unsigned long* bits = bitmapPtr->bits;
     long count = 0;
+    long w;
 
-    for (i = 0; i < numBit; i++) {
-        if (bits[i/NUM_BIT_PER_WORD] & (1UL << (i % NUM_BIT_PER_WORD))) {
-            count++;
-        }
+    if (numWord == 0) {
+        return 0;
+    }
+
+    for (w = 0; w < numWord - 1; w++) {
+        count += __builtin_popcountl(bits[w]);
     }
+    count += __builtin_popcountl(bits[w] & getLastMask(bitmapPtr->numBit));
 
     return count;
 }
 
 
+/* =============================================================================
+ * bitmap_isEmpty
+ * -- Returns true if no bit is set
+ * =============================================================================
+ */
+TM_SAFE
+bool
+bitmap_isEmpty (bitmap_t* bitmapPtr)
+{
+    return (findBit(bitmapPtr, 0, 0UL) < 0);
+}
+
+
 /* =============================================================================
  * bitmap_copy
  * =============================================================================
@@ -313,6 +365,66 @@ bitmap_copy (bitmap_t* dstPtr, bitmap_t* srcPtr)
 }
 
 
+/* =============================================================================
+ * bitmap_or
+ * -- dst |= src
+ * =============================================================================
+ */
+TM_SAFE
+void
+bitmap_or (bitmap_t* dstPtr, bitmap_t* srcPtr)
+{
+    assert(dstPtr->numBit == srcPtr->numBit);
+    unsigned long* dstBits = dstPtr->bits;
+    unsigned long* srcBits = srcPtr->bits;
+    long numWord = dstPtr->numWord;
+    long w;
+    for (w = 0; w < numWord; w++) {
+        dstBits[w] |= srcBits[w];
+    }
+}
+
+
+/* =============================================================================
+ * bitmap_and
+ * -- dst &= src
+ * =============================================================================
+ */
+TM_SAFE
+void
+bitmap_and (bitmap_t* dstPtr, bitmap_t* srcPtr)
+{
+    assert(dstPtr->numBit == srcPtr->numBit);
+    unsigned long* dstBits = dstPtr->bits;
+    unsigned long* srcBits = srcPtr->bits;
+    long numWord = dstPtr->numWord;
+    long w;
+    for (w = 0; w < numWord; w++) {
+        dstBits[w] &= srcBits[w];
+    }
+}
+
+
+/* =============================================================================
+ * bitmap_andNot
+ * -- dst &= ~src
+ * =============================================================================
+ */
+TM_SAFE
+void
+bitmap_andNot (bitmap_t* dstPtr, bitmap_t* srcPtr)
+{
+    assert(dstPtr->numBit == srcPtr->numBit);
+    unsigned long* dstBits = dstPtr->bits;
+    unsigned long* srcBits = srcPtr->bits;
+    long numWord = dstPtr->numWord;
+    long w;
+    for (w = 0; w < numWord; w++) {
+        dstBits[w] &= ~srcBits[w];
+    }
+}
+
+
 /* =============================================================================
  * bitmap_toggleAll
  * =============================================================================
@@ -330,6 +442,68 @@ bitmap_toggleAll (bitmap_t* bitmapPtr)
 }
 
 
+/* =============================================================================
+ * bitmap_iter_reset
+ * =============================================================================
+ */
+TM_SAFE
+void
+bitmap_iter_reset (bitmap_iter_t* itPtr, bitmap_t* bitmapPtr)
+{
+    itPtr->word = 0;
+    itPtr->bits = 0;
+    if (bitmapPtr->numWord > 0) {
+        itPtr->bits = bitmapPtr->bits[0];
+        if (bitmapPtr->numWord == 1) {
+            itPtr->bits &= getLastMask(bitmapPtr->numBit);
+        }
+    }
+}
+
+
+/* =============================================================================
+ * bitmap_iter_hasNext
+ * -- Skips to the next word with a set bit
+ * =============================================================================
+ */
+TM_SAFE
+bool
+bitmap_iter_hasNext (bitmap_iter_t* itPtr, bitmap_t* bitmapPtr)
+{
+    long numWord = bitmapPtr->numWord;
+
+    while (itPtr->bits == 0) {
+        if (++itPtr->word >= numWord) {
+            itPtr->word = numWord;
+            return false;
+        }
+        itPtr->bits = bitmapPtr->bits[itPtr->word];
+        if (itPtr->word == numWord - 1) {
+            itPtr->bits &= getLastMask(bitmapPtr->numBit);
+        }
+    }
+
+    return true;
+}
+
+
+/* =============================================================================
+ * bitmap_iter_next
+ * -- Returns the index of the next set bit; call bitmap_iter_hasNext first
+ * =============================================================================
+ */
+TM_SAFE
+long
+bitmap_iter_next (bitmap_iter_t* itPtr, bitmap_t*)
+{
+    unsigned long bits = itPtr->bits;
+    assert(bits != 0);
+    itPtr->bits = bits & (bits - 1); /* clear lowest set bit */
+
+    return (itPtr->word << LOG_BIT_PER_WORD) + __builtin_ctzl(bits);
+}
+
+
 /* =============================================================================
  * TEST_BITMAP
  * =============================================================================
@@ -420,6 +594,86 @@ main ()
 
     bitmap_free(bitmapPtr);
 
+    /* Word scans, bulk ops and iterator against bit-by-bit answers, on a
+     * size with a partial last word */
+    long numBitTail = 300;
+    bitmap_t* aPtr = bitmap_alloc(numBitTail);
+    bitmap_t* bPtr = bitmap_alloc(numBitTail);
+    bitmap_t* cPtr = bitmap_alloc(numBitTail);
+    assert(bitmap_isEmpty(aPtr));
+    for (long r = 0; r < 100; r++) {
+        bitmap_clearAll(aPtr);
+        bitmap_clearAll(bPtr);
+        for (i = 0; i < numBitTail; i++) {
+            if (rand() % 4 == 0) {
+                bitmap_set(aPtr, i);
+            }
+            if (rand() % 4 == 0) {
+                bitmap_set(bPtr, i);
+            }
+        }
+        if (r % 2) {
+            bitmap_toggleAll(aPtr); /* also sets the bits past numBit */
+        }
+
+        for (i = -1; i <= numBitTail; i++) {
+            long s = -1;
+            long c = -1;
+            for (j = ((i < 0) ? 0 : i); j < numBitTail; j++) {
+                if (s < 0 && bitmap_isSet(aPtr, j)) {
+                    s = j;
+                }
+                if (c < 0 && bitmap_isClear(aPtr, j)) {
+                    c = j;
+                }
+            }
+            assert(bitmap_findSet(aPtr, i) == s);
+            assert(bitmap_findClear(aPtr, i) == c);
+        }
+
+        long numSet = 0;
+        for (i = 0; i < numBitTail; i++) {
+            numSet += bitmap_isSet(aPtr, i);
+        }
+        assert(bitmap_getNumSet(aPtr) == numSet);
+        assert(bitmap_isEmpty(aPtr) == (numSet == 0));
+
+        bitmap_iter_t it;
+        bitmap_iter_reset(&it, aPtr);
+        j = 0;
+        i = -1;
+        while (bitmap_iter_hasNext(&it, aPtr)) {
+            long k = bitmap_iter_next(&it, aPtr);
+            assert(k > i && bitmap_isSet(aPtr, k));
+            assert(bitmap_findSet(aPtr, i + 1) == k);
+            i = k;
+            j++;
+        }
+        assert(j == numSet);
+
+        bitmap_copy(cPtr, aPtr);
+        bitmap_or(cPtr, bPtr);
+        for (i = 0; i < numBitTail; i++) {
+            assert(bitmap_isSet(cPtr, i) ==
+                   (bitmap_isSet(aPtr, i) || bitmap_isSet(bPtr, i)));
+        }
+        bitmap_copy(cPtr, aPtr);
+        bitmap_and(cPtr, bPtr);
+        for (i = 0; i < numBitTail; i++) {
+            assert(bitmap_isSet(cPtr, i) ==
+                   (bitmap_isSet(aPtr, i) && bitmap_isSet(bPtr, i)));
+        }
+        bitmap_copy(cPtr, aPtr);
+        bitmap_andNot(cPtr, bPtr);
+        for (i = 0; i < numBitTail; i++) {
+            assert(bitmap_isSet(cPtr, i) ==
+                   (bitmap_isSet(aPtr, i) && !bitmap_isSet(bPtr, i)));
+        }
+    }
+    bitmap_free(aPtr);
+    bitmap_free(bPtr);
+    bitmap_free(cPtr);
+
     puts("All tests passed.");
 
     return 0;
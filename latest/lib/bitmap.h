@@ -77,6 +77,11 @@ struct bitmap_t {
     unsigned long* bits;
 };
 
+struct bitmap_iter_t {
+    long word;          /* index of the word being scanned */
+    unsigned long bits; /* its set bits not yet returned */
+};
+
 /* =============================================================================
  * bitmap_alloc
  * -- Returns NULL on failure
@@ -163,6 +168,7 @@ bitmap_findClear (bitmap_t* bitmapPtr, long startIndex);
 /* =============================================================================
  * bitmap_findSet
  * -- Returns index of first set bit
+ * -- If start index is negative, will start from beginning
  * -- If all bits are clear, returns -1
  * =============================================================================
  */
@@ -189,8 +195,19 @@ long
 bitmap_getNumSet (bitmap_t* bitmapPtr);
 
 
+/* =============================================================================
+ * bitmap_isEmpty
+ * -- Returns true if no bit is set
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+bitmap_isEmpty (bitmap_t* bitmapPtr);
+
+
 /* =============================================================================
  * bitmap_copy
+ * -- Both bitmaps must have the same number of bits
  * =============================================================================
  */
 __attribute__((transaction_safe))
@@ -198,6 +215,36 @@ void
 bitmap_copy (bitmap_t* dstPtr, bitmap_t* srcPtr);
 
 
+/* =============================================================================
+ * bitmap_or
+ * -- dst |= src, a word at a time
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+bitmap_or (bitmap_t* dstPtr, bitmap_t* srcPtr);
+
+
+/* =============================================================================
+ * bitmap_and
+ * -- dst &= src, a word at a time
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+bitmap_and (bitmap_t* dstPtr, bitmap_t* srcPtr);
+
+
+/* =============================================================================
+ * bitmap_andNot
+ * -- dst &= ~src, a word at a time
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+bitmap_andNot (bitmap_t* dstPtr, bitmap_t* srcPtr);
+
+
 /* =============================================================================
  * bitmap_toggleAll
  * =============================================================================
@@ -207,6 +254,37 @@ void
 bitmap_toggleAll (bitmap_t* bitmapPtr);
 
 
+/* =============================================================================
+ * bitmap_iter_reset
+ * -- Iterates over the set bits in increasing order, one ctz per bit
+ * -- The bitmap must not change while iterating
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+bitmap_iter_reset (bitmap_iter_t* itPtr, bitmap_t* bitmapPtr);
+
+
+/* =============================================================================
+ * bitmap_iter_hasNext
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+bitmap_iter_hasNext (bitmap_iter_t* itPtr, bitmap_t* bitmapPtr);
+
+
+/* =============================================================================
+ * bitmap_iter_next
+ * -- Returns the index of the next set bit
+ * -- bitmapPtr is unused; it is there to match bitmap_iter_hasNext
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+long
+bitmap_iter_next (bitmap_iter_t* itPtr, bitmap_t* bitmapPtr);
+
+
 #define TMBITMAP_ALLOC(n)                bitmap_alloc(n)
 #define TMBITMAP_FREE(b)                 bitmap_free(b)
 #define TMBITMAP_SET(b, i)               bitmap_set(b, i)
@@ -217,5 +295,12 @@ bitmap_toggleAll (bitmap_t* bitmapPtr);
 #define TMBITMAP_FINDSET(b, i)           bitmap_findSet(b, i)
 #define TMBITMAP_GETNUMCLEAR(b)          bitmap_getNumClear(b)
 #define TMBITMAP_GETNUMSET(b)            bitmap_getNumSet(b)
-#define TMBITMAP_COPY(b)                 bitmap_copy(b)
+#define TMBITMAP_ISEMPTY(b)              bitmap_isEmpty(b)
+#define TMBITMAP_COPY(d, s)              bitmap_copy(d, s)
+#define TMBITMAP_OR(d, s)                bitmap_or(d, s)
+#define TMBITMAP_AND(d, s)               bitmap_and(d, s)
+#define TMBITMAP_ANDNOT(d, s)            bitmap_andNot(d, s)
 #define TMBITMAP_TOGGLEALL(b)            bitmap_toggleAll(b)
+#define TMBITMAP_ITER_RESET(it, b)       bitmap_iter_reset(it, b)
+#define TMBITMAP_ITER_HASNEXT(it, b)     bitmap_iter_hasNext(it, b)
+#define TMBITMAP_ITER_NEXT(it, b)        bitmap_iter_next(it, b)
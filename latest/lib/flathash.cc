@@ -0,0 +1,467 @@
+/* =============================================================================
+ *
+ * flathash.cc
+ * -- Open-addressing hash map from long keys to pointers
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "flathash.h"
+#include "memory.h"
+#include "tm.h"
+#include "tm_transition.h"
+
+
+/* =============================================================================
+ * getHome
+ * -- Fibonacci hashing: the top bits of key * 2^64/phi
+ * =============================================================================
+ */
+TM_SAFE
+static inline long
+getHome (long key, long shift)
+{
+    return (long)(((unsigned long)key * 0x9e3779b97f4a7c15UL) >> shift);
+}
+
+
+/* =============================================================================
+ * allocEntries
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+TM_SAFE
+static flathash_entry_t*
+allocEntries (long capacity)
+{
+    flathash_entry_t* entries =
+        (flathash_entry_t*)memory_alloc(capacity * sizeof(flathash_entry_t));
+    if (entries == NULL) {
+        return NULL;
+    }
+
+    for (long i = 0; i < capacity; i++) {
+        entries[i].key = FLATHASH_EMPTY_KEY;
+        entries[i].dataPtr = NULL;
+    }
+
+    return entries;
+}
+
+
+/* =============================================================================
+ * getShift
+ * =============================================================================
+ */
+TM_SAFE
+static long
+getShift (long capacity)
+{
+    long shift = 64;
+
+    while (capacity > 1) {
+        capacity >>= 1;
+        shift--;
+    }
+
+    return shift;
+}
+
+
+/* =============================================================================
+ * findIndex
+ * -- Returns the slot holding key, or -1
+ * =============================================================================
+ */
+TM_SAFE
+static long
+findIndex (flathash_t* hashPtr, long key)
+{
+    flathash_entry_t* entries = hashPtr->entries;
+    long mask = hashPtr->capacity - 1;
+    long i = getHome(key, hashPtr->shift);
+
+    for (long p = 0; p < FLATHASH_MAX_PROBE; p++) {
+        long k = entries[i].key;
+        if (k == key) {
+            return i;
+        }
+        if (k == FLATHASH_EMPTY_KEY) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return -1;
+}
+
+
+/* =============================================================================
+ * placeEntry
+ * -- Puts key, known to be absent, in the first free slot of its window
+ * -- Returns false if there is none
+ * =============================================================================
+ */
+TM_SAFE
+static bool
+placeEntry (flathash_entry_t* entries, long capacity, long shift,
+            long key, void* dataPtr)
+{
+    long mask = capacity - 1;
+    long i = getHome(key, shift);
+
+    for (long p = 0; p < FLATHASH_MAX_PROBE; p++) {
+        long k = entries[i].key;
+        if (k == FLATHASH_EMPTY_KEY || k == FLATHASH_DELETED_KEY) {
+            entries[i].key = key;
+            entries[i].dataPtr = dataPtr;
+            return true;
+        }
+        i = (i + 1) & mask;
+    }
+
+    return false;
+}
+
+
+/* =============================================================================
+ * rehash
+ * -- Rebuilds the table without tombstones; doubles it unless they were
+ *    at least an eighth of the slots, in which case it is sized for the
+ *    live keys at half load
+ * -- Returns false on allocation failure
+ * =============================================================================
+ */
+TM_SAFE
+static bool
+rehash (flathash_t* hashPtr)
+{
+    flathash_entry_t* entries = hashPtr->entries;
+    long capacity = hashPtr->capacity;
+    long numLive = 0;
+    long numDeleted = 0;
+
+    for (long i = 0; i < capacity; i++) {
+        long k = entries[i].key;
+        if (k == FLATHASH_DELETED_KEY) {
+            numDeleted++;
+        } else if (k != FLATHASH_EMPTY_KEY) {
+            numLive++;
+        }
+    }
+
+    long newCapacity = capacity * 2;
+    if (numDeleted >= capacity / 8) {
+        newCapacity = FLATHASH_INIT_CAPACITY;
+        while (newCapacity < 2 * (numLive + 1)) {
+            newCapacity *= 2;
+        }
+    }
+
+    while (1) {
+        flathash_entry_t* newEntries = allocEntries(newCapacity);
+        if (newEntries == NULL) {
+            return false;
+        }
+        long newShift = getShift(newCapacity);
+
+        long i;
+        for (i = 0; i < capacity; i++) {
+            long k = entries[i].key;
+            if (k != FLATHASH_EMPTY_KEY && k != FLATHASH_DELETED_KEY) {
+                if (!placeEntry(newEntries, newCapacity, newShift,
+                                k, entries[i].dataPtr)) {
+                    break;
+                }
+            }
+        }
+
+        if (i == capacity) {
+            memory_free(entries);
+            hashPtr->entries = newEntries;
+            hashPtr->capacity = newCapacity;
+            hashPtr->shift = newShift;
+            return true;
+        }
+
+        /* A window overflowed even here */
+        memory_free(newEntries);
+        newCapacity *= 2;
+    }
+}
+
+
+/* =============================================================================
+ * flathash_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+TM_SAFE
+flathash_t*
+flathash_alloc ()
+{
+    flathash_t* hashPtr = (flathash_t*)memory_alloc(sizeof(flathash_t));
+    if (hashPtr == NULL) {
+        return NULL;
+    }
+
+    hashPtr->entries = allocEntries(FLATHASH_INIT_CAPACITY);
+    if (hashPtr->entries == NULL) {
+        memory_free(hashPtr);
+        return NULL;
+    }
+    hashPtr->capacity = FLATHASH_INIT_CAPACITY;
+    hashPtr->shift = getShift(FLATHASH_INIT_CAPACITY);
+
+    return hashPtr;
+}
+
+
+/* =============================================================================
+ * flathash_free
+ * =============================================================================
+ */
+TM_SAFE
+void
+flathash_free (flathash_t* hashPtr)
+{
+    memory_free(hashPtr->entries);
+    memory_free(hashPtr);
+}
+
+
+/* =============================================================================
+ * flathash_contains
+ * =============================================================================
+ */
+TM_SAFE
+bool
+flathash_contains (flathash_t* hashPtr, long key)
+{
+    return (findIndex(hashPtr, key) >= 0);
+}
+
+
+/* =============================================================================
+ * flathash_find
+ * -- Returns NULL if not found, else the data
+ * =============================================================================
+ */
+TM_SAFE
+void*
+flathash_find (flathash_t* hashPtr, long key)
+{
+    long i = findIndex(hashPtr, key);
+
+    return ((i >= 0) ? hashPtr->entries[i].dataPtr : NULL);
+}
+
+
+/* =============================================================================
+ * flathash_insert
+ * -- Returns false if the key is already present or on allocation failure
+ * =============================================================================
+ */
+TM_SAFE
+bool
+flathash_insert (flathash_t* hashPtr, long key, void* dataPtr)
+{
+    assert(key != FLATHASH_EMPTY_KEY && key != FLATHASH_DELETED_KEY);
+
+    if (findIndex(hashPtr, key) >= 0) {
+        return false;
+    }
+
+    while (!placeEntry(hashPtr->entries, hashPtr->capacity, hashPtr->shift,
+                       key, dataPtr))
+    {
+        if (!rehash(hashPtr)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* =============================================================================
+ * flathash_remove
+ * -- Returns true if successful, else false
+ * -- A tombstone followed by an empty slot ends no probe that must go on,
+ *    so it and the tombstones before it become empty again
+ * =============================================================================
+ */
+TM_SAFE
+bool
+flathash_remove (flathash_t* hashPtr, long key)
+{
+    long i = findIndex(hashPtr, key);
+    if (i < 0) {
+        return false;
+    }
+
+    flathash_entry_t* entries = hashPtr->entries;
+    long mask = hashPtr->capacity - 1;
+
+    entries[i].dataPtr = NULL;
+    if (entries[(i + 1) & mask].key != FLATHASH_EMPTY_KEY) {
+        entries[i].key = FLATHASH_DELETED_KEY;
+        return true;
+    }
+
+    entries[i].key = FLATHASH_EMPTY_KEY;
+    for (long p = 1; p < hashPtr->capacity; p++) {
+        long j = (i - p) & mask;
+        if (entries[j].key != FLATHASH_DELETED_KEY) {
+            break;
+        }
+        entries[j].key = FLATHASH_EMPTY_KEY;
+    }
+
+    return true;
+}
+
+
+/* =============================================================================
+ * flathash_bulkLoad
+ * -- Sizes the table once for numKey keys at half load and places them, so
+ *    no insert ever rehashes
+ * -- The map must be empty and the keys distinct
+ * -- Returns false on allocation failure, leaving the map empty
+ * =============================================================================
+ */
+bool
+flathash_bulkLoad (flathash_t* hashPtr, const long* keys, void** dataPtrs,
+                   long numKey)
+{
+    long capacity = FLATHASH_INIT_CAPACITY;
+    while (capacity < 2 * (numKey + 1)) {
+        capacity *= 2;
+    }
+
+    while (1) {
+        flathash_entry_t* entries = allocEntries(capacity);
+        if (entries == NULL) {
+            return false;
+        }
+        long shift = getShift(capacity);
+
+        long i;
+        for (i = 0; i < numKey; i++) {
+            assert(keys[i] != FLATHASH_EMPTY_KEY &&
+                   keys[i] != FLATHASH_DELETED_KEY);
+            if (!placeEntry(entries, capacity, shift, keys[i], dataPtrs[i])) {
+                break;
+            }
+        }
+
+        if (i == numKey) {
+            memory_free(hashPtr->entries);
+            hashPtr->entries = entries;
+            hashPtr->capacity = capacity;
+            hashPtr->shift = shift;
+            return true;
+        }
+
+        /* A window overflowed */
+        memory_free(entries);
+        capacity *= 2;
+    }
+}
+
+
+/* =============================================================================
+ * TEST_FLATHASH
+ * =============================================================================
+ */
+#ifdef TEST_FLATHASH
+
+
+#include <stdio.h>
+
+
+int
+main ()
+{
+    long numKey = 100000;
+    long k;
+
+    puts("Starting...");
+
+    flathash_t* hashPtr = flathash_alloc();
+    assert(hashPtr);
+
+    for (k = 0; k < numKey; k++) {
+        assert(flathash_insert(hashPtr, k * 3, (void*)(k + 1)));
+        assert(!flathash_insert(hashPtr, k * 3, (void*)(k + 1)));
+    }
+    printf("%li keys in %li slots\n", numKey, hashPtr->capacity);
+
+    for (k = 0; k < numKey * 3; k++) {
+        void* dataPtr = flathash_find(hashPtr, k);
+        assert(dataPtr == ((k % 3 == 0) ? (void*)(k / 3 + 1) : NULL));
+    }
+
+    /* Churn: removes leave tombstones that later inserts and rehashes reuse */
+    for (long r = 0; r < 10; r++) {
+        for (k = r % 2; k < numKey; k += 2) {
+            assert(flathash_remove(hashPtr, k * 3));
+            assert(!flathash_remove(hashPtr, k * 3));
+            assert(!flathash_contains(hashPtr, k * 3));
+        }
+        for (k = r % 2; k < numKey; k += 2) {
+            assert(flathash_insert(hashPtr, k * 3, (void*)(k + 1)));
+        }
+    }
+    printf("%li slots after churn\n", hashPtr->capacity);
+
+    for (k = 0; k < numKey; k++) {
+        assert(flathash_find(hashPtr, k * 3) == (void*)(k + 1));
+        assert(flathash_remove(hashPtr, k * 3));
+    }
+    for (long i = 0; i < hashPtr->capacity; i++) {
+        assert(hashPtr->entries[i].key == FLATHASH_EMPTY_KEY);
+    }
+
+    flathash_free(hashPtr);
+
+    /* A bulk load holds the same keys as the inserts did */
+    long* keys = (long*)malloc(numKey * sizeof(long));
+    void** dataPtrs = (void**)malloc(numKey * sizeof(void*));
+    assert(keys && dataPtrs);
+    for (k = 0; k < numKey; k++) {
+        keys[k] = k * 3;
+        dataPtrs[k] = (void*)(k + 1);
+    }
+    hashPtr = flathash_alloc();
+    assert(hashPtr);
+    assert(flathash_bulkLoad(hashPtr, keys, dataPtrs, numKey));
+    printf("%li keys in %li slots after bulk load\n", numKey, hashPtr->capacity);
+    for (k = 0; k < numKey * 3; k++) {
+        void* dataPtr = flathash_find(hashPtr, k);
+        assert(dataPtr == ((k % 3 == 0) ? (void*)(k / 3 + 1) : NULL));
+    }
+    assert(!flathash_insert(hashPtr, 0, (void*)1));
+    assert(flathash_insert(hashPtr, 1, (void*)1));
+    flathash_free(hashPtr);
+    free(keys);
+    free(dataPtrs);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_FLATHASH */
+
+
+/* =============================================================================
+ *
+ * End of flathash.cc
+ *
+ * =============================================================================
+ */
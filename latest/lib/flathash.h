@@ -0,0 +1,127 @@
+/* =============================================================================
+ *
+ * flathash.h
+ * -- Open-addressing hash map from long keys to pointers
+ *
+ * =============================================================================
+ *
+ * Keys and values are stored inline in one array of 16-byte entries, with
+ * linear probing from a Fibonacci hash of the key and a power-of-two
+ * capacity.  A lookup reads one or two cache lines and no other memory,
+ * where a tree reads one node per level.
+ *
+ * No key is ever more than FLATHASH_MAX_PROBE slots from its home slot, so
+ * no probe goes further.  An insert that finds no free slot in that window
+ * rehashes the table, at double the capacity unless mostly tombstones (the
+ * marks left by remove) are in the way.  There is no size field: inserts
+ * and removes of different keys only conflict if their probe windows
+ * overlap, or on such a rehash.
+ *
+ * LONG_MIN and LONG_MIN + 1 mark empty and removed slots and cannot be
+ * used as keys.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+#include <limits.h>
+
+enum flathash_config {
+    FLATHASH_INIT_CAPACITY = 16,
+    FLATHASH_MAX_PROBE     = 32
+};
+
+#define FLATHASH_EMPTY_KEY    (LONG_MIN)
+#define FLATHASH_DELETED_KEY  (LONG_MIN + 1)
+
+struct flathash_entry_t {
+    long key;
+    void* dataPtr;
+};
+
+struct flathash_t {
+    flathash_entry_t* entries;
+    long capacity;  /* a power of 2 */
+    long shift;     /* 64 - log2(capacity) */
+};
+
+
+/* =============================================================================
+ * flathash_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+flathash_t*
+flathash_alloc ();
+
+
+/* =============================================================================
+ * flathash_free
+ * -- Does not free the data
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+flathash_free (flathash_t* hashPtr);
+
+
+/* =============================================================================
+ * flathash_contains
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+flathash_contains (flathash_t* hashPtr, long key);
+
+
+/* =============================================================================
+ * flathash_find
+ * -- Returns NULL if not found, else the data
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void*
+flathash_find (flathash_t* hashPtr, long key);
+
+
+/* =============================================================================
+ * flathash_insert
+ * -- Returns false if the key is already present or on allocation failure
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+flathash_insert (flathash_t* hashPtr, long key, void* dataPtr);
+
+
+/* =============================================================================
+ * flathash_remove
+ * -- Returns true if successful, else false
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+flathash_remove (flathash_t* hashPtr, long key);
+
+
+/* =============================================================================
+ * flathash_bulkLoad
+ * -- Sizes the table once for numKey keys and places them, in O(n)
+ * -- The map must be empty and the keys distinct
+ * -- Returns false on allocation failure, leaving the map empty
+ * -- Not for use inside a transaction
+ * =============================================================================
+ */
+bool
+flathash_bulkLoad (flathash_t* hashPtr, const long* keys, void** dataPtrs,
+                   long numKey);
+
+
+#define TMFLATHASH_ALLOC()            flathash_alloc()
+#define TMFLATHASH_FREE(h)            flathash_free(h)
+#define TMFLATHASH_CONTAINS(h, k)     flathash_contains(h, (long)(k))
+#define TMFLATHASH_FIND(h, k)         flathash_find(h, (long)(k))
+#define TMFLATHASH_INSERT(h, k, d)    flathash_insert(h, (long)(k), (void*)(d))
+#define TMFLATHASH_REMOVE(h, k)       flathash_remove(h, (long)(k))
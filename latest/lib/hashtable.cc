@@ -84,11 +84,50 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "hashtable.h"
-#include "list.h"
+#include "memory.h"
+#include "smalllist.h"
 #include "pair.h"
 #include "tm.h"
 #include "tm_transition.h"
 
+/* =============================================================================
+ * TMhashtable_getChain
+ * -- Iteration visits buckets, then the old buckets not yet moved
+ * -- Returns NULL for a moved old bucket or past the end
+ * =============================================================================
+ */
+TM_SAFE
+smalllist_t*
+TMhashtable_getChain (hashtable_t* hashtablePtr, long bucket)
+{
+    long numBucket = hashtablePtr->numBucket;
+
+    if (bucket < numBucket) {
+        return hashtablePtr->buckets[bucket];
+    }
+
+    smalllist_t** oldBuckets = hashtablePtr->oldBuckets;
+    if (oldBuckets != NULL && bucket - numBucket < hashtablePtr->oldNumBucket) {
+        return oldBuckets[bucket - numBucket];
+    }
+
+    return NULL;
+}
+
+
+/* =============================================================================
+ * TMhashtable_getNumChain
+ * =============================================================================
+ */
+TM_SAFE
+long
+TMhashtable_getNumChain (hashtable_t* hashtablePtr)
+{
+    return (hashtablePtr->numBucket +
+            ((hashtablePtr->oldBuckets != NULL) ? hashtablePtr->oldNumBucket : 0));
+}
+
+
 /* =============================================================================
  * TMhashtable_iter_reset
  * =============================================================================
@@ -103,6 +142,35 @@ TMhashtable_iter_reset (
 }
 
 
+/* =============================================================================
+ * TMiterAdvance
+ * -- Moves it to the next bucket with a next element; returns false at end
+ * =============================================================================
+ */
+TM_SAFE
+static bool
+TMiterAdvance (hashtable_t* hashtablePtr, long* bucketPtr, smalllist_iter_t* itPtr)
+{
+    long numIterBucket = TMhashtable_getNumChain(hashtablePtr);
+    long bucket = *bucketPtr;
+
+    while (!TMLIST_ITER_HASNEXT(itPtr)) {
+        smalllist_t* chainPtr = NULL;
+        while (chainPtr == NULL) {
+            if (++bucket >= numIterBucket) {
+                *bucketPtr = bucket;
+                return false;
+            }
+            chainPtr = TMhashtable_getChain(hashtablePtr, bucket);
+        }
+        TMLIST_ITER_RESET(itPtr, chainPtr);
+    }
+
+    *bucketPtr = bucket;
+    return true;
+}
+
+
 /* =============================================================================
  * hashtable_iter_hasNext
  * =============================================================================
@@ -112,21 +180,10 @@ bool
 TMhashtable_iter_hasNext (
                           hashtable_iter_t* itPtr, hashtable_t* hashtablePtr)
 {
-    long bucket;
-    long numBucket = hashtablePtr->numBucket;
-    list_t** buckets = hashtablePtr->buckets;
-    list_iter_t it = itPtr->it;
-
-    for (bucket = itPtr->bucket; bucket < numBucket; /* inside body */) {
-        list_t* chainPtr = buckets[bucket];
-        if (TMLIST_ITER_HASNEXT(&it)) {
-            return true;
-        }
-        /* May use dummy bucket; see allocBuckets() */
-        TMLIST_ITER_RESET(&it, buckets[++bucket]);
-    }
+    long bucket = itPtr->bucket;
+    smalllist_iter_t it = itPtr->it;
 
-    return false;
+    return TMiterAdvance(hashtablePtr, &bucket, &it);
 }
 
 
@@ -139,21 +196,13 @@ void*
 TMhashtable_iter_next (
                        hashtable_iter_t* itPtr, hashtable_t* hashtablePtr)
 {
-    long bucket;
-    long numBucket = hashtablePtr->numBucket;
-    list_t** buckets = hashtablePtr->buckets;
-    list_iter_t it = itPtr->it;
+    long bucket = itPtr->bucket;
+    smalllist_iter_t it = itPtr->it;
     void* dataPtr = NULL;
 
-    for (bucket = itPtr->bucket; bucket < numBucket; /* inside body */) {
-        list_t* chainPtr = hashtablePtr->buckets[bucket];
-        if (TMLIST_ITER_HASNEXT(&it)) {
-            pair_t* pairPtr = (pair_t*)TMLIST_ITER_NEXT(&it);
-            dataPtr = pairPtr->secondPtr;
-            break;
-        }
-        /* May use dummy bucket; see allocBuckets() */
-        TMLIST_ITER_RESET(&it, buckets[++bucket]);
+    if (TMiterAdvance(hashtablePtr, &bucket, &it)) {
+        pair_t* pairPtr = (pair_t*)TMLIST_ITER_NEXT(&it);
+        dataPtr = pairPtr->secondPtr;
     }
 
     itPtr->bucket = bucket;
@@ -170,22 +219,22 @@ TMhashtable_iter_next (
  * =============================================================================
  */
 TM_SAFE
-list_t**
+smalllist_t**
 TMallocBuckets (
-                long numBucket, long (*comparePairs)(const pair_t*, const pair_t*))
+                long numBucket, TM_SAFE long (*comparePairs)(const pair_t*, const pair_t*))
 {
     long i;
-    list_t** buckets;
+    smalllist_t** buckets;
 
     /* Allocate bucket: extra bucket is dummy for easier iterator code */
-    buckets = (list_t**)malloc((numBucket + 1) * sizeof(list_t*));
+    buckets = (smalllist_t**)memory_alloc((numBucket + 1) * sizeof(smalllist_t*));
     if (buckets == NULL) {
         return NULL;
     }
 
     for (i = 0; i < (numBucket + 1); i++) {
-        list_t* chainPtr =
-            TMLIST_ALLOC((long (*)(const void*, const void*))comparePairs);
+        smalllist_t* chainPtr =
+            TMSMALLLIST_ALLOC((TM_SAFE long (*)(const void*, const void*))comparePairs);
         if (chainPtr == NULL) {
             while (--i >= 0) {
                 TMLIST_FREE(buckets[i]);
@@ -200,34 +249,74 @@ TMallocBuckets (
 
 
 
+/* =============================================================================
+ * hashKeyDefault
+ * -- For integer keys stored in the key pointer itself
+ * =============================================================================
+ */
+TM_SAFE
+static unsigned long
+hashKeyDefault (const void* keyPtr)
+{
+    return (unsigned long)keyPtr;
+}
+
+
+/* =============================================================================
+ * comparePairsDefault
+ * -- For integer keys stored in the key pointer itself
+ * =============================================================================
+ */
+TM_SAFE
+static long
+comparePairsDefault (const pair_t* a, const pair_t* b)
+{
+    long x = (long)a->firstPtr;
+    long y = (long)b->firstPtr;
+
+    return ((x < y) ? -1 : (x > y));
+}
+
+
 /* =============================================================================
  * TMhashtable_alloc
  * -- Returns NULL on failure
  * -- Negative values for resizeRatio or growthFactor select default values
+ * -- NULL hash or comparePairs select ones for integer keys
  * =============================================================================
  */
 TM_SAFE
 hashtable_t*
 TMhashtable_alloc (long initNumBucket,
-                   unsigned long (*hash)(const void*),
-                   long (*comparePairs)(const pair_t*, const pair_t*),
+                   TM_SAFE unsigned long (*hash)(const void*),
+                   TM_SAFE long (*comparePairs)(const pair_t*, const pair_t*),
                    long resizeRatio,
                    long growthFactor)
 {
     hashtable_t* hashtablePtr;
 
-    hashtablePtr = (hashtable_t*)malloc(sizeof(hashtable_t));
+    if (hash == NULL) {
+        hash = &hashKeyDefault;
+    }
+    if (comparePairs == NULL) {
+        comparePairs = &comparePairsDefault;
+    }
+
+    hashtablePtr = (hashtable_t*)memory_alloc(sizeof(hashtable_t));
     if (hashtablePtr == NULL) {
         return NULL;
     }
 
     hashtablePtr->buckets = TMallocBuckets(  initNumBucket, comparePairs);
     if (hashtablePtr->buckets == NULL) {
-        free(hashtablePtr);
+        memory_free(hashtablePtr);
         return NULL;
     }
 
     hashtablePtr->numBucket = initNumBucket;
+    hashtablePtr->oldBuckets = NULL;
+    hashtablePtr->oldNumBucket = 0;
+    hashtablePtr->migrateIndex = 0;
 #ifdef HASHTABLE_SIZE_FIELD
     hashtablePtr->size = 0;
 #endif
@@ -248,7 +337,7 @@ TMhashtable_alloc (long initNumBucket,
  */
 TM_SAFE
 void
-TMfreeBuckets (  list_t** buckets, long numBucket)
+TMfreeBuckets (  smalllist_t** buckets, long numBucket)
 {
     long i;
 
@@ -257,7 +346,7 @@ TMfreeBuckets (  list_t** buckets, long numBucket)
         TMLIST_FREE(buckets[i]);
     }
 
-    free(buckets);
+    memory_free(buckets);
 }
 
 
@@ -270,8 +359,17 @@ TM_SAFE
 void
 TMhashtable_free (  hashtable_t* hashtablePtr)
 {
+    smalllist_t** oldBuckets = hashtablePtr->oldBuckets;
+    if (oldBuckets != NULL) {
+        long i;
+        /* Moved buckets are already freed */
+        for (i = hashtablePtr->migrateIndex; i < hashtablePtr->oldNumBucket+1; i++) {
+            TMLIST_FREE(oldBuckets[i]);
+        }
+        memory_free(oldBuckets);
+    }
     TMfreeBuckets(  hashtablePtr->buckets, hashtablePtr->numBucket);
-    free(hashtablePtr);
+    memory_free(hashtablePtr);
 }
 
 
@@ -289,8 +387,9 @@ TMhashtable_isEmpty (  hashtable_t* hashtablePtr)
 #else
     long i;
 
-    for (i = 0; i < hashtablePtr->numBucket; i++) {
-        if (!TMLIST_ISEMPTY(hashtablePtr->buckets[i])) {
+    for (i = 0; i < TMhashtable_getNumChain(hashtablePtr); i++) {
+        smalllist_t* chainPtr = TMhashtable_getChain(hashtablePtr, i);
+        if (chainPtr != NULL && !TMLIST_ISEMPTY(chainPtr)) {
             return false;
         }
     }
@@ -316,8 +415,11 @@ TMhashtable_getSize (  hashtable_t* hashtablePtr)
     long i;
     long size = 0;
 
-    for (i = 0; i < hashtablePtr->numBucket; i++) {
-        size += TMLIST_GETSIZE(hashtablePtr->buckets[i]);
+    for (i = 0; i < TMhashtable_getNumChain(hashtablePtr); i++) {
+        smalllist_t* chainPtr = TMhashtable_getChain(hashtablePtr, i);
+        if (chainPtr != NULL) {
+            size += TMLIST_GETSIZE(chainPtr);
+        }
     }
 
     return size;
@@ -325,6 +427,29 @@ TMhashtable_getSize (  hashtable_t* hashtablePtr)
 }
 
 
+/* =============================================================================
+ * TMfindChain
+ * -- Returns the chain that holds or would hold a key with hash value h
+ * -- While resizing, that is the old chain until it has been moved
+ * =============================================================================
+ */
+TM_SAFE
+static smalllist_t*
+TMfindChain (hashtable_t* hashtablePtr, unsigned long h)
+{
+    smalllist_t** oldBuckets = hashtablePtr->oldBuckets;
+
+    if (oldBuckets != NULL) {
+        long i = (long)(h % hashtablePtr->oldNumBucket);
+        if (i >= hashtablePtr->migrateIndex) {
+            return oldBuckets[i];
+        }
+    }
+
+    return hashtablePtr->buckets[h % hashtablePtr->numBucket];
+}
+
+
 /* =============================================================================
  * TMhashtable_containsKey
  * =============================================================================
@@ -340,10 +465,9 @@ TMhashtable_containsKey (  hashtable_t* hashtablePtr, void* keyPtr)
     unsigned long (*hash)(const void*) TM_SAFE = hashtablePtr->hash;
 
     i = hash(keyPtr);
-    i = i % hashtablePtr->numBucket;
 
     findPair.firstPtr = keyPtr;
-    pairPtr = (pair_t*)TMLIST_FIND(hashtablePtr->buckets[i], &findPair);
+    pairPtr = (pair_t*)TMLIST_FIND(TMfindChain(hashtablePtr, i), &findPair);
 
     return ((pairPtr != NULL) ? true : false);
 }
@@ -366,10 +490,9 @@ TMhashtable_find (  hashtable_t* hashtablePtr, void* keyPtr)
     unsigned long (*hash)(const void*) TM_SAFE = hashtablePtr->hash;
 
     i = hash(keyPtr);
-    i = i % hashtablePtr->numBucket;
 
     findPair.firstPtr = keyPtr;
-    pairPtr = (pair_t*)TMLIST_FIND(hashtablePtr->buckets[i], &findPair);
+    pairPtr = (pair_t*)TMLIST_FIND(TMfindChain(hashtablePtr, i), &findPair);
     if (pairPtr == NULL) {
         return NULL;
     }
@@ -378,9 +501,103 @@ TMhashtable_find (  hashtable_t* hashtablePtr, void* keyPtr)
 }
 
 
-#if defined(HASHTABLE_RESIZABLE)
-#  warning "The hash table resizing must be disabled for TM"
-#endif /* HASHTABLE_RESIZABLE */
+/* =============================================================================
+ * TMmigrateStep
+ * -- Moves the next HASHTABLE_MIGRATE_STEP old buckets, if resizing
+ * -- The list nodes are reallocated, but the pairs are kept
+ * =============================================================================
+ */
+TM_SAFE
+static void
+TMmigrateStep (hashtable_t* hashtablePtr)
+{
+    smalllist_t** oldBuckets = hashtablePtr->oldBuckets;
+    if (oldBuckets == NULL) {
+        return;
+    }
+
+    unsigned long (*hash)(const void*) TM_SAFE = hashtablePtr->hash;
+    smalllist_t** buckets = hashtablePtr->buckets;
+    long numBucket = hashtablePtr->numBucket;
+    long oldNumBucket = hashtablePtr->oldNumBucket;
+    long index = hashtablePtr->migrateIndex;
+    long stop = index + HASHTABLE_MIGRATE_STEP;
+    if (stop > oldNumBucket) {
+        stop = oldNumBucket;
+    }
+
+    for (; index < stop; index++) {
+        smalllist_t* chainPtr = oldBuckets[index];
+        smalllist_iter_t it;
+        TMLIST_ITER_RESET(&it, chainPtr);
+        while (TMLIST_ITER_HASNEXT(&it)) {
+            pair_t* pairPtr = (pair_t*)TMLIST_ITER_NEXT(&it);
+            unsigned long i = hash(pairPtr->firstPtr) % numBucket;
+            bool status = TMLIST_INSERT(buckets[i], pairPtr);
+            assert(status);
+        }
+        TMLIST_FREE(chainPtr);
+        oldBuckets[index] = NULL;
+    }
+
+    if (index == oldNumBucket) {
+        /* And the extra bucket of TMallocBuckets */
+        TMLIST_FREE(oldBuckets[oldNumBucket]);
+        memory_free(oldBuckets);
+        hashtablePtr->oldBuckets = NULL;
+        hashtablePtr->oldNumBucket = 0;
+        index = 0;
+    }
+    hashtablePtr->migrateIndex = index;
+}
+
+
+/* =============================================================================
+ * TMisOverloaded
+ * -- Samples the chains from bucket i on; reads their sizes only
+ * =============================================================================
+ */
+TM_SAFE
+static bool
+TMisOverloaded (hashtable_t* hashtablePtr, unsigned long i)
+{
+    smalllist_t** buckets = hashtablePtr->buckets;
+    long numBucket = hashtablePtr->numBucket;
+    long numSample = ((numBucket < HASHTABLE_RESIZE_SAMPLE) ?
+                      numBucket : (long)HASHTABLE_RESIZE_SAMPLE);
+    long size = 0;
+    long s;
+
+    for (s = 0; s < numSample; s++) {
+        size += TMLIST_GETSIZE(buckets[(i + s) % numBucket]);
+    }
+
+    return (size > hashtablePtr->resizeRatio * numSample);
+}
+
+
+/* =============================================================================
+ * TMstartResize
+ * -- Installs the new buckets; TMmigrateStep moves the entries over later
+ * -- On allocation failure the table just keeps its size
+ * =============================================================================
+ */
+TM_SAFE
+static void
+TMstartResize (hashtable_t* hashtablePtr)
+{
+    long newNumBucket = hashtablePtr->numBucket * hashtablePtr->growthFactor;
+    smalllist_t** newBuckets = TMallocBuckets(newNumBucket, hashtablePtr->comparePairs);
+    if (newBuckets == NULL) {
+        return;
+    }
+
+    hashtablePtr->oldBuckets = hashtablePtr->buckets;
+    hashtablePtr->oldNumBucket = hashtablePtr->numBucket;
+    hashtablePtr->migrateIndex = 0;
+    hashtablePtr->buckets = newBuckets;
+    hashtablePtr->numBucket = newNumBucket;
+}
 
 
 /* =============================================================================
@@ -394,15 +611,16 @@ TMhashtable_insert (
 {
   //unsigned long (*hash)(const void*) TM_IFUNC_DECL = hashtablePtr->hash;
     unsigned long (*hash)(const void*) TM_SAFE = hashtablePtr->hash;
-    long numBucket = hashtablePtr->numBucket;
     unsigned long i;
 
+    TMmigrateStep(hashtablePtr);
+
     i = hash(keyPtr);
-    i = i % numBucket;
+    smalllist_t* chainPtr = TMfindChain(hashtablePtr, i);
 
     pair_t findPair;
     findPair.firstPtr = keyPtr;
-    pair_t* pairPtr = (pair_t*)TMLIST_FIND(hashtablePtr->buckets[i], &findPair);
+    pair_t* pairPtr = (pair_t*)TMLIST_FIND(chainPtr, &findPair);
     if (pairPtr != NULL) {
         return false;
     }
@@ -413,11 +631,21 @@ TMhashtable_insert (
     }
 
     /* Add new entry  */
-    if (TMLIST_INSERT(hashtablePtr->buckets[i], insertPtr) == false) {
+    if (TMLIST_INSERT(chainPtr, insertPtr) == false) {
         TMPAIR_FREE(insertPtr);
         return false;
     }
 
+    /* Only a long chain makes it look further */
+    if (hashtablePtr->resizeRatio > 0 &&
+        hashtablePtr->growthFactor > 1 &&
+        hashtablePtr->oldBuckets == NULL &&
+        TMLIST_GETSIZE(chainPtr) > hashtablePtr->resizeRatio &&
+        TMisOverloaded(hashtablePtr, i % hashtablePtr->numBucket))
+    {
+        TMstartResize(hashtablePtr);
+    }
+
 #ifdef HASHTABLE_SIZE_FIELD
     long newSize = TM_SHARED_READ(hashtablePtr->size) + 1;
     assert(newSize > 0);
@@ -438,17 +666,17 @@ TM_SAFE
 bool
 TMhashtable_remove (  hashtable_t* hashtablePtr, void* keyPtr)
 {
-    long numBucket = hashtablePtr->numBucket;
     //unsigned long (*hash)(const void*) TM_IFUNC_DECL = hashtablePtr->hash;
     unsigned long (*hash)(const void*) TM_SAFE = hashtablePtr->hash;
     unsigned long i;
-    list_t* chainPtr;
+    smalllist_t* chainPtr;
     pair_t* pairPtr;
     pair_t removePair;
 
+    TMmigrateStep(hashtablePtr);
+
     i = hash(keyPtr);
-    i = i % numBucket;
-    chainPtr = hashtablePtr->buckets[i];
+    chainPtr = TMfindChain(hashtablePtr, i);
 
     removePair.firstPtr = keyPtr;
     pairPtr = (pair_t*)TMLIST_FIND(chainPtr, &removePair);
@@ -461,7 +689,7 @@ TMhashtable_remove (  hashtable_t* hashtablePtr, void* keyPtr)
     TMPAIR_FREE(pairPtr);
 
 #ifdef HASHTABLE_SIZE_FIELD
-    TM_SHARED_WRITE(hashtablePtr->size
+    TM_SHARED_WRITE(hashtablePtr->size,
                     (long)TM_SHARED_READ(hashtablePtr->size)-1);
     assert(hashtablePtr->size >= 0);
 #endif
@@ -470,6 +698,83 @@ TMhashtable_remove (  hashtable_t* hashtablePtr, void* keyPtr)
 }
 
 
+/* =============================================================================
+ * unloadKeys
+ * -- Unlinks and frees the pairs of the first numKey keys, which a bulk
+ *    load linked in
+ * =============================================================================
+ */
+static void
+unloadKeys (hashtable_t* hashtablePtr, void** keyPtrs, long numKey)
+{
+    for (long k = 0; k < numKey; k++) {
+        unsigned long i = hashtablePtr->hash(keyPtrs[k]) % hashtablePtr->numBucket;
+        smalllist_t* chainPtr = hashtablePtr->buckets[i];
+        pair_t findPair;
+        findPair.firstPtr = keyPtrs[k];
+        pair_t* pairPtr = (pair_t*)TMLIST_FIND(chainPtr, &findPair);
+        assert(pairPtr != NULL);
+        bool status = TMLIST_REMOVE(chainPtr, &findPair);
+        assert(status);
+        TMPAIR_FREE(pairPtr);
+    }
+
+#ifdef HASHTABLE_SIZE_FIELD
+    hashtablePtr->size = 0;
+#endif
+}
+
+
+/* =============================================================================
+ * hashtable_bulkLoad
+ * -- Gives a resizable table one bucket per key up front, then links the
+ *    pairs straight into their chains, in O(n)
+ * -- The table must be empty and the keys distinct
+ * -- Returns false on allocation failure, with the table left empty
+ * =============================================================================
+ */
+bool
+hashtable_bulkLoad (hashtable_t* hashtablePtr,
+                    void** keyPtrs, void** dataPtrs, long numKey)
+{
+    assert(hashtablePtr->oldBuckets == NULL);
+    assert(TMhashtable_isEmpty(hashtablePtr));
+
+    if (hashtablePtr->resizeRatio > 0 &&
+        hashtablePtr->growthFactor > 1 &&
+        hashtablePtr->numBucket < numKey)
+    {
+        smalllist_t** buckets =
+            TMallocBuckets(numKey, hashtablePtr->comparePairs);
+        if (buckets == NULL) {
+            return false;
+        }
+        TMfreeBuckets(hashtablePtr->buckets, hashtablePtr->numBucket);
+        hashtablePtr->buckets = buckets;
+        hashtablePtr->numBucket = numKey;
+    }
+
+    for (long k = 0; k < numKey; k++) {
+        unsigned long i = hashtablePtr->hash(keyPtrs[k]) % hashtablePtr->numBucket;
+        pair_t* pairPtr = TMPAIR_ALLOC(keyPtrs[k], dataPtrs[k]);
+        if (pairPtr == NULL) {
+            unloadKeys(hashtablePtr, keyPtrs, k);
+            return false;
+        }
+        if (TMLIST_INSERT(hashtablePtr->buckets[i], pairPtr) == false) {
+            TMPAIR_FREE(pairPtr);
+            unloadKeys(hashtablePtr, keyPtrs, k);
+            return false;
+        }
+#ifdef HASHTABLE_SIZE_FIELD
+        hashtablePtr->size++;
+#endif
+    }
+
+    return true;
+}
+
+
 /* =============================================================================
  * TEST_HASHTABLE
  * =============================================================================
@@ -480,6 +785,7 @@ TMhashtable_remove (  hashtable_t* hashtablePtr, void* keyPtr)
 #include <stdio.h>
 
 
+TM_SAFE
 static unsigned long
 hash (const void* keyPtr)
 {
@@ -487,6 +793,7 @@ hash (const void* keyPtr)
 }
 
 
+TM_SAFE
 static long
 comparePairs (const pair_t* a, const pair_t* b)
 {
@@ -501,19 +808,19 @@ printHashtable (hashtable_t* hashtablePtr)
     hashtable_iter_t it;
 
     printf("[");
-    hashtable_iter_reset(&it, hashtablePtr);
-    while (hashtable_iter_hasNext(&it)) {
-        printf("%li ", *((long*)(hashtable_iter_next(&it, hashtablePtr))));
+    TMhashtable_iter_reset(&it, hashtablePtr);
+    while (TMhashtable_iter_hasNext(&it, hashtablePtr)) {
+        printf("%li ", *((long*)(TMhashtable_iter_next(&it, hashtablePtr))));
     }
     puts("]");
 
     /* Low-level to see structure */
     for (i = 0; i < hashtablePtr->numBucket; i++) {
-        list_iter_t it;
+        smalllist_iter_t it;
         printf("%2li: [", i);
         list_iter_reset(&it, hashtablePtr->buckets[i]);
         while (list_iter_hasNext(&it)) {
-            void* pairPtr = list_iter_next(&it, hashtablePtr->buckets[i]);
+            void* pairPtr = list_iter_next(&it);
             printf("%li ", *(long*)(((pair_t*)pairPtr)->secondPtr));
         }
         puts("]");
@@ -525,7 +832,7 @@ static void
 insertInt (hashtable_t* hashtablePtr, long* data)
 {
     printf("Inserting: %li\n", *data);
-    hashtable_insert(hashtablePtr, (void*)data, (void*)data);
+    TMhashtable_insert(hashtablePtr, (void*)data, (void*)data);
     printHashtable(hashtablePtr);
     puts("");
 }
@@ -535,7 +842,7 @@ static void
 removeInt (hashtable_t* hashtablePtr, long* data)
 {
     printf("Removing: %li\n", *data);
-    hashtable_remove(hashtablePtr, (void*)data);
+    TMhashtable_remove(hashtablePtr, (void*)data);
     printHashtable(hashtablePtr);
     puts("");
 }
@@ -550,19 +857,89 @@ main ()
 
     puts("Starting...");
 
-    hashtablePtr = hashtable_alloc(1, &hash, &comparePairs, -1, -1);
+    hashtablePtr = TMhashtable_alloc(1, &hash, &comparePairs, 0, 0);
 
     for (i = 0; data[i] >= 0; i++) {
         insertInt(hashtablePtr, &data[i]);
-        assert(*(long*)hashtable_find(hashtablePtr, &data[i]) == data[i]);
+        assert(*(long*)TMhashtable_find(hashtablePtr, &data[i]) == data[i]);
     }
 
     for (i = 0; data[i] >= 0; i++) {
         removeInt(hashtablePtr, &data[i]);
-        assert(hashtable_find(hashtablePtr, &data[i]) == NULL);
+        assert(TMhashtable_find(hashtablePtr, &data[i]) == NULL);
     }
 
-    hashtable_free(hashtablePtr);
+    TMhashtable_free(hashtablePtr);
+
+    /* Grow from one bucket, checking every key while entries move */
+    {
+        long numKey = 10000;
+        long* keys = (long*)malloc(numKey * sizeof(long));
+        long numResize = 0;
+        hashtable_iter_t it;
+        long k;
+
+        hashtablePtr = TMhashtable_alloc(1, &hash, &comparePairs, -1, -1);
+        for (k = 0; k < numKey; k++) {
+            keys[k] = k * 7919;
+            bool wasResizing = (hashtablePtr->oldBuckets != NULL);
+            assert(TMhashtable_insert(hashtablePtr, &keys[k], &keys[k]));
+            if (!wasResizing && hashtablePtr->oldBuckets != NULL) {
+                numResize++;
+            }
+            assert(TMhashtable_getSize(hashtablePtr) == k + 1);
+            assert(TMhashtable_find(hashtablePtr, &keys[k / 2]) == &keys[k / 2]);
+        }
+        for (k = 0; k < numKey; k++) {
+            assert(TMhashtable_containsKey(hashtablePtr, &keys[k]));
+        }
+        k = 0;
+        TMhashtable_iter_reset(&it, hashtablePtr);
+        while (TMhashtable_iter_hasNext(&it, hashtablePtr)) {
+            TMhashtable_iter_next(&it, hashtablePtr);
+            k++;
+        }
+        assert(k == numKey);
+        printf("%li keys, %li buckets after %li resizes\n",
+               numKey, hashtablePtr->numBucket, numResize);
+        assert(numResize > 0);
+        for (k = 0; k < numKey; k += 2) {
+            assert(TMhashtable_remove(hashtablePtr, &keys[k]));
+        }
+        assert(TMhashtable_getSize(hashtablePtr) == numKey / 2);
+        TMhashtable_free(hashtablePtr);
+
+        /* A bulk load sizes the table once and holds the same keys */
+        void** keyPtrs = (void**)malloc(numKey * sizeof(void*));
+        for (k = 0; k < numKey; k++) {
+            keyPtrs[k] = &keys[k];
+        }
+        hashtablePtr = TMhashtable_alloc(1, &hash, &comparePairs, -1, -1);
+        assert(hashtable_bulkLoad(hashtablePtr, keyPtrs, keyPtrs, numKey));
+        assert(hashtablePtr->numBucket == numKey);
+        assert(TMhashtable_getSize(hashtablePtr) == numKey);
+        for (k = 0; k < numKey; k++) {
+            assert(TMhashtable_find(hashtablePtr, &keys[k]) == &keys[k]);
+        }
+        assert(!TMhashtable_insert(hashtablePtr, &keys[0], &keys[0]));
+        TMhashtable_free(hashtablePtr);
+
+        /* NULL hash and comparePairs take the integer key itself */
+        for (k = 0; k < numKey; k++) {
+            keyPtrs[k] = (void*)(k + 1);
+        }
+        hashtablePtr = TMhashtable_alloc(1, NULL, NULL, -1, -1);
+        assert(hashtable_bulkLoad(hashtablePtr, keyPtrs, keyPtrs, numKey));
+        for (k = 0; k < numKey; k++) {
+            assert(TMhashtable_find(hashtablePtr, (void*)(k + 1)) == (void*)(k + 1));
+        }
+        assert(TMhashtable_find(hashtablePtr, (void*)(numKey + 1)) == NULL);
+        assert(TMhashtable_remove(hashtablePtr, (void*)1));
+        assert(!TMhashtable_containsKey(hashtablePtr, (void*)1));
+        TMhashtable_free(hashtablePtr);
+        free(keyPtrs);
+        free(keys);
+    }
 
     puts("Done.");
 
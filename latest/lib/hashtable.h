@@ -83,17 +83,30 @@
 
 #pragma once
 
-#include "list.h"
+#include "smalllist.h"
 #include "pair.h"
 
+/*
+ * Resizing: an insert that lands in a chain longer than resizeRatio samples
+ * HASHTABLE_RESIZE_SAMPLE chains from there; if they average more than
+ * resizeRatio too, it allocates numBucket * growthFactor new buckets.  The
+ * old buckets are then moved over HASHTABLE_MIGRATE_STEP at a time by every
+ * following insert and remove, so no single transaction rehashes the table.
+ * resizeRatio 0 or growthFactor below 2 keep the size fixed.
+ */
 enum hashtable_config {
     HASHTABLE_DEFAULT_RESIZE_RATIO  = 3,
-    HASHTABLE_DEFAULT_GROWTH_FACTOR = 3
+    HASHTABLE_DEFAULT_GROWTH_FACTOR = 3,
+    HASHTABLE_RESIZE_SAMPLE         = 16,
+    HASHTABLE_MIGRATE_STEP          = 2
 };
 
 struct hashtable_t {
-    list_t** buckets;
+    smalllist_t** buckets;
     long numBucket;
+    smalllist_t** oldBuckets;  /* non-NULL while moving entries into buckets */
+    long oldNumBucket;
+    long migrateIndex;    /* oldBuckets below this are moved (and NULL) */
 #ifdef HASHTABLE_SIZE_FIELD
     long size;
 #endif
@@ -108,11 +121,33 @@ struct hashtable_t {
 
 struct hashtable_iter_t {
     long bucket;
-    list_iter_t it;
+    smalllist_iter_t it;
 };
 
 
 
+/* =============================================================================
+ * TMhashtable_getNumChain
+ * -- Number of chains to visit to see every element, including those in
+ *    old buckets not yet moved by a resize
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+long
+TMhashtable_getNumChain (hashtable_t* hashtablePtr);
+
+
+/* =============================================================================
+ * TMhashtable_getChain
+ * -- Returns chain i, 0 <= i < TMhashtable_getNumChain(), or NULL if that
+ *    old bucket has been moved
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+smalllist_t*
+TMhashtable_getChain (hashtable_t* hashtablePtr, long i);
+
+
 /* =============================================================================
  * TMhashtable_iter_reset
  * =============================================================================
@@ -148,14 +183,17 @@ TMhashtable_iter_next (hashtable_iter_t* itPtr, hashtable_t* hashtablePtr);
  * TMhashtable_alloc
  * -- Returns NULL on failure
  * -- Negative values for resizeRatio or growthFactor select default values
+ * -- See hashtable_config for how they control resizing
+ * -- NULL hash or comparePairs select ones for integer keys stored in the
+ *    key pointer itself
  * =============================================================================
  */
 __attribute__((transaction_safe))
 hashtable_t*
 TMhashtable_alloc (
                    long initNumBucket,
-                   unsigned long (*hash)(const void*),
-                   long (*comparePairs)(const pair_t*, const pair_t*),
+                   __attribute__((transaction_safe)) unsigned long (*hash)(const void*),
+                   __attribute__((transaction_safe)) long (*comparePairs)(const pair_t*, const pair_t*),
                    long resizeRatio,
                    long growthFactor);
 
@@ -231,6 +269,20 @@ bool
 TMhashtable_remove (hashtable_t* hashtablePtr, void* keyPtr);
 
 
+/* =============================================================================
+ * hashtable_bulkLoad
+ * -- Gives a resizable table one bucket per key up front, then links the
+ *    pairs straight into their chains, in O(n)
+ * -- The table must be empty and the keys distinct
+ * -- Returns false on allocation failure, with the table left empty
+ * -- Not for use inside a transaction
+ * =============================================================================
+ */
+bool
+hashtable_bulkLoad (hashtable_t* hashtablePtr,
+                    void** keyPtrs, void** dataPtrs, long numKey);
+
+
 #define TMHASHTABLE_ITER_RESET(it, ht)    TMhashtable_iter_reset(  it, ht)
 #define TMHASHTABLE_ITER_HASNEXT(it, ht)  TMhashtable_iter_hasNext(  it, ht)
 #define TMHASHTABLE_ITER_NEXT(it, ht)     TMhashtable_iter_next(  it, ht)
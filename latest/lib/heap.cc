@@ -69,36 +69,40 @@
  */
 
 
-#include <stdlib.h>
 #include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include "heap.h"
+#include "memory.h"
 #include "tm.h"
+#include "tm_transition.h"
 
-struct heap_t {
-    void** elements;
-    long size;
-    long capacity;
-    // [wer] mark the comparator TM_SAFE
-    TM_SAFE long (*compare)(const void*, const void*);
-};
 
+/* Indices are into heapPtr->entries, where the root is at HEAP_ROOT */
+#define PARENT(i)       ((i) / HEAP_ARITY + HEAP_ROOT - 1)
+#define FIRST_CHILD(i)  (HEAP_ARITY * ((i) - HEAP_ROOT + 1))
 
-#define PARENT(i)       ((i) / 2)
-#define LEFT_CHILD(i)   (2*i)
-#define RIGHT_CHILD(i)  (2*(i) + 1)
 
 /* =============================================================================
- * DECLARATION OF TM_SAFE FUNCTIONS
+ * allocEntries
+ * -- Aligns the array so that each group of siblings fills one cache line
+ * -- Returns NULL on failure
  * =============================================================================
  */
-
 TM_SAFE
-void
-siftUp (heap_t* heapPtr, long startIndex);
+static heap_entry_t*
+allocEntries (long capacity, void** memoryPtrPtr)
+{
+    void* memoryPtr =
+        memory_alloc((capacity + HEAP_ROOT) * sizeof(heap_entry_t) + 63);
+    if (memoryPtr == NULL) {
+        return NULL;
+    }
+    *memoryPtrPtr = memoryPtr;
 
-TM_SAFE
-void
-TMheapify (heap_t* heapPtr, long startIndex);
+    return (heap_entry_t*)(((uintptr_t)memoryPtr + 63) & ~(uintptr_t)63);
+}
 
 
 /* =============================================================================
@@ -106,19 +110,18 @@ TMheapify (heap_t* heapPtr, long startIndex);
  * -- Returns NULL on failure
  * =============================================================================
  */
+TM_SAFE
 heap_t*
-heap_alloc (long initCapacity, long (*compare)(const void*, const void*))
+heap_alloc (long initCapacity)
 {
     heap_t* heapPtr;
 
-    heapPtr = (heap_t*)malloc(sizeof(heap_t));
+    heapPtr = (heap_t*)memory_alloc(sizeof(heap_t));
     if (heapPtr) {
-        long capacity = ((initCapacity > 0) ? (initCapacity) : (1));
-        heapPtr->elements = (void**)malloc(capacity * sizeof(void*));
-        assert(heapPtr->elements);
-        heapPtr->size = 0;
-        heapPtr->capacity = capacity;
-        heapPtr->compare = compare;
+        if (!heap_init(heapPtr, initCapacity)) {
+            memory_free(heapPtr);
+            return NULL;
+        }
     }
 
     return heapPtr;
@@ -129,224 +132,146 @@ heap_alloc (long initCapacity, long (*compare)(const void*, const void*))
  * heap_free
  * =============================================================================
  */
+TM_SAFE
 void
 heap_free (heap_t* heapPtr)
 {
-    free(heapPtr->elements);
-    free(heapPtr);
+    heap_destroy(heapPtr);
+    memory_free(heapPtr);
 }
 
 
 /* =============================================================================
- * siftUp
+ * heap_init
+ * -- Returns false on failure
  * =============================================================================
  */
 TM_SAFE
-void siftUp (heap_t* heapPtr, long startIndex)
+bool
+heap_init (heap_t* heapPtr, long initCapacity)
 {
-    void** elements = heapPtr->elements;
-    long TM_SAFE (*compare)(const void*, const void*) = heapPtr->compare;
+    long capacity = ((initCapacity > 0) ? (initCapacity) : (1));
 
-    long index = startIndex;
-    while ((index > 1)) {
-        long parentIndex = PARENT(index);
-        void* parentPtr = elements[parentIndex];
-        void* thisPtr   = elements[index];
-        if (compare(parentPtr, thisPtr) >= 0) {
-            break;
-        }
-        void* tmpPtr = parentPtr;
-        elements[parentIndex] = thisPtr;
-        elements[index] = tmpPtr;
-        index = parentIndex;
+    heapPtr->entries = allocEntries(capacity, &heapPtr->memoryPtr);
+    if (heapPtr->entries == NULL) {
+        return false;
     }
+    heapPtr->size = 0;
+    heapPtr->capacity = capacity;
+
+    return true;
 }
 
 
 /* =============================================================================
- * heap_insert
- * -- Returns false on failure
+ * heap_destroy
  * =============================================================================
  */
 TM_SAFE
-bool
-heap_insert (heap_t* heapPtr, void* dataPtr)
+void
+heap_destroy (heap_t* heapPtr)
 {
-    long size = heapPtr->size;
-    long capacity = heapPtr->capacity;
-
-    if ((size + 1) >= capacity) {
-        long newCapacity = capacity * 2;
-        void** newElements = (void**)malloc(newCapacity * sizeof(void*));
-        if (newElements == NULL) {
-            return false;
-        }
-        heapPtr->capacity = newCapacity;
-        long i;
-        void** elements = heapPtr->elements;
-        for (i = 0; i <= size; i++) {
-            newElements[i] = elements[i];
-        }
-        free(heapPtr->elements);
-        heapPtr->elements = newElements;
-    }
-    size ++;
-    heapPtr->size = size;
-    //size = ++(heapPtr->size);
-    heapPtr->elements[size] = dataPtr;
-    siftUp(heapPtr, size);
-
-    return true;
+    memory_free(heapPtr->memoryPtr);
 }
 
 
 /* =============================================================================
- * TMheap_insert
- * -- Returns false on failure
+ * siftUp
+ * -- Moves the hole at index up past smaller parents, then fills it
  * =============================================================================
  */
-#if 0
 TM_SAFE
-bool
-TMheap_insert (  heap_t* heapPtr, void* dataPtr)
+static void
+siftUp (heap_entry_t* entries, long index, long key, void* dataPtr)
 {
-    long size = (long)TM_SHARED_READ(heapPtr->size);
-    long capacity = (long)TM_SHARED_READ(heapPtr->capacity);
-
-    if ((size + 1) >= capacity) {
-        long newCapacity = capacity * 2;
-        void** newElements = (void**)TM_MALLOC(newCapacity * sizeof(void*));
-        if (newElements == NULL) {
-            return false;
-        }
-        TM_SHARED_WRITE(heapPtr->capacity, newCapacity);
-        long i;
-        void** elements = (void **)TM_SHARED_READ_P(heapPtr->elements);
-        for (i = 0; i <= size; i++) {
-            newElements[i] = (void*)TM_SHARED_READ_P(elements[i]);
+    while (index > HEAP_ROOT) {
+        long parentIndex = PARENT(index);
+        if (entries[parentIndex].key >= key) {
+            break;
         }
-        free(heapPtr->elements);
-        TM_SHARED_WRITE_P(heapPtr->elements, newElements);
+        entries[index] = entries[parentIndex];
+        index = parentIndex;
     }
 
-    size++;
-    TM_SHARED_WRITE(heapPtr->size, size);
-    void** elements = (void**)TM_SHARED_READ_P(heapPtr->elements);
-    TM_SHARED_WRITE_P(elements[size], dataPtr);
-    siftUp(heapPtr, size);
-
-    return true;
+    entries[index].key = key;
+    entries[index].dataPtr = dataPtr;
 }
-#endif
+
 
 /* =============================================================================
- * heapify
+ * siftDown
+ * -- Moves the hole at index down past larger children, then fills it
  * =============================================================================
  */
-#if 0
+TM_SAFE
 static void
-heapify (heap_t* heapPtr, long startIndex)
+siftDown (heap_entry_t* entries, long end, long index, long key, void* dataPtr)
 {
-    void** elements = heapPtr->elements;
-    long (*compare)(const void*, const void*) = heapPtr->compare;
-
-    long size = heapPtr->size;
-    long index = startIndex;
-
     while (1) {
-
-        long leftIndex = LEFT_CHILD(index);
-        long rightIndex = RIGHT_CHILD(index);
-        long maxIndex = -1;
-
-        if ((leftIndex <= size) &&
-            (compare(elements[leftIndex], elements[index]) > 0))
-        {
-            maxIndex = leftIndex;
-        } else {
-            maxIndex = index;
+        long childIndex = FIRST_CHILD(index);
+        if (childIndex >= end) {
+            break;
         }
-
-        if ((rightIndex <= size) &&
-            (compare(elements[rightIndex], elements[maxIndex]) > 0))
-        {
-            maxIndex = rightIndex;
+        long lastIndex = childIndex + HEAP_ARITY;
+        if (lastIndex > end) {
+            lastIndex = end;
         }
-
-        if (maxIndex == index) {
+        long maxIndex = childIndex;
+        long maxKey = entries[childIndex].key;
+        for (long c = childIndex + 1; c < lastIndex; c++) {
+            if (entries[c].key > maxKey) {
+                maxIndex = c;
+                maxKey = entries[c].key;
+            }
+        }
+        if (maxKey <= key) {
             break;
-        } else {
-            void* tmpPtr = elements[index];
-            elements[index] = elements[maxIndex];
-            elements[maxIndex] = tmpPtr;
-            index = maxIndex;
         }
+        entries[index] = entries[maxIndex];
+        index = maxIndex;
     }
+
+    entries[index].key = key;
+    entries[index].dataPtr = dataPtr;
 }
-#endif
+
 
 /* =============================================================================
- * TMheapify
+ * heap_insert
+ * -- Returns false on failure
  * =============================================================================
  */
 TM_SAFE
-void
-TMheapify (  heap_t* heapPtr, long startIndex)
+bool
+heap_insert (heap_t* heapPtr, long key, void* dataPtr)
 {
-    void** elements = (void**)TM_SHARED_READ_P(heapPtr->elements);
-    //long (*compare)(const void*, const void*) TM_IFUNC_DECL = heapPtr->compare;
-    long (*compare)(const void*, const void*) TM_SAFE = heapPtr->compare;
-
-    long size = (long)TM_SHARED_READ(heapPtr->size);
-    long index = startIndex;
-
-    while (1) {
-        long leftIndex = LEFT_CHILD(index);
-        long rightIndex = RIGHT_CHILD(index);
-        long maxIndex = -1;
-
-        if (leftIndex <= size)
-        {
-            long ret;
-            void *e1, *e2;
-
-            e1 = (void*)TM_SHARED_READ_P(elements[leftIndex]);
-            e2 = (void*)TM_SHARED_READ_P(elements[index]);
-            ret = compare(e1, e2);
-
-            if (ret > 0)
-                maxIndex = leftIndex;
-            else
-                maxIndex = index;
-        } else {
-            maxIndex = index;
-        }
-
-        if (rightIndex <= size)
-        {
-            long ret;
-            void *e1, *e2;
-
-            e1 = (void*)TM_SHARED_READ_P(elements[rightIndex]);
-            e2 = (void*)TM_SHARED_READ_P(elements[maxIndex]);
-            ret = compare(e1, e2);
+    long size = heapPtr->size;
+    long capacity = heapPtr->capacity;
 
-            if (ret > 0)
-                maxIndex = rightIndex;
+    if (size >= capacity) {
+        long newCapacity = capacity * 2;
+        void* newMemoryPtr;
+        heap_entry_t* newEntries = allocEntries(newCapacity, &newMemoryPtr);
+        if (newEntries == NULL) {
+            return false;
         }
-
-        if (maxIndex == index) {
-            break;
-        } else {
-            void* tmpPtr = (void*)TM_SHARED_READ_P(elements[index]);
-            TM_SHARED_WRITE_P(elements[index],
-                              (void*)TM_SHARED_READ_P(elements[maxIndex]));
-            TM_SHARED_WRITE_P(elements[maxIndex], tmpPtr);
-            index = maxIndex;
+        heap_entry_t* entries = heapPtr->entries;
+        for (long i = HEAP_ROOT; i < HEAP_ROOT + size; i++) {
+            newEntries[i] = entries[i];
         }
+        memory_free(heapPtr->memoryPtr);
+        heapPtr->entries = newEntries;
+        heapPtr->memoryPtr = newMemoryPtr;
+        heapPtr->capacity = newCapacity;
     }
+
+    heapPtr->size = size + 1;
+    siftUp(heapPtr->entries, (HEAP_ROOT + size), key, dataPtr);
+
+    return true;
 }
 
+
 /* =============================================================================
  * heap_remove
  * -- Returns NULL if empty
@@ -362,15 +287,43 @@ heap_remove (heap_t* heapPtr)
         return NULL;
     }
 
-    void** elements = heapPtr->elements;
-    void* dataPtr = elements[1];
-    elements[1] = elements[size];
+    heap_entry_t* entries = heapPtr->entries;
+    void* dataPtr = entries[HEAP_ROOT].dataPtr;
+    long end = HEAP_ROOT + size - 1;
     heapPtr->size = size - 1;
-    TMheapify(heapPtr, 1);
+    if (size > 1) {
+        siftDown(entries, end, HEAP_ROOT, entries[end].key, entries[end].dataPtr);
+    }
 
     return dataPtr;
 }
 
+
+/* =============================================================================
+ * heap_peekKey
+ * -- Returns the largest key, or LONG_MIN if empty
+ * =============================================================================
+ */
+TM_SAFE
+long
+heap_peekKey (heap_t* heapPtr)
+{
+    return ((heapPtr->size > 0) ? heapPtr->entries[HEAP_ROOT].key : LONG_MIN);
+}
+
+
+/* =============================================================================
+ * heap_getSize
+ * =============================================================================
+ */
+TM_SAFE
+long
+heap_getSize (heap_t* heapPtr)
+{
+    return heapPtr->size;
+}
+
+
 /* =============================================================================
  * heap_isValid
  * =============================================================================
@@ -378,13 +331,12 @@ heap_remove (heap_t* heapPtr)
 bool
 heap_isValid (heap_t* heapPtr)
 {
-    long size = heapPtr->size;
-    long (*compare)(const void*, const void*) = heapPtr->compare;
-    void** elements = heapPtr->elements;
+    heap_entry_t* entries = heapPtr->entries;
+    long end = HEAP_ROOT + heapPtr->size;
 
     long i;
-    for (i = 1; i < size; i++) {
-        if (compare(elements[i+1], elements[PARENT(i+1)]) > 0) {
+    for (i = HEAP_ROOT + 1; i < end; i++) {
+        if (entries[i].key > entries[PARENT(i)].key) {
             return false;
         }
     }
@@ -400,17 +352,9 @@ heap_isValid (heap_t* heapPtr)
 #ifdef TEST_HEAP
 
 
-#include <assert.h>
 #include <stdio.h>
 
 
-static long
-compare (const void* a, const void* b)
-{
-    return (*((const long*)a) - *((const long*)b));
-}
-
-
 static void
 printHeap (heap_t* heapPtr)
 {
@@ -418,7 +362,7 @@ printHeap (heap_t* heapPtr)
 
     long i;
     for (i = 0; i < heapPtr->size; i++) {
-        printf("%li ", *(long*)heapPtr->elements[i+1]);
+        printf("%li ", heapPtr->entries[HEAP_ROOT + i].key);
     }
 
     puts("]");
@@ -429,19 +373,20 @@ static void
 insertInt (heap_t* heapPtr, long* data)
 {
     printf("Inserting: %li\n", *data);
-    assert(heap_insert(heapPtr, (void*)data));
+    assert(heap_insert(heapPtr, *data, (void*)data));
     printHeap(heapPtr);
     assert(heap_isValid(heapPtr));
 }
 
 
-static void
+static long
 removeInt (heap_t* heapPtr)
 {
-    long* data = heap_remove(heapPtr);
+    long* data = (long*)heap_remove(heapPtr);
     printf("Removing: %li\n", *data);
     printHeap(heapPtr);
     assert(heap_isValid(heapPtr));
+    return *data;
 }
 
 
@@ -454,20 +399,51 @@ main ()
 {
     puts("Starting...");
 
-    heap_t* heapPtr = heap_alloc(1, compare);
+    heap_t* heapPtr = heap_alloc(1);
 
     assert(heapPtr);
+    assert(((uintptr_t)&heapPtr->entries[HEAP_ROOT + 1] & 63) == 0);
 
     long i;
     for (i = 0; i < global_numData; i++) {
         insertInt(heapPtr, &global_data[i]);
     }
 
+    long last = LONG_MAX;
     for (i = 0; i < global_numData; i++) {
-        removeInt(heapPtr);
+        assert(heap_peekKey(heapPtr) <= last);
+        long key = removeInt(heapPtr);
+        assert(key <= last);
+        last = key;
     }
 
     assert(heap_remove(heapPtr) == NULL); /* empty */
+    assert(heap_peekKey(heapPtr) == LONG_MIN);
+
+    /* Random interleaving of inserts and removes */
+    srand(0);
+    long numRemove = 0;
+    for (i = 0; i < 100000; i++) {
+        if (rand() % 3) {
+            long key = rand() % 1000;
+            assert(heap_insert(heapPtr, key, (void*)(key + 1)));
+        } else if (heap_getSize(heapPtr) > 0) {
+            long key = heap_peekKey(heapPtr);
+            assert(heap_remove(heapPtr) == (void*)(key + 1));
+            numRemove++;
+        }
+        if (i % 1000 == 0) {
+            assert(heap_isValid(heapPtr));
+        }
+    }
+    printf("%li removes, %li left\n", numRemove, heap_getSize(heapPtr));
+    last = LONG_MAX;
+    while (heap_getSize(heapPtr) > 0) {
+        long key = heap_peekKey(heapPtr);
+        assert(key <= last);
+        heap_remove(heapPtr);
+        last = key;
+    }
 
     heap_free(heapPtr);
 
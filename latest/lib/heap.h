@@ -70,7 +70,30 @@
 
 #pragma once
 
-struct heap_t;
+/*
+ * Max-heap of (key, data) pairs.  The key sits inline next to its pointer,
+ * so a sift compares longs without calling out or touching the data, and
+ * each node has four children: one 64-byte line holds all the entries a
+ * sift-down step compares, and the tree is half as deep as a binary one.
+ */
+
+struct heap_entry_t {
+    long key;
+    void* dataPtr;
+};
+
+struct heap_t {
+    heap_entry_t* entries;  /* entries[HEAP_ROOT] is the root */
+    void* memoryPtr;        /* block entries points into */
+    long size;
+    long capacity;
+};
+
+enum heap_config {
+    HEAP_ARITY = 4,
+    /* Offset of the root, so that every group of siblings starts a line */
+    HEAP_ROOT  = HEAP_ARITY - 1
+};
 
 
 /* =============================================================================
@@ -78,20 +101,42 @@ struct heap_t;
  * -- Returns NULL on failure
  * =============================================================================
  */
-//[wer210] called once in yada, outside of tx
+__attribute__((transaction_safe))
 heap_t*
-heap_alloc (long initCapacity, long (*compare)(const void*, const void*));
+heap_alloc (long initCapacity);
 
 
 /* =============================================================================
  * heap_free
+ * -- Does not free the data
  * =============================================================================
  */
-// [wer210] never called
+__attribute__((transaction_safe))
 void
 heap_free (heap_t* heapPtr);
 
 
+/* =============================================================================
+ * heap_init
+ * -- heap_alloc for a heap_t placed by the caller, e.g., padded to a line
+ * -- Returns false on failure
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+heap_init (heap_t* heapPtr, long initCapacity);
+
+
+/* =============================================================================
+ * heap_destroy
+ * -- Frees what heap_init allocated; does not free the data
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+heap_destroy (heap_t* heapPtr);
+
+
 /* =============================================================================
  * heap_insert
  * -- Returns false on failure
@@ -99,10 +144,12 @@ heap_free (heap_t* heapPtr);
  */
 __attribute__((transaction_safe))
 bool
-heap_insert (heap_t* heapPtr, void* dataPtr);
+heap_insert (heap_t* heapPtr, long key, void* dataPtr);
+
 
 /* =============================================================================
  * heap_remove
+ * -- Removes an element with the largest key
  * -- Returns NULL if empty
  * =============================================================================
  */
@@ -111,14 +158,36 @@ void*
 heap_remove (heap_t* heapPtr);
 
 
+/* =============================================================================
+ * heap_peekKey
+ * -- Returns the largest key, or LONG_MIN if empty
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+long
+heap_peekKey (heap_t* heapPtr);
+
+
+/* =============================================================================
+ * heap_getSize
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+long
+heap_getSize (heap_t* heapPtr);
+
+
 /* =============================================================================
  * heap_isValid
  * =============================================================================
  */
-// [wer210] never called
 bool
 heap_isValid (heap_t* heapPtr);
 
 
-#define TMHEAP_INSERT(h, d)             heap_insert((h), (d))
+#define TMHEAP_ALLOC(c)                 heap_alloc(c)
+#define TMHEAP_FREE(h)                  heap_free(h)
+#define TMHEAP_INSERT(h, k, d)          heap_insert((h), (long)(k), (void*)(d))
 #define TMHEAP_REMOVE(h)                heap_remove((h))
+#define TMHEAP_PEEKKEY(h)               heap_peekKey((h))
+#define TMHEAP_GETSIZE(h)               heap_getSize((h))
@@ -0,0 +1,241 @@
+/* =============================================================================
+ *
+ * histogram.cc
+ * -- Log-bucketed histogram of unsigned values, for latency percentiles
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include "histogram.h"
+#include "memory.h"
+
+
+/* =============================================================================
+ * getHighestInBucket
+ * -- Inverse of histogram_getBucket: the largest value the bucket counts
+ * =============================================================================
+ */
+static unsigned long
+getHighestInBucket (long bucket)
+{
+    if (bucket < HISTOGRAM_NUM_SUB) {
+        return (unsigned long)bucket;
+    }
+
+    long shift = bucket / HISTOGRAM_NUM_SUB - 1;
+    unsigned long mantissa = (unsigned long)(bucket - shift * HISTOGRAM_NUM_SUB);
+
+    return (((mantissa + 1) << shift) - 1);
+}
+
+
+/* =============================================================================
+ * histogram_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+histogram_t*
+histogram_alloc ()
+{
+    histogram_t* histogramPtr = (histogram_t*)memory_alloc(sizeof(histogram_t));
+    if (histogramPtr == NULL) {
+        return NULL;
+    }
+
+    histogram_clear(histogramPtr);
+
+    return histogramPtr;
+}
+
+
+/* =============================================================================
+ * histogram_free
+ * =============================================================================
+ */
+void
+histogram_free (histogram_t* histogramPtr)
+{
+    memory_free(histogramPtr);
+}
+
+
+/* =============================================================================
+ * histogram_clear
+ * =============================================================================
+ */
+void
+histogram_clear (histogram_t* histogramPtr)
+{
+    memset(histogramPtr, 0, sizeof(histogram_t));
+}
+
+
+/* =============================================================================
+ * histogram_merge
+ * -- Adds the values of srcPtr to dstPtr
+ * =============================================================================
+ */
+void
+histogram_merge (histogram_t* dstPtr, const histogram_t* srcPtr)
+{
+    if (srcPtr->count == 0) {
+        return;
+    }
+
+    for (long b = 0; b < HISTOGRAM_NUM_BUCKET; b++) {
+        dstPtr->buckets[b] += srcPtr->buckets[b];
+    }
+    if (dstPtr->count == 0 || srcPtr->min < dstPtr->min) {
+        dstPtr->min = srcPtr->min;
+    }
+    if (srcPtr->max > dstPtr->max) {
+        dstPtr->max = srcPtr->max;
+    }
+    dstPtr->count += srcPtr->count;
+    dstPtr->sum += srcPtr->sum;
+}
+
+
+/* =============================================================================
+ * histogram_getPercentile
+ * -- Returns the largest value in the bucket of the value at the given
+ *    percentile (0 to 100), capped at the largest value recorded
+ * -- Returns 0 if the histogram is empty
+ * =============================================================================
+ */
+unsigned long
+histogram_getPercentile (const histogram_t* histogramPtr, double percentile)
+{
+    assert(percentile >= 0.0 && percentile <= 100.0);
+
+    if (histogramPtr->count == 0) {
+        return 0;
+    }
+
+    /* Rank of the value, from 1: the smallest n with n/count >= percentile */
+    unsigned long rank =
+        (unsigned long)ceil(percentile / 100.0 * (double)histogramPtr->count);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > histogramPtr->count) {
+        rank = histogramPtr->count;
+    }
+
+    unsigned long numSeen = 0;
+    for (long b = 0; b < HISTOGRAM_NUM_BUCKET; b++) {
+        numSeen += histogramPtr->buckets[b];
+        if (numSeen >= rank) {
+            unsigned long value = getHighestInBucket(b);
+            return ((value < histogramPtr->max) ? value : histogramPtr->max);
+        }
+    }
+
+    assert(0); /* the buckets add up to count */
+    return histogramPtr->max;
+}
+
+
+/* =============================================================================
+ * histogram_getMean
+ * -- Returns 0 if the histogram is empty
+ * =============================================================================
+ */
+double
+histogram_getMean (const histogram_t* histogramPtr)
+{
+    if (histogramPtr->count == 0) {
+        return 0.0;
+    }
+
+    return (histogramPtr->sum / (double)histogramPtr->count);
+}
+
+
+/* =============================================================================
+ * TEST_HISTOGRAM
+ * =============================================================================
+ */
+#ifdef TEST_HISTOGRAM
+
+
+#include <stdio.h>
+
+
+int
+main ()
+{
+    puts("Starting...");
+
+    /* Buckets are contiguous and each value lies in its own bucket */
+    long lastBucket = -1;
+    for (unsigned long v = 0; v < (1UL << 20); v++) {
+        long b = histogram_getBucket(v);
+        assert(b == lastBucket || b == lastBucket + 1);
+        assert(getHighestInBucket(b) >= v);
+        assert(b == 0 || getHighestInBucket(b - 1) < v);
+        lastBucket = b;
+    }
+    assert(histogram_getBucket(~0UL) == HISTOGRAM_NUM_BUCKET - 1);
+    assert(getHighestInBucket(HISTOGRAM_NUM_BUCKET - 1) == ~0UL);
+
+    /* Exact below 2^HISTOGRAM_SUB_BITS */
+    histogram_t* aPtr = histogram_alloc();
+    assert(aPtr);
+    assert(histogram_getPercentile(aPtr, 50.0) == 0);
+    for (unsigned long v = 1; v <= 20; v++) {
+        histogram_record(aPtr, v);
+    }
+    assert(aPtr->count == 20 && aPtr->min == 1 && aPtr->max == 20);
+    assert(histogram_getPercentile(aPtr, 0.0) == 1);
+    assert(histogram_getPercentile(aPtr, 50.0) == 10);
+    assert(histogram_getPercentile(aPtr, 100.0) == 20);
+    assert(histogram_getMean(aPtr) == 10.5);
+
+    /* Within the bucket width above that */
+    histogram_t* bPtr = histogram_alloc();
+    assert(bPtr);
+    for (unsigned long v = 1; v <= 1000000; v++) {
+        histogram_record(bPtr, v * 10);
+    }
+    double percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+    for (unsigned long p = 0; p < sizeof(percentiles) / sizeof(double); p++) {
+        double exact = percentiles[p] / 100.0 * 1000000 * 10;
+        double value = (double)histogram_getPercentile(bPtr, percentiles[p]);
+        assert(value >= exact && value <= exact * (1.0 + 1.0 / HISTOGRAM_NUM_SUB));
+        printf("p%-6g %10.0f exact %10.0f\n", percentiles[p], value, exact);
+    }
+    assert(histogram_getPercentile(bPtr, 100.0) == 10000000);
+
+    /* Merging is the same as recording into one histogram */
+    histogram_merge(aPtr, bPtr);
+    assert(aPtr->count == 1000020 && aPtr->min == 1 && aPtr->max == 10000000);
+    for (unsigned long v = 1; v <= 20; v++) {
+        histogram_record(bPtr, v);
+    }
+    assert(memcmp(aPtr->buckets, bPtr->buckets, sizeof(aPtr->buckets)) == 0);
+    assert(histogram_getPercentile(aPtr, 99.0) ==
+           histogram_getPercentile(bPtr, 99.0));
+
+    histogram_free(aPtr);
+    histogram_free(bPtr);
+
+    puts("All tests passed.");
+
+    return 0;
+}
+
+
+#endif /* TEST_HISTOGRAM */
+
+
+/* =============================================================================
+ *
+ * End of histogram.cc
+ *
+ * =============================================================================
+ */
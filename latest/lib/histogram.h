@@ -0,0 +1,128 @@
+/* =============================================================================
+ *
+ * histogram.h
+ * -- Log-bucketed histogram of unsigned values, for latency percentiles
+ *
+ * =============================================================================
+ *
+ * As in HdrHistogram, values are counted in buckets whose width grows with
+ * the value: values below 2^HISTOGRAM_SUB_BITS get a bucket each, and every
+ * power-of-two range above that is split into 2^HISTOGRAM_SUB_BITS equal
+ * buckets.  A percentile is therefore within 1/2^HISTOGRAM_SUB_BITS (about
+ * 3%) of the exact one, whatever the range of the values, and recording a
+ * value is a few instructions and one increment.
+ *
+ * Each thread records into its own histogram; histogram_merge adds them up
+ * once the threads are done.  None of these functions may be called inside
+ * a transaction.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+enum histogram_config {
+    HISTOGRAM_SUB_BITS   = 5,
+    HISTOGRAM_NUM_SUB    = 1 << HISTOGRAM_SUB_BITS,
+    HISTOGRAM_NUM_BUCKET = HISTOGRAM_NUM_SUB * (64 - HISTOGRAM_SUB_BITS + 1)
+};
+
+struct histogram_t {
+    unsigned long count;
+    unsigned long min;
+    unsigned long max;
+    double sum;
+    unsigned long buckets[HISTOGRAM_NUM_BUCKET];
+};
+
+
+/* =============================================================================
+ * histogram_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+histogram_t*
+histogram_alloc ();
+
+
+/* =============================================================================
+ * histogram_free
+ * =============================================================================
+ */
+void
+histogram_free (histogram_t* histogramPtr);
+
+
+/* =============================================================================
+ * histogram_clear
+ * =============================================================================
+ */
+void
+histogram_clear (histogram_t* histogramPtr);
+
+
+/* =============================================================================
+ * histogram_getBucket
+ * -- Index of the bucket that counts value
+ * =============================================================================
+ */
+static inline long
+histogram_getBucket (unsigned long value)
+{
+    if (value < HISTOGRAM_NUM_SUB) {
+        return (long)value;
+    }
+
+    long shift = (63 - __builtin_clzl(value)) - HISTOGRAM_SUB_BITS;
+
+    return ((shift + 1) * HISTOGRAM_NUM_SUB +
+            (long)(value >> shift) - HISTOGRAM_NUM_SUB);
+}
+
+
+/* =============================================================================
+ * histogram_record
+ * =============================================================================
+ */
+static inline void
+histogram_record (histogram_t* histogramPtr, unsigned long value)
+{
+    histogramPtr->buckets[histogram_getBucket(value)]++;
+    if (histogramPtr->count == 0 || value < histogramPtr->min) {
+        histogramPtr->min = value;
+    }
+    if (value > histogramPtr->max) {
+        histogramPtr->max = value;
+    }
+    histogramPtr->count++;
+    histogramPtr->sum += (double)value;
+}
+
+
+/* =============================================================================
+ * histogram_merge
+ * -- Adds the values of srcPtr to dstPtr
+ * =============================================================================
+ */
+void
+histogram_merge (histogram_t* dstPtr, const histogram_t* srcPtr);
+
+
+/* =============================================================================
+ * histogram_getPercentile
+ * -- Returns the largest value in the bucket of the value at the given
+ *    percentile (0 to 100), capped at the largest value recorded
+ * -- Returns 0 if the histogram is empty
+ * =============================================================================
+ */
+unsigned long
+histogram_getPercentile (const histogram_t* histogramPtr, double percentile);
+
+
+/* =============================================================================
+ * histogram_getMean
+ * -- Returns 0 if the histogram is empty
+ * =============================================================================
+ */
+double
+histogram_getMean (const histogram_t* histogramPtr);
@@ -74,6 +74,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "list.h"
+#include "memory.h"
 #include "tm.h"
 #include "tm_transition.h"
 
@@ -158,7 +159,7 @@ __attribute__((transaction_safe))
 list_node_t*
 allocNode (void* dataPtr)
 {
-    list_node_t* nodePtr = (list_node_t*)malloc(sizeof(list_node_t));
+    list_node_t* nodePtr = (list_node_t*)memory_alloc(sizeof(list_node_t));
     if (nodePtr == NULL) {
         return NULL;
     }
@@ -180,7 +181,7 @@ __attribute__((transaction_safe))
 list_t*
 list_alloc (__attribute__((transaction_safe)) long (*compare)(const void*, const void*))
 {
-    list_t* listPtr = (list_t*)malloc(sizeof(list_t));
+    list_t* listPtr = (list_t*)memory_alloc(sizeof(list_t));
     if (listPtr == NULL) {
         return NULL;
     }
@@ -207,7 +208,7 @@ __attribute__((transaction_safe))
 void
 freeNode (list_node_t* nodePtr)
 {
-    free(nodePtr);
+    memory_free(nodePtr);
 }
 
 
@@ -236,7 +237,7 @@ list_free (  list_t* listPtr)
 {
     list_node_t* nextPtr = (list_node_t*)listPtr->head.nextPtr;
     freeList(nextPtr);
-    free(listPtr);
+    memory_free(listPtr);
 }
 
 
@@ -405,6 +406,7 @@ list_clear (list_t* listPtr)
 #include <stdio.h>
 
 
+TM_SAFE
 static long
 compare (const void* a, const void* b)
 {
@@ -418,8 +420,8 @@ printList (list_t* listPtr)
     list_iter_t it;
     printf("[");
     list_iter_reset(&it, listPtr);
-    while (list_iter_hasNext(&it, listPtr)) {
-        printf("%li ", *((long*)(list_iter_next(&it, listPtr))));
+    while (list_iter_hasNext(&it)) {
+        printf("%li ", *((long*)(list_iter_next(&it))));
     }
     puts("]");
 }
@@ -69,6 +69,11 @@
  * =============================================================================
  */
 
+/*
+ * MAP_BULKLOAD(map, keys, data, n) fills an empty map from n integer keys
+ * in increasing order, outside any transaction; only some maps have it.
+ */
+
 #pragma once
 
 #include <stdlib.h>
@@ -80,12 +85,20 @@
 #  include "hashtable.h"
 
 #  define MAP_T                       hashtable_t
-#  define MAP_ALLOC(hash, cmp)        hashtable_alloc(1, hash, cmp, 2, 2)
-#  define MAP_FREE(map)               hashtable_free(map)
-#  define MAP_CONTAINS(map, key)      hashtable_containsKey(map, (void*)(key))
-#  define MAP_FIND(map, key)          hashtable_find(map, (void*)(key))
-#  define MAP_INSERT(map, key, data)  hashtable_insert(map, (void*)(key), (void*)(data))
-#  define MAP_REMOVE(map, key)        hashtable_remove(map, (void*)(key))
+#  define MAP_ALLOC(hash, cmp)        TMhashtable_alloc(1, hash, cmp, 2, 2)
+#  define MAP_FREE(map)               TMhashtable_free(map)
+#  define MAP_CONTAINS(map, key)      TMhashtable_containsKey(map, (void*)(key))
+#  define MAP_FIND(map, key)          TMhashtable_find(map, (void*)(key))
+#  define MAP_INSERT(map, key, data)  TMhashtable_insert(map, (void*)(key), (void*)(data))
+#  define MAP_REMOVE(map, key)        TMhashtable_remove(map, (void*)(key))
+#  define MAP_BULKLOAD(map, keys, data, n) \
+    hashtable_bulkLoad(map, (void**)(keys), (void**)(data), n)
+
+#  define TMMAP_CONTAINS(map, key)    TMhashtable_containsKey(map, (void*)(key))
+#  define TMMAP_FIND(map, key)        TMhashtable_find(map, (void*)(key))
+#  define TMMAP_INSERT(map, key, data) \
+    TMhashtable_insert(map, (void*)(key), (void*)(data))
+#  define TMMAP_REMOVE(map, key)      TMhashtable_remove(map, (void*)(key))
 
 #elif defined(MAP_USE_ATREE)
 
@@ -205,6 +218,8 @@
 #  define MAP_INSERT(map, key, data) \
     rbtree_insert(map, (void*)(key), (void*)(data))
 #  define MAP_REMOVE(map, key)        rbtree_delete(map, (void*)(key))
+#  define MAP_BULKLOAD(map, keys, data, n) \
+    rbtree_bulkLoad(map, (void**)(keys), (void**)(data), n)
 
 #  define TMMAP_CONTAINS(map, key)    TMRBTREE_CONTAINS(map, (void*)(key))
 #  define TMMAP_FIND(map, key)        TMRBTREE_GET(map, (void*)(key))
@@ -213,60 +228,49 @@
 #  define TMMAP_REMOVE(map, key)      TMRBTREE_DELETE(map, (void*)(key))
 
 
+#elif defined(MAP_USE_FLATHASH)
+
+#  include "flathash.h"
+
+/* Keys must be integers; hash and cmp are ignored */
+#  define MAP_T                       flathash_t
+#  define MAP_ALLOC(hash, cmp)        flathash_alloc()
+#  define MAP_FREE(map)               flathash_free(map)
+
+#  define MAP_CONTAINS(map, key)      flathash_contains(map, (long)(key))
+#  define MAP_FIND(map, key)          flathash_find(map, (long)(key))
+#  define MAP_INSERT(map, key, data) \
+    flathash_insert(map, (long)(key), (void*)(data))
+#  define MAP_REMOVE(map, key)        flathash_remove(map, (long)(key))
+#  define MAP_BULKLOAD(map, keys, data, n) \
+    flathash_bulkLoad(map, (const long*)(keys), (void**)(data), n)
+
+#  define TMMAP_CONTAINS(map, key)    TMFLATHASH_CONTAINS(map, key)
+#  define TMMAP_FIND(map, key)        TMFLATHASH_FIND(map, key)
+#  define TMMAP_INSERT(map, key, data) \
+    TMFLATHASH_INSERT(map, key, data)
+#  define TMMAP_REMOVE(map, key)      TMFLATHASH_REMOVE(map, key)
+
+
 #elif defined(MAP_USE_SKIPLIST)
 
 #  include "skiplist.h"
 
-#  define SKIPLIST_MAX_HEIGHT (64)
+#  define MAP_T                       skiplist_t
+#  define MAP_ALLOC(hash, cmp)        skiplist_alloc(cmp)
+#  define MAP_FREE(map)               skiplist_free(map)
 
-#  define MAP_T                       jsw_skip_t
-#  define MAP_ALLOC(hash, cmp)        jsw_snew(SKIPLIST_MAX_HEIGHT, (cmp_f)cmp)
-#  define MAP_FREE(map)               jsw_sdelete(map)
-#  define MAP_CONTAINS(map, key) \
-    ({ \
-        bool success = false; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)key; \
-        if (jsw_sfind(map, (void*)&searchPair) != NULL) { \
-            success = true; \
-        } \
-        success; \
-     })
-#  define MAP_FIND(map, key) \
-    ({ \
-        void* dataPtr = NULL; \
-        pair_t* pairPtr; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)(key); \
-        pairPtr = (pair_t*)jsw_sfind(map, (void*)&searchPair); \
-        if (pairPtr != NULL) { \
-            dataPtr = pairPtr->secondPtr; \
-        } \
-        dataPtr; \
-     })
+#  define MAP_CONTAINS(map, key)      skiplist_contains(map, (void*)(key))
+#  define MAP_FIND(map, key)          skiplist_get(map, (void*)(key))
 #  define MAP_INSERT(map, key, data) \
-    ({ \
-        bool success = false; \
-        pair_t* insertPtr = pair_alloc((void*)(key), (void*)data); \
-        if (insertPtr != NULL) { \
-            if (jsw_sinsert(map, (void*)insertPtr)) { \
-                success = true; \
-            } \
-        } \
-        success; \
-     })
-#  define MAP_REMOVE(map, key) \
-    ({ \
-        bool success = false; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)(key); \
-        pairPtr = (pair_t*)jsw_sfind(map, (void*)&searchPair); \
-        if (jsw_serase(map, (void*)&searchPair)) { \
-            pair_free(pairPtr); \
-            success = true; \
-        } \
-        success; \
-     })
+    skiplist_insert(map, (void*)(key), (void*)(data))
+#  define MAP_REMOVE(map, key)        skiplist_delete(map, (void*)(key))
+
+#  define TMMAP_CONTAINS(map, key)    TMSKIPLIST_CONTAINS(map, (void*)(key))
+#  define TMMAP_FIND(map, key)        TMSKIPLIST_GET(map, (void*)(key))
+#  define TMMAP_INSERT(map, key, data) \
+    TMSKIPLIST_INSERT(map, (void*)(key), (void*)(data))
+#  define TMMAP_REMOVE(map, key)      TMSKIPLIST_DELETE(map, (void*)(key))
 
 #else
 
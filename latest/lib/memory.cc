@@ -73,15 +73,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "memory.h"
-#include "types.h"
-
-/* We want to use enum bool */
-#ifdef false
-#  undef false
-#endif
-#ifdef true
-#  undef true
-#endif
+#include "tm_transition.h"
 
 
 #define PADDING_SIZE 8
@@ -121,14 +113,14 @@ allocBlock (size_t capacity)
 
     assert(capacity > 0);
 
-    blockPtr = (block_t*)SEQ_MALLOC(sizeof(block_t));
+    blockPtr = (block_t*)malloc(sizeof(block_t));
     if (blockPtr == NULL) {
         return NULL;
     }
 
     blockPtr->size = 0;
     blockPtr->capacity = capacity;
-    blockPtr->contents = (char*)SEQ_MALLOC(capacity / sizeof(char) + 1);
+    blockPtr->contents = (char*)malloc(capacity / sizeof(char) + 1);
     if (blockPtr->contents == NULL) {
         return NULL;
     }
@@ -145,8 +137,8 @@ allocBlock (size_t capacity)
 static void
 freeBlock (block_t* blockPtr)
 {
-    SEQ_FREE(blockPtr->contents);
-    SEQ_FREE(blockPtr);
+    free(blockPtr->contents);
+    free(blockPtr);
 }
 
 
@@ -160,15 +152,15 @@ allocPool (size_t initBlockCapacity, long blockGrowthFactor)
 {
     pool_t* poolPtr;
 
-    poolPtr = (pool_t*)SEQ_MALLOC(sizeof(pool_t));
+    poolPtr = (pool_t*)malloc(sizeof(pool_t));
     if (poolPtr == NULL) {
         return NULL;
     }
 
     poolPtr->initBlockCapacity =
-        (initBlockCapacity > 0) ? initBlockCapacity : DEFAULT_INIT_BLOCK_CAPACITY;
+        (initBlockCapacity > 0) ? initBlockCapacity : (size_t)DEFAULT_INIT_BLOCK_CAPACITY;
     poolPtr->blockGrowthFactor =
-        (blockGrowthFactor > 0) ? blockGrowthFactor : DEFAULT_BLOCK_GROWTH_FACTOR;
+        (blockGrowthFactor > 0) ? blockGrowthFactor : (long)DEFAULT_BLOCK_GROWTH_FACTOR;
 
     poolPtr->blocksPtr = allocBlock(poolPtr->initBlockCapacity);
     if (poolPtr->blocksPtr == NULL) {
@@ -204,7 +196,7 @@ static void
 freePool (pool_t* poolPtr)
 {
     freeBlocks(poolPtr->blocksPtr);
-    SEQ_FREE(poolPtr);
+    free(poolPtr);
 }
 
 
@@ -220,12 +212,12 @@ memory_init (long numThread, size_t initBlockCapacity, long blockGrowthFactor)
 
     assert(numThread > 0);
 
-    global_memoryPtr = (memory_t*)SEQ_MALLOC(sizeof(memory_t));
+    global_memoryPtr = (memory_t*)malloc(sizeof(memory_t));
     if (global_memoryPtr == NULL) {
         return false;
     }
 
-    global_memoryPtr->pools = (pool_t**)SEQ_MALLOC(numThread * sizeof(pool_t*));
+    global_memoryPtr->pools = (pool_t**)malloc(numThread * sizeof(pool_t*));
     if (global_memoryPtr->pools == NULL) {
         return false;
     }
@@ -256,8 +248,8 @@ memory_destroy (void)
     for (i = 0; i < numThread; i++) {
         freePool(global_memoryPtr->pools[i]);
     }
-    SEQ_FREE(global_memoryPtr->pools);
-    SEQ_FREE(global_memoryPtr);
+    free(global_memoryPtr->pools);
+    free(global_memoryPtr);
 }
 
 
@@ -360,6 +352,120 @@ memory_get (long threadId, size_t numByte)
 }
 
 
+/* =============================================================================
+ * Size-class allocator
+ * -- Every block has a one-word header holding its size class.  Blocks of
+ *    up to MEMORY_MAX_BLOCK bytes come from the calling thread's free list
+ *    for their class, else are carved from the thread's current chunk.
+ *    Larger blocks go to malloc.  A freed block goes on the free list of
+ *    the thread that frees it.
+ *
+ *    The free lists and chunk cursor are only ever touched by their own
+ *    thread, so inside a transaction the instrumented accesses to them never
+ *    conflict, and an aborted attempt rolls them back like any other data.
+ *    Only a chunk taken by an attempt that aborts is not reclaimed.
+ * =============================================================================
+ */
+
+#define MEMORY_ALIGN       8
+#define MEMORY_MAX_BLOCK   512
+#define MEMORY_NUM_CLASS   (MEMORY_MAX_BLOCK / MEMORY_ALIGN)
+#define MEMORY_CLASS_LARGE MEMORY_NUM_CLASS
+#define MEMORY_CHUNK_SIZE  (1 << 16)
+
+typedef struct freeBlock {
+    struct freeBlock* nextPtr;
+} freeBlock_t;
+
+static __thread freeBlock_t* global_freeLists[MEMORY_NUM_CLASS];
+static __thread char*        global_chunkPtr    = NULL;
+static __thread char*        global_chunkEndPtr = NULL;
+
+
+/* =============================================================================
+ * allocChunk
+ * -- Outside the transaction, so an abort does not hand it back to malloc
+ * =============================================================================
+ */
+__attribute__((transaction_pure))
+static char*
+allocChunk ()
+{
+    char* chunkPtr = (char*)malloc(MEMORY_CHUNK_SIZE);
+    assert(chunkPtr);
+    return chunkPtr;
+}
+
+
+/* =============================================================================
+ * memory_alloc
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void*
+memory_alloc (size_t numByte)
+{
+    size_t blockSize = (numByte + sizeof(long) + MEMORY_ALIGN - 1) &
+                       ~(size_t)(MEMORY_ALIGN - 1);
+    long* headerPtr;
+
+    if (blockSize > MEMORY_MAX_BLOCK) {
+        headerPtr = (long*)malloc(numByte + sizeof(long));
+        if (headerPtr == NULL) {
+            return NULL;
+        }
+        headerPtr[0] = MEMORY_CLASS_LARGE;
+        return (void*)(headerPtr + 1);
+    }
+
+    long sizeClass = blockSize / MEMORY_ALIGN - 1;
+    freeBlock_t* blockPtr = global_freeLists[sizeClass];
+    if (blockPtr != NULL) {
+        global_freeLists[sizeClass] = blockPtr->nextPtr;
+        return (void*)blockPtr;
+    }
+
+    if (global_chunkPtr == NULL ||
+        (size_t)(global_chunkEndPtr - global_chunkPtr) < blockSize)
+    {
+        global_chunkPtr = allocChunk();
+        global_chunkEndPtr = global_chunkPtr + MEMORY_CHUNK_SIZE;
+    }
+    headerPtr = (long*)global_chunkPtr;
+    global_chunkPtr += blockSize;
+    headerPtr[0] = sizeClass;
+
+    return (void*)(headerPtr + 1);
+}
+
+
+/* =============================================================================
+ * memory_free
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+memory_free (void* ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    long* headerPtr = (long*)ptr - 1;
+    long sizeClass = headerPtr[0];
+
+    if (sizeClass == MEMORY_CLASS_LARGE) {
+        free(headerPtr);
+        return;
+    }
+
+    assert(sizeClass >= 0 && sizeClass < MEMORY_NUM_CLASS);
+    freeBlock_t* blockPtr = (freeBlock_t*)ptr;
+    blockPtr->nextPtr = global_freeLists[sizeClass];
+    global_freeLists[sizeClass] = blockPtr;
+}
+
+
 /* =============================================================================
  * TEST_MEMORY
  * =============================================================================
@@ -368,6 +474,7 @@ memory_get (long threadId, size_t numByte)
 
 
 #include <stdio.h>
+#include <string.h>
 
 #define NUM_ALLOC (10)
 
@@ -441,6 +548,24 @@ main ()
 
     memory_destroy();
 
+    puts("Checking size classes...");
+    for (size = 1; size <= 4 * MEMORY_MAX_BLOCK; size += 7) {
+        char* aPtr = (char*)memory_alloc(size);
+        char* bPtr = (char*)memory_alloc(size);
+        assert(aPtr && bPtr && aPtr != bPtr);
+        assert((size_t)aPtr % MEMORY_ALIGN == 0);
+        memset(aPtr, 'a', size);
+        memset(bPtr, 'b', size);
+        assert(aPtr[size - 1] == 'a');
+        memory_free(aPtr);
+        char* cPtr = (char*)memory_alloc(size);
+        if (size + sizeof(long) <= MEMORY_MAX_BLOCK) {
+            assert(cPtr == aPtr); /* reused from the free list */
+        }
+        memory_free(bPtr);
+        memory_free(cPtr);
+    }
+
     puts("All tests passed.");
 
     return 0;
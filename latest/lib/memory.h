@@ -114,6 +114,28 @@ void*
 memory_get (long threadId, size_t numByte);
 
 
+/* =============================================================================
+ * memory_alloc
+ * -- Thread-local size-class allocator; needs no memory_init
+ * -- Callable inside transactions; blocks must be freed with memory_free
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void*
+memory_alloc (size_t numByte);
+
+
+/* =============================================================================
+ * memory_free
+ * -- Any thread may free a block; it joins that thread's free list
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+memory_free (void* ptr);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,312 @@
+/* =============================================================================
+ *
+ * mpmcqueue.cc
+ * -- Bounded lock-free multi-producer/multi-consumer FIFO queue
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "memory.h"
+#include "mpmcqueue.h"
+
+
+/* =============================================================================
+ * mpmcqueue_alloc
+ * -- Capacity is rounded up to a power of 2
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+mpmcqueue_t*
+mpmcqueue_alloc (long capacity)
+{
+    unsigned long numCell = 2;
+    while ((long)numCell < capacity) {
+        numCell *= 2;
+    }
+
+    mpmcqueue_t* queuePtr = (mpmcqueue_t*)memory_alloc(sizeof(mpmcqueue_t));
+    if (queuePtr == NULL) {
+        return NULL;
+    }
+
+    queuePtr->cells =
+        (mpmcqueue_cell_t*)memory_alloc(numCell * sizeof(mpmcqueue_cell_t));
+    if (queuePtr->cells == NULL) {
+        memory_free(queuePtr);
+        return NULL;
+    }
+    for (unsigned long i = 0; i < numCell; i++) {
+        queuePtr->cells[i].sequence = i;
+        queuePtr->cells[i].dataPtr = NULL;
+    }
+    queuePtr->mask = numCell - 1;
+    queuePtr->enqueuePos = 0;
+    queuePtr->dequeuePos = 0;
+
+    return queuePtr;
+}
+
+
+/* =============================================================================
+ * mpmcqueue_free
+ * -- Does not free the data
+ * =============================================================================
+ */
+void
+mpmcqueue_free (mpmcqueue_t* queuePtr)
+{
+    memory_free(queuePtr->cells);
+    memory_free(queuePtr);
+}
+
+
+/* =============================================================================
+ * mpmcqueue_push
+ * -- Returns false if the queue is full
+ * =============================================================================
+ */
+bool
+mpmcqueue_push (mpmcqueue_t* queuePtr, void* dataPtr)
+{
+    mpmcqueue_cell_t* cellPtr;
+    unsigned long pos = __atomic_load_n(&queuePtr->enqueuePos,
+                                        __ATOMIC_RELAXED);
+
+    while (1) {
+        cellPtr = &queuePtr->cells[pos & queuePtr->mask];
+        unsigned long seq = __atomic_load_n(&cellPtr->sequence,
+                                            __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&queuePtr->enqueuePos, &pos,
+                                            pos + 1, true,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; /* the cell still holds data from the last lap */
+        } else {
+            pos = __atomic_load_n(&queuePtr->enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+
+    cellPtr->dataPtr = dataPtr;
+    __atomic_store_n(&cellPtr->sequence, pos + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+
+/* =============================================================================
+ * mpmcqueue_pop
+ * -- Returns NULL if the queue is empty
+ * =============================================================================
+ */
+void*
+mpmcqueue_pop (mpmcqueue_t* queuePtr)
+{
+    void* dataPtr;
+
+    return ((mpmcqueue_pop_n(queuePtr, &dataPtr, 1) == 1) ? dataPtr : NULL);
+}
+
+
+/* =============================================================================
+ * mpmcqueue_pop_n
+ * -- Pops up to n elements, in order, into dataPtrs with one claim
+ * -- Returns the number popped; 0 if the queue is empty
+ * -- A cell whose sequence is pos + 1 can only be emptied by whoever moves
+ *    dequeuePos past pos, so cells seen full before the claim are still
+ *    full after it
+ * =============================================================================
+ */
+long
+mpmcqueue_pop_n (mpmcqueue_t* queuePtr, void** dataPtrs, long n)
+{
+    mpmcqueue_cell_t* cells = queuePtr->cells;
+    unsigned long mask = queuePtr->mask;
+    unsigned long pos = __atomic_load_n(&queuePtr->dequeuePos,
+                                        __ATOMIC_RELAXED);
+    long numPop;
+
+    assert(n > 0);
+
+    while (1) {
+        unsigned long seq = __atomic_load_n(&cells[pos & mask].sequence,
+                                            __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - (pos + 1));
+        if (diff < 0) {
+            return 0; /* the cell has not been pushed yet */
+        }
+        if (diff > 0) {
+            pos = __atomic_load_n(&queuePtr->dequeuePos, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        for (numPop = 1; numPop < n; numPop++) {
+            unsigned long p = pos + numPop;
+            if (__atomic_load_n(&cells[p & mask].sequence,
+                                __ATOMIC_ACQUIRE) != p + 1) {
+                break;
+            }
+        }
+
+        if (__atomic_compare_exchange_n(&queuePtr->dequeuePos, &pos,
+                                        pos + numPop, true,
+                                        __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    for (long i = 0; i < numPop; i++) {
+        mpmcqueue_cell_t* cellPtr = &cells[(pos + i) & mask];
+        dataPtrs[i] = cellPtr->dataPtr;
+        __atomic_store_n(&cellPtr->sequence, pos + i + mask + 1,
+                         __ATOMIC_RELEASE);
+    }
+
+    return numPop;
+}
+
+
+/* =============================================================================
+ * mpmcqueue_isEmpty
+ * -- Only a hint while other threads push or pop
+ * =============================================================================
+ */
+bool
+mpmcqueue_isEmpty (mpmcqueue_t* queuePtr)
+{
+    unsigned long pos = __atomic_load_n(&queuePtr->dequeuePos,
+                                        __ATOMIC_RELAXED);
+    unsigned long seq =
+        __atomic_load_n(&queuePtr->cells[pos & queuePtr->mask].sequence,
+                        __ATOMIC_ACQUIRE);
+
+    return ((long)(seq - (pos + 1)) < 0);
+}
+
+
+/* =============================================================================
+ * TEST_MPMCQUEUE
+ * =============================================================================
+ */
+#ifdef TEST_MPMCQUEUE
+
+
+#include <stdio.h>
+#include "thread.h"
+
+
+static mpmcqueue_t* global_queuePtr;
+static long* global_count;
+static long global_numData = 1000000;
+static long global_numPopped = 0;
+
+
+/* =============================================================================
+ * pushAndPop
+ * -- Even threads push their share of 0..numData-1 (spinning while the
+ *    queue is full); odd threads pop, alternating single and batch pops,
+ *    until every element has come out
+ * =============================================================================
+ */
+static void
+pushAndPop (void* argPtr)
+{
+    long threadId = thread_getId();
+    long numProducer = (thread_getNumThread() + 1) / 2;
+
+    if (threadId % 2 == 0) {
+        for (long i = threadId / 2; i < global_numData; i += numProducer) {
+            while (!mpmcqueue_push(global_queuePtr, (void*)(i + 1))) {
+                /* full */
+            }
+        }
+        return;
+    }
+
+    void* dataPtrs[16];
+    long round = 0;
+    while (__atomic_load_n(&global_numPopped, __ATOMIC_RELAXED) <
+           global_numData)
+    {
+        long numPop = ((round++ % 2) ?
+                       mpmcqueue_pop_n(global_queuePtr, dataPtrs, 16) :
+                       (long)((dataPtrs[0] = mpmcqueue_pop(global_queuePtr))
+                              != NULL));
+        for (long p = 0; p < numPop; p++) {
+            long i = (long)dataPtrs[p] - 1;
+            assert(i >= 0 && i < global_numData);
+            __atomic_fetch_add(&global_count[i], 1, __ATOMIC_RELAXED);
+        }
+        __atomic_fetch_add(&global_numPopped, numPop, __ATOMIC_RELAXED);
+    }
+}
+
+
+int
+main ()
+{
+    long i;
+
+    puts("Starting...");
+
+    /* Single thread: FIFO order, full and empty, batches across the wrap */
+    mpmcqueue_t* queuePtr = mpmcqueue_alloc(5);
+    assert(queuePtr && queuePtr->mask == 7);
+    assert(mpmcqueue_isEmpty(queuePtr));
+    assert(mpmcqueue_pop(queuePtr) == NULL);
+    for (long r = 0; r < 3; r++) {
+        for (i = 0; i < 8; i++) {
+            assert(mpmcqueue_push(queuePtr, (void*)(i + 1)));
+        }
+        assert(!mpmcqueue_push(queuePtr, (void*)9L));
+        assert(mpmcqueue_pop(queuePtr) == (void*)1L);
+        void* dataPtrs[8];
+        assert(mpmcqueue_pop_n(queuePtr, dataPtrs, 3) == 3);
+        assert(dataPtrs[0] == (void*)2L && dataPtrs[2] == (void*)4L);
+        assert(mpmcqueue_pop_n(queuePtr, dataPtrs, 8) == 4);
+        assert(dataPtrs[3] == (void*)8L);
+        assert(mpmcqueue_pop_n(queuePtr, dataPtrs, 8) == 0);
+        assert(mpmcqueue_isEmpty(queuePtr));
+    }
+    mpmcqueue_free(queuePtr);
+
+    /* Several threads: every element comes out exactly once */
+    long numThread = 4;
+    thread_startup(numThread);
+    global_queuePtr = mpmcqueue_alloc(1024);
+    assert(global_queuePtr);
+    global_count = (long*)calloc(global_numData, sizeof(long));
+    assert(global_count);
+    thread_start(pushAndPop, NULL);
+    for (i = 0; i < global_numData; i++) {
+        assert(global_count[i] == 1);
+    }
+    assert(mpmcqueue_isEmpty(global_queuePtr));
+    printf("%li elements through %li threads\n", global_numData, numThread);
+    mpmcqueue_free(global_queuePtr);
+    free(global_count);
+    thread_shutdown();
+
+    puts("Passed all tests.");
+
+    return 0;
+}
+
+
+#endif /* TEST_MPMCQUEUE */
+
+
+/* =============================================================================
+ *
+ * End of mpmcqueue.cc
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,96 @@
+/* =============================================================================
+ *
+ * mpmcqueue.h
+ * -- Bounded lock-free multi-producer/multi-consumer FIFO queue
+ *
+ * =============================================================================
+ *
+ * A queue that is filled before the threads start and then only drained
+ * (labyrinth's paths to route, intruder's packets) does not need a
+ * transaction per pop: with queue_t, every pop writes the same index, so
+ * any two concurrent pops conflict and one of them aborts.
+ *
+ * This is Vyukov's bounded queue.  Each cell carries a sequence number
+ * that says whose turn it is: a cell at position pos is free for a push
+ * when its sequence is pos, and holds data for a pop when it is pos + 1.
+ * A push or pop claims its position with one compare-and-swap on the
+ * enqueue or dequeue counter, which sit on separate cache lines, and then
+ * hands the cell over by advancing its sequence.
+ *
+ * None of these functions may be called inside a transaction.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+struct mpmcqueue_cell_t {
+    unsigned long sequence;
+    void* dataPtr;
+};
+
+struct mpmcqueue_t {
+    mpmcqueue_cell_t* cells;
+    unsigned long mask;      /* capacity - 1; capacity is a power of 2 */
+    char padding1[64];
+    unsigned long enqueuePos;
+    char padding2[64];
+    unsigned long dequeuePos;
+    char padding3[64];
+};
+
+
+/* =============================================================================
+ * mpmcqueue_alloc
+ * -- Capacity is rounded up to a power of 2
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+mpmcqueue_t*
+mpmcqueue_alloc (long capacity);
+
+
+/* =============================================================================
+ * mpmcqueue_free
+ * -- Does not free the data
+ * =============================================================================
+ */
+void
+mpmcqueue_free (mpmcqueue_t* queuePtr);
+
+
+/* =============================================================================
+ * mpmcqueue_push
+ * -- Returns false if the queue is full
+ * =============================================================================
+ */
+bool
+mpmcqueue_push (mpmcqueue_t* queuePtr, void* dataPtr);
+
+
+/* =============================================================================
+ * mpmcqueue_pop
+ * -- Returns NULL if the queue is empty
+ * =============================================================================
+ */
+void*
+mpmcqueue_pop (mpmcqueue_t* queuePtr);
+
+
+/* =============================================================================
+ * mpmcqueue_pop_n
+ * -- Pops up to n elements, in order, into dataPtrs with one claim
+ * -- Returns the number popped; 0 if the queue is empty
+ * =============================================================================
+ */
+long
+mpmcqueue_pop_n (mpmcqueue_t* queuePtr, void** dataPtrs, long n);
+
+
+/* =============================================================================
+ * mpmcqueue_isEmpty
+ * -- Only a hint while other threads push or pop
+ * =============================================================================
+ */
+bool
+mpmcqueue_isEmpty (mpmcqueue_t* queuePtr);
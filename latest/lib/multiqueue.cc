@@ -0,0 +1,221 @@
+/* =============================================================================
+ *
+ * multiqueue.cc
+ * -- Relaxed concurrent max-priority queue over several heaps
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "heap.h"
+#include "memory.h"
+#include "multiqueue.h"
+#include "tm.h"
+#include "tm_transition.h"
+#include "xorshift.h"
+
+static __thread unsigned long global_pickSeed = 0;
+
+
+/* =============================================================================
+ * randomQueue
+ * -- Pure: an aborted transaction just leaves the generator further along
+ * =============================================================================
+ */
+__attribute__((transaction_pure))
+static long
+randomQueue (long numQueue)
+{
+    if (global_pickSeed == 0) {
+        global_pickSeed =
+            (unsigned long)&global_pickSeed * 0x9e3779b97f4a7c15UL | 1;
+    }
+    unsigned long seed = xorshift_next(&global_pickSeed);
+
+    return (long)((seed >> 11) % (unsigned long)numQueue);
+}
+
+
+/* =============================================================================
+ * multiqueue_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+multiqueue_t*
+multiqueue_alloc (long numQueue)
+{
+    assert(numQueue > 0);
+
+    multiqueue_t* queuePtr = (multiqueue_t*)memory_alloc(sizeof(multiqueue_t));
+    if (queuePtr == NULL) {
+        return NULL;
+    }
+
+    void* memoryPtr = memory_alloc(numQueue * sizeof(multiqueue_slot_t) + 63);
+    if (memoryPtr == NULL) {
+        memory_free(queuePtr);
+        return NULL;
+    }
+    queuePtr->memoryPtr = memoryPtr;
+    queuePtr->slots =
+        (multiqueue_slot_t*)(((uintptr_t)memoryPtr + 63) & ~(uintptr_t)63);
+    queuePtr->numQueue = numQueue;
+
+    for (long q = 0; q < numQueue; q++) {
+        if (!heap_init(&queuePtr->slots[q].heap, 1)) {
+            queuePtr->numQueue = q;
+            multiqueue_free(queuePtr);
+            return NULL;
+        }
+    }
+
+    return queuePtr;
+}
+
+
+/* =============================================================================
+ * multiqueue_free
+ * =============================================================================
+ */
+void
+multiqueue_free (multiqueue_t* queuePtr)
+{
+    for (long q = 0; q < queuePtr->numQueue; q++) {
+        heap_destroy(&queuePtr->slots[q].heap);
+    }
+    memory_free(queuePtr->memoryPtr);
+    memory_free(queuePtr);
+}
+
+
+/* =============================================================================
+ * multiqueue_insert
+ * -- Returns false on failure
+ * =============================================================================
+ */
+TM_SAFE
+bool
+multiqueue_insert (multiqueue_t* queuePtr, long key, void* dataPtr)
+{
+    long q = randomQueue(queuePtr->numQueue);
+
+    return heap_insert(&queuePtr->slots[q].heap, key, dataPtr);
+}
+
+
+/* =============================================================================
+ * multiqueue_remove
+ * -- Returns NULL if all heaps are empty
+ * =============================================================================
+ */
+TM_SAFE
+void*
+multiqueue_remove (multiqueue_t* queuePtr)
+{
+    multiqueue_slot_t* slots = queuePtr->slots;
+    long numQueue = queuePtr->numQueue;
+
+    long a = randomQueue(numQueue);
+    long b = randomQueue(numQueue);
+    long aKey = heap_peekKey(&slots[a].heap);
+    long bKey = heap_peekKey(&slots[b].heap);
+    heap_t* heapPtr = &slots[((bKey > aKey) ? b : a)].heap;
+    if (heap_getSize(heapPtr) > 0) {
+        return heap_remove(heapPtr);
+    }
+
+    /* Both picks were empty: take from any heap that is not */
+    for (long i = 1; i < numQueue; i++) {
+        heapPtr = &slots[(a + i) % numQueue].heap;
+        if (heap_getSize(heapPtr) > 0) {
+            return heap_remove(heapPtr);
+        }
+    }
+
+    return NULL;
+}
+
+
+/* =============================================================================
+ * TEST_MULTIQUEUE
+ * =============================================================================
+ */
+#ifdef TEST_MULTIQUEUE
+
+
+#include <stdio.h>
+
+
+int
+main ()
+{
+    long numData = 100000;
+    long numQueue = 8;
+    long i;
+
+    puts("Starting...");
+
+    multiqueue_t* queuePtr = multiqueue_alloc(numQueue);
+    assert(queuePtr);
+    for (i = 0; i < numQueue; i++) {
+        assert(((uintptr_t)&queuePtr->slots[i] & 63) == 0);
+    }
+
+    long* data = (long*)malloc(numData * sizeof(long));
+    long* count = (long*)calloc(numData, sizeof(long));
+    for (i = 0; i < numData; i++) {
+        data[i] = i;
+        assert(multiqueue_insert(queuePtr, i % 100, &data[i]));
+    }
+
+    /* Every element comes out exactly once, roughly in key order */
+    long numInversion = 0;
+    long lastKey = LONG_MAX;
+    for (i = 0; i < numData; i++) {
+        long* dataPtr = (long*)multiqueue_remove(queuePtr);
+        assert(dataPtr);
+        count[*dataPtr]++;
+        long key = *dataPtr % 100;
+        if (key > lastKey) {
+            numInversion++;
+        }
+        lastKey = key;
+    }
+    assert(multiqueue_remove(queuePtr) == NULL);
+    for (i = 0; i < numData; i++) {
+        assert(count[i] == 1);
+    }
+    printf("%li of %li removes out of key order\n", numInversion, numData);
+
+    /* Removes find the last elements wherever they are */
+    for (i = 0; i < 3; i++) {
+        assert(multiqueue_insert(queuePtr, 0, &data[i]));
+    }
+    for (i = 0; i < 3; i++) {
+        assert(multiqueue_remove(queuePtr));
+    }
+    assert(multiqueue_remove(queuePtr) == NULL);
+
+    multiqueue_free(queuePtr);
+    free(data);
+    free(count);
+
+    puts("Passed all tests.");
+
+    return 0;
+}
+
+
+#endif /* TEST_MULTIQUEUE */
+
+
+/* =============================================================================
+ *
+ * End of multiqueue.cc
+ *
+ * =============================================================================
+ */
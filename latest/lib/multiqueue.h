@@ -0,0 +1,82 @@
+/* =============================================================================
+ *
+ * multiqueue.h
+ * -- Relaxed concurrent max-priority queue over several heaps
+ *
+ * =============================================================================
+ *
+ * A single shared heap serializes every transaction that pops: all of them
+ * write its root and size.  A multiqueue spreads the elements over
+ * numQueue heaps (MULTIQUEUE_FACTOR per thread is typical).  An insert
+ * goes into a random heap; a remove peeks at the tops of two random heaps
+ * and pops the larger.  Two transactions only conflict if they pick a
+ * common heap, and the element removed is close to, though not always,
+ * the global maximum.
+ *
+ * A remove that finds both of its heaps empty scans all of them, so NULL
+ * means the whole multiqueue was empty.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+#include "heap.h"
+
+enum multiqueue_config {
+    MULTIQUEUE_FACTOR = 2
+};
+
+/* Each heap header has a line to itself, so heaps do not false-share */
+struct multiqueue_slot_t {
+    heap_t heap;
+} __attribute__((aligned(64)));
+
+struct multiqueue_t {
+    multiqueue_slot_t* slots;  /* aligned to a line */
+    void* memoryPtr;           /* block slots points into */
+    long numQueue;
+};
+
+
+/* =============================================================================
+ * multiqueue_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+multiqueue_t*
+multiqueue_alloc (long numQueue);
+
+
+/* =============================================================================
+ * multiqueue_free
+ * -- Does not free the data
+ * =============================================================================
+ */
+void
+multiqueue_free (multiqueue_t* queuePtr);
+
+
+/* =============================================================================
+ * multiqueue_insert
+ * -- Returns false on failure
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+multiqueue_insert (multiqueue_t* queuePtr, long key, void* dataPtr);
+
+
+/* =============================================================================
+ * multiqueue_remove
+ * -- Removes the larger of the top elements of two random heaps
+ * -- Returns NULL if all heaps are empty
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void*
+multiqueue_remove (multiqueue_t* queuePtr);
+
+
+#define TMMULTIQUEUE_INSERT(q, k, d)    multiqueue_insert((q), (long)(k), (void*)(d))
+#define TMMULTIQUEUE_REMOVE(q)          multiqueue_remove((q))
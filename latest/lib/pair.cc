@@ -72,6 +72,7 @@
 #include <stdlib.h>
 #include "memory.h"
 #include "pair.h"
+#include "memory.h"
 
 
 /* =============================================================================
@@ -85,7 +86,7 @@ pair_alloc (void* firstPtr, void* secondPtr)
 {
     pair_t* pairPtr;
 
-    pairPtr = (pair_t*)malloc(sizeof(pair_t));
+    pairPtr = (pair_t*)memory_alloc(sizeof(pair_t));
     if (pairPtr != NULL) {
         pairPtr->firstPtr = firstPtr;
         pairPtr->secondPtr = secondPtr;
@@ -103,7 +104,7 @@ __attribute__((transaction_safe))
 void
 pair_free (pair_t* pairPtr)
 {
-    free(pairPtr);
+    memory_free(pairPtr);
 }
 
 
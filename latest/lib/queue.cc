@@ -74,6 +74,7 @@
 #include <string.h>
 #include "tm.h"
 #include "queue.h"
+#include "memory.h"
 #include "tm_transition.h"
 
 struct queue_t {
@@ -96,13 +97,13 @@ TM_SAFE
 queue_t*
 queue_alloc (  long initCapacity)
 {
-    queue_t* queuePtr = (queue_t*)malloc(sizeof(queue_t));
+    queue_t* queuePtr = (queue_t*)memory_alloc(sizeof(queue_t));
 
     if (queuePtr) {
         long capacity = ((initCapacity < 2) ? 2 : initCapacity);
-        queuePtr->elements = (void**)malloc(capacity * sizeof(void*));
+        queuePtr->elements = (void**)memory_alloc(capacity * sizeof(void*));
         if (queuePtr->elements == NULL) {
-            free(queuePtr);
+            memory_free(queuePtr);
             return NULL;
         }
         queuePtr->pop      = capacity - 1;
@@ -122,8 +123,8 @@ TM_SAFE
 void
 queue_free (queue_t* queuePtr)
 {
-    free(queuePtr->elements);
-    free(queuePtr);
+    memory_free(queuePtr->elements);
+    memory_free(queuePtr);
 }
 
 
@@ -208,7 +209,7 @@ queue_push (queue_t* queuePtr, void* dataPtr)
     if (newPush == pop) {
 
         long newCapacity = capacity * QUEUE_GROWTH_FACTOR;
-        void** newElements = (void**)malloc(newCapacity * sizeof(void*));
+        void** newElements = (void**)memory_alloc(newCapacity * sizeof(void*));
         if (newElements == NULL) {
             return false;
         }
@@ -230,7 +231,7 @@ queue_push (queue_t* queuePtr, void* dataPtr)
             }
         }
 
-        free(elements);
+        memory_free(elements);
         queuePtr->elements = newElements;
         queuePtr->pop      = newCapacity - 1;
         queuePtr->capacity = newCapacity;
@@ -311,14 +312,13 @@ int
 main ()
 {
     queue_t* queuePtr;
-    random_t* randomPtr;
+    std::mt19937* randomPtr;
     long data[] = {3, 1, 4, 1, 5};
     long numData = sizeof(data) / sizeof(data[0]);
     long i;
 
-    randomPtr = random_alloc();
+    randomPtr = new std::mt19937(0);
     assert(randomPtr);
-    random_seed(randomPtr, 0);
 
     puts("Starting tests...");
 
@@ -351,6 +351,7 @@ main ()
     assert(!queue_isEmpty(queuePtr));
 
     queue_free(queuePtr);
+    delete randomPtr;
 
     return 0;
 }
@@ -80,12 +80,14 @@
  */
 
 
+#include <assert.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include "memory.h"
 #include "rbtree.h"
+#include "memory.h"
 #include "tm.h"
 
 struct node_t {
@@ -1045,9 +1047,9 @@ compareKeysDefault (const void* a, const void* b)
  */
 TM_SAFE
 rbtree_t*
-rbtree_alloc (long (*compare)(const void*, const void*))
+rbtree_alloc (TM_SAFE long (*compare)(const void*, const void*))
 {
-    rbtree_t* n = (rbtree_t* )malloc(sizeof(*n));
+    rbtree_t* n = (rbtree_t* )memory_alloc(sizeof(*n));
     if (n) {
         n->compare = (compare ? compare : &compareKeysDefault);
         n->root = NULL;
@@ -1063,7 +1065,7 @@ rbtree_alloc (long (*compare)(const void*, const void*))
 void
 releaseNode (node_t* n)
 {
-  free(n);
+  memory_free(n);
 }
 
 
@@ -1092,7 +1094,7 @@ void
 rbtree_free (rbtree_t* r)
 {
     freeTreeNode(r->root);
-    free(r);
+    memory_free(r);
 }
 
 
@@ -1105,7 +1107,7 @@ rbtree_free (rbtree_t* r)
 node_t*
 getNode ()
 {
-    node_t* n = (node_t*)malloc(sizeof(*n));
+    node_t* n = (node_t*)memory_alloc(sizeof(*n));
     return n;
 }
 
@@ -1197,6 +1199,87 @@ rbtree_contains (  rbtree_t* r, void* key)
 }
 
 
+/* =============================================================================
+ * linkSubtree
+ * -- Makes nodes[lo..hi) a subtree rooted at its middle node, which is at
+ *    the given depth; only the nodes at redDepth are red
+ * =============================================================================
+ */
+static node_t*
+linkSubtree (node_t** nodes, long lo, long hi, node_t* parent,
+             long depth, long redDepth)
+{
+    if (lo >= hi) {
+        return NULL;
+    }
+
+    long mid = lo + (hi - lo) / 2;
+    node_t* n = nodes[mid];
+    n->p = parent;
+    n->c = ((depth == redDepth) ? RED : BLACK);
+    n->l = linkSubtree(nodes, lo, mid, n, depth + 1, redDepth);
+    n->r = linkSubtree(nodes, mid + 1, hi, n, depth + 1, redDepth);
+
+    return n;
+}
+
+
+/* =============================================================================
+ * rbtree_bulkLoad
+ * -- Builds the tree bottom-up from keys in increasing order, in O(n)
+ * -- The tree must be empty and the keys distinct
+ * -- Returns false on allocation failure, leaving the tree empty
+ * =============================================================================
+ */
+bool
+rbtree_bulkLoad (rbtree_t* r, void** keys, void** vals, long numKey)
+{
+    assert(r->root == NULL);
+
+    if (numKey <= 0) {
+        return true;
+    }
+
+    node_t** nodes = (node_t**)malloc(numKey * sizeof(node_t*));
+    if (nodes == NULL) {
+        return false;
+    }
+
+    for (long i = 0; i < numKey; i++) {
+        assert(i == 0 || r->compare(keys[i - 1], keys[i]) < 0);
+        node_t* n = getNode();
+        if (n == NULL) {
+            while (--i >= 0) {
+                releaseNode(nodes[i]);
+            }
+            free(nodes);
+            return false;
+        }
+        n->k = keys[i];
+        n->v = vals[i];
+        nodes[i] = n;
+    }
+
+    /*
+     * Splitting at the middle fills every level but the deepest, so all
+     * paths have the same number of black nodes if only that level is red.
+     * A lone root stays black.
+     */
+    long redDepth = 0;
+    for (long n = numKey; n > 1; n >>= 1) {
+        redDepth++;
+    }
+    if (redDepth == 0) {
+        redDepth = -1;
+    }
+
+    r->root = linkSubtree(nodes, 0, numKey, NULL, 0, redDepth);
+    free(nodes);
+
+    return true;
+}
+
+
 /* /////////////////////////////////////////////////////////////////////////////
  * TEST_RBTREE
  * /////////////////////////////////////////////////////////////////////////////
@@ -1208,6 +1291,7 @@ rbtree_contains (  rbtree_t* r, void* key)
 #include <stdio.h>
 
 
+TM_SAFE
 static long
 compare (const void* a, const void* b)
 {
@@ -1257,6 +1341,30 @@ main ()
 
     rbtree_free(rbtreePtr);
 
+    /* Bulk loads of every size up to a few full levels are valid trees */
+    long keys[100];
+    void* keyPtrs[100];
+    for (i = 0; i < 100; i++) {
+        keys[i] = i * 2;
+        keyPtrs[i] = &keys[i];
+    }
+    for (long n = 0; n <= 100; n++) {
+        rbtreePtr = rbtree_alloc(&compare);
+        assert(rbtreePtr);
+        assert(rbtree_bulkLoad(rbtreePtr, keyPtrs, keyPtrs, n));
+        assert(rbtree_verify(rbtreePtr, 0) > 0);
+        for (i = 0; i < n; i++) {
+            assert(rbtree_get(rbtreePtr, keyPtrs[i]) == keyPtrs[i]);
+        }
+        long odd = 1;
+        assert(rbtree_get(rbtreePtr, &odd) == NULL);
+        if (n > 0) {
+            removeInt(rbtreePtr, &keys[n / 2]);
+            insertInt(rbtreePtr, &keys[n / 2]);
+        }
+        rbtree_free(rbtreePtr);
+    }
+
     puts("Done.");
 
     return 0;
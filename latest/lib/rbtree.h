@@ -98,7 +98,7 @@ rbtree_verify (rbtree_t* s, long verbose);
  */
 __attribute__((transaction_safe))
 rbtree_t*
-rbtree_alloc (long (*compare)(const void*, const void*));
+rbtree_alloc (__attribute__((transaction_safe)) long (*compare)(const void*, const void*));
 
 
 /* =============================================================================
@@ -157,6 +157,18 @@ bool
 rbtree_contains (  rbtree_t* r, void* key);
 
 
+/* =============================================================================
+ * rbtree_bulkLoad
+ * -- Builds the tree bottom-up from keys in increasing order, in O(n)
+ * -- The tree must be empty and the keys distinct
+ * -- Returns false on allocation failure, leaving the tree empty
+ * -- Not for use inside a transaction
+ * =============================================================================
+ */
+bool
+rbtree_bulkLoad (rbtree_t* r, void** keys, void** vals, long numKey);
+
+
 #define TMRBTREE_ALLOC()          rbtree_alloc()
 #define TMRBTREE_FREE(r)          rbtree_free(r)
 #define TMRBTREE_INSERT(r, k, v)  rbtree_insert(r, (void*)(k), (void*)(v))
@@ -0,0 +1,421 @@
+/* =============================================================================
+ *
+ * skiplist.cc
+ * -- Ordered map as a skip list (Pugh, CACM 1990)
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "memory.h"
+#include "skiplist.h"
+#include "tm.h"
+#include "tm_transition.h"
+#include "xorshift.h"
+
+static __thread unsigned long global_levelSeed = 0;
+
+
+/* =============================================================================
+ * randomHeight
+ * -- Pure: an aborted insert just leaves the generator further along
+ * =============================================================================
+ */
+__attribute__((transaction_pure))
+static long
+randomHeight ()
+{
+    if (global_levelSeed == 0) {
+        global_levelSeed =
+            (unsigned long)&global_levelSeed * 0x9e3779b97f4a7c15UL | 1;
+    }
+    unsigned long seed = xorshift_next(&global_levelSeed);
+
+    /* Two random bits per level: 1/4 of the towers reach the next one */
+    long height = 1;
+    while (height < SKIPLIST_MAX_LEVEL && (seed & 3) == 0) {
+        seed >>= 2;
+        height++;
+    }
+
+    return height;
+}
+
+
+/* =============================================================================
+ * allocNode
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+TM_SAFE
+static skiplist_node_t*
+allocNode (void* k, void* v, long height)
+{
+    skiplist_node_t* n = (skiplist_node_t*)memory_alloc(
+        sizeof(skiplist_node_t) + (height - 1) * sizeof(skiplist_node_t*));
+    if (n == NULL) {
+        return NULL;
+    }
+
+    n->k = k;
+    n->v = v;
+    n->height = height;
+    for (long i = 0; i < height; i++) {
+        n->next[i] = NULL;
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * compareKeysDefault
+ * =============================================================================
+ */
+TM_SAFE
+static long
+compareKeysDefault (const void* a, const void* b)
+{
+    return (((long)a < (long)b) ? -1 : ((long)a > (long)b));
+}
+
+
+/* =============================================================================
+ * findPreds
+ * -- Fills preds[i] with the last node at level i whose key is < key
+ * -- Returns the first node whose key is >= key, or NULL
+ * =============================================================================
+ */
+TM_SAFE
+static skiplist_node_t*
+findPreds (skiplist_t* s, void* key, skiplist_node_t** preds)
+{
+    long (*compare)(const void*, const void*) TM_SAFE = s->compare;
+    skiplist_node_t* x = s->head;
+
+    for (long i = SKIPLIST_MAX_LEVEL - 1; i >= 0; i--) {
+        skiplist_node_t* n = x->next[i];
+        while (n != NULL && compare(n->k, key) < 0) {
+            x = n;
+            n = x->next[i];
+        }
+        preds[i] = x;
+    }
+
+    return x->next[0];
+}
+
+
+/* =============================================================================
+ * findNode
+ * -- Like findPreds, but stops at the first level where key shows up
+ * =============================================================================
+ */
+TM_SAFE
+static skiplist_node_t*
+findNode (skiplist_t* s, void* key)
+{
+    long (*compare)(const void*, const void*) TM_SAFE = s->compare;
+    skiplist_node_t* x = s->head;
+
+    for (long i = SKIPLIST_MAX_LEVEL - 1; i >= 0; i--) {
+        skiplist_node_t* n = x->next[i];
+        while (n != NULL) {
+            long cmp = compare(n->k, key);
+            if (cmp == 0) {
+                return n;
+            }
+            if (cmp > 0) {
+                break;
+            }
+            x = n;
+            n = x->next[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/* =============================================================================
+ * skiplist_alloc
+ * =============================================================================
+ */
+TM_SAFE
+skiplist_t*
+skiplist_alloc (TM_SAFE long (*compare)(const void*, const void*))
+{
+    skiplist_t* s = (skiplist_t*)memory_alloc(sizeof(skiplist_t));
+    if (s == NULL) {
+        return NULL;
+    }
+
+    s->compare = (compare ? compare : &compareKeysDefault);
+    s->head = allocNode(NULL, NULL, SKIPLIST_MAX_LEVEL);
+    if (s->head == NULL) {
+        memory_free(s);
+        return NULL;
+    }
+
+    return s;
+}
+
+
+/* =============================================================================
+ * skiplist_free
+ * =============================================================================
+ */
+TM_SAFE
+void
+skiplist_free (skiplist_t* s)
+{
+    skiplist_node_t* n = s->head;
+
+    while (n != NULL) {
+        skiplist_node_t* nextPtr = n->next[0];
+        memory_free(n);
+        n = nextPtr;
+    }
+
+    memory_free(s);
+}
+
+
+/* =============================================================================
+ * skiplist_insert
+ * =============================================================================
+ */
+TM_SAFE
+bool
+skiplist_insert (skiplist_t* s, void* key, void* val)
+{
+    skiplist_node_t* preds[SKIPLIST_MAX_LEVEL];
+    skiplist_node_t* n = findPreds(s, key, preds);
+
+    if (n != NULL && s->compare(n->k, key) == 0) {
+        return false;
+    }
+
+    long height = randomHeight();
+    skiplist_node_t* newPtr = allocNode(key, val, height);
+    if (newPtr == NULL) {
+        return false;
+    }
+
+    for (long i = 0; i < height; i++) {
+        newPtr->next[i] = preds[i]->next[i];
+        preds[i]->next[i] = newPtr;
+    }
+
+    return true;
+}
+
+
+/* =============================================================================
+ * skiplist_delete
+ * =============================================================================
+ */
+TM_SAFE
+bool
+skiplist_delete (skiplist_t* s, void* key)
+{
+    skiplist_node_t* preds[SKIPLIST_MAX_LEVEL];
+    skiplist_node_t* n = findPreds(s, key, preds);
+
+    if (n == NULL || s->compare(n->k, key) != 0) {
+        return false;
+    }
+
+    for (long i = 0; i < n->height; i++) {
+        assert(preds[i]->next[i] == n);
+        preds[i]->next[i] = n->next[i];
+    }
+    memory_free(n);
+
+    return true;
+}
+
+
+/* =============================================================================
+ * skiplist_update
+ * =============================================================================
+ */
+TM_SAFE
+bool
+skiplist_update (skiplist_t* s, void* key, void* val)
+{
+    skiplist_node_t* n = findNode(s, key);
+
+    if (n != NULL) {
+        n->v = val;
+        return true;
+    }
+
+    skiplist_insert(s, key, val);
+    return false;
+}
+
+
+/* =============================================================================
+ * skiplist_get
+ * =============================================================================
+ */
+TM_SAFE
+void*
+skiplist_get (skiplist_t* s, void* key)
+{
+    skiplist_node_t* n = findNode(s, key);
+
+    return ((n != NULL) ? n->v : NULL);
+}
+
+
+/* =============================================================================
+ * skiplist_contains
+ * =============================================================================
+ */
+TM_SAFE
+bool
+skiplist_contains (skiplist_t* s, void* key)
+{
+    return (findNode(s, key) != NULL);
+}
+
+
+/* =============================================================================
+ * skiplist_iter_reset
+ * =============================================================================
+ */
+TM_SAFE
+void
+skiplist_iter_reset (skiplist_iter_t* itPtr, skiplist_t* s)
+{
+    *itPtr = s->head;
+}
+
+
+/* =============================================================================
+ * skiplist_iter_seek
+ * =============================================================================
+ */
+TM_SAFE
+void
+skiplist_iter_seek (skiplist_iter_t* itPtr, skiplist_t* s, void* key)
+{
+    skiplist_node_t* preds[SKIPLIST_MAX_LEVEL];
+
+    findPreds(s, key, preds);
+    *itPtr = preds[0];
+}
+
+
+/* =============================================================================
+ * skiplist_iter_hasNext
+ * =============================================================================
+ */
+TM_SAFE
+bool
+skiplist_iter_hasNext (skiplist_iter_t* itPtr)
+{
+    return ((*itPtr)->next[0] != NULL);
+}
+
+
+/* =============================================================================
+ * skiplist_iter_next
+ * =============================================================================
+ */
+TM_SAFE
+void*
+skiplist_iter_next (skiplist_iter_t* itPtr, void** keyPtrPtr)
+{
+    skiplist_node_t* n = (*itPtr)->next[0];
+
+    *itPtr = n;
+    if (keyPtrPtr != NULL) {
+        *keyPtrPtr = n->k;
+    }
+
+    return n->v;
+}
+
+
+/* =============================================================================
+ * TEST_SKIPLIST
+ * =============================================================================
+ */
+#ifdef TEST_SKIPLIST
+
+
+#include <stdio.h>
+
+
+int
+main ()
+{
+    long numKey = 100000;
+    long k;
+
+    puts("Starting...");
+
+    skiplist_t* s = skiplist_alloc(NULL);
+    assert(s);
+
+    /* Insert in a scrambled order: 7919 is prime to numKey */
+    for (k = 0; k < numKey; k++) {
+        long key = (k * 7919) % numKey;
+        assert(skiplist_insert(s, (void*)key, (void*)(key + 1)));
+        assert(!skiplist_insert(s, (void*)key, (void*)(key + 1)));
+    }
+
+    for (k = 0; k < numKey; k++) {
+        assert(skiplist_get(s, (void*)k) == (void*)(k + 1));
+    }
+    assert(!skiplist_contains(s, (void*)numKey));
+
+    for (k = 0; k < numKey; k += 2) {
+        assert(skiplist_delete(s, (void*)k));
+        assert(!skiplist_delete(s, (void*)k));
+    }
+    assert(!skiplist_update(s, (void*)0, (void*)1));
+    assert(skiplist_update(s, (void*)0, (void*)2));
+
+    /* In order: 0, then the odd keys */
+    skiplist_iter_t it;
+    void* keyPtr;
+    long expect = 0;
+    long n = 0;
+    skiplist_iter_reset(&it, s);
+    while (skiplist_iter_hasNext(&it)) {
+        void* v = skiplist_iter_next(&it, &keyPtr);
+        assert((long)keyPtr == expect);
+        assert(v == (void*)((expect == 0) ? 2 : expect + 1));
+        expect = (expect == 0) ? 1 : expect + 2;
+        n++;
+    }
+    assert(n == numKey / 2 + 1);
+
+    skiplist_iter_seek(&it, s, (void*)500);
+    assert(skiplist_iter_hasNext(&it));
+    skiplist_iter_next(&it, &keyPtr);
+    assert((long)keyPtr == 501);
+
+    skiplist_free(s);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_SKIPLIST */
+
+
+/* =============================================================================
+ *
+ * End of skiplist.cc
+ *
+ * =============================================================================
+ */
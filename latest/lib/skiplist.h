@@ -0,0 +1,164 @@
+/* =============================================================================
+ *
+ * skiplist.h
+ * -- Ordered map as a skip list (Pugh, CACM 1990)
+ *
+ * =============================================================================
+ *
+ * Same interface as rbtree.h.  Nothing is rebalanced: an insert or remove
+ * writes only the next pointers of the key's predecessors, at the levels of
+ * its own tower, and reads the path down to it.  Two transactions on keys
+ * that are not adjacent at any common level do not conflict, where with the
+ * rbtree recoloring and rotations can write nodes near the root.
+ *
+ * Towers are SKIPLIST_MAX_LEVEL high at most, level i + 1 holding a key
+ * with probability 1/4, so searches take O(log n) steps up to ~4^16 keys.
+ * Searches start at the top of the head tower; there is no current-height
+ * field for every tall insert to write.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+enum skiplist_config {
+    SKIPLIST_MAX_LEVEL = 16
+};
+
+struct skiplist_node_t {
+    void* k;
+    void* v;
+    long height;
+    skiplist_node_t* next[1]; /* [height] */
+};
+
+struct skiplist_t {
+    __attribute__((transaction_safe)) long (*compare)(const void*, const void*);
+    skiplist_node_t* head;    /* SKIPLIST_MAX_LEVEL high; no key */
+};
+
+typedef skiplist_node_t* skiplist_iter_t;
+
+
+/* =============================================================================
+ * skiplist_alloc
+ * -- NULL compare orders keys as longs
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+skiplist_t*
+skiplist_alloc (__attribute__((transaction_safe)) long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * skiplist_free
+ * -- Does not free keys or values
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+skiplist_free (skiplist_t* s);
+
+
+/* =============================================================================
+ * skiplist_insert
+ * -- Returns false if the key is present or on allocation failure
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+skiplist_insert (skiplist_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * skiplist_delete
+ * -- Returns true if successful, else false
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+skiplist_delete (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * skiplist_update
+ * -- Return false if had to insert node first
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+skiplist_update (skiplist_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * skiplist_get
+ * -- Returns NULL if not found, else the value
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void*
+skiplist_get (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * skiplist_contains
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+skiplist_contains (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * skiplist_iter_reset
+ * -- Positions before the smallest key
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+skiplist_iter_reset (skiplist_iter_t* itPtr, skiplist_t* s);
+
+
+/* =============================================================================
+ * skiplist_iter_seek
+ * -- Positions before the smallest key not less than key
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+skiplist_iter_seek (skiplist_iter_t* itPtr, skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * skiplist_iter_hasNext
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+skiplist_iter_hasNext (skiplist_iter_t* itPtr);
+
+
+/* =============================================================================
+ * skiplist_iter_next
+ * -- Returns the next value in key order; its key goes to *keyPtrPtr
+ *    unless that is NULL
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void*
+skiplist_iter_next (skiplist_iter_t* itPtr, void** keyPtrPtr);
+
+
+#define TMSKIPLIST_ALLOC(c)           skiplist_alloc(c)
+#define TMSKIPLIST_FREE(s)            skiplist_free(s)
+#define TMSKIPLIST_INSERT(s, k, v)    skiplist_insert(s, (void*)(k), (void*)(v))
+#define TMSKIPLIST_DELETE(s, k)       skiplist_delete(s, (void*)(k))
+#define TMSKIPLIST_UPDATE(s, k, v)    skiplist_update(s, (void*)(k), (void*)(v))
+#define TMSKIPLIST_GET(s, k)          skiplist_get(s, (void*)(k))
+#define TMSKIPLIST_CONTAINS(s, k)     skiplist_contains(s, (void*)(k))
+#define TMSKIPLIST_ITER_RESET(it, s)  skiplist_iter_reset(it, s)
+#define TMSKIPLIST_ITER_SEEK(it, s, k) \
+    skiplist_iter_seek(it, s, (void*)(k))
+#define TMSKIPLIST_ITER_HASNEXT(it)   skiplist_iter_hasNext(it)
+#define TMSKIPLIST_ITER_NEXT(it, kp)  skiplist_iter_next(it, kp)
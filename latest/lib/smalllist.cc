@@ -0,0 +1,385 @@
+/* =============================================================================
+ *
+ * smalllist.cc
+ * -- Sorted list that keeps its first elements inline in an array
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include "list.h"
+#include "memory.h"
+#include "smalllist.h"
+#include "tm.h"
+#include "tm_transition.h"
+
+
+/* =============================================================================
+ * compareAddresses
+ * -- Default compare function
+ * =============================================================================
+ */
+TM_SAFE
+static long
+compareAddresses (const void* a, const void* b)
+{
+    return ((long)a - (long)b);
+}
+
+
+/* =============================================================================
+ * getNumInline
+ * =============================================================================
+ */
+TM_SAFE
+static inline long
+getNumInline (smalllist_t* listPtr)
+{
+    long size = listPtr->size;
+
+    return ((size < SMALLLIST_NUM_INLINE) ? size : (long)SMALLLIST_NUM_INLINE);
+}
+
+
+/* =============================================================================
+ * findIndex
+ * -- Returns the first inline index whose element is not less than dataPtr,
+ *    or the number of inline elements if there is none
+ * =============================================================================
+ */
+TM_SAFE
+static long
+findIndex (smalllist_t* listPtr, void* dataPtr, long numInline)
+{
+    long i;
+
+    for (i = 0; i < numInline; i++) {
+        if (listPtr->compare(listPtr->elements[i], dataPtr) >= 0) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/* =============================================================================
+ * findPreviousLink
+ * -- Returns the link in the overflow chain that points to the first node
+ *    whose data is not less than dataPtr, or to NULL
+ * =============================================================================
+ */
+TM_SAFE
+static list_node_t**
+findPreviousLink (smalllist_t* listPtr, void* dataPtr)
+{
+    list_node_t** linkPtr = &listPtr->overflowPtr;
+
+    for (; *linkPtr != NULL; linkPtr = &(*linkPtr)->nextPtr) {
+        if (listPtr->compare((*linkPtr)->dataPtr, dataPtr) >= 0) {
+            break;
+        }
+    }
+
+    return linkPtr;
+}
+
+
+/* =============================================================================
+ * smalllist_alloc
+ * -- If NULL passed for 'compare' function, will compare data pointer addresses
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+TM_SAFE
+smalllist_t*
+smalllist_alloc (TM_SAFE long (*compare)(const void*, const void*))
+{
+    smalllist_t* listPtr = (smalllist_t*)memory_alloc(sizeof(smalllist_t));
+    if (listPtr == NULL) {
+        return NULL;
+    }
+
+    listPtr->size = 0;
+    listPtr->compare = ((compare != NULL) ? compare : &compareAddresses);
+    listPtr->overflowPtr = NULL;
+
+    return listPtr;
+}
+
+
+/* =============================================================================
+ * smalllist_free
+ * =============================================================================
+ */
+TM_SAFE
+void
+smalllist_free (smalllist_t* listPtr)
+{
+    smalllist_clear(listPtr);
+    memory_free(listPtr);
+}
+
+
+/* =============================================================================
+ * smalllist_find
+ * -- Returns NULL if not found, else returns pointer to data
+ * =============================================================================
+ */
+TM_SAFE
+void*
+smalllist_find (smalllist_t* listPtr, void* dataPtr)
+{
+    long numInline = getNumInline(listPtr);
+    long i = findIndex(listPtr, dataPtr, numInline);
+
+    if (i < numInline) {
+        void* elementPtr = listPtr->elements[i];
+        return ((listPtr->compare(elementPtr, dataPtr) == 0) ?
+                elementPtr : NULL);
+    }
+
+    list_node_t* nodePtr = *findPreviousLink(listPtr, dataPtr);
+    if ((nodePtr == NULL) ||
+        (listPtr->compare(nodePtr->dataPtr, dataPtr) != 0)) {
+        return NULL;
+    }
+
+    return nodePtr->dataPtr;
+}
+
+
+/* =============================================================================
+ * smalllist_insert
+ * -- Return true on success, else false
+ * -- Goes before any equal elements, as with list_insert
+ * =============================================================================
+ */
+TM_SAFE
+bool
+smalllist_insert (smalllist_t* listPtr, void* dataPtr)
+{
+    long numInline = getNumInline(listPtr);
+    long i = findIndex(listPtr, dataPtr, numInline);
+
+    if (i == numInline && numInline == SMALLLIST_NUM_INLINE) {
+        /* Past the array: goes in the overflow chain */
+        list_node_t** linkPtr = findPreviousLink(listPtr, dataPtr);
+#ifdef LIST_NO_DUPLICATES
+        if ((*linkPtr != NULL) &&
+            (listPtr->compare((*linkPtr)->dataPtr, dataPtr) == 0)) {
+            return false;
+        }
+#endif
+        list_node_t* nodePtr = (list_node_t*)memory_alloc(sizeof(list_node_t));
+        if (nodePtr == NULL) {
+            return false;
+        }
+        nodePtr->dataPtr = dataPtr;
+        nodePtr->nextPtr = *linkPtr;
+        *linkPtr = nodePtr;
+        listPtr->size++;
+        return true;
+    }
+
+#ifdef LIST_NO_DUPLICATES
+    if ((i < numInline) &&
+        (listPtr->compare(listPtr->elements[i], dataPtr) == 0)) {
+        return false;
+    }
+#endif
+
+    if (numInline == SMALLLIST_NUM_INLINE) {
+        /* The last inline element moves to the front of the chain */
+        list_node_t* nodePtr = (list_node_t*)memory_alloc(sizeof(list_node_t));
+        if (nodePtr == NULL) {
+            return false;
+        }
+        nodePtr->dataPtr = listPtr->elements[SMALLLIST_NUM_INLINE - 1];
+        nodePtr->nextPtr = listPtr->overflowPtr;
+        listPtr->overflowPtr = nodePtr;
+        numInline--;
+    }
+
+    for (long j = numInline; j > i; j--) {
+        listPtr->elements[j] = listPtr->elements[j - 1];
+    }
+    listPtr->elements[i] = dataPtr;
+    listPtr->size++;
+
+    return true;
+}
+
+
+/* =============================================================================
+ * smalllist_remove
+ * -- Returns true if successful, else false
+ * =============================================================================
+ */
+TM_SAFE
+bool
+smalllist_remove (smalllist_t* listPtr, void* dataPtr)
+{
+    long numInline = getNumInline(listPtr);
+    long i = findIndex(listPtr, dataPtr, numInline);
+
+    if (i == numInline) {
+        list_node_t** linkPtr = findPreviousLink(listPtr, dataPtr);
+        list_node_t* nodePtr = *linkPtr;
+        if ((nodePtr == NULL) ||
+            (listPtr->compare(nodePtr->dataPtr, dataPtr) != 0)) {
+            return false;
+        }
+        *linkPtr = nodePtr->nextPtr;
+        memory_free(nodePtr);
+        listPtr->size--;
+        return true;
+    }
+
+    if (listPtr->compare(listPtr->elements[i], dataPtr) != 0) {
+        return false;
+    }
+
+    for (long j = i + 1; j < numInline; j++) {
+        listPtr->elements[j - 1] = listPtr->elements[j];
+    }
+
+    /* The first overflow element fills the freed end of the array */
+    list_node_t* nodePtr = listPtr->overflowPtr;
+    if (nodePtr != NULL) {
+        listPtr->elements[SMALLLIST_NUM_INLINE - 1] = nodePtr->dataPtr;
+        listPtr->overflowPtr = nodePtr->nextPtr;
+        memory_free(nodePtr);
+    }
+    listPtr->size--;
+    assert(listPtr->size >= 0);
+
+    return true;
+}
+
+
+/* =============================================================================
+ * smalllist_clear
+ * -- Removes all elements
+ * =============================================================================
+ */
+TM_SAFE
+void
+smalllist_clear (smalllist_t* listPtr)
+{
+    list_node_t* nodePtr = listPtr->overflowPtr;
+
+    while (nodePtr != NULL) {
+        list_node_t* nextPtr = nodePtr->nextPtr;
+        memory_free(nodePtr);
+        nodePtr = nextPtr;
+    }
+    listPtr->overflowPtr = NULL;
+    listPtr->size = 0;
+}
+
+
+/* =============================================================================
+ * TEST_SMALLLIST
+ * =============================================================================
+ */
+#ifdef TEST_SMALLLIST
+
+
+#include <stdio.h>
+
+
+TM_SAFE
+static long
+compare (const void* a, const void* b)
+{
+    return (*((const long*)a) - *((const long*)b));
+}
+
+
+/* =============================================================================
+ * checkSame
+ * -- The small list and a list_t fed the same operations hold the same
+ *    elements in the same order
+ * =============================================================================
+ */
+static void
+checkSame (smalllist_t* smallPtr, list_t* listPtr)
+{
+    smalllist_iter_t smallIt;
+    list_iter_t it;
+
+    assert(list_getSize(smallPtr) == list_getSize(listPtr));
+    assert(list_isEmpty(smallPtr) == list_isEmpty(listPtr));
+
+    list_iter_reset(&smallIt, smallPtr);
+    list_iter_reset(&it, listPtr);
+    while (list_iter_hasNext(&it)) {
+        assert(list_iter_hasNext(&smallIt));
+        assert(list_iter_next(&smallIt) == list_iter_next(&it));
+    }
+    assert(!list_iter_hasNext(&smallIt));
+}
+
+
+int
+main ()
+{
+    long numData = 64;
+    long data[64];
+    long i;
+
+    puts("Starting...");
+
+    for (i = 0; i < numData; i++) {
+        data[i] = i / 2; /* pairs of equal keys in different places */
+    }
+
+    smalllist_t* smallPtr = smalllist_alloc(&compare);
+    list_t* listPtr = list_alloc(&compare);
+    assert(smallPtr && listPtr);
+    checkSame(smallPtr, listPtr);
+
+    unsigned long seed = 1;
+    for (long r = 0; r < 20000; r++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        long* dataPtr = &data[(seed >> 33) % numData];
+        long op = (seed >> 20) % 8;
+        if (op < 4 && list_getSize(listPtr) < 24) {
+            assert(list_insert(smallPtr, dataPtr) ==
+                   list_insert(listPtr, dataPtr));
+        } else if (op < 7) {
+            assert(list_remove(smallPtr, dataPtr) ==
+                   list_remove(listPtr, dataPtr));
+        } else {
+            void* foundPtr = list_find(smallPtr, dataPtr);
+            assert(foundPtr == list_find(listPtr, dataPtr) ||
+                   (foundPtr && *(long*)foundPtr == *dataPtr));
+        }
+        checkSame(smallPtr, listPtr);
+    }
+
+    list_clear(smallPtr);
+    list_clear(listPtr);
+    checkSame(smallPtr, listPtr);
+
+    list_free(smallPtr);
+    list_free(listPtr);
+
+    puts("All tests passed.");
+
+    return 0;
+}
+
+
+#endif /* TEST_SMALLLIST */
+
+
+/* =============================================================================
+ *
+ * End of smalllist.cc
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,203 @@
+/* =============================================================================
+ *
+ * smalllist.h
+ * -- Sorted list that keeps its first elements inline in an array
+ *
+ * =============================================================================
+ *
+ * Hashtable chains, vacation's reservation lists and yada's neighbor lists
+ * almost always hold a handful of elements.  As list_t, each element is a
+ * node of its own, so a transaction that walks one reads a cache line per
+ * element and an insert allocates.  smalllist_t holds the first
+ * SMALLLIST_NUM_INLINE elements, in order, in an array next to the size
+ * and compare pointer; only elements past those go into a sorted chain of
+ * list_node_t.  Walking a short list reads one or two cache lines.
+ *
+ * The order, the compare function and the LIST_NO_DUPLICATES behavior are
+ * those of list_t.  The list_* functions below are overloads of the list.h
+ * ones, so the TMLIST_* macros and list_iter_t-style loops work on a
+ * smalllist_t with a smalllist_iter_t.  Allocation differs: use
+ * smalllist_alloc (TMSMALLLIST_ALLOC).
+ *
+ * As with list_t, an iterator is invalid once the list is changed.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+#include "list.h"
+
+enum smalllist_config {
+    SMALLLIST_NUM_INLINE = 6 /* the list header then spans 80 bytes */
+};
+
+struct smalllist_t {
+    long size;
+    __attribute__((transaction_safe)) long (*compare)(const void*, const void*);
+    void* elements[SMALLLIST_NUM_INLINE]; /* first min(size, N) elements */
+    list_node_t* overflowPtr;             /* the rest, in order */
+};
+
+struct smalllist_iter_t {
+    smalllist_t* listPtr;
+    long index;            /* next inline element */
+    list_node_t* nodePtr;  /* last overflow node returned, else NULL */
+};
+
+
+/* =============================================================================
+ * smalllist_alloc
+ * -- If NULL passed for 'compare' function, will compare data pointer addresses
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+smalllist_t*
+smalllist_alloc (__attribute__((transaction_safe)) long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * smalllist_free
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+smalllist_free (smalllist_t* listPtr);
+
+
+/* =============================================================================
+ * smalllist_find
+ * -- Returns NULL if not found, else returns pointer to data
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void*
+smalllist_find (smalllist_t* listPtr, void* dataPtr);
+
+
+/* =============================================================================
+ * smalllist_insert
+ * -- Return true on success, else false
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+smalllist_insert (smalllist_t* listPtr, void* dataPtr);
+
+
+/* =============================================================================
+ * smalllist_remove
+ * -- Returns true if successful, else false
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+bool
+smalllist_remove (smalllist_t* listPtr, void* dataPtr);
+
+
+/* =============================================================================
+ * smalllist_clear
+ * -- Removes all elements
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+void
+smalllist_clear (smalllist_t* listPtr);
+
+
+/* =============================================================================
+ * Overloads of the list.h interface
+ * =============================================================================
+ */
+
+__attribute__((transaction_safe))
+inline void
+list_iter_reset (smalllist_iter_t* itPtr, smalllist_t* listPtr)
+{
+    itPtr->listPtr = listPtr;
+    itPtr->index = 0;
+    itPtr->nodePtr = NULL;
+}
+
+__attribute__((transaction_safe))
+inline bool
+list_iter_hasNext (smalllist_iter_t* itPtr)
+{
+    smalllist_t* listPtr = itPtr->listPtr;
+
+    if (itPtr->index < listPtr->size && itPtr->index < SMALLLIST_NUM_INLINE) {
+        return true;
+    }
+
+    return (((itPtr->nodePtr != NULL) ?
+             itPtr->nodePtr->nextPtr : listPtr->overflowPtr) != NULL);
+}
+
+__attribute__((transaction_safe))
+inline void*
+list_iter_next (smalllist_iter_t* itPtr)
+{
+    smalllist_t* listPtr = itPtr->listPtr;
+
+    if (itPtr->index < listPtr->size && itPtr->index < SMALLLIST_NUM_INLINE) {
+        return listPtr->elements[itPtr->index++];
+    }
+
+    itPtr->nodePtr = ((itPtr->nodePtr != NULL) ?
+                      itPtr->nodePtr->nextPtr : listPtr->overflowPtr);
+
+    return itPtr->nodePtr->dataPtr;
+}
+
+__attribute__((transaction_safe))
+inline void
+list_free (smalllist_t* listPtr)
+{
+    smalllist_free(listPtr);
+}
+
+__attribute__((transaction_safe))
+inline bool
+list_isEmpty (smalllist_t* listPtr)
+{
+    return (listPtr->size == 0);
+}
+
+__attribute__((transaction_safe))
+inline long
+list_getSize (smalllist_t* listPtr)
+{
+    return listPtr->size;
+}
+
+__attribute__((transaction_safe))
+inline void*
+list_find (smalllist_t* listPtr, void* dataPtr)
+{
+    return smalllist_find(listPtr, dataPtr);
+}
+
+__attribute__((transaction_safe))
+inline bool
+list_insert (smalllist_t* listPtr, void* dataPtr)
+{
+    return smalllist_insert(listPtr, dataPtr);
+}
+
+__attribute__((transaction_safe))
+inline bool
+list_remove (smalllist_t* listPtr, void* dataPtr)
+{
+    return smalllist_remove(listPtr, dataPtr);
+}
+
+__attribute__((transaction_safe))
+inline void
+list_clear (smalllist_t* listPtr)
+{
+    smalllist_clear(listPtr);
+}
+
+
+#define TMSMALLLIST_ALLOC(cmp)          smalllist_alloc(cmp)
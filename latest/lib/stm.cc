@@ -0,0 +1,1121 @@
+/* =============================================================================
+ *
+ * stm.cc
+ * -- NOrec word-based STM behind the GCC transactional memory ABI
+ *
+ * =============================================================================
+ *
+ * See stm.h.  Accesses are tracked per aligned 8-byte word with a byte
+ * mask, so sub-word and unaligned accesses share one code path.  Reads are
+ * logged as (word, value, mask) and revalidated by value whenever the
+ * global sequence lock moves.  Writes are buffered in a hashed redo log
+ * and written back under the sequence lock at commit.
+ *
+ * Stack memory below the frame that began the transaction is private to
+ * the transaction and is accessed directly: buffering it would make the
+ * commit write into frames that have since been reused.
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xmmintrin.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+#include "stm.h"
+#include "xorshift.h"
+
+#ifndef __x86_64__
+#  error "stm.cc: _ITM_beginTransaction is only implemented for x86_64"
+#endif
+
+#define STM_SERIAL_RETRY  64 /* conflicts before going serial irrevocable */
+#define STM_MAX_BACKOFF   10 /* log2 of the largest backoff, in pauses */
+
+/* Subset of the Intel TM ABI constants used by GCC (see libitm.h) */
+enum {
+    pr_instrumentedCode     = 0x0001,
+    pr_uninstrumentedCode   = 0x0002,
+    pr_hasNoAbort           = 0x0008,
+    pr_doesGoIrrevocable    = 0x0040
+};
+
+enum {
+    a_runInstrumentedCode   = 0x01,
+    a_runUninstrumentedCode = 0x02,
+    a_saveLiveVariables     = 0x04,
+    a_restoreLiveVariables  = 0x08,
+    a_abortTransaction      = 0x10
+};
+
+enum {
+    userAbort               = 1,
+    TMConflict              = 4,
+    outerAbort              = 16
+};
+
+enum {
+    outsideTransaction      = 0,
+    inRetryableTransaction  = 1,
+    inIrrevocableTransaction = 2
+};
+
+/* Layout shared with the assembly below */
+typedef struct stm_jmpbuf {
+    uint64_t cfa;
+    uint64_t rbx;
+    uint64_t rbp;
+    uint64_t r12;
+    uint64_t r13;
+    uint64_t r14;
+    uint64_t r15;
+    uint64_t rip;
+} stm_jmpbuf_t;
+
+typedef struct readEntry {
+    const uint64_t* addr;
+    uint64_t value;
+    uint64_t mask;
+} readEntry_t;
+
+typedef struct writeEntry {
+    uint64_t* addr;
+    uint64_t value;
+    uint64_t mask;
+    unsigned long bucket;
+} writeEntry_t;
+
+typedef struct undoEntry {
+    void* addr;
+    size_t size;
+    size_t offset; /* into stm_tx_t::undoBytes */
+} undoEntry_t;
+
+typedef struct allocEntry {
+    void* ptr;
+    bool isNew; /* operator new, else malloc */
+} allocEntry_t;
+
+typedef struct stm_tx {
+    stm_jmpbuf_t jmpbuf;
+    uint32_t props;
+    long nesting;
+    uint64_t snapshot;
+    bool isIrrevocable;
+    unsigned long numRetry;
+    unsigned long seed;
+    std::vector<readEntry_t> readSet;
+    std::vector<writeEntry_t> writeSet;
+    std::vector<long> writeBuckets; /* index+1 into writeSet, 0 is empty */
+    std::vector<undoEntry_t> undoLog;
+    std::vector<char> undoBytes;
+    std::vector<allocEntry_t> allocs;
+    std::vector<allocEntry_t> frees;
+    unsigned long long id;
+    struct stm_tx* nextPtr;
+} __attribute__((aligned(64))) stm_tx_t;
+
+typedef struct cloneTable {
+    std::vector<std::pair<void*, void*> > pairs; /* sorted (orig, clone) */
+    void* table;
+    struct cloneTable* nextPtr;
+} cloneTable_t;
+
+static struct {
+    std::atomic<uint64_t> value;
+    char pad[64 - sizeof(std::atomic<uint64_t>)];
+} __attribute__((aligned(64))) global_seqlock;
+
+static std::atomic<unsigned long long> global_txId(0);
+static pthread_mutex_t global_txLock     = PTHREAD_MUTEX_INITIALIZER;
+static stm_tx_t*       global_txListPtr  = NULL;
+static cloneTable_t*   global_cloneTables = NULL;
+
+static __thread stm_tx_t* stm_self = NULL;
+
+extern "C" {
+uint32_t stm_beginTransaction (uint32_t props, const stm_jmpbuf_t* jmpbufPtr);
+void stm_longjmp (uint32_t actions, const stm_jmpbuf_t* jmpbufPtr)
+    __attribute__((noreturn));
+}
+
+/*
+ * Like libitm's sjlj.S: save the callee-saved registers and the caller's
+ * stack pointer in a jmpbuf on our stack, whose rip slot overlaps the
+ * return address, and hand it to stm_beginTransaction.  stm_longjmp
+ * reloads them and returns from _ITM_beginTransaction a second time.
+ */
+asm (
+    "   .text\n"
+    "   .globl  _ITM_beginTransaction\n"
+    "   .type   _ITM_beginTransaction, @function\n"
+    "_ITM_beginTransaction:\n"
+    "   .cfi_startproc\n"
+    "   leaq    8(%rsp), %rax\n"
+    "   subq    $72, %rsp\n"
+    "   .cfi_adjust_cfa_offset 72\n"
+    "   movq    %rax, -64(%rax)\n"
+    "   movq    %rbx, -56(%rax)\n"
+    "   movq    %rbp, -48(%rax)\n"
+    "   movq    %r12, -40(%rax)\n"
+    "   movq    %r13, -32(%rax)\n"
+    "   movq    %r14, -24(%rax)\n"
+    "   movq    %r15, -16(%rax)\n"
+    "   leaq    -64(%rax), %rsi\n"
+    "   call    stm_beginTransaction\n"
+    "   addq    $72, %rsp\n"
+    "   .cfi_adjust_cfa_offset -72\n"
+    "   ret\n"
+    "   .cfi_endproc\n"
+    "   .size   _ITM_beginTransaction, .-_ITM_beginTransaction\n"
+    "\n"
+    "   .globl  stm_longjmp\n"
+    "   .type   stm_longjmp, @function\n"
+    "stm_longjmp:\n"
+    "   .cfi_startproc\n"
+    "   movq    (%rsi), %rcx\n"
+    "   movq    8(%rsi), %rbx\n"
+    "   movq    16(%rsi), %rbp\n"
+    "   movq    24(%rsi), %r12\n"
+    "   movq    32(%rsi), %r13\n"
+    "   movq    40(%rsi), %r14\n"
+    "   movq    48(%rsi), %r15\n"
+    "   movl    %edi, %eax\n"
+    "   movq    %rcx, %rsp\n"
+    "   jmp     *56(%rsi)\n"
+    "   .cfi_endproc\n"
+    "   .size   stm_longjmp, .-stm_longjmp\n"
+);
+
+
+/* =============================================================================
+ * Descriptors
+ * =============================================================================
+ */
+
+static stm_tx_t*
+allocTx ()
+{
+    void* memory;
+    int status = posix_memalign(&memory, 64, sizeof(stm_tx_t));
+    assert(status == 0);
+    stm_tx_t* txPtr = new (memory) stm_tx_t();
+
+    txPtr->nesting = 0;
+    txPtr->isIrrevocable = false;
+    txPtr->numRetry = 0;
+    txPtr->seed = (unsigned long)txPtr ^ 0x9e3779b97f4a7c15UL;
+    txPtr->readSet.reserve(1024);
+    txPtr->writeSet.reserve(256);
+    txPtr->writeBuckets.assign(512, 0);
+
+    pthread_mutex_lock(&global_txLock);
+    txPtr->nextPtr = global_txListPtr;
+    global_txListPtr = txPtr;
+    pthread_mutex_unlock(&global_txLock);
+
+    return txPtr;
+}
+
+
+static inline stm_tx_t*
+getTx ()
+{
+    stm_tx_t* txPtr = stm_self;
+    if (__builtin_expect(txPtr == NULL, 0)) {
+        txPtr = allocTx();
+        stm_self = txPtr;
+    }
+    return txPtr;
+}
+
+
+/* =============================================================================
+ * Redo log
+ * =============================================================================
+ */
+
+static inline unsigned long
+hashWord (const uint64_t* addr, unsigned long numBucket)
+{
+    return (((uintptr_t)addr >> 3) * 0x9e3779b97f4a7c15UL) >> 20 & (numBucket - 1);
+}
+
+
+static inline writeEntry_t*
+findWrite (stm_tx_t* txPtr, const uint64_t* addr)
+{
+    unsigned long numBucket = txPtr->writeBuckets.size();
+    unsigned long b = hashWord(addr, numBucket);
+    long index;
+
+    while ((index = txPtr->writeBuckets[b]) != 0) {
+        writeEntry_t* entryPtr = &txPtr->writeSet[index - 1];
+        if (entryPtr->addr == addr) {
+            return entryPtr;
+        }
+        b = (b + 1) & (numBucket - 1);
+    }
+
+    return NULL;
+}
+
+
+static void
+rehashWrites (stm_tx_t* txPtr, unsigned long numBucket)
+{
+    txPtr->writeBuckets.assign(numBucket, 0);
+    for (size_t i = 0; i < txPtr->writeSet.size(); i++) {
+        writeEntry_t* entryPtr = &txPtr->writeSet[i];
+        unsigned long b = hashWord(entryPtr->addr, numBucket);
+        while (txPtr->writeBuckets[b] != 0) {
+            b = (b + 1) & (numBucket - 1);
+        }
+        txPtr->writeBuckets[b] = i + 1;
+        entryPtr->bucket = b;
+    }
+}
+
+
+static inline void
+addWrite (stm_tx_t* txPtr, uint64_t* addr, uint64_t value, uint64_t mask)
+{
+    writeEntry_t* entryPtr =
+        txPtr->writeSet.empty() ? NULL : findWrite(txPtr, addr);
+
+    if (entryPtr) {
+        entryPtr->value = (entryPtr->value & ~mask) | (value & mask);
+        entryPtr->mask |= mask;
+        return;
+    }
+
+    if (2 * (txPtr->writeSet.size() + 1) > txPtr->writeBuckets.size()) {
+        rehashWrites(txPtr, 2 * txPtr->writeBuckets.size());
+    }
+
+    unsigned long numBucket = txPtr->writeBuckets.size();
+    unsigned long b = hashWord(addr, numBucket);
+    while (txPtr->writeBuckets[b] != 0) {
+        b = (b + 1) & (numBucket - 1);
+    }
+
+    writeEntry_t entry = { addr, value & mask, mask, b };
+    txPtr->writeSet.push_back(entry);
+    txPtr->writeBuckets[b] = txPtr->writeSet.size();
+}
+
+
+/* =============================================================================
+ * storeMasked
+ * -- Stores only the bytes selected by mask, so that concurrent
+ *    non-transactional writes to the rest of the word are not lost
+ * =============================================================================
+ */
+static inline void
+storeMasked (uint64_t* addr, uint64_t value, uint64_t mask)
+{
+    if (mask == ~0UL) {
+        __atomic_store_n(addr, value, __ATOMIC_RELAXED);
+        return;
+    }
+    unsigned char* bytes = (unsigned char*)addr;
+    for (long i = 0; i < 8; i++) {
+        if ((mask >> (8 * i)) & 0xff) {
+            bytes[i] = (unsigned char)(value >> (8 * i));
+        }
+    }
+}
+
+
+static void
+writeBack (stm_tx_t* txPtr)
+{
+    for (size_t i = 0; i < txPtr->writeSet.size(); i++) {
+        writeEntry_t* entryPtr = &txPtr->writeSet[i];
+        storeMasked(entryPtr->addr, entryPtr->value, entryPtr->mask);
+    }
+}
+
+
+static void
+clearLogs (stm_tx_t* txPtr)
+{
+    for (size_t i = 0; i < txPtr->writeSet.size(); i++) {
+        txPtr->writeBuckets[txPtr->writeSet[i].bucket] = 0;
+    }
+    txPtr->writeSet.clear();
+    txPtr->readSet.clear();
+    txPtr->undoLog.clear();
+    txPtr->undoBytes.clear();
+    txPtr->allocs.clear();
+    txPtr->frees.clear();
+}
+
+
+static void
+freeAll (std::vector<allocEntry_t>* entries)
+{
+    for (size_t i = 0; i < entries->size(); i++) {
+        allocEntry_t* entryPtr = &(*entries)[i];
+        if (entryPtr->isNew) {
+            ::operator delete(entryPtr->ptr);
+        } else {
+            free(entryPtr->ptr);
+        }
+    }
+}
+
+
+/* =============================================================================
+ * NOrec core
+ * =============================================================================
+ */
+
+static void abortTx (stm_tx_t* txPtr, uint32_t reason) __attribute__((noreturn));
+
+
+/* =============================================================================
+ * validate
+ * -- Returns a new consistent snapshot, or aborts if a read value changed
+ * =============================================================================
+ */
+static uint64_t
+validate (stm_tx_t* txPtr)
+{
+    while (1) {
+        uint64_t time = global_seqlock.value.load(std::memory_order_acquire);
+        if (time & 1) {
+            _mm_pause();
+            continue;
+        }
+        for (size_t i = 0; i < txPtr->readSet.size(); i++) {
+            readEntry_t* entryPtr = &txPtr->readSet[i];
+            uint64_t value = __atomic_load_n(entryPtr->addr, __ATOMIC_RELAXED);
+            if ((value ^ entryPtr->value) & entryPtr->mask) {
+                abortTx(txPtr, TMConflict);
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (global_seqlock.value.load(std::memory_order_relaxed) == time) {
+            return time;
+        }
+    }
+}
+
+
+static inline uint64_t
+sharedRead (stm_tx_t* txPtr, const uint64_t* addr, uint64_t mask)
+{
+    uint64_t value = __atomic_load_n(addr, __ATOMIC_RELAXED);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    while (global_seqlock.value.load(std::memory_order_relaxed) != txPtr->snapshot) {
+        txPtr->snapshot = validate(txPtr);
+        value = __atomic_load_n(addr, __ATOMIC_RELAXED);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    readEntry_t entry = { addr, value, mask };
+    txPtr->readSet.push_back(entry);
+    return value;
+}
+
+
+/* =============================================================================
+ * acquireSeqlock
+ * -- Takes the sequence lock at a snapshot consistent with the read set
+ * =============================================================================
+ */
+static void
+acquireSeqlock (stm_tx_t* txPtr)
+{
+    uint64_t time = txPtr->snapshot;
+    while (!global_seqlock.value.compare_exchange_weak(time, time + 1,
+                                                       std::memory_order_acquire))
+    {
+        time = validate(txPtr);
+    }
+    txPtr->snapshot = time;
+}
+
+
+static void
+becomeIrrevocable (stm_tx_t* txPtr)
+{
+    if (txPtr->isIrrevocable) {
+        return;
+    }
+    acquireSeqlock(txPtr);
+    writeBack(txPtr);
+    for (size_t i = 0; i < txPtr->writeSet.size(); i++) {
+        txPtr->writeBuckets[txPtr->writeSet[i].bucket] = 0;
+    }
+    txPtr->writeSet.clear();
+    txPtr->readSet.clear();
+    txPtr->isIrrevocable = true;
+}
+
+
+static void
+backoff (stm_tx_t* txPtr)
+{
+    unsigned long shift = std::min(txPtr->numRetry, (unsigned long)STM_MAX_BACKOFF);
+    unsigned long seed = xorshift_next(&txPtr->seed);
+    unsigned long numPause = seed & ((1UL << shift) - 1);
+    for (unsigned long i = 0; i < numPause; i++) {
+        _mm_pause();
+    }
+}
+
+
+/* =============================================================================
+ * startAttempt
+ * -- Returns the _ITM_actions for a fresh attempt of the outermost block
+ * =============================================================================
+ */
+static uint32_t
+startAttempt (stm_tx_t* txPtr)
+{
+    uint32_t props = txPtr->props;
+    bool isSerial = !(props & pr_instrumentedCode) ||
+                    ((props & pr_doesGoIrrevocable) &&
+                     (props & pr_uninstrumentedCode)) ||
+                    ((props & pr_hasNoAbort) &&
+                     txPtr->numRetry >= STM_SERIAL_RETRY);
+
+    txPtr->id = ++global_txId;
+
+    if (isSerial) {
+        uint64_t time;
+        while (1) {
+            time = global_seqlock.value.load(std::memory_order_relaxed);
+            if (!(time & 1) &&
+                global_seqlock.value.compare_exchange_weak(time, time + 1,
+                                                           std::memory_order_acquire))
+            {
+                break;
+            }
+            _mm_pause();
+        }
+        txPtr->snapshot = time;
+        txPtr->isIrrevocable = true;
+        return (props & pr_uninstrumentedCode) ?
+               a_runUninstrumentedCode : a_runInstrumentedCode;
+    }
+
+    uint64_t time;
+    while ((time = global_seqlock.value.load(std::memory_order_acquire)) & 1) {
+        _mm_pause();
+    }
+    txPtr->snapshot = time;
+    return a_runInstrumentedCode;
+}
+
+
+static void
+rollback (stm_tx_t* txPtr)
+{
+    for (size_t i = txPtr->undoLog.size(); i > 0; i--) {
+        undoEntry_t* entryPtr = &txPtr->undoLog[i - 1];
+        memcpy(entryPtr->addr,
+               &txPtr->undoBytes[entryPtr->offset],
+               entryPtr->size);
+    }
+    freeAll(&txPtr->allocs);
+    clearLogs(txPtr);
+}
+
+
+/* =============================================================================
+ * abortTx
+ * -- Rolls back and resumes at _ITM_beginTransaction of the outermost block
+ * =============================================================================
+ */
+static void
+abortTx (stm_tx_t* txPtr, uint32_t reason)
+{
+    assert(!txPtr->isIrrevocable);
+    rollback(txPtr);
+
+    if (reason & userAbort) {
+        txPtr->nesting = 0;
+        txPtr->numRetry = 0;
+        stm_longjmp(a_abortTransaction | a_restoreLiveVariables,
+                    &txPtr->jmpbuf);
+    }
+
+    txPtr->numRetry++;
+    backoff(txPtr);
+    txPtr->nesting = 1;
+    stm_longjmp(startAttempt(txPtr) | a_restoreLiveVariables, &txPtr->jmpbuf);
+}
+
+
+/* =============================================================================
+ * Word access
+ * =============================================================================
+ */
+
+static inline uint64_t
+byteMask (uintptr_t offset, size_t size)
+{
+    return ((size >= 8) ? ~0UL : ((1UL << (8 * size)) - 1)) << (8 * offset);
+}
+
+
+static inline bool
+isTxStack (stm_tx_t* txPtr, const void* addr)
+{
+    return ((uintptr_t)addr >= (uintptr_t)__builtin_frame_address(0) &&
+            (uintptr_t)addr < txPtr->jmpbuf.cfa);
+}
+
+
+static inline uint64_t
+readWord (stm_tx_t* txPtr, const uint64_t* addr, uint64_t mask)
+{
+    writeEntry_t* entryPtr =
+        txPtr->writeSet.empty() ? NULL : findWrite(txPtr, addr);
+
+    if (entryPtr && (entryPtr->mask & mask) == mask) {
+        return entryPtr->value;
+    }
+    uint64_t value = sharedRead(txPtr, addr, mask & ~(entryPtr ? entryPtr->mask : 0));
+    if (entryPtr) {
+        value = (value & ~entryPtr->mask) | entryPtr->value;
+    }
+    return value;
+}
+
+
+static void
+readBytes (stm_tx_t* txPtr, void* dst, const void* src, size_t size)
+{
+    if (txPtr->isIrrevocable || isTxStack(txPtr, src)) {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    char* out = (char*)dst;
+    uintptr_t addr = (uintptr_t)src;
+    while (size > 0) {
+        uintptr_t offset = addr & 7;
+        size_t n = std::min(size, (size_t)(8 - offset));
+        uint64_t word = readWord(txPtr, (const uint64_t*)(addr - offset),
+                                 byteMask(offset, n));
+        memcpy(out, (char*)&word + offset, n);
+        out += n;
+        addr += n;
+        size -= n;
+    }
+}
+
+
+static void
+writeBytes (stm_tx_t* txPtr, void* dst, const void* src, size_t size)
+{
+    if (txPtr->isIrrevocable || isTxStack(txPtr, dst)) {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    const char* in = (const char*)src;
+    uintptr_t addr = (uintptr_t)dst;
+    while (size > 0) {
+        uintptr_t offset = addr & 7;
+        size_t n = std::min(size, (size_t)(8 - offset));
+        uint64_t word = 0;
+        memcpy((char*)&word + offset, in, n);
+        addWrite(txPtr, (uint64_t*)(addr - offset), word, byteMask(offset, n));
+        in += n;
+        addr += n;
+        size -= n;
+    }
+}
+
+
+template <typename T>
+static inline T
+stmRead (const T* ptr)
+{
+    stm_tx_t* txPtr = stm_self;
+    uintptr_t addr = (uintptr_t)ptr;
+    uintptr_t offset = addr & 7;
+
+    if (sizeof(T) <= 8 && offset + sizeof(T) <= 8 &&
+        !txPtr->isIrrevocable && !isTxStack(txPtr, ptr))
+    {
+        uint64_t word = readWord(txPtr, (const uint64_t*)(addr - offset),
+                                 byteMask(offset, sizeof(T)));
+        T value;
+        memcpy(&value, (char*)&word + offset, sizeof(T));
+        return value;
+    }
+
+    T value;
+    readBytes(txPtr, &value, ptr, sizeof(T));
+    return value;
+}
+
+
+template <typename T>
+static inline void
+stmWrite (T* ptr, T value)
+{
+    stm_tx_t* txPtr = stm_self;
+    uintptr_t addr = (uintptr_t)ptr;
+    uintptr_t offset = addr & 7;
+
+    if (txPtr->isIrrevocable || isTxStack(txPtr, ptr)) {
+        /* GCC passes 8-aligned addresses to the M128 barriers */
+        memcpy(ptr, &value, sizeof(T));
+        return;
+    }
+    if (sizeof(T) <= 8 && offset + sizeof(T) <= 8) {
+        uint64_t word = 0;
+        memcpy((char*)&word + offset, &value, sizeof(T));
+        addWrite(txPtr, (uint64_t*)(addr - offset), word,
+                 byteMask(offset, sizeof(T)));
+        return;
+    }
+    writeBytes(txPtr, ptr, &value, sizeof(T));
+}
+
+
+static void
+logBytes (const void* ptr, size_t size)
+{
+    stm_tx_t* txPtr = stm_self;
+    if (txPtr->isIrrevocable) {
+        return;
+    }
+    undoEntry_t entry = { (void*)ptr, size, txPtr->undoBytes.size() };
+    txPtr->undoBytes.insert(txPtr->undoBytes.end(),
+                            (const char*)ptr, (const char*)ptr + size);
+    txPtr->undoLog.push_back(entry);
+}
+
+
+static void*
+lookupClone (void* ptr)
+{
+    for (cloneTable_t* tablePtr = global_cloneTables;
+         tablePtr != NULL;
+         tablePtr = tablePtr->nextPtr)
+    {
+        std::vector<std::pair<void*, void*> >::iterator it =
+            std::lower_bound(tablePtr->pairs.begin(),
+                             tablePtr->pairs.end(),
+                             std::make_pair(ptr, (void*)NULL));
+        if (it != tablePtr->pairs.end() && it->first == ptr) {
+            return it->second;
+        }
+    }
+    return NULL;
+}
+
+
+/* =============================================================================
+ * ABI entry points
+ * =============================================================================
+ */
+extern "C" {
+
+uint32_t
+stm_beginTransaction (uint32_t props, const stm_jmpbuf_t* jmpbufPtr)
+{
+    stm_tx_t* txPtr = getTx();
+
+    if (txPtr->nesting++ > 0) {
+        /* Flat nesting; a nested __transaction_cancel is not supported */
+        return (props & pr_instrumentedCode) && !txPtr->isIrrevocable ?
+               a_runInstrumentedCode : a_runUninstrumentedCode;
+    }
+
+    txPtr->jmpbuf = *jmpbufPtr;
+    txPtr->props = props;
+    txPtr->numRetry = 0;
+
+    return startAttempt(txPtr) | a_saveLiveVariables;
+}
+
+
+void
+_ITM_commitTransaction ()
+{
+    stm_tx_t* txPtr = stm_self;
+
+    if (--txPtr->nesting > 0) {
+        return;
+    }
+
+    if (txPtr->isIrrevocable) {
+        global_seqlock.value.store(txPtr->snapshot + 2, std::memory_order_release);
+        txPtr->isIrrevocable = false;
+    } else if (!txPtr->writeSet.empty()) {
+        txPtr->nesting = 1; /* validation may still abort and retry */
+        acquireSeqlock(txPtr);
+        txPtr->nesting = 0;
+        writeBack(txPtr);
+        global_seqlock.value.store(txPtr->snapshot + 2, std::memory_order_release);
+    }
+
+    freeAll(&txPtr->frees);
+    clearLogs(txPtr);
+}
+
+
+void
+_ITM_commitTransactionEH (void* exceptionPtr)
+{
+    (void)exceptionPtr;
+    _ITM_commitTransaction();
+}
+
+
+void
+_ITM_abortTransaction (uint32_t reason)
+{
+    stm_tx_t* txPtr = stm_self;
+    assert(reason & userAbort);
+    assert(!(reason & outerAbort));
+    if (txPtr->nesting != 1 || txPtr->isIrrevocable) {
+        fprintf(stderr, "stm: __transaction_cancel needs an outermost, "
+                        "non-irrevocable transaction\n");
+        abort();
+    }
+    abortTx(txPtr, reason);
+}
+
+
+void
+_ITM_changeTransactionMode (uint32_t mode)
+{
+    (void)mode; /* only modeSerialIrrevocable exists */
+    becomeIrrevocable(stm_self);
+}
+
+
+uint32_t
+_ITM_inTransaction ()
+{
+    stm_tx_t* txPtr = stm_self;
+    if (txPtr == NULL || txPtr->nesting == 0) {
+        return outsideTransaction;
+    }
+    return txPtr->isIrrevocable ? inIrrevocableTransaction : inRetryableTransaction;
+}
+
+
+unsigned long long
+_ITM_getTransactionId ()
+{
+    stm_tx_t* txPtr = stm_self;
+    return (txPtr && txPtr->nesting) ? txPtr->id : 0;
+}
+
+
+int
+_ITM_versionCompatible (int version)
+{
+    return version == 1;
+}
+
+
+const char*
+_ITM_libraryVersion ()
+{
+    return "STAMP NOrec STM";
+}
+
+
+void
+_ITM_error (const void* location, int code)
+{
+    (void)location;
+    fprintf(stderr, "stm: _ITM_error %d\n", code);
+    abort();
+}
+
+
+void
+_ITM_registerTMCloneTable (void* table, size_t numPair)
+{
+    cloneTable_t* tablePtr = new cloneTable_t();
+    void** entries = (void**)table;
+    for (size_t i = 0; i < numPair; i++) {
+        tablePtr->pairs.push_back(std::make_pair(entries[2 * i], entries[2 * i + 1]));
+    }
+    std::sort(tablePtr->pairs.begin(), tablePtr->pairs.end());
+    tablePtr->table = table;
+    tablePtr->nextPtr = global_cloneTables;
+    global_cloneTables = tablePtr;
+}
+
+
+void
+_ITM_deregisterTMCloneTable (void* table)
+{
+    cloneTable_t** prevPtr = &global_cloneTables;
+    while (*prevPtr != NULL) {
+        if ((*prevPtr)->table == table) {
+            cloneTable_t* tablePtr = *prevPtr;
+            *prevPtr = tablePtr->nextPtr;
+            delete tablePtr;
+            return;
+        }
+        prevPtr = &(*prevPtr)->nextPtr;
+    }
+}
+
+
+void*
+_ITM_getTMCloneSafe (void* ptr)
+{
+    void* clonePtr = lookupClone(ptr);
+    if (clonePtr == NULL) {
+        fprintf(stderr, "stm: no transactional clone for %p\n", ptr);
+        abort();
+    }
+    return clonePtr;
+}
+
+
+void*
+_ITM_getTMCloneOrIrrevocable (void* ptr)
+{
+    void* clonePtr = lookupClone(ptr);
+    if (clonePtr == NULL) {
+        becomeIrrevocable(stm_self);
+        return ptr;
+    }
+    return clonePtr;
+}
+
+
+void*
+_ITM_malloc (size_t size)
+{
+    void* ptr = malloc(size);
+    allocEntry_t entry = { ptr, false };
+    stm_self->allocs.push_back(entry);
+    return ptr;
+}
+
+
+void*
+_ITM_calloc (size_t numElement, size_t size)
+{
+    void* ptr = calloc(numElement, size);
+    allocEntry_t entry = { ptr, false };
+    stm_self->allocs.push_back(entry);
+    return ptr;
+}
+
+
+void
+_ITM_free (void* ptr)
+{
+    stm_tx_t* txPtr = stm_self;
+    if (txPtr->isIrrevocable) {
+        free(ptr);
+        return;
+    }
+    allocEntry_t entry = { ptr, false };
+    txPtr->frees.push_back(entry);
+}
+
+
+void
+_ITM_dropReferences (void* ptr, size_t size)
+{
+    (void)ptr;
+    (void)size;
+}
+
+
+/* operator new/delete clones (mangled names of their transactional clones) */
+
+static void*
+newTx (size_t size)
+{
+    void* ptr = ::operator new(size);
+    allocEntry_t entry = { ptr, true };
+    stm_self->allocs.push_back(entry);
+    return ptr;
+}
+
+static void
+deleteTx (void* ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    stm_tx_t* txPtr = stm_self;
+    if (txPtr->isIrrevocable) {
+        ::operator delete(ptr);
+        return;
+    }
+    allocEntry_t entry = { ptr, true };
+    txPtr->frees.push_back(entry);
+}
+
+void* _ZGTtnwm (size_t size)            { return newTx(size); }
+void* _ZGTtnam (size_t size)            { return newTx(size); }
+void  _ZGTtdlPv (void* ptr)             { deleteTx(ptr); }
+void  _ZGTtdaPv (void* ptr)             { deleteTx(ptr); }
+void  _ZGTtdlPvm (void* ptr, size_t n)  { (void)n; deleteTx(ptr); }
+void  _ZGTtdaPvm (void* ptr, size_t n)  { (void)n; deleteTx(ptr); }
+
+
+/* Loads, stores and logging for each ABI type */
+
+#define STM_BARRIERS(T, S) \
+    T _ITM_R##S (const T* ptr)      { return stmRead<T>(ptr); } \
+    T _ITM_RaR##S (const T* ptr)    { return stmRead<T>(ptr); } \
+    T _ITM_RaW##S (const T* ptr)    { return stmRead<T>(ptr); } \
+    T _ITM_RfW##S (const T* ptr)    { return stmRead<T>(ptr); } \
+    void _ITM_W##S (T* ptr, T val)   { stmWrite<T>(ptr, val); } \
+    void _ITM_WaR##S (T* ptr, T val) { stmWrite<T>(ptr, val); } \
+    void _ITM_WaW##S (T* ptr, T val) { stmWrite<T>(ptr, val); } \
+    void _ITM_L##S (const T* ptr)    { logBytes(ptr, sizeof(T)); }
+
+STM_BARRIERS(uint8_t, U1)
+STM_BARRIERS(uint16_t, U2)
+STM_BARRIERS(uint32_t, U4)
+STM_BARRIERS(uint64_t, U8)
+STM_BARRIERS(float, F)
+STM_BARRIERS(double, D)
+STM_BARRIERS(long double, E)
+STM_BARRIERS(__complex__ float, CF)
+STM_BARRIERS(__complex__ double, CD)
+STM_BARRIERS(__complex__ long double, CE)
+STM_BARRIERS(__m128, M128)
+
+void
+_ITM_LB (const void* ptr, size_t size)
+{
+    logBytes(ptr, size);
+}
+
+
+/* memcpy/memmove: R/W t = transactional, n = not; aR/aW hints are ignored */
+
+static void
+copyTx (void* dst, const void* src, size_t size, bool isReadTx, bool isWriteTx)
+{
+    stm_tx_t* txPtr = stm_self;
+    char buffer[256];
+
+    /* Read everything before writing so overlapping moves work */
+    char* tmp = (size <= sizeof(buffer)) ? buffer : (char*)malloc(size);
+    assert(tmp);
+    if (isReadTx) {
+        readBytes(txPtr, tmp, src, size);
+    } else {
+        memcpy(tmp, src, size);
+    }
+    if (isWriteTx) {
+        writeBytes(txPtr, dst, tmp, size);
+    } else {
+        memcpy(dst, tmp, size);
+    }
+    if (tmp != buffer) {
+        free(tmp);
+    }
+}
+
+#define STM_COPY(R, W, isReadTx, isWriteTx) \
+    void _ITM_memcpy##R##W (void* dst, const void* src, size_t size) \
+    { copyTx(dst, src, size, isReadTx, isWriteTx); } \
+    void _ITM_memmove##R##W (void* dst, const void* src, size_t size) \
+    { copyTx(dst, src, size, isReadTx, isWriteTx); }
+
+STM_COPY(Rn,   Wt,   false, true)
+STM_COPY(Rn,   WtaR, false, true)
+STM_COPY(Rn,   WtaW, false, true)
+STM_COPY(Rt,   Wn,   true,  false)
+STM_COPY(Rt,   Wt,   true,  true)
+STM_COPY(Rt,   WtaR, true,  true)
+STM_COPY(Rt,   WtaW, true,  true)
+STM_COPY(RtaR, Wn,   true,  false)
+STM_COPY(RtaR, Wt,   true,  true)
+STM_COPY(RtaR, WtaR, true,  true)
+STM_COPY(RtaR, WtaW, true,  true)
+STM_COPY(RtaW, Wn,   true,  false)
+STM_COPY(RtaW, Wt,   true,  true)
+STM_COPY(RtaW, WtaR, true,  true)
+STM_COPY(RtaW, WtaW, true,  true)
+
+static void
+setTx (void* dst, int c, size_t size)
+{
+    stm_tx_t* txPtr = stm_self;
+    char buffer[256];
+    memset(buffer, c, sizeof(buffer));
+    char* out = (char*)dst;
+    while (size > 0) {
+        size_t n = std::min(size, sizeof(buffer));
+        writeBytes(txPtr, out, buffer, n);
+        out += n;
+        size -= n;
+    }
+}
+
+void _ITM_memsetW (void* dst, int c, size_t size)   { setTx(dst, c, size); }
+void _ITM_memsetWaR (void* dst, int c, size_t size) { setTx(dst, c, size); }
+void _ITM_memsetWaW (void* dst, int c, size_t size) { setTx(dst, c, size); }
+
+} /* extern "C" */
+
+
+/* =============================================================================
+ * stm_startup
+ * =============================================================================
+ */
+void
+stm_startup (long numThread)
+{
+    assert(numThread > 0);
+    global_seqlock.value.store(0);
+}
+
+
+/* =============================================================================
+ * stm_shutdown
+ * =============================================================================
+ */
+void
+stm_shutdown ()
+{
+    pthread_mutex_lock(&global_txLock);
+    stm_tx_t* txPtr = global_txListPtr;
+    global_txListPtr = NULL;
+    pthread_mutex_unlock(&global_txLock);
+
+    while (txPtr != NULL) {
+        stm_tx_t* nextPtr = txPtr->nextPtr;
+        assert(txPtr->nesting == 0);
+        txPtr->~stm_tx_t();
+        free(txPtr);
+        txPtr = nextPtr;
+    }
+    stm_self = NULL;
+}
+
+
+/* =============================================================================
+ * stm_threadEnter
+ * =============================================================================
+ */
+void
+stm_threadEnter ()
+{
+    getTx();
+}
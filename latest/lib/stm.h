@@ -0,0 +1,54 @@
+/* =============================================================================
+ *
+ * stm.h
+ * -- Built-in word-based STM, selected with make TMBACKEND=stm
+ *
+ * =============================================================================
+ *
+ * lib/stm.cc implements the transactional memory ABI that g++ -fgnu-tm
+ * emits calls to (_ITM_beginTransaction, _ITM_RU8, _ITM_WU8, ...), so it
+ * links in place of libitm without changing any benchmark or library code.
+ * Every access GCC instruments inside TM_BEGIN/TM_END and TM_SAFE
+ * functions, TM_SHARED_READ/TM_SHARED_WRITE included, goes through it.
+ *
+ * The algorithm is NOrec (Dalessandro, Spear, Scott, PPoPP 2010): one
+ * global sequence lock, a redo log for writes (lazy versioning), and
+ * value-based read validation.  There is no ownership-record table, so
+ * nothing is shared between transactions except the sequence lock.
+ * Transactions without __transaction_cancel fall back to serial
+ * irrevocable mode after STM_SERIAL_RETRY consecutive conflicts.
+ *
+ * Only x86_64 is supported.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+
+/* =============================================================================
+ * stm_startup
+ * -- Called once by thread_startup before any thread runs transactions
+ * =============================================================================
+ */
+void
+stm_startup (long numThread);
+
+
+/* =============================================================================
+ * stm_shutdown
+ * -- Called by thread_shutdown; frees all per-thread descriptors
+ * =============================================================================
+ */
+void
+stm_shutdown ();
+
+
+/* =============================================================================
+ * stm_threadEnter
+ * -- Allocates the calling thread's transaction descriptor
+ * -- Threads that skip this get one on their first transaction
+ * =============================================================================
+ */
+void
+stm_threadEnter ();
@@ -72,8 +72,18 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
 #include "tm.h"
 #include "thread.h"
+#include "xorshift.h"
 
 static __thread long      global_threadId;
 static long               global_numThread         = 1;
@@ -83,6 +93,549 @@ static pthread_t*         global_threads           = NULL;
 static void               (*global_funcPtr)(void*) = NULL;
 static void*              global_argPtr            = NULL;
 static volatile bool      global_doShutdown        = false;
+static bool               global_isParallel        = false;
+
+/**
+ * Task runtime: every thread owns a Chase-Lev work-stealing deque.  The owner
+ * pushes and takes at the bottom; idle threads steal from the top.  See Le,
+ * Pop, Cohen, Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak
+ * Memory Models", PPoPP 2013, for the memory orderings used below.
+ */
+enum {
+    TASK_CACHE_LINE        = 64,
+    TASK_INIT_LOG_SIZE     = 10,
+    TASK_SPIN_BEFORE_YIELD = 64
+};
+
+struct task_t {
+    void (*funcPtr)(void*);
+    void* argPtr;
+};
+
+struct taskArray_t {
+    long                  size;  /* always a power of 2 */
+    taskArray_t*          nextRetiredPtr;
+    std::atomic<task_t*>* elements;
+};
+
+struct taskDeque_t {
+    std::atomic<long>         top;
+    char                      pad1[TASK_CACHE_LINE - sizeof(std::atomic<long>)];
+    std::atomic<long>         bottom;
+    std::atomic<taskArray_t*> array;
+    taskArray_t*              retiredPtr; /* old arrays, freed at shutdown */
+    char                      pad2[TASK_CACHE_LINE
+                                   - sizeof(std::atomic<long>)
+                                   - sizeof(std::atomic<taskArray_t*>)
+                                   - sizeof(taskArray_t*)];
+};
+
+static taskDeque_t*       global_taskDeques        = NULL;
+static std::atomic<long>  global_numPendingTask(0);
+static long               global_nextSeedThread    = 0;
+static __thread unsigned long global_stealSeed;
+
+/**
+ * taskArray_alloc: Array of size task slots; size must be a power of 2
+ */
+static taskArray_t* taskArray_alloc(long size)
+{
+    taskArray_t* arrayPtr = (taskArray_t*)malloc(sizeof(taskArray_t));
+    assert(arrayPtr);
+    arrayPtr->size = size;
+    arrayPtr->nextRetiredPtr = NULL;
+    arrayPtr->elements =
+        (std::atomic<task_t*>*)malloc(size * sizeof(std::atomic<task_t*>));
+    assert(arrayPtr->elements);
+    return arrayPtr;
+}
+
+/**
+ * taskArray_free: Release an array and its slots
+ */
+static void taskArray_free(taskArray_t* arrayPtr)
+{
+    free(arrayPtr->elements);
+    free(arrayPtr);
+}
+
+/**
+ * taskDeque_init: Set up an empty deque
+ */
+static void taskDeque_init(taskDeque_t* dequePtr)
+{
+    dequePtr->top.store(0, std::memory_order_relaxed);
+    dequePtr->bottom.store(0, std::memory_order_relaxed);
+    dequePtr->array.store(taskArray_alloc(1L << TASK_INIT_LOG_SIZE),
+                          std::memory_order_relaxed);
+    dequePtr->retiredPtr = NULL;
+}
+
+/**
+ * taskDeque_destroy: Free the current array and every retired one
+ */
+static void taskDeque_destroy(taskDeque_t* dequePtr)
+{
+    taskArray_free(dequePtr->array.load(std::memory_order_relaxed));
+    taskArray_t* arrayPtr = dequePtr->retiredPtr;
+    while (arrayPtr) {
+        taskArray_t* nextPtr = arrayPtr->nextRetiredPtr;
+        taskArray_free(arrayPtr);
+        arrayPtr = nextPtr;
+    }
+}
+
+/**
+ * taskDeque_push: Owner only.  Doubles the array when full; the old array is
+ *                 kept alive because a thief may still be reading from it.
+ */
+static void taskDeque_push(taskDeque_t* dequePtr, task_t* taskPtr)
+{
+    long b = dequePtr->bottom.load(std::memory_order_relaxed);
+    long t = dequePtr->top.load(std::memory_order_acquire);
+    taskArray_t* arrayPtr = dequePtr->array.load(std::memory_order_relaxed);
+
+    if (b - t > arrayPtr->size - 1) {
+        taskArray_t* newArrayPtr = taskArray_alloc(arrayPtr->size * 2);
+        for (long i = t; i < b; i++) {
+            task_t* oldPtr = arrayPtr->elements[i & (arrayPtr->size - 1)]
+                .load(std::memory_order_relaxed);
+            newArrayPtr->elements[i & (newArrayPtr->size - 1)]
+                .store(oldPtr, std::memory_order_relaxed);
+        }
+        arrayPtr->nextRetiredPtr = dequePtr->retiredPtr;
+        dequePtr->retiredPtr = arrayPtr;
+        dequePtr->array.store(newArrayPtr, std::memory_order_release);
+        arrayPtr = newArrayPtr;
+    }
+
+    arrayPtr->elements[b & (arrayPtr->size - 1)]
+        .store(taskPtr, std::memory_order_relaxed);
+    dequePtr->bottom.store(b + 1, std::memory_order_release);
+}
+
+/**
+ * taskDeque_take: Owner only.  LIFO pop from the bottom; NULL if empty.
+ */
+static task_t* taskDeque_take(taskDeque_t* dequePtr)
+{
+    long b = dequePtr->bottom.load(std::memory_order_relaxed) - 1;
+    taskArray_t* arrayPtr = dequePtr->array.load(std::memory_order_relaxed);
+    dequePtr->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long t = dequePtr->top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        dequePtr->bottom.store(b + 1, std::memory_order_relaxed);
+        return NULL;
+    }
+
+    task_t* taskPtr = arrayPtr->elements[b & (arrayPtr->size - 1)]
+        .load(std::memory_order_relaxed);
+    if (t == b) {
+        /* Last element: race against thieves for it */
+        if (!dequePtr->top.compare_exchange_strong(t, t + 1,
+                                                   std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed)) {
+            taskPtr = NULL;
+        }
+        dequePtr->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return taskPtr;
+}
+
+/**
+ * taskDeque_steal: Any thread.  FIFO pop from the top; NULL if empty or if
+ *                  another thread won the race.
+ */
+static task_t* taskDeque_steal(taskDeque_t* dequePtr)
+{
+    long t = dequePtr->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long b = dequePtr->bottom.load(std::memory_order_acquire);
+
+    if (t >= b) {
+        return NULL;
+    }
+
+    taskArray_t* arrayPtr = dequePtr->array.load(std::memory_order_acquire);
+    task_t* taskPtr = arrayPtr->elements[t & (arrayPtr->size - 1)]
+        .load(std::memory_order_relaxed);
+    if (!dequePtr->top.compare_exchange_strong(t, t + 1,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed)) {
+        return NULL;
+    }
+
+    return taskPtr;
+}
+
+/**
+ * taskSteal: Try every other thread's deque once, starting at a random victim
+ */
+static task_t* taskSteal(long threadId)
+{
+    long numThread = global_numThread;
+    if (numThread < 2) {
+        return NULL;
+    }
+
+    /* A random first victim spreads the thieves out */
+    unsigned long x = xorshift_next(&global_stealSeed);
+
+    long start = (long)(x % (unsigned long)numThread);
+    for (long i = 0; i < numThread; i++) {
+        long victim = (start + i) % numThread;
+        if (victim == threadId) {
+            continue;
+        }
+        task_t* taskPtr = taskDeque_steal(&global_taskDeques[victim]);
+        if (taskPtr) {
+            return taskPtr;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Spinning barrier: centralized and sense-reversing.  Arrivals decrement a
+ * counter; the last one resets it and flips the shared sense.  Waiters spin on
+ * the sense with bounded exponential backoff and, if the phase is long (e.g.,
+ * secondary threads parked between parallel regions), sleep on a futex.
+ */
+enum {
+    BARRIER_MAX_BACKOFF = 64,      /* pause instructions per poll, at most */
+    BARRIER_SPIN_LIMIT  = 1L << 13 /* pause instructions before futex sleep */
+};
+
+struct spinBarrier_t {
+    std::atomic<long> numRemaining;
+    char              pad1[TASK_CACHE_LINE - sizeof(std::atomic<long>)];
+    std::atomic<int>  sense;        /* int: futex word */
+    std::atomic<int>  numSleeping;
+    char              pad2[TASK_CACHE_LINE - 2 * sizeof(std::atomic<int>)];
+    long              numThread;
+    long              spinLimit;    /* 0 when threads outnumber CPUs */
+};
+
+static thread_barrier_kind_t global_barrierKind    = THREAD_BARRIER_SPIN;
+static spinBarrier_t*     global_spinBarrierPtr    = NULL;
+static __thread int       global_barrierSense      = 0;
+
+/**
+ * cpuRelax: Hint to the core that we are spinning
+ */
+static inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/**
+ * futexWait/futexWake: Thin wrappers; spurious returns are handled by callers
+ */
+static void futexWait(std::atomic<int>* addrPtr, int val)
+{
+    syscall(SYS_futex, (int*)addrPtr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static void futexWake(std::atomic<int>* addrPtr)
+{
+    syscall(SYS_futex, (int*)addrPtr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/**
+ * spinBarrier_alloc: Cache-line aligned barrier for numThread threads
+ */
+static spinBarrier_t* spinBarrier_alloc(long numThread)
+{
+    void* memPtr = NULL;
+    int status = posix_memalign(&memPtr, TASK_CACHE_LINE, sizeof(spinBarrier_t));
+    assert(status == 0);
+    (void)status;
+    spinBarrier_t* barrierPtr = (spinBarrier_t*)memPtr;
+    barrierPtr->numRemaining.store(numThread);
+    barrierPtr->sense.store(0);
+    barrierPtr->numSleeping.store(0);
+    barrierPtr->numThread = numThread;
+    /* Spinning while the releaser waits for a CPU only delays it */
+    long numCpu = sysconf(_SC_NPROCESSORS_ONLN);
+    barrierPtr->spinLimit = ((numCpu > 0 && numThread > numCpu) ?
+                             0 : BARRIER_SPIN_LIMIT);
+    return barrierPtr;
+}
+
+/**
+ * spinBarrier_wait: The last arrival releases everyone; the store to sense
+ *                   publishes all writes made before the barrier.
+ */
+static void spinBarrier_wait(spinBarrier_t* barrierPtr)
+{
+    int mySense = !global_barrierSense;
+    global_barrierSense = mySense;
+
+    if (barrierPtr->numRemaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        barrierPtr->numRemaining.store(barrierPtr->numThread,
+                                       std::memory_order_relaxed);
+        barrierPtr->sense.store(mySense, std::memory_order_seq_cst);
+        if (barrierPtr->numSleeping.load(std::memory_order_seq_cst) > 0) {
+            futexWake(&barrierPtr->sense);
+        }
+        return;
+    }
+
+    long backoff = 1;
+    long spinLimit = barrierPtr->spinLimit;
+    for (long numSpin = 0; numSpin < spinLimit; numSpin += backoff) {
+        if (barrierPtr->sense.load(std::memory_order_acquire) == mySense) {
+            return;
+        }
+        for (long i = 0; i < backoff; i++) {
+            cpuRelax();
+        }
+        if (backoff < BARRIER_MAX_BACKOFF) {
+            backoff *= 2;
+        }
+    }
+
+    /*
+     * Registering as a sleeper before re-checking sense means the releaser
+     * either sees us and wakes us, or flipped sense before FUTEX_WAIT reads it.
+     */
+    barrierPtr->numSleeping.fetch_add(1, std::memory_order_seq_cst);
+    while (barrierPtr->sense.load(std::memory_order_seq_cst) != mySense) {
+        futexWait(&barrierPtr->sense, !mySense);
+    }
+    barrierPtr->numSleeping.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * barrierWait: Dispatch to the barrier chosen at thread_startup
+ */
+static void barrierWait()
+{
+    if (global_barrierKind == THREAD_BARRIER_PTHREAD) {
+        pthread_barrier_wait(global_barrierPtr);
+    } else {
+        spinBarrier_wait(global_spinBarrierPtr);
+    }
+}
+
+/**
+ * Thread placement: STAMP_AFFINITY selects where thread i runs.
+ *   compact      -- fill one NUMA node (and each core's SMT siblings) first
+ *   scatter      -- round-robin over nodes, then cores, then SMT siblings
+ *   <cpu list>   -- explicit list such as "0-3,8,10-11"; thread i gets the
+ *                   i-th entry
+ * Anything else (or unset) leaves placement to the scheduler.  Only CPUs in
+ * the process' initial affinity mask are used, and threads wrap around if
+ * there are more threads than CPUs.
+ */
+enum {
+    AFFINITY_MAX_CPU = CPU_SETSIZE
+};
+
+struct cpuInfo_t {
+    int  cpu;
+    long node;
+    long core;     /* package and core id; SMT siblings share it */
+    long smtRank;  /* position among SMT siblings */
+    long coreRank; /* position of the core within its node */
+};
+
+static int*               global_threadCpus        = NULL; /* NULL: unpinned */
+
+/**
+ * parseCpuList: Parse "0-3,8" into cpus[]; returns count, or -1 if malformed
+ */
+static long parseCpuList(const char* str, int* cpus, long maxNumCpu)
+{
+    long numCpu = 0;
+    const char* p = str;
+
+    while (*p && *p != '\n') {
+        char* endPtr;
+        long first = strtol(p, &endPtr, 10);
+        if (endPtr == p || first < 0) {
+            return -1;
+        }
+        long last = first;
+        p = endPtr;
+        if (*p == '-') {
+            p++;
+            last = strtol(p, &endPtr, 10);
+            if (endPtr == p || last < first) {
+                return -1;
+            }
+            p = endPtr;
+        }
+        for (long c = first; c <= last && numCpu < maxNumCpu; c++) {
+            cpus[numCpu++] = (int)c;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p && *p != '\n') {
+            return -1;
+        }
+    }
+
+    return numCpu;
+}
+
+/**
+ * readSysLong: First integer in a sysfs file, or defaultValue
+ */
+static long readSysLong(const char* path, long defaultValue)
+{
+    FILE* filePtr = fopen(path, "r");
+    if (!filePtr) {
+        return defaultValue;
+    }
+    long value;
+    if (fscanf(filePtr, "%li", &value) != 1) {
+        value = defaultValue;
+    }
+    fclose(filePtr);
+    return value;
+}
+
+/**
+ * getCpuTopology: Fill infos[] for every CPU we may run on; returns count
+ */
+static long getCpuTopology(cpuInfo_t* infos)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return 0;
+    }
+
+    static long nodeOf[AFFINITY_MAX_CPU];
+    for (long c = 0; c < AFFINITY_MAX_CPU; c++) {
+        nodeOf[c] = 0;
+    }
+    static int nodeCpus[AFFINITY_MAX_CPU];
+    for (long node = 0; node < AFFINITY_MAX_CPU; node++) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%li/cpulist",
+                 node);
+        FILE* filePtr = fopen(path, "r");
+        if (!filePtr) {
+            break;
+        }
+        char line[4096];
+        if (fgets(line, sizeof(line), filePtr)) {
+            long n = parseCpuList(line, nodeCpus, AFFINITY_MAX_CPU);
+            for (long i = 0; i < n; i++) {
+                if (nodeCpus[i] < AFFINITY_MAX_CPU) {
+                    nodeOf[nodeCpus[i]] = node;
+                }
+            }
+        }
+        fclose(filePtr);
+    }
+
+    long numCpu = 0;
+    for (int c = 0; c < AFFINITY_MAX_CPU; c++) {
+        if (!CPU_ISSET(c, &allowed)) {
+            continue;
+        }
+        char path[128];
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%i/topology/physical_package_id", c);
+        long package = readSysLong(path, 0);
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu%i/topology/core_id", c);
+        long core = readSysLong(path, c);
+        infos[numCpu].cpu  = c;
+        infos[numCpu].node = nodeOf[c];
+        infos[numCpu].core = package * AFFINITY_MAX_CPU + core;
+        numCpu++;
+    }
+
+    /* Ranks for scatter: compact order groups siblings and cores together */
+    std::sort(infos, infos + numCpu, [](const cpuInfo_t& a, const cpuInfo_t& b) {
+        if (a.node != b.node) return a.node < b.node;
+        if (a.core != b.core) return a.core < b.core;
+        return a.cpu < b.cpu;
+    });
+    for (long i = 0; i < numCpu; i++) {
+        if (i > 0 && infos[i].node == infos[i-1].node) {
+            bool isSibling = (infos[i].core == infos[i-1].core);
+            infos[i].smtRank  = (isSibling ? infos[i-1].smtRank + 1 : 0);
+            infos[i].coreRank = infos[i-1].coreRank + (isSibling ? 0 : 1);
+        } else {
+            infos[i].smtRank  = 0;
+            infos[i].coreRank = 0;
+        }
+    }
+
+    return numCpu;
+}
+
+/**
+ * getPlacement: CPU for each thread per STAMP_AFFINITY; NULL if unpinned
+ */
+static int* getPlacement(long numThread)
+{
+    const char* policy = getenv("STAMP_AFFINITY");
+    if (!policy || !*policy || strcmp(policy, "none") == 0) {
+        return NULL;
+    }
+
+    static int order[AFFINITY_MAX_CPU];
+    long numCpu = 0;
+
+    if (strcmp(policy, "compact") == 0 || strcmp(policy, "scatter") == 0) {
+        static cpuInfo_t infos[AFFINITY_MAX_CPU];
+        numCpu = getCpuTopology(infos);
+        if (strcmp(policy, "scatter") == 0) {
+            std::stable_sort(infos, infos + numCpu,
+                             [](const cpuInfo_t& a, const cpuInfo_t& b) {
+                if (a.smtRank != b.smtRank) return a.smtRank < b.smtRank;
+                if (a.coreRank != b.coreRank) return a.coreRank < b.coreRank;
+                return a.node < b.node;
+            });
+        }
+        for (long i = 0; i < numCpu; i++) {
+            order[i] = infos[i].cpu;
+        }
+    } else {
+        numCpu = parseCpuList(policy, order, AFFINITY_MAX_CPU);
+        for (long i = 0; i < numCpu; i++) {
+            if (order[i] >= AFFINITY_MAX_CPU) {
+                numCpu = -1;
+                break;
+            }
+        }
+    }
+
+    if (numCpu <= 0) {
+        fprintf(stderr, "Ignoring STAMP_AFFINITY=%s\n", policy);
+        return NULL;
+    }
+
+    int* threadCpus = (int*)malloc(numThread * sizeof(int));
+    assert(threadCpus);
+    for (long i = 0; i < numThread; i++) {
+        threadCpus[i] = order[i % numCpu];
+    }
+    return threadCpus;
+}
+
+/**
+ * Reduction slots: two sets of one cache line per thread.  Successive
+ * reductions alternate sets, so a thread still reading the slots of one
+ * reduction cannot be overwritten by a thread already in the next; that
+ * thread would have to pass the barrier of the next first.
+ */
+static char*              global_reduceSlots       = NULL;
+static __thread long      global_reducePhase       = 0;
 
 /**
  * threadWait: Synchronizes all threads to start/stop parallel section
@@ -92,14 +645,17 @@ static void* threadWait(void* argPtr)
     long threadId = *(long*)argPtr;
 
     global_threadId = (long)threadId;
+    global_stealSeed = (unsigned long)threadId * 2654435761UL + 1;
+    TM_THREAD_ENTER();
 
     while (1) {
-        pthread_barrier_wait(global_barrierPtr); /* wait for start parallel */
+        barrierWait(); /* wait for start parallel */
         if (global_doShutdown) {
             break;
         }
+        global_reducePhase = 0;
         global_funcPtr(global_argPtr);
-        pthread_barrier_wait(global_barrierPtr); /* wait for end parallel */
+        barrierWait(); /* wait for end parallel */
         if (threadId == 0) {
             break;
         }
@@ -109,18 +665,35 @@ static void* threadWait(void* argPtr)
 
 /**
  * thread_startup: Create pool of secondary threads.  numThread is total
- *                 number of threads (primary + secondaries)
+ *                 number of threads (primary + secondaries).  barrierKind
+ *                 picks the barrier; THREAD_BARRIER_DEFAULT consults the
+ *                 STAMP_BARRIER environment variable.
  */
-void thread_startup(long numThread)
+void thread_startup(long numThread, thread_barrier_kind_t barrierKind)
 {
     global_numThread = numThread;
     global_doShutdown = false;
 
+    TM_STARTUP(numThread);
+
+    if (barrierKind == THREAD_BARRIER_DEFAULT) {
+        const char* envPtr = getenv("STAMP_BARRIER");
+        if (envPtr && strcmp(envPtr, "pthread") == 0) {
+            barrierKind = THREAD_BARRIER_PTHREAD;
+        } else {
+            barrierKind = THREAD_BARRIER_SPIN;
+        }
+    }
+    global_barrierKind = barrierKind;
+
     // Set up barrier
     assert(global_barrierPtr == NULL);
     global_barrierPtr = (pthread_barrier_t*)malloc(sizeof(pthread_barrier_t));
     assert(global_barrierPtr);
     pthread_barrier_init(global_barrierPtr, 0, numThread);
+    assert(global_spinBarrierPtr == NULL);
+    global_spinBarrierPtr = spinBarrier_alloc(numThread);
+    global_barrierSense = 0;
 
     // Set up ids
     assert(global_threadIds == NULL);
@@ -135,9 +708,50 @@ void thread_startup(long numThread)
     global_threads = (pthread_t*)malloc(numThread * sizeof(pthread_t));
     assert(global_threads);
 
+    // Set up task deques
+    assert(global_taskDeques == NULL);
+    void* dequeMemPtr = NULL;
+    int status = posix_memalign(&dequeMemPtr, TASK_CACHE_LINE,
+                                numThread * sizeof(taskDeque_t));
+    assert(status == 0);
+    (void)status;
+    global_taskDeques = (taskDeque_t*)dequeMemPtr;
+    for (long i = 0; i < numThread; i++) {
+        taskDeque_init(&global_taskDeques[i]);
+    }
+    global_numPendingTask.store(0);
+    global_nextSeedThread = 0;
+
+    // Set up reduction slots
+    assert(global_reduceSlots == NULL);
+    void* slotMemPtr = NULL;
+    status = posix_memalign(&slotMemPtr, TASK_CACHE_LINE,
+                            2 * numThread * THREAD_REDUCE_SLOT_SIZE);
+    assert(status == 0);
+    global_reduceSlots = (char*)slotMemPtr;
+
+    // Set up placement; the primary is pinned here, secondaries at creation
+    assert(global_threadCpus == NULL);
+    global_threadCpus = getPlacement(numThread);
+    if (global_threadCpus) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(global_threadCpus[0], &cpuSet);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    }
+
     // Set up pool
     for (long i = 1; i < numThread; i++) {
-        pthread_create(&global_threads[i], NULL, &threadWait, (void*)&global_threadIds[i]);
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (global_threadCpus) {
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET(global_threadCpus[i], &cpuSet);
+            pthread_attr_setaffinity_np(&attr, sizeof(cpuSet), &cpuSet);
+        }
+        pthread_create(&global_threads[i], &attr, &threadWait, (void*)&global_threadIds[i]);
+        pthread_attr_destroy(&attr);
     }
 
     // Wait for primary thread to call thread_start
@@ -154,7 +768,9 @@ void thread_start(void (*funcPtr)(void*), void* argPtr)
     global_argPtr = argPtr;
 
     long threadId = 0; /* primary */
+    global_isParallel = true;
     threadWait((void*)&threadId);
+    global_isParallel = false;
 }
 
 /**
@@ -164,7 +780,7 @@ void thread_shutdown()
 {
     // Make secondary threads exit wait()
     global_doShutdown = true;
-    pthread_barrier_wait(global_barrierPtr);
+    barrierWait();
 
     long numThread = global_numThread;
 
@@ -172,15 +788,34 @@ void thread_shutdown()
         pthread_join(global_threads[i], NULL);
     }
 
+    pthread_barrier_destroy(global_barrierPtr);
     free(global_barrierPtr);
     global_barrierPtr = NULL;
 
+    free(global_spinBarrierPtr);
+    global_spinBarrierPtr = NULL;
+
     free(global_threadIds);
     global_threadIds = NULL;
 
     free(global_threads);
     global_threads = NULL;
 
+    free(global_threadCpus);
+    global_threadCpus = NULL;
+
+    assert(global_numPendingTask.load() == 0);
+    for (long i = 0; i < numThread; i++) {
+        taskDeque_destroy(&global_taskDeques[i]);
+    }
+    free(global_taskDeques);
+    global_taskDeques = NULL;
+
+    free(global_reduceSlots);
+    global_reduceSlots = NULL;
+
+    TM_SHUTDOWN();
+
     global_numThread = 1;
 }
 
@@ -208,7 +843,150 @@ long thread_getNumThread()
  */
 void thread_barrier_wait()
 {
-    pthread_barrier_wait(global_barrierPtr);
+    barrierWait();
+}
+
+/**
+ * thread_spawnTask: Queue funcPtr(argPtr) on the calling thread's deque.  The
+ *                   primary thread outside a parallel region deals tasks
+ *                   round-robin instead, so that no thread starts out idle.
+ */
+void thread_spawnTask(void (*funcPtr)(void*), void* argPtr)
+{
+    task_t* taskPtr = (task_t*)malloc(sizeof(task_t));
+    assert(taskPtr);
+    taskPtr->funcPtr = funcPtr;
+    taskPtr->argPtr = argPtr;
+
+    long dequeId;
+    if (global_isParallel) {
+        dequeId = global_threadId;
+    } else {
+        dequeId = global_nextSeedThread;
+        global_nextSeedThread = (dequeId + 1) % global_numThread;
+    }
+
+    global_numPendingTask.fetch_add(1, std::memory_order_relaxed);
+    taskDeque_push(&global_taskDeques[dequeId], taskPtr);
+}
+
+/**
+ * thread_waitAll: Run local tasks, then steal, until no task is pending
+ *                 anywhere.  A task's children are counted before the task
+ *                 itself retires, so the count only reaches zero when the
+ *                 whole task graph has finished.
+ */
+void thread_waitAll()
+{
+    long threadId = global_threadId;
+    taskDeque_t* myDequePtr = &global_taskDeques[threadId];
+    long numIdle = 0;
+
+    while (1) {
+        task_t* taskPtr = taskDeque_take(myDequePtr);
+        if (!taskPtr) {
+            taskPtr = taskSteal(threadId);
+        }
+
+        if (taskPtr) {
+            taskPtr->funcPtr(taskPtr->argPtr);
+            free(taskPtr);
+            global_numPendingTask.fetch_sub(1, std::memory_order_release);
+            numIdle = 0;
+            continue;
+        }
+
+        if (global_numPendingTask.load(std::memory_order_acquire) == 0) {
+            break;
+        }
+
+        if (++numIdle > TASK_SPIN_BEFORE_YIELD) {
+            sched_yield();
+        }
+    }
+}
+
+/**
+ * thread_reduceExchange: Publish the caller's value in its slot of the
+ *                        current set and wait for everyone else's
+ */
+const void* thread_reduceExchange(const void* valuePtr, size_t numByte)
+{
+    assert(numByte <= THREAD_REDUCE_SLOT_SIZE);
+
+    char* slots = global_reduceSlots
+                  + (global_reducePhase & 1) * global_numThread
+                    * THREAD_REDUCE_SLOT_SIZE;
+    global_reducePhase++;
+
+    memcpy(slots + global_threadId * THREAD_REDUCE_SLOT_SIZE, valuePtr, numByte);
+    barrierWait();
+
+    return slots;
+}
+
+/**
+ * memsetMyPart: Write the calling thread's block of whole pages in
+ *               [ptr, ptr+numByte)
+ */
+static void memsetMyPart(void* ptr, int value, size_t numByte,
+                         long threadId, long numThread)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t numPage = (numByte + pageSize - 1) / pageSize;
+    size_t pagesPerThread = (numPage + numThread - 1) / numThread;
+    size_t start = (size_t)threadId * pagesPerThread * pageSize;
+    size_t stop = start + pagesPerThread * pageSize;
+    if (stop > numByte) {
+        stop = numByte;
+    }
+    if (start < stop) {
+        memset((char*)ptr + start, value, stop - start);
+    }
+}
+
+struct memsetArg_t {
+    void*  ptr;
+    int    value;
+    size_t numByte;
+};
+
+/**
+ * memsetWork: Parallel region body of thread_memset
+ */
+static void memsetWork(void* argPtr)
+{
+    memsetArg_t* memsetArgPtr = (memsetArg_t*)argPtr;
+    memsetMyPart(memsetArgPtr->ptr, memsetArgPtr->value,
+                 memsetArgPtr->numByte, global_threadId, global_numThread);
+}
+
+/**
+ * thread_memset: memset, but with each thread writing the pages it owns under
+ *                a block partition, so that first-touch page placement puts
+ *                them on that thread's NUMA node.  Inside a parallel region
+ *                the memory is taken to be the caller's own and is written
+ *                by it alone.
+ */
+void thread_memset(void* ptr, int value, size_t numByte)
+{
+    if (global_isParallel || global_numThread == 1 || global_threads == NULL) {
+        memset(ptr, value, numByte);
+        return;
+    }
+
+    memsetArg_t arg = {ptr, value, numByte};
+    thread_start(&memsetWork, (void*)&arg);
+}
+
+/**
+ * thread_memsetPart: Collective version of thread_memset for use inside a
+ *                    parallel region; every thread must call it, and a
+ *                    barrier is needed before reading the memory.
+ */
+void thread_memsetPart(void* ptr, int value, size_t numByte)
+{
+    memsetMyPart(ptr, value, numByte, global_threadId, global_numThread);
 }
 
 /* =============================================================================
@@ -219,9 +997,11 @@ void thread_barrier_wait()
 
 #include <stdio.h>
 #include <unistd.h>
+#include "timer.h"
 
 #define NUM_THREADS    (4)
 #define NUM_ITERATIONS (3)
+#define NUM_BARRIERS   (100000)
 
 void printId (void* argPtr)
 {
@@ -244,6 +1024,64 @@ void printId (void* argPtr)
     }
 }
 
+static std::atomic<long> global_numTaskRun(0);
+
+void countTask (void* argPtr)
+{
+    long depth = (long)argPtr;
+    global_numTaskRun.fetch_add(1);
+    if (depth > 0) {
+        thread_spawnTask(countTask, (void*)(depth - 1));
+        thread_spawnTask(countTask, (void*)(depth - 1));
+    }
+}
+
+void runTasks (void*)
+{
+    thread_waitAll();
+}
+
+static double global_reduceResults[3];
+
+void reduceLoop (void*)
+{
+    long threadId = thread_getId();
+    long numThread = thread_getNumThread();
+
+    for (long i = 0; i < 1000; i++) {
+        long sum = thread_reduce_sum(threadId + i);
+        long min = thread_reduce_min(threadId + i);
+        long max = thread_reduce_max(threadId + i);
+        assert(sum == numThread * (numThread - 1) / 2 + numThread * i);
+        assert(min == i);
+        assert(max == numThread - 1 + i);
+    }
+
+    double values[3] = {1.0, (double)threadId, 0.5};
+    thread_reduceArray_sum(values, global_reduceResults, 3);
+}
+
+void barrierLoop (void*)
+{
+    for (long i = 0; i < NUM_BARRIERS; i++) {
+        thread_barrier_wait();
+    }
+}
+
+static void
+timeBarrier (thread_barrier_kind_t kind, const char* name)
+{
+    thread_startup(NUM_THREADS, kind);
+    TIMER_T start;
+    TIMER_READ(start);
+    thread_start(barrierLoop, NULL);
+    TIMER_T stop;
+    TIMER_READ(stop);
+    thread_shutdown();
+    printf("%-8s barrier: %0.3lf us/barrier\n", name,
+           TIMER_DIFF_SECONDS(start, stop) * 1e6 / NUM_BARRIERS);
+}
+
 int main ()
 {
     puts("Starting...");
@@ -255,8 +1093,25 @@ int main ()
     thread_start(printId, NULL);
     thread_start(printId, NULL);
     /* Stop timing here */
+
+    /* Task tree of depth 10 seeded from outside the parallel region */
+    for (long i = 0; i < NUM_THREADS; i++) {
+        thread_spawnTask(countTask, (void*)10L);
+    }
+    thread_start(runTasks, NULL);
+    assert(global_numTaskRun.load() == NUM_THREADS * ((1L << 11) - 1));
+    printf("tasks run = %li\n", global_numTaskRun.load());
+
+    thread_start(reduceLoop, NULL);
+    assert(global_reduceResults[0] == NUM_THREADS);
+    assert(global_reduceResults[1] == NUM_THREADS * (NUM_THREADS - 1) / 2);
+    assert(global_reduceResults[2] == NUM_THREADS * 0.5);
+    puts("reductions ok");
     thread_shutdown();
 
+    timeBarrier(THREAD_BARRIER_PTHREAD, "pthread");
+    timeBarrier(THREAD_BARRIER_SPIN, "spin");
+
     puts("Done.");
 
     return 0;
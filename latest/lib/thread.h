@@ -70,14 +70,28 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <algorithm>
+
+enum thread_barrier_kind_t {
+    THREAD_BARRIER_DEFAULT, /* STAMP_BARRIER=pthread|spin, else spin */
+    THREAD_BARRIER_PTHREAD, /* pthread_barrier_t; sleeps in the kernel */
+    THREAD_BARRIER_SPIN     /* sense-reversing; spins, then futex sleep */
+};
+
+
 /* =============================================================================
  * thread_startup
  * -- Create pool of secondary threads
  * -- numThread is total number of threads (primary + secondary)
+ * -- barrierKind selects the barrier used by thread_start/thread_barrier_wait
+ * -- Threads are pinned according to STAMP_AFFINITY (compact, scatter, or a
+ *    CPU list such as 0-3,8); unset leaves placement to the scheduler
  * =============================================================================
  */
 void
-thread_startup (long numThread);
+thread_startup (long numThread,
+                thread_barrier_kind_t barrierKind = THREAD_BARRIER_DEFAULT);
 
 
 /* =============================================================================
@@ -124,3 +138,169 @@ thread_getNumThread();
  */
 void
 thread_barrier_wait();
+
+
+/* =============================================================================
+ * thread_spawnTask
+ * -- Queue funcPtr(argPtr) for execution by the task runtime
+ * -- Inside a parallel region, the task goes on the calling thread's deque
+ * -- Called by the primary thread outside a parallel region, tasks are dealt
+ *    round-robin to every thread's deque so the next region starts balanced
+ * -- Tasks may spawn further tasks
+ * =============================================================================
+ */
+void
+thread_spawnTask (void (*funcPtr)(void*), void* argPtr);
+
+
+/* =============================================================================
+ * thread_waitAll
+ * -- Run and steal tasks until every spawned task has completed
+ * -- Call from every thread inside the parallel region; returns once the
+ *    pool is drained, but does not act as a barrier
+ * =============================================================================
+ */
+void
+thread_waitAll();
+
+
+/* =============================================================================
+ * thread_memset
+ * -- memset whose pages are first written by the thread that owns them under
+ *    a block partition, so they land on that thread's NUMA node
+ * -- Call from the primary thread outside a parallel region, after
+ *    thread_startup; inside a parallel region it is a plain memset
+ * =============================================================================
+ */
+void
+thread_memset (void* ptr, int value, size_t numByte);
+
+
+/* =============================================================================
+ * thread_memsetPart
+ * -- Collective thread_memset for use inside a parallel region
+ * -- Every thread must call it; barrier before using the memory
+ * =============================================================================
+ */
+void
+thread_memsetPart (void* ptr, int value, size_t numByte);
+
+
+/* =============================================================================
+ * Per-thread reduction
+ * -- Each thread owns one cache-line slot, so nothing is shared until the
+ *    barrier where the slots are combined; a trailing transaction on a
+ *    global accumulator conflicts with every other thread instead
+ * -- All are collective: every thread in the parallel region must call them,
+ *    in the same order
+ * =============================================================================
+ */
+enum {
+    THREAD_REDUCE_SLOT_SIZE = 64
+};
+
+
+/* =============================================================================
+ * thread_reduceExchange
+ * -- Copies numByte from valuePtr into the caller's slot, waits at the
+ *    barrier, and returns the first slot; thread i's value follows at
+ *    i * THREAD_REDUCE_SLOT_SIZE bytes
+ * -- The slots stay readable until the caller's next reduction
+ * =============================================================================
+ */
+const void*
+thread_reduceExchange (const void* valuePtr, size_t numByte);
+
+
+/* =============================================================================
+ * thread_reduce
+ * -- Returns op(...op(op(v0, v1), v2)..., vN-1) to every thread, where vi is
+ *    the value passed by thread i; the order is fixed, so floating-point
+ *    sums come out the same on every run
+ * =============================================================================
+ */
+template <typename T, typename Op>
+T
+thread_reduce (T value, Op op)
+{
+    static_assert(sizeof(T) <= THREAD_REDUCE_SLOT_SIZE,
+                  "thread_reduce value does not fit in a slot");
+
+    const char* slots = (const char*)thread_reduceExchange(&value, sizeof(T));
+    long numThread = thread_getNumThread();
+
+    T result = *(const T*)slots;
+    for (long i = 1; i < numThread; i++) {
+        result = op(result, *(const T*)(slots + i * THREAD_REDUCE_SLOT_SIZE));
+    }
+
+    return result;
+}
+
+
+template <typename T>
+T
+thread_reduce_sum (T value)
+{
+    return thread_reduce(value, [](T a, T b) { return a + b; });
+}
+
+
+template <typename T>
+T
+thread_reduce_min (T value)
+{
+    return thread_reduce(value, [](T a, T b) { return (b < a) ? b : a; });
+}
+
+
+template <typename T>
+T
+thread_reduce_max (T value)
+{
+    return thread_reduce(value, [](T a, T b) { return (a < b) ? b : a; });
+}
+
+
+/* =============================================================================
+ * thread_reduceArray
+ * -- Element-wise thread_reduce of every thread's localValues[numElement]
+ *    into outValues; each thread combines one block of the elements
+ * -- Returns after a barrier, when all of outValues is written and the
+ *    localValues arrays are no longer read
+ * =============================================================================
+ */
+template <typename T, typename Op>
+void
+thread_reduceArray (const T* localValues, T* outValues, long numElement, Op op)
+{
+    const char* slots =
+        (const char*)thread_reduceExchange(&localValues, sizeof(localValues));
+    long numThread = thread_getNumThread();
+    long threadId = thread_getId();
+
+    long numPerThread = (numElement + numThread - 1) / numThread;
+    long start = threadId * numPerThread;
+    long stop = std::min(start + numPerThread, numElement);
+
+    for (long e = start; e < stop; e++) {
+        T result = (*(const T* const*)slots)[e];
+        for (long i = 1; i < numThread; i++) {
+            const T* valuesPtr =
+                *(const T* const*)(slots + i * THREAD_REDUCE_SLOT_SIZE);
+            result = op(result, valuesPtr[e]);
+        }
+        outValues[e] = result;
+    }
+
+    thread_barrier_wait();
+}
+
+
+template <typename T>
+void
+thread_reduceArray_sum (const T* localValues, T* outValues, long numElement)
+{
+    thread_reduceArray(localValues, outValues, numElement,
+                       [](T a, T b) { return a + b; });
+}
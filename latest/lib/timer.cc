@@ -0,0 +1,157 @@
+/* =============================================================================
+ *
+ * timer.cc
+ * -- Named-phase timing with per-thread accumulation
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include "thread.h"
+#include "timer.h"
+
+#define TIMER_MAX_PHASE  32
+#define TIMER_MAX_THREAD 256
+
+typedef struct phaseTotal {
+    unsigned long long numNanosecond[TIMER_MAX_PHASE];
+    unsigned long numCall[TIMER_MAX_PHASE];
+} __attribute__((aligned(64))) phaseTotal_t;
+
+static const char*       global_phaseNames[TIMER_MAX_PHASE];
+static std::atomic<long> global_numPhase(0);
+static pthread_mutex_t   global_phaseLock = PTHREAD_MUTEX_INITIALIZER;
+static phaseTotal_t      global_phaseTotals[TIMER_MAX_THREAD];
+
+static __thread unsigned long long global_phaseStarts[TIMER_MAX_PHASE];
+
+
+/* =============================================================================
+ * findPhase
+ * -- Returns index of name, registering it on first use
+ * =============================================================================
+ */
+static long
+findPhase (const char* name)
+{
+    long numPhase = global_numPhase.load(std::memory_order_acquire);
+    long p;
+
+    for (p = 0; p < numPhase; p++) {
+        if (global_phaseNames[p] == name) {
+            return p;
+        }
+    }
+    for (p = 0; p < numPhase; p++) {
+        if (strcmp(global_phaseNames[p], name) == 0) {
+            return p;
+        }
+    }
+
+    pthread_mutex_lock(&global_phaseLock);
+    numPhase = global_numPhase.load(std::memory_order_relaxed);
+    for (p = 0; p < numPhase; p++) {
+        if (strcmp(global_phaseNames[p], name) == 0) {
+            break;
+        }
+    }
+    if (p == numPhase) {
+        assert(numPhase < TIMER_MAX_PHASE);
+        global_phaseNames[p] = name;
+        global_numPhase.store(numPhase + 1, std::memory_order_release);
+    }
+    pthread_mutex_unlock(&global_phaseLock);
+
+    return p;
+}
+
+
+/* =============================================================================
+ * timer_phaseBegin
+ * =============================================================================
+ */
+void
+timer_phaseBegin (const char* name)
+{
+    long p = findPhase(name);
+    assert(global_phaseStarts[p] == 0);
+    global_phaseStarts[p] = timer_now();
+}
+
+
+/* =============================================================================
+ * timer_phaseEnd
+ * =============================================================================
+ */
+void
+timer_phaseEnd (const char* name)
+{
+    unsigned long long stop = timer_now();
+    long p = findPhase(name);
+    long threadId = thread_getId();
+
+    assert(global_phaseStarts[p] != 0);
+    assert(threadId >= 0 && threadId < TIMER_MAX_THREAD);
+
+    phaseTotal_t* totalPtr = &global_phaseTotals[threadId];
+    totalPtr->numNanosecond[p] += stop - global_phaseStarts[p];
+    totalPtr->numCall[p]++;
+    global_phaseStarts[p] = 0;
+}
+
+
+/* =============================================================================
+ * timer_phasePrint
+ * =============================================================================
+ */
+void
+timer_phasePrint ()
+{
+    long numPhase = global_numPhase.load(std::memory_order_acquire);
+    if (numPhase == 0) {
+        return;
+    }
+
+    puts("\nPhase times (seconds per thread)");
+    printf("%-20s %8s %10s %12s %12s %12s\n",
+           "Phase", "Threads", "Calls", "Mean", "Min", "Max");
+
+    for (long p = 0; p < numPhase; p++) {
+        long numThread = 0;
+        unsigned long numCall = 0;
+        unsigned long long sum = 0;
+        unsigned long long min = ~0ULL;
+        unsigned long long max = 0;
+        for (long t = 0; t < TIMER_MAX_THREAD; t++) {
+            phaseTotal_t* totalPtr = &global_phaseTotals[t];
+            if (totalPtr->numCall[p] == 0) {
+                continue;
+            }
+            unsigned long long nanos = totalPtr->numNanosecond[p];
+            numThread++;
+            numCall += totalPtr->numCall[p];
+            sum += nanos;
+            if (nanos < min) {
+                min = nanos;
+            }
+            if (nanos > max) {
+                max = nanos;
+            }
+        }
+        if (numThread == 0) {
+            continue;
+        }
+        printf("%-20s %8ld %10lu %12.6f %12.6f %12.6f\n",
+               global_phaseNames[p],
+               numThread,
+               numCall,
+               sum / 1e9 / numThread,
+               min / 1e9,
+               max / 1e9);
+    }
+}
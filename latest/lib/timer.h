@@ -73,16 +73,66 @@
 #define TIMER_H 1
 
 
-#include <sys/time.h>
+#include <time.h>
 
 
-#define TIMER_T                         struct timeval
+/*
+ * CLOCK_MONOTONIC is immune to wall-clock adjustments, has nanosecond
+ * resolution, and is served from the vDSO (the TSC on x86) without a
+ * system call.
+ */
+#define TIMER_T                         struct timespec
 
-#define TIMER_READ(time)                gettimeofday(&(time), NULL)
+#define TIMER_READ(time)                clock_gettime(CLOCK_MONOTONIC, &(time))
 
 #define TIMER_DIFF_SECONDS(start, stop) \
-    (((double)(stop.tv_sec)  + (double)(stop.tv_usec / 1000000.0)) - \
-     ((double)(start.tv_sec) + (double)(start.tv_usec / 1000000.0)))
+    ((double)((stop).tv_sec - (start).tv_sec) + \
+     (double)((stop).tv_nsec - (start).tv_nsec) / 1000000000.0)
+
+
+/* =============================================================================
+ * timer_now
+ * -- Returns monotonic time in nanoseconds
+ * =============================================================================
+ */
+static inline unsigned long long
+timer_now ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+/* =============================================================================
+ * timer_phaseBegin
+ * -- Start timing the named phase on the calling thread
+ * -- Phases may nest, but a phase may not be begun twice without an end
+ * -- name is compared by pointer first, so pass a string literal
+ * =============================================================================
+ */
+void
+timer_phaseBegin (const char* name);
+
+
+/* =============================================================================
+ * timer_phaseEnd
+ * -- Add the time since the matching timer_phaseBegin to the calling
+ *    thread's total for the phase
+ * =============================================================================
+ */
+void
+timer_phaseEnd (const char* name);
+
+
+/* =============================================================================
+ * timer_phasePrint
+ * -- Print, for each phase, the calls and the mean/min/max per-thread time
+ * -- Call from the primary thread outside a parallel region
+ * =============================================================================
+ */
+void
+timer_phasePrint ();
 
 
 #endif /* TIMER_H */
@@ -3,6 +3,35 @@
 #define TM_PURE                       __attribute__((transaction_pure))
 #define TM_SAFE                       __attribute__((transaction_safe))
 
+/*
+ * TM_BEGIN(site) ... TM_END() delimit an atomic block; site is a string
+ * naming it in the TM_PROFILE report.  __transaction_cancel and break work
+ * as they do inside a plain __transaction_atomic block.
+ */
+#ifdef TM_PROFILE
+
+#include "tmprofile.h"
+
+#define TM_BEGIN(site)                { \
+    static tm_profile_site_t tm_profileSite(site, __FILE__, __LINE__); \
+    tm_profile_scope_t tm_profileScope(&tm_profileSite); \
+    __transaction_atomic { \
+        tm_profileScope.isCommitted = true;
+#define TM_END()                      } }
+
+#define TM_SHARED_READ(var)           (tm_profile_countRead(), (var))
+#define TM_SHARED_READ_P(var)         (tm_profile_countRead(), (var))
+#define TM_SHARED_READ_F(var)         (tm_profile_countRead(), (var))
+
+#define TM_SHARED_WRITE(var, val)     (tm_profile_countWrite(), var = val)
+#define TM_SHARED_WRITE_P(var, val)   (tm_profile_countWrite(), var = val)
+#define TM_SHARED_WRITE_F(var, val)   (tm_profile_countWrite(), var = val)
+
+#else /* !TM_PROFILE */
+
+#define TM_BEGIN(site)                __transaction_atomic {
+#define TM_END()                      }
+
 #define TM_SHARED_READ(var)           var
 #define TM_SHARED_READ_P(var)         var
 #define TM_SHARED_READ_F(var)         var
@@ -11,6 +40,29 @@
 #define TM_SHARED_WRITE_P(var, val)   var = val
 #define TM_SHARED_WRITE_F(var, val)   var = val
 
+#endif /* !TM_PROFILE */
+
+/*
+ * TM_STARTUP/TM_SHUTDOWN bracket the thread pool and TM_THREAD_ENTER runs
+ * on each pool thread before its first transaction.  They only do work
+ * with the built-in STM (make TMBACKEND=stm); libitm sets itself up.
+ */
+#ifdef TM_BACKEND_STM
+
+#include "stm.h"
+
+#define TM_STARTUP(numThread)         stm_startup(numThread)
+#define TM_SHUTDOWN()                 stm_shutdown()
+#define TM_THREAD_ENTER()             stm_threadEnter()
+
+#else /* !TM_BACKEND_STM */
+
+#define TM_STARTUP(numThread)         /* nothing */
+#define TM_SHUTDOWN()                 /* nothing */
+#define TM_THREAD_ENTER()             /* nothing */
+
+#endif /* !TM_BACKEND_STM */
+
 #define TM_LOCAL_WRITE(var, val)      var = val
 #define TM_LOCAL_WRITE_P(var, val)    var = val
 #define TM_LOCAL_WRITE_F(var, val)    var = val
@@ -0,0 +1,93 @@
+/* =============================================================================
+ *
+ * tmhashmap.cc
+ * -- Unit test of tmlib::hashmap (tmhashmap.h is header-only)
+ *
+ * =============================================================================
+ */
+
+
+/* =============================================================================
+ * TEST_TMHASHMAP
+ * =============================================================================
+ */
+#ifdef TEST_TMHASHMAP
+
+
+#include <assert.h>
+#include <stdio.h>
+#include "tmhashmap.h"
+
+
+struct long_hash {
+    unsigned long operator() (long key) const {
+        return ((unsigned long)key * 0x9e3779b97f4a7c15UL);
+    }
+};
+
+struct long_eq {
+    bool operator() (long a, long b) const {
+        return (a == b);
+    }
+};
+
+typedef tmlib::hashmap<long, long, long_hash, long_eq> long_map_t;
+
+
+int
+main ()
+{
+    long numKey = 1000;
+    bool isPresent[1000] = { false };
+    long numPresent = 0;
+    long k;
+
+    puts("Starting...");
+
+    /* Few buckets, so chains are long and removes hit every position */
+    long_map_t* mapPtr = long_map_t::alloc(7);
+    assert(mapPtr);
+    assert(mapPtr->getSize() == 0);
+    assert(!mapPtr->contains(0));
+    assert(mapPtr->find(0) == 0);
+
+    unsigned long seed = 1;
+    for (long r = 0; r < 20000; r++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        k = (long)((seed >> 33) % numKey);
+        if ((seed >> 20) % 3 != 0) {
+            assert(mapPtr->insert(k, k + 1) == !isPresent[k]);
+            numPresent += !isPresent[k];
+            isPresent[k] = true;
+        } else {
+            assert(mapPtr->remove(k) == isPresent[k]);
+            numPresent -= isPresent[k];
+            isPresent[k] = false;
+        }
+        assert(mapPtr->contains(k) == isPresent[k]);
+        assert(mapPtr->find(k) == (isPresent[k] ? k + 1 : 0));
+    }
+
+    assert(mapPtr->getSize() == numPresent);
+    for (k = 0; k < numKey; k++) {
+        assert(mapPtr->find(k) == (isPresent[k] ? k + 1 : 0));
+    }
+    printf("%li keys in %li buckets\n", numPresent, mapPtr->numBucket);
+
+    long_map_t::free(mapPtr);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_TMHASHMAP */
+
+
+/* =============================================================================
+ *
+ * End of tmhashmap.cc
+ *
+ * =============================================================================
+ */
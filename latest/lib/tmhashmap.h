@@ -0,0 +1,210 @@
+/* =============================================================================
+ *
+ * tmhashmap.h
+ * -- Chained hash map with the key and value types, hash and equality
+ *    fixed at compile time
+ *
+ * =============================================================================
+ *
+ * tmlib::hashmap<K, V, Hash, Eq> stands in for hashtable_t where the hash
+ * and comparePairs pointers would be called on every operation: Hash()(k)
+ * returns an unsigned long and Eq()(a, b) a bool, both called directly.
+ * Each node holds its key and value inline, so an insert allocates one
+ * block instead of a node and a pair_t.
+ *
+ * The number of buckets is fixed at alloc, like a hashtable_t with
+ * resizing off, and there is no size field, so inserts into different
+ * buckets do not conflict.  getSize walks the buckets.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+#include "memory.h"
+
+namespace tmlib {
+
+template <typename K, typename V>
+struct hashmap_node {
+    K key;
+    V value;
+    hashmap_node* nextPtr;
+};
+
+
+template <typename K, typename V, typename Hash, typename Eq>
+struct hashmap {
+    typedef hashmap_node<K, V> node_t;
+
+    node_t** buckets;
+    long numBucket;
+
+    /* =========================================================================
+     * alloc
+     * -- Returns NULL on failure
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    static hashmap*
+    alloc (long numBucket)
+    {
+        hashmap* mapPtr = (hashmap*)memory_alloc(sizeof(hashmap));
+        if (mapPtr == NULL) {
+            return NULL;
+        }
+
+        if (numBucket < 1) {
+            numBucket = 1;
+        }
+        mapPtr->buckets = (node_t**)memory_alloc(numBucket * sizeof(node_t*));
+        if (mapPtr->buckets == NULL) {
+            memory_free(mapPtr);
+            return NULL;
+        }
+        for (long i = 0; i < numBucket; i++) {
+            mapPtr->buckets[i] = NULL;
+        }
+        mapPtr->numBucket = numBucket;
+
+        return mapPtr;
+    }
+
+    /* =========================================================================
+     * free
+     * -- Does not free the keys and values
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    static void
+    free (hashmap* mapPtr)
+    {
+        for (long i = 0; i < mapPtr->numBucket; i++) {
+            node_t* nodePtr = mapPtr->buckets[i];
+            while (nodePtr != NULL) {
+                node_t* nextPtr = nodePtr->nextPtr;
+                memory_free(nodePtr);
+                nodePtr = nextPtr;
+            }
+        }
+        memory_free(mapPtr->buckets);
+        memory_free(mapPtr);
+    }
+
+    /* =========================================================================
+     * findPrevious
+     * -- Returns the link that points to the node with key, or to NULL
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    node_t**
+    findPrevious (const K& key)
+    {
+        node_t** linkPtr = &buckets[Hash()(key) % (unsigned long)numBucket];
+
+        for (; *linkPtr != NULL; linkPtr = &(*linkPtr)->nextPtr) {
+            if (Eq()((*linkPtr)->key, key)) {
+                break;
+            }
+        }
+
+        return linkPtr;
+    }
+
+    /* =========================================================================
+     * contains
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    bool
+    contains (const K& key)
+    {
+        return (*findPrevious(key) != NULL);
+    }
+
+    /* =========================================================================
+     * find
+     * -- Returns V() if not found, else the value
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    V
+    find (const K& key)
+    {
+        node_t* nodePtr = *findPrevious(key);
+
+        return ((nodePtr != NULL) ? nodePtr->value : V());
+    }
+
+    /* =========================================================================
+     * insert
+     * -- Returns false if the key is already present or on allocation failure
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    bool
+    insert (const K& key, const V& value)
+    {
+        node_t** linkPtr = findPrevious(key);
+        if (*linkPtr != NULL) {
+            return false;
+        }
+
+        node_t* nodePtr = (node_t*)memory_alloc(sizeof(node_t));
+        if (nodePtr == NULL) {
+            return false;
+        }
+        nodePtr->key = key;
+        nodePtr->value = value;
+        nodePtr->nextPtr = NULL;
+        *linkPtr = nodePtr;
+
+        return true;
+    }
+
+    /* =========================================================================
+     * remove
+     * -- Returns true if successful, else false
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    bool
+    remove (const K& key)
+    {
+        node_t** linkPtr = findPrevious(key);
+        node_t* nodePtr = *linkPtr;
+        if (nodePtr == NULL) {
+            return false;
+        }
+
+        *linkPtr = nodePtr->nextPtr;
+        memory_free(nodePtr);
+
+        return true;
+    }
+
+    /* =========================================================================
+     * getSize
+     * -- Walks every chain; meant for between phases
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    long
+    getSize ()
+    {
+        long size = 0;
+
+        for (long i = 0; i < numBucket; i++) {
+            for (node_t* nodePtr = buckets[i];
+                 nodePtr != NULL;
+                 nodePtr = nodePtr->nextPtr)
+            {
+                size++;
+            }
+        }
+
+        return size;
+    }
+};
+
+} /* namespace tmlib */
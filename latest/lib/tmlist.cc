@@ -0,0 +1,122 @@
+/* =============================================================================
+ *
+ * tmlist.cc
+ * -- Unit test of tmlib::list (tmlist.h is header-only)
+ *
+ * =============================================================================
+ */
+
+
+/* =============================================================================
+ * TEST_TMLIST
+ * =============================================================================
+ */
+#ifdef TEST_TMLIST
+
+
+#include <assert.h>
+#include <stdio.h>
+#include "list.h"
+#include "tm.h"
+#include "tmlist.h"
+
+
+struct long_compare {
+    long operator() (const long* a, const long* b) const {
+        return ((*a < *b) ? -1 : (*a > *b));
+    }
+};
+
+typedef tmlib::list<long*, long_compare> long_list_t;
+
+
+TM_SAFE
+static long
+compare (const void* a, const void* b)
+{
+    return ((*(const long*)a < *(const long*)b) ? -1 :
+            (*(const long*)a > *(const long*)b));
+}
+
+
+/* =============================================================================
+ * checkSame
+ * -- The typed list and a list_t fed the same operations hold the same
+ *    elements in the same order
+ * =============================================================================
+ */
+static void
+checkSame (long_list_t* typedPtr, list_t* listPtr)
+{
+    long_list_t::iter_t typedIt;
+    list_iter_t it;
+
+    assert(list_getSize(typedPtr) == list_getSize(listPtr));
+    assert(list_isEmpty(typedPtr) == list_isEmpty(listPtr));
+
+    list_iter_reset(&typedIt, typedPtr);
+    list_iter_reset(&it, listPtr);
+    while (list_iter_hasNext(&it)) {
+        assert(list_iter_hasNext(&typedIt));
+        assert(list_iter_next(&typedIt) == list_iter_next(&it));
+    }
+    assert(!list_iter_hasNext(&typedIt));
+}
+
+
+int
+main ()
+{
+    long numData = 64;
+    long data[64];
+    long i;
+
+    puts("Starting...");
+
+    for (i = 0; i < numData; i++) {
+        data[i] = i / 2; /* pairs of equal keys in different places */
+    }
+
+    long_list_t* typedPtr = long_list_t::alloc();
+    list_t* listPtr = list_alloc(&compare);
+    assert(typedPtr && listPtr);
+    checkSame(typedPtr, listPtr);
+
+    unsigned long seed = 1;
+    for (long r = 0; r < 20000; r++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        long* dataPtr = &data[(seed >> 33) % numData];
+        if ((seed >> 20) % 3 != 0) {
+            assert(list_insert(typedPtr, dataPtr) == list_insert(listPtr, dataPtr));
+        } else {
+            assert(list_remove(typedPtr, dataPtr) == list_remove(listPtr, dataPtr));
+        }
+        long* foundPtr = list_find(typedPtr, dataPtr);
+        assert((foundPtr == NULL) == (list_find(listPtr, dataPtr) == NULL));
+        assert(foundPtr == NULL || *foundPtr == *dataPtr);
+        checkSame(typedPtr, listPtr);
+    }
+    printf("%li elements after churn\n", list_getSize(typedPtr));
+
+    list_clear(typedPtr);
+    list_clear(listPtr);
+    checkSame(typedPtr, listPtr);
+
+    list_free(typedPtr);
+    list_free(listPtr);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_TMLIST */
+
+
+/* =============================================================================
+ *
+ * End of tmlist.cc
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,293 @@
+/* =============================================================================
+ *
+ * tmlist.h
+ * -- Sorted linked list with the element type and comparator fixed at
+ *    compile time
+ *
+ * =============================================================================
+ *
+ * tmlib::list<T, Cmp> is list_t with T in place of void* and a functor in
+ * place of the compare pointer.  Cmp()(a, b) returns {<0, 0, >0} like the
+ * list_t compare functions, and the calls are direct, so the compiler can
+ * inline them and the TM needs no clone lookup per comparison.  The layout
+ * (a dummy head node, nextPtr links, a size) and the LIST_NO_DUPLICATES
+ * behavior are the same as list_t.
+ *
+ * The list_* functions below are overloads of the list.h ones, so the
+ * TMLIST_* and PLIST_* macros work on either kind of list.  The element
+ * type is checked, so pass T, not void*.  Allocation differs:
+ * tmlib::list<T, Cmp>::alloc() takes no comparator.
+ *
+ * The namespace is not tm because <time.h> declares struct tm.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+#include <assert.h>
+#include "memory.h"
+#include "tm_transition.h"
+
+namespace tmlib {
+
+template <typename T>
+struct list_node {
+    T dataPtr;
+    list_node* nextPtr;
+};
+
+
+/* =============================================================================
+ * address_compare
+ * -- Orders pointers by address, the default of list_alloc(NULL)
+ * =============================================================================
+ */
+struct address_compare {
+    long operator() (const void* a, const void* b) const {
+        return ((long)a - (long)b);
+    }
+};
+
+
+template <typename T, typename Cmp = address_compare>
+struct list {
+    typedef list_node<T> node_t;
+    typedef list_node<T>* iter_t;
+
+    node_t head;
+    long size;
+
+    /* =========================================================================
+     * alloc
+     * -- Returns NULL on failure
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    static list*
+    alloc ()
+    {
+        list* listPtr = (list*)memory_alloc(sizeof(list));
+        if (listPtr == NULL) {
+            return NULL;
+        }
+
+        listPtr->head.dataPtr = T();
+        listPtr->head.nextPtr = NULL;
+        listPtr->size = 0;
+
+        return listPtr;
+    }
+
+    /* =========================================================================
+     * free
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    static void
+    free (list* listPtr)
+    {
+        listPtr->clear();
+        memory_free(listPtr);
+    }
+
+    /* =========================================================================
+     * findPrevious
+     * -- Returns the last node whose data is less than dataPtr
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    node_t*
+    findPrevious (const T& dataPtr)
+    {
+        node_t* prevPtr = &head;
+        node_t* nodePtr = prevPtr->nextPtr;
+
+        for (; nodePtr != NULL; nodePtr = nodePtr->nextPtr) {
+            if (Cmp()(nodePtr->dataPtr, dataPtr) >= 0) {
+                return prevPtr;
+            }
+            prevPtr = nodePtr;
+        }
+
+        return prevPtr;
+    }
+
+    /* =========================================================================
+     * find
+     * -- Returns T() if not found, else the data
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    T
+    find (const T& dataPtr)
+    {
+        node_t* nodePtr = findPrevious(dataPtr)->nextPtr;
+
+        if ((nodePtr == NULL) || (Cmp()(nodePtr->dataPtr, dataPtr) != 0)) {
+            return T();
+        }
+
+        return nodePtr->dataPtr;
+    }
+
+    /* =========================================================================
+     * insert
+     * -- Returns false on failure
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    bool
+    insert (const T& dataPtr)
+    {
+        node_t* prevPtr = findPrevious(dataPtr);
+        node_t* currPtr = prevPtr->nextPtr;
+
+#ifdef LIST_NO_DUPLICATES
+        if ((currPtr != NULL) && (Cmp()(currPtr->dataPtr, dataPtr) == 0)) {
+            return false;
+        }
+#endif
+
+        node_t* nodePtr = (node_t*)memory_alloc(sizeof(node_t));
+        if (nodePtr == NULL) {
+            return false;
+        }
+        nodePtr->dataPtr = dataPtr;
+        nodePtr->nextPtr = currPtr;
+        prevPtr->nextPtr = nodePtr;
+        size++;
+
+        return true;
+    }
+
+    /* =========================================================================
+     * remove
+     * -- Returns true if successful, else false
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    bool
+    remove (const T& dataPtr)
+    {
+        node_t* prevPtr = findPrevious(dataPtr);
+        node_t* nodePtr = prevPtr->nextPtr;
+
+        if ((nodePtr != NULL) && (Cmp()(nodePtr->dataPtr, dataPtr) == 0)) {
+            prevPtr->nextPtr = nodePtr->nextPtr;
+            memory_free(nodePtr);
+            size--;
+            assert(size >= 0);
+            return true;
+        }
+
+        return false;
+    }
+
+    /* =========================================================================
+     * clear
+     * =========================================================================
+     */
+    __attribute__((transaction_safe))
+    void
+    clear ()
+    {
+        node_t* nodePtr = head.nextPtr;
+        while (nodePtr != NULL) {
+            node_t* nextPtr = nodePtr->nextPtr;
+            memory_free(nodePtr);
+            nodePtr = nextPtr;
+        }
+        head.nextPtr = NULL;
+        size = 0;
+    }
+};
+
+} /* namespace tmlib */
+
+
+/* =============================================================================
+ * Overloads of the list.h interface
+ * =============================================================================
+ */
+
+template <typename T, typename Cmp>
+__attribute__((transaction_safe))
+inline void
+list_iter_reset (tmlib::list_node<T>** itPtr, tmlib::list<T, Cmp>* listPtr)
+{
+    *itPtr = &(listPtr->head);
+}
+
+template <typename T>
+__attribute__((transaction_safe))
+inline bool
+list_iter_hasNext (tmlib::list_node<T>** itPtr)
+{
+    return ((*itPtr)->nextPtr != NULL);
+}
+
+template <typename T>
+__attribute__((transaction_safe))
+inline T
+list_iter_next (tmlib::list_node<T>** itPtr)
+{
+    *itPtr = (*itPtr)->nextPtr;
+    return (*itPtr)->dataPtr;
+}
+
+template <typename T, typename Cmp>
+__attribute__((transaction_safe))
+inline void
+list_free (tmlib::list<T, Cmp>* listPtr)
+{
+    tmlib::list<T, Cmp>::free(listPtr);
+}
+
+template <typename T, typename Cmp>
+__attribute__((transaction_safe))
+inline bool
+list_isEmpty (tmlib::list<T, Cmp>* listPtr)
+{
+    return (listPtr->head.nextPtr == NULL);
+}
+
+template <typename T, typename Cmp>
+__attribute__((transaction_safe))
+inline long
+list_getSize (tmlib::list<T, Cmp>* listPtr)
+{
+    return listPtr->size;
+}
+
+template <typename T, typename Cmp>
+__attribute__((transaction_safe))
+inline T
+list_find (tmlib::list<T, Cmp>* listPtr, T dataPtr)
+{
+    return listPtr->find(dataPtr);
+}
+
+template <typename T, typename Cmp>
+__attribute__((transaction_safe))
+inline bool
+list_insert (tmlib::list<T, Cmp>* listPtr, T dataPtr)
+{
+    return listPtr->insert(dataPtr);
+}
+
+template <typename T, typename Cmp>
+__attribute__((transaction_safe))
+inline bool
+list_remove (tmlib::list<T, Cmp>* listPtr, T dataPtr)
+{
+    return listPtr->remove(dataPtr);
+}
+
+template <typename T, typename Cmp>
+__attribute__((transaction_safe))
+inline void
+list_clear (tmlib::list<T, Cmp>* listPtr)
+{
+    listPtr->clear();
+}
@@ -0,0 +1,160 @@
+/* =============================================================================
+ *
+ * tmprofile.cc
+ * -- Per-site transaction profiler, enabled by building with TMPROFILE=1
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "thread.h"
+#include "tmprofile.h"
+
+__thread tm_profile_stats_t* tm_profile_currentStatsPtr = NULL;
+
+static pthread_mutex_t    global_siteLock = PTHREAD_MUTEX_INITIALIZER;
+static tm_profile_site_t* global_siteListPtr = NULL;
+
+
+/* =============================================================================
+ * sumStats
+ * -- Returns number of threads that ran the site
+ * =============================================================================
+ */
+static long
+sumStats (tm_profile_site_t* sitePtr, tm_profile_stats_t* totalPtr)
+{
+    long numActive = 0;
+
+    totalPtr->numCommit = 0;
+    totalPtr->numCancel = 0;
+    totalPtr->numRead = 0;
+    totalPtr->numWrite = 0;
+    totalPtr->numNanosecond = 0;
+
+    for (long t = 0; t < TM_PROFILE_MAX_THREAD; t++) {
+        tm_profile_stats_t* statsPtr = &sitePtr->stats[t];
+        if (statsPtr->numCommit + statsPtr->numCancel == 0) {
+            continue;
+        }
+        numActive++;
+        totalPtr->numCommit += statsPtr->numCommit;
+        totalPtr->numCancel += statsPtr->numCancel;
+        totalPtr->numRead += statsPtr->numRead;
+        totalPtr->numWrite += statsPtr->numWrite;
+        totalPtr->numNanosecond += statsPtr->numNanosecond;
+    }
+
+    return numActive;
+}
+
+
+/* =============================================================================
+ * printRow
+ * =============================================================================
+ */
+static void
+printRow (const char* label, const char* thread, tm_profile_stats_t* statsPtr)
+{
+    unsigned long numAttempt = statsPtr->numCommit + statsPtr->numCancel;
+
+    printf("%-34s %6s %11lu %9lu %11.1f %11.1f %11.3f %9.3f\n",
+           label,
+           thread,
+           statsPtr->numCommit,
+           statsPtr->numCancel,
+           (double)statsPtr->numRead / numAttempt,
+           (double)statsPtr->numWrite / numAttempt,
+           statsPtr->numNanosecond / 1e6,
+           statsPtr->numNanosecond / 1e3 / numAttempt);
+}
+
+
+/* =============================================================================
+ * printProfile
+ * -- Registered with atexit() when the first site is reached
+ * =============================================================================
+ */
+static void
+printProfile ()
+{
+    std::vector<std::pair<unsigned long long, tm_profile_site_t*> > sites;
+
+    pthread_mutex_lock(&global_siteLock);
+    for (tm_profile_site_t* sitePtr = global_siteListPtr;
+         sitePtr != NULL;
+         sitePtr = sitePtr->nextPtr)
+    {
+        tm_profile_stats_t total;
+        if (sumStats(sitePtr, &total) > 0) {
+            sites.push_back(std::make_pair(total.numNanosecond, sitePtr));
+        }
+    }
+    pthread_mutex_unlock(&global_siteLock);
+
+    std::sort(sites.rbegin(), sites.rend());
+
+    puts("\nTransaction profile (sites by total time; footprint is per attempt)");
+    printf("%-34s %6s %11s %9s %11s %11s %11s %9s\n",
+           "Site", "Thread", "Commits", "Cancels",
+           "Reads", "Writes", "Time(ms)", "Avg(us)");
+
+    for (size_t s = 0; s < sites.size(); s++) {
+        tm_profile_site_t* sitePtr = sites[s].second;
+        tm_profile_stats_t total;
+        long numActive = sumStats(sitePtr, &total);
+        printRow(sitePtr->name, "all", &total);
+        printf("  %s:%ld\n", sitePtr->file, sitePtr->line);
+        if (numActive == 1) {
+            continue;
+        }
+        for (long t = 0; t < TM_PROFILE_MAX_THREAD; t++) {
+            tm_profile_stats_t* statsPtr = &sitePtr->stats[t];
+            if (statsPtr->numCommit + statsPtr->numCancel == 0) {
+                continue;
+            }
+            char thread[16];
+            snprintf(thread, sizeof(thread), "%ld", t);
+            printRow("", thread, statsPtr);
+        }
+    }
+}
+
+
+/* =============================================================================
+ * tm_profile_site_t::tm_profile_site_t
+ * -- Runs once per site, on first use (function-local static)
+ * =============================================================================
+ */
+tm_profile_site_t::tm_profile_site_t (const char* name,
+                                      const char* file,
+                                      long line)
+    : name(name), file(file), line(line), nextPtr(NULL), stats()
+{
+    pthread_mutex_lock(&global_siteLock);
+    if (global_siteListPtr == NULL) {
+        atexit(&printProfile);
+    }
+    nextPtr = global_siteListPtr;
+    global_siteListPtr = this;
+    pthread_mutex_unlock(&global_siteLock);
+}
+
+
+/* =============================================================================
+ * tm_profile_getStats
+ * =============================================================================
+ */
+tm_profile_stats_t*
+tm_profile_getStats (tm_profile_site_t* sitePtr)
+{
+    long threadId = thread_getId();
+    assert(threadId >= 0 && threadId < TM_PROFILE_MAX_THREAD);
+    return &sitePtr->stats[threadId];
+}
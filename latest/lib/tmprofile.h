@@ -0,0 +1,113 @@
+/* =============================================================================
+ *
+ * tmprofile.h
+ * -- Per-site transaction profiler, enabled by building with TMPROFILE=1
+ *
+ * =============================================================================
+ *
+ * Every TM_BEGIN(site) ... TM_END() block owns a static tm_profile_site_t.
+ * For each thread the site counts committed executions, attempts rolled back
+ * by __transaction_cancel, wall time spent inside the block (cancelled
+ * attempts included), and the number of TM_SHARED_READ* / TM_SHARED_WRITE*
+ * accesses made while the block was running.  Accesses are counted on every
+ * attempt, including ones that libitm rolls back and restarts on conflict.
+ *
+ * The sites are printed as a table, hottest first, when the program exits.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+#include "timer.h"
+
+#define TM_PROFILE_MAX_THREAD 256
+
+
+typedef struct tm_profile_stats {
+    unsigned long numCommit;
+    unsigned long numCancel;
+    unsigned long numRead;
+    unsigned long numWrite;
+    unsigned long long numNanosecond;
+} __attribute__((aligned(64))) tm_profile_stats_t;
+
+
+struct tm_profile_site_t {
+    const char* name;
+    const char* file;
+    long line;
+    tm_profile_site_t* nextPtr;
+    tm_profile_stats_t stats[TM_PROFILE_MAX_THREAD];
+
+    tm_profile_site_t (const char* name, const char* file, long line);
+};
+
+
+/* Stats of the innermost profiled block running on this thread, else NULL */
+extern __thread tm_profile_stats_t* tm_profile_currentStatsPtr;
+
+
+/* =============================================================================
+ * tm_profile_getStats
+ * -- Returns the calling thread's row of sitePtr
+ * =============================================================================
+ */
+tm_profile_stats_t*
+tm_profile_getStats (tm_profile_site_t* sitePtr);
+
+
+/* =============================================================================
+ * tm_profile_scope_t
+ * -- Lives around one attempt of a profiled block; isCommitted is written
+ *    inside the transaction, so a cancelled attempt leaves it false
+ * =============================================================================
+ */
+struct tm_profile_scope_t {
+    tm_profile_stats_t* statsPtr;
+    tm_profile_stats_t* prevStatsPtr;
+    unsigned long long startTime;
+    bool isCommitted;
+
+    explicit tm_profile_scope_t (tm_profile_site_t* sitePtr)
+    {
+        statsPtr = tm_profile_getStats(sitePtr);
+        prevStatsPtr = tm_profile_currentStatsPtr;
+        tm_profile_currentStatsPtr = statsPtr;
+        isCommitted = false;
+        startTime = timer_now();
+    }
+
+    ~tm_profile_scope_t ()
+    {
+        statsPtr->numNanosecond += timer_now() - startTime;
+        if (isCommitted) {
+            statsPtr->numCommit++;
+        } else {
+            statsPtr->numCancel++;
+        }
+        tm_profile_currentStatsPtr = prevStatsPtr;
+    }
+};
+
+
+/* =============================================================================
+ * tm_profile_countRead / tm_profile_countWrite
+ * -- Called from TM_SHARED_READ* / TM_SHARED_WRITE*; no-ops outside a block
+ * =============================================================================
+ */
+__attribute__((transaction_pure)) static inline void
+tm_profile_countRead ()
+{
+    if (tm_profile_currentStatsPtr) {
+        tm_profile_currentStatsPtr->numRead++;
+    }
+}
+
+__attribute__((transaction_pure)) static inline void
+tm_profile_countWrite ()
+{
+    if (tm_profile_currentStatsPtr) {
+        tm_profile_currentStatsPtr->numWrite++;
+    }
+}
@@ -0,0 +1,195 @@
+/* =============================================================================
+ *
+ * tmretry.cc
+ * -- Retry loop with backoff for transactions that cancel themselves
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <xmmintrin.h>
+#include "thread.h"
+#include "tmretry.h"
+#include "xorshift.h"
+
+/* From the TM ABI (libitm.h); 0 is modeSerialIrrevocable */
+extern "C" void _ITM_changeTransactionMode (int mode);
+/* 2 is inIrrevocableTransaction */
+extern "C" int _ITM_inTransaction ();
+
+static pthread_mutex_t  global_siteLock    = PTHREAD_MUTEX_INITIALIZER;
+static tm_retry_site_t* global_siteListPtr = NULL;
+
+static __thread unsigned long global_backoffSeed = 0;
+static __thread unsigned long global_lastNumStart = 0;
+
+
+/* =============================================================================
+ * tm_retry_site_t::tm_retry_site_t
+ * -- Runs once per site, on first use (function-local static)
+ * =============================================================================
+ */
+tm_retry_site_t::tm_retry_site_t (const char* name)
+    : name(name), nextPtr(NULL), stats()
+{
+    pthread_mutex_lock(&global_siteLock);
+    nextPtr = global_siteListPtr;
+    global_siteListPtr = this;
+    pthread_mutex_unlock(&global_siteLock);
+}
+
+
+/* =============================================================================
+ * tm_retry_t::tm_retry_t
+ * =============================================================================
+ */
+tm_retry_t::tm_retry_t (tm_retry_site_t* sitePtr)
+{
+    long threadId = thread_getId();
+    assert(threadId >= 0 && threadId < TM_RETRY_MAX_THREAD);
+    statsPtr = &sitePtr->stats[threadId];
+    numAttempt = 0;
+    numStart = 0;
+}
+
+
+/* =============================================================================
+ * tm_retry_t::~tm_retry_t
+ * -- Runs when the loop is left, i.e., after the attempt that committed
+ * =============================================================================
+ */
+tm_retry_t::~tm_retry_t ()
+{
+    statsPtr->numCommit++;
+    if (numAttempt > statsPtr->maxAttempt) {
+        statsPtr->maxAttempt = numAttempt;
+    }
+    global_lastNumStart = numStart;
+}
+
+
+/* =============================================================================
+ * tm_retry_attempt
+ * =============================================================================
+ */
+void
+tm_retry_attempt (tm_retry_t* retryPtr)
+{
+    if (retryPtr->numAttempt > 0) {
+        retryPtr->statsPtr->numCancel++;
+
+        if (global_backoffSeed == 0) {
+            global_backoffSeed =
+                (unsigned long)(thread_getId() + 1) * 0x9e3779b97f4a7c15UL;
+        }
+        unsigned long seed = xorshift_next(&global_backoffSeed);
+
+        unsigned long shift = retryPtr->numAttempt;
+        if (shift > TM_RETRY_MAX_BACKOFF) {
+            shift = TM_RETRY_MAX_BACKOFF;
+        }
+        unsigned long numPause = seed & ((1UL << shift) - 1);
+        for (unsigned long i = 0; i < numPause; i++) {
+            _mm_pause();
+        }
+    }
+
+    retryPtr->numAttempt++;
+    if (retryPtr->numAttempt == TM_RETRY_SERIAL_ATTEMPT) {
+        retryPtr->statsPtr->numSerial++;
+    }
+}
+
+
+/* =============================================================================
+ * tm_retry_enter
+ * -- If the TM has to restart the transaction to make it irrevocable, it
+ *    restarts at TM_BEGIN and this runs again; the start is then already
+ *    counted, so it only counts when not yet irrevocable
+ * -- Being pure, the count of starts survives the TM rolling back
+ * =============================================================================
+ */
+__attribute__((transaction_pure))
+void
+tm_retry_enter (tm_retry_t* retryPtr)
+{
+    bool isSerial = (retryPtr->numAttempt >= TM_RETRY_SERIAL_ATTEMPT);
+    if (isSerial && _ITM_inTransaction() == 2) {
+        return;
+    }
+    retryPtr->numStart++;
+    if (isSerial) {
+        _ITM_changeTransactionMode(0);
+    }
+}
+
+
+/* =============================================================================
+ * tm_retry_getNumStart
+ * =============================================================================
+ */
+unsigned long
+tm_retry_getNumStart ()
+{
+    return global_lastNumStart;
+}
+
+
+/* =============================================================================
+ * tm_retry_print
+ * =============================================================================
+ */
+void
+tm_retry_print ()
+{
+    bool isRun = false;
+
+    pthread_mutex_lock(&global_siteLock);
+
+    for (tm_retry_site_t* sitePtr = global_siteListPtr;
+         sitePtr != NULL;
+         sitePtr = sitePtr->nextPtr)
+    {
+        for (long t = 0; t < TM_RETRY_MAX_THREAD; t++) {
+            if (sitePtr->stats[t].numCommit > 0) {
+                isRun = true;
+            }
+        }
+    }
+
+    if (isRun) {
+        puts("\nRetries after __transaction_cancel");
+        printf("%-28s %11s %9s %12s %8s %11s\n",
+               "Site", "Commits", "Cancels", "Cancels/txn", "Serial", "MaxAttempt");
+        for (tm_retry_site_t* sitePtr = global_siteListPtr;
+             sitePtr != NULL;
+             sitePtr = sitePtr->nextPtr)
+        {
+            tm_retry_stats_t total = tm_retry_stats_t();
+            for (long t = 0; t < TM_RETRY_MAX_THREAD; t++) {
+                tm_retry_stats_t* statsPtr = &sitePtr->stats[t];
+                total.numCommit += statsPtr->numCommit;
+                total.numCancel += statsPtr->numCancel;
+                total.numSerial += statsPtr->numSerial;
+                if (statsPtr->maxAttempt > total.maxAttempt) {
+                    total.maxAttempt = statsPtr->maxAttempt;
+                }
+            }
+            if (total.numCommit == 0) {
+                continue;
+            }
+            printf("%-28s %11lu %9lu %12.4f %8lu %11lu\n",
+                   sitePtr->name,
+                   total.numCommit,
+                   total.numCancel,
+                   (double)total.numCancel / total.numCommit,
+                   total.numSerial,
+                   total.maxAttempt);
+        }
+    }
+
+    pthread_mutex_unlock(&global_siteLock);
+}
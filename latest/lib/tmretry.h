@@ -0,0 +1,125 @@
+/* =============================================================================
+ *
+ * tmretry.h
+ * -- Retry loop with backoff for transactions that cancel themselves
+ *
+ * =============================================================================
+ *
+ * Some transactions detect an inconsistent view of shared data themselves
+ * and restart with __transaction_cancel.  Written as a bare while loop
+ * around TM_BEGIN, they retry at once, and under contention the same
+ * transactions keep cancelling each other.  Write them instead as
+ *
+ *     TM_RETRY_BEGIN("site");
+ *       ...
+ *       if (!done) TM_RETRY_CANCEL();
+ *     TM_RETRY_END();
+ *
+ * Every attempt after a cancel first waits a random number of pauses,
+ * between 0 and 2^(retries) capped at 2^TM_RETRY_MAX_BACKOFF.  Attempt
+ * TM_RETRY_SERIAL_ATTEMPT and later run serial irrevocable.  Nothing else
+ * runs concurrently then, so the view is consistent and the body must not
+ * cancel.
+ *
+ * Each site counts commits, cancels, serial attempts and the longest run
+ * of attempts per thread; tm_retry_print() writes them as a table.
+ * tm_retry_getNumStart() tells the caller how many times the last site it
+ * ran began its body, conflict restarts by the TM included.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+#include "tm.h"
+
+#ifndef TM_RETRY_SERIAL_ATTEMPT
+#  define TM_RETRY_SERIAL_ATTEMPT 16
+#endif
+#define TM_RETRY_MAX_BACKOFF      12
+#define TM_RETRY_MAX_THREAD       256
+
+
+typedef struct tm_retry_stats {
+    unsigned long numCommit;
+    unsigned long numCancel;
+    unsigned long numSerial;
+    unsigned long maxAttempt;
+} __attribute__((aligned(64))) tm_retry_stats_t;
+
+
+struct tm_retry_site_t {
+    const char* name;
+    tm_retry_site_t* nextPtr;
+    tm_retry_stats_t stats[TM_RETRY_MAX_THREAD];
+
+    explicit tm_retry_site_t (const char* name);
+};
+
+
+/* =============================================================================
+ * tm_retry_t
+ * -- Lives around all attempts of one execution of a site
+ * =============================================================================
+ */
+struct tm_retry_t {
+    tm_retry_stats_t* statsPtr;
+    unsigned long numAttempt; /* by this loop, i.e., 1 + cancels */
+    unsigned long numStart;   /* of the body, also after TM restarts */
+
+    explicit tm_retry_t (tm_retry_site_t* sitePtr);
+    ~tm_retry_t ();
+};
+
+
+/* =============================================================================
+ * tm_retry_attempt
+ * -- Called before each attempt; backs off if the last one cancelled
+ * =============================================================================
+ */
+void
+tm_retry_attempt (tm_retry_t* retryPtr);
+
+
+/* =============================================================================
+ * tm_retry_enter
+ * -- First statement of each attempt; goes serial irrevocable when due
+ * =============================================================================
+ */
+__attribute__((transaction_pure))
+void
+tm_retry_enter (tm_retry_t* retryPtr);
+
+
+/* =============================================================================
+ * tm_retry_getNumStart
+ * -- Times the body of the calling thread's last completed site began,
+ *    counting restarts on conflict as well as cancels; 1 if it committed
+ *    at once
+ * =============================================================================
+ */
+unsigned long
+tm_retry_getNumStart ();
+
+
+/* =============================================================================
+ * tm_retry_print
+ * -- Prints the sites that ran, if any
+ * =============================================================================
+ */
+void
+tm_retry_print ();
+
+
+#define TM_RETRY_BEGIN(site)          { \
+    static tm_retry_site_t tm_retrySite(site); \
+    tm_retry_t tm_retry(&tm_retrySite); \
+    while (1) { \
+        tm_retry_attempt(&tm_retry); \
+        TM_BEGIN(site); \
+            tm_retry_enter(&tm_retry);
+#define TM_RETRY_CANCEL()             __transaction_cancel
+#define TM_RETRY_END()                \
+            break; \
+        TM_END(); \
+    } }
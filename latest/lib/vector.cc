@@ -74,6 +74,7 @@
 #include "tm.h"
 #include "utility.h"
 #include "vector.h"
+#include "memory.h"
 
 /* =============================================================================
  * vector_alloc
@@ -87,12 +88,12 @@ vector_alloc (long initCapacity)
     vector_t* vectorPtr;
     long capacity = MAX(initCapacity, 1);
 
-    vectorPtr = (vector_t*)malloc(sizeof(vector_t));
+    vectorPtr = (vector_t*)memory_alloc(sizeof(vector_t));
 
     if (vectorPtr != NULL) {
         vectorPtr->size = 0;
         vectorPtr->capacity = capacity;
-        vectorPtr->elements = (void**)malloc(capacity * sizeof(void*));
+        vectorPtr->elements = (void**)memory_alloc(capacity * sizeof(void*));
         if (vectorPtr->elements == NULL) {
             return NULL;
         }
@@ -110,8 +111,8 @@ TM_SAFE
 void
 vector_free (vector_t* vectorPtr)
 {
-    free(vectorPtr->elements);
-    free(vectorPtr);
+    memory_free(vectorPtr->elements);
+    memory_free(vectorPtr);
 }
 
 
@@ -144,7 +145,7 @@ vector_pushBack (vector_t* vectorPtr, void* dataPtr)
     if (vectorPtr->size == vectorPtr->capacity) {
         long i;
         long newCapacity = vectorPtr->capacity * 2;
-        void** newElements = (void**)malloc(newCapacity * sizeof(void*));
+        void** newElements = (void**)memory_alloc(newCapacity * sizeof(void*));
         if (newElements == NULL) {
             return false;
         }
@@ -152,7 +153,7 @@ vector_pushBack (vector_t* vectorPtr, void* dataPtr)
         for (i = 0; i < vectorPtr->size; i++) {
             newElements[i] = vectorPtr->elements[i];
         }
-        free(vectorPtr->elements);
+        memory_free(vectorPtr->elements);
         vectorPtr->elements = newElements;
     }
     vectorPtr->elements[vectorPtr->size++] = dataPtr;
@@ -216,31 +217,15 @@ vector_sort (vector_t* vectorPtr, int (*compare) (const void*, const void*))
 /* =============================================================================
  * TM_SAFE
  * vector_sort
- * selection_sort
+ * -- Was a selection sort; see vector_sortElements
  * =============================================================================
  */
 TM_SAFE
 void
 vector_sort (vector_t* vectorPtr, int TM_SAFE (*compare) (const void*, const void*))
 {
-    long size = vectorPtr->size;
-    long i, j;
-
-    for (i = 0; i < size - 1; i++)
-    {
-      long min = i;
-      // find the minimal number from i to N
-      for (j = i + 1; j < size; j++)
-        if (compare (&vectorPtr->elements[j], &vectorPtr->elements[min]) < 0)
-          min = j;
-
-      // exchange
-      if (min != i) {
-        void* temp = vectorPtr->elements[i];
-        vectorPtr->elements[i] = vectorPtr->elements[min];
-        vectorPtr->elements[min] = temp;
-      }
-    }
+    vector_sortElements(vectorPtr->elements, vectorPtr->size,
+                        [compare](void* a, void* b) { return compare(&a, &b) < 0; });
 }
 
 
@@ -256,11 +241,11 @@ vector_copy (vector_t* dstVectorPtr, vector_t* srcVectorPtr)
     long srcSize = srcVectorPtr->size;
     if (dstCapacity < srcSize) {
         long srcCapacity = srcVectorPtr->capacity;
-        void** elements = (void**)malloc(srcCapacity * sizeof(void*));
+        void** elements = (void**)memory_alloc(srcCapacity * sizeof(void*));
         if (elements == NULL)
             return false;
 
-        free(dstVectorPtr->elements);
+        memory_free(dstVectorPtr->elements);
         dstVectorPtr->elements = elements;
         dstVectorPtr->capacity = srcCapacity;
     }
@@ -280,6 +265,7 @@ vector_copy (vector_t* dstVectorPtr, vector_t* srcVectorPtr)
 #ifdef TEST_VECTOR
 
 
+#include <assert.h>
 #include <stdio.h>
 
 static void
@@ -314,7 +300,7 @@ removeInt (vector_t* vectorPtr)
 }
 
 
-static int
+TM_SAFE static int
 compareInt (const void* aPtr, const void* bPtr)
 {
     long a = *((long*)(*(void**)aPtr));
@@ -356,6 +342,33 @@ main ()
     vector_free(vectorPtr);
     vector_free(copyVectorPtr);
 
+    /* Random, few distinct, sorted and reversed inputs of many sizes */
+    for (long n = 0; n < 2000; n = n * 3 / 2 + 1) {
+        for (long kind = 0; kind < 4; kind++) {
+            long* values = (long*)malloc((n + 1) * sizeof(long));
+            vectorPtr = vector_alloc(n + 1);
+            for (i = 0; i < n; i++) {
+                values[i] = ((kind == 0) ? rand() :
+                             (kind == 1) ? rand() % 3 :
+                             (kind == 2) ? i : n - i);
+                vector_pushBack(vectorPtr, &values[i]);
+            }
+            if (kind % 2) {
+                vector_sort(vectorPtr, &compareInt);
+            } else {
+                vector_sortBy<long*>(vectorPtr,
+                                     [](long* a, long* b) { return *a < *b; });
+            }
+            for (i = 1; i < n; i++) {
+                assert(*(long*)vector_at(vectorPtr, i - 1) <=
+                       *(long*)vector_at(vectorPtr, i));
+            }
+            vector_free(vectorPtr);
+            free(values);
+        }
+    }
+    puts("sorts ok");
+
     puts("Done.");
 
     return 0;
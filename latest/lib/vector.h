@@ -155,8 +155,135 @@ void
 vector_clear (vector_t* vectorPtr);
 
 
+/* =============================================================================
+ * vector_sortElements
+ * -- Introsort of elements[0..n) by less(a, b), which is true if a goes
+ *    before b: median-of-3 quicksort down to VECTOR_SORT_CUTOFF elements,
+ *    then insertion sort, and heapsort below 2*log2(n) levels, so it is
+ *    O(n log n) in the worst case; not stable
+ * -- In place and without libc, so it is transaction-safe as long as less is
+ * =============================================================================
+ */
+enum {
+    VECTOR_SORT_CUTOFF = 16
+};
+
+template <typename Less>
+__attribute__((transaction_safe))
+void
+vector_siftDown (void** elements, long root, long n, Less less)
+{
+    void* x = elements[root];
+
+    while (2 * root + 1 < n) {
+        long child = 2 * root + 1;
+        if (child + 1 < n && less(elements[child], elements[child + 1])) {
+            child++;
+        }
+        if (!less(x, elements[child])) {
+            break;
+        }
+        elements[root] = elements[child];
+        root = child;
+    }
+    elements[root] = x;
+}
+
+template <typename Less>
+__attribute__((transaction_safe))
+void
+vector_sortRange (void** elements, long lo, long hi, long depth, Less less)
+{
+    /* Sorts [lo, hi); loops on the larger half */
+    while (hi - lo > VECTOR_SORT_CUTOFF) {
+        void** base = elements + lo;
+        long size = hi - lo;
+
+        if (depth-- == 0) {
+            for (long i = size / 2 - 1; i >= 0; i--) {
+                vector_siftDown(base, i, size, less);
+            }
+            for (long i = size - 1; i > 0; i--) {
+                void* tmp = base[0];
+                base[0] = base[i];
+                base[i] = tmp;
+                vector_siftDown(base, 0, i, less);
+            }
+            hi = lo;
+            break;
+        }
+
+        /* Median of three to base[0], which is then the pivot */
+        long mid = size / 2;
+        long last = size - 1;
+        if (less(base[mid], base[0])) {
+            void* tmp = base[mid]; base[mid] = base[0]; base[0] = tmp;
+        }
+        if (less(base[last], base[mid])) {
+            void* tmp = base[last]; base[last] = base[mid]; base[mid] = tmp;
+            if (less(base[mid], base[0])) {
+                tmp = base[mid]; base[mid] = base[0]; base[0] = tmp;
+            }
+        }
+        void* tmp = base[0]; base[0] = base[mid]; base[mid] = tmp;
+        void* pivot = base[0];
+
+        /* Hoare partition; elements equal to the pivot go to both sides */
+        long i = 0;
+        long j = size;
+        while (1) {
+            do { i++; } while (i < size && less(base[i], pivot));
+            do { j--; } while (less(pivot, base[j]));
+            if (i >= j) {
+                break;
+            }
+            tmp = base[i]; base[i] = base[j]; base[j] = tmp;
+        }
+        base[0] = base[j];
+        base[j] = pivot;
+
+        /*
+         * Recurse into the smaller side, so the stack stays O(log n); it
+         * gets what is left of the depth, not a fresh 2*log2 of its size
+         */
+        if (j < size - 1 - j) {
+            vector_sortRange(elements, lo, lo + j, depth, less);
+            lo = lo + j + 1;
+        } else {
+            vector_sortRange(elements, lo + j + 1, hi, depth, less);
+            hi = lo + j;
+        }
+    }
+
+    for (long i = lo + 1; i < hi; i++) {
+        void* x = elements[i];
+        long j = i;
+        while (j > lo && less(x, elements[j - 1])) {
+            elements[j] = elements[j - 1];
+            j--;
+        }
+        elements[j] = x;
+    }
+}
+
+
+template <typename Less>
+__attribute__((transaction_safe))
+void
+vector_sortElements (void** elements, long n, Less less)
+{
+    long depth = 0;
+    for (long m = n; m > 1; m >>= 1) {
+        depth += 2;
+    }
+
+    vector_sortRange(elements, 0, n, depth, less);
+}
+
+
 /* =============================================================================
  * vector_sort
+ * -- compare gets pointers to the two elements, as for qsort
  * =============================================================================
  */
 //[wer] this function was pure because of qsort(), fixed
@@ -165,6 +292,23 @@ void
 vector_sort (vector_t* vectorPtr, int __attribute__((transaction_safe)) (*compare) (const void*, const void*));
 
 
+/* =============================================================================
+ * vector_sortBy
+ * -- Typed vector_sort: less(a, b) takes the elements themselves as T, so
+ *    an inline less needs neither the function pointer nor the void**
+ * -- E.g., vector_sortBy<query_t*>(v, [](query_t* a, query_t* b) { ... })
+ * =============================================================================
+ */
+template <typename T, typename Less>
+__attribute__((transaction_safe))
+void
+vector_sortBy (vector_t* vectorPtr, Less less)
+{
+    vector_sortElements(vectorPtr->elements, vectorPtr->size,
+                        [less](void* a, void* b) { return less((T)a, (T)b); });
+}
+
+
 /* =============================================================================
  * vector_copy
  * =============================================================================
@@ -0,0 +1,34 @@
+/* =============================================================================
+ *
+ * xorshift.h
+ * -- Small fast generator (Marsaglia's xorshift64) for per-thread use
+ *
+ * =============================================================================
+ *
+ * The state is one nonzero word, usually a __thread variable owned by the
+ * caller, who also picks the seed.  It is not for anything that needs good
+ * statistics, only for spreading choices such as backoffs, tower heights
+ * and queue picks.
+ *
+ * =============================================================================
+ */
+
+#pragma once
+
+
+/* =============================================================================
+ * xorshift_next
+ * -- Advances *seedPtr, which must not be 0, and returns the new value
+ * =============================================================================
+ */
+static inline unsigned long
+xorshift_next (unsigned long* seedPtr)
+{
+    unsigned long x = *seedPtr;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *seedPtr = x;
+
+    return x;
+}
@@ -72,12 +72,11 @@
 #include "defs.h"
 #include "globals.h"
 #include "thread.h"
+#include "tm.h"
 #include "utility.h"
 #include "tm_transition.h"
 
 static ULONGINT_T*  global_p                 = NULL;
-static ULONGINT_T   global_maxNumVertices    = 0;
-static ULONGINT_T   global_outVertexListSize = 0;
 static ULONGINT_T*  global_impliedEdgeList   = NULL;
 static ULONGINT_T** global_auxArr            = NULL;
 
@@ -180,17 +179,7 @@ computeGraph (void* argPtr)
         }
     }
 
-    __transaction_atomic {
-      //long tmp_maxNumVertices = (long)TM_SHARED_READ(global_maxNumVertices);
-      //long new_maxNumVertices = MAX(tmp_maxNumVertices, maxNumVertices + 1);
-      //TM_SHARED_WRITE(global_maxNumVertices, (unsigned long)new_maxNumVertices);
-      if (global_maxNumVertices < maxNumVertices + 1)
-        global_maxNumVertices = maxNumVertices + 1;
-    }
-
-    thread_barrier_wait();
-
-    maxNumVertices = global_maxNumVertices;
+    maxNumVertices = thread_reduce_max(maxNumVertices + 1);
 
     if (myId == 0) {
 
@@ -299,13 +288,7 @@ computeGraph (void* argPtr)
 
     thread_barrier_wait();
 
-    __transaction_atomic {
-        global_outVertexListSize += outVertexListSize;
-    }
-
-    thread_barrier_wait();
-
-    outVertexListSize = global_outVertexListSize;
+    outVertexListSize = thread_reduce_sum(outVertexListSize);
 
     if (myId == 0) {
         GPtr->numDirectedEdges = outVertexListSize;
@@ -315,6 +298,18 @@ computeGraph (void* argPtr)
         GPtr->paralEdgeIndex =
             (ULONGINT_T*)malloc(outVertexListSize * sizeof(ULONGINT_T));
         assert(GPtr->paralEdgeIndex);
+    }
+
+    thread_barrier_wait();
+
+    /* First touch: each thread places the edge pages it will fill */
+    thread_memsetPart(GPtr->outVertexList, 0,
+                      outVertexListSize * sizeof(ULONGINT_T));
+    thread_memsetPart(GPtr->paralEdgeIndex, 0,
+                      outVertexListSize * sizeof(ULONGINT_T));
+
+    /* Thread 0's part always starts at element 0 */
+    if (myId == 0) {
         GPtr->outVertexList[0] = SDGdataPtr->endVertex[0];
     }
 
@@ -472,7 +467,7 @@ computeGraph (void* argPtr)
                 }
             }
             if (k == GPtr->outVertexIndex[v]+GPtr->outDegree[v]) {
-              __transaction_atomic {
+              TM_BEGIN("computeGraph_addImpliedEdge");
                 /* Add i to the impliedEdgeList of v */
 
                 long inDegree = GPtr->inDegree[v];
@@ -493,7 +488,7 @@ computeGraph (void* argPtr)
                   }
                   a[inDegree % MAX_CLUSTER_SIZE] = (unsigned long)i;
                 }
-              } // TM_END
+              TM_END();
             }
         }
     } /* for i */
@@ -511,6 +506,11 @@ computeGraph (void* argPtr)
 
     thread_barrier_wait();
 
+    thread_memsetPart(GPtr->inVertexList, 0,
+                      GPtr->numUndirectedEdges * sizeof(ULONGINT_T));
+
+    thread_barrier_wait();
+
     /*
      * Create the inVertex List
      */
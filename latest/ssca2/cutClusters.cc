@@ -73,6 +73,7 @@
 #include "defs.h"
 #include "globals.h"
 #include "thread.h"
+#include "tm.h"
 
 static ULONGINT_T* global_Index                = NULL;
 static ULONGINT_T* global_neighbourArray       = NULL;
@@ -526,9 +527,9 @@ cutClusters (void* argPtr)
             global_iter = iter;
         }
 
-        __transaction_atomic {
+        TM_BEGIN("cutClusters_sumCliqueSize");
           global_cliqueSize += cliqueSize;
-        }
+        TM_END();
 
         thread_barrier_wait();
 
@@ -597,11 +598,11 @@ cutClusters (void* argPtr)
         }
     }
 
-    __transaction_atomic {
+    TM_BEGIN("cutClusters_sumCutSetIndex");
       //long tmp_cutSetIndex = (long)TM_SHARED_READ(global_cutSetIndex);
       //TM_SHARED_WRITE(global_cutSetIndex, (tmp_cutSetIndex + cutSetIndex));
       global_cutSetIndex += cutSetIndex;
-    }
+    TM_END();
 
     thread_barrier_wait();
 
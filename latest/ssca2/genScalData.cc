@@ -76,6 +76,7 @@
 #include "genScalData.h"
 #include "globals.h"
 #include "thread.h"
+#include "tm.h"
 
 static ULONGINT_T* global_permV              = NULL;
 static long*       global_cliqueSizes        = NULL;
@@ -802,14 +803,14 @@ genScalData (void* argPtr)
         long t1 = stream();
         long t = i + t1 % (TOT_VERTICES - i);
         if (t != i) {
-          __transaction_atomic {
+          TM_BEGIN("genScalData_permuteVertices");
             //unsigned long t2 = (unsigned long)TM_SHARED_READ(permV[t]);
             //TM_SHARED_WRITE(permV[t], TM_SHARED_READ(permV[i]));
             //TM_SHARED_WRITE(permV[i], t2);
             unsigned long temp = (unsigned long)permV[t];
             permV[t] = permV[i];
             permV[i] = temp;
-          }
+          TM_END();
         }
     }
 
@@ -1091,11 +1092,11 @@ genScalData (void* argPtr)
         }
     }
 
-    __transaction_atomic {
+    TM_BEGIN("genScalData_countIntraCliqueEdges");
       //TM_SHARED_WRITE(global_edgeNum,
       //                ((long)TM_SHARED_READ(global_edgeNum) + i_edgePtr));
       global_edgeNum += i_edgePtr;
-    }
+    TM_END();
 
     thread_barrier_wait();
 
@@ -1309,11 +1310,11 @@ genScalData (void* argPtr)
             i_edgeStartCounter[i] = i_edgeEndCounter[i-1];
         }
     }
-    __transaction_atomic {
+    TM_BEGIN("genScalData_countInterCliqueEdges");
       //TM_SHARED_WRITE(global_edgeNum,
       //                ((long)TM_SHARED_READ(global_edgeNum) + i_edgePtr));
       global_edgeNum += i_edgePtr;
-    }
+    TM_END();
 
     thread_barrier_wait();
 
@@ -1390,11 +1391,11 @@ genScalData (void* argPtr)
             }
         }
     }
-    __transaction_atomic {
+    TM_BEGIN("genScalData_countStrWtEdges");
       //TM_SHARED_WRITE(global_numStrWtEdges,
       //                ((long)TM_SHARED_READ(global_numStrWtEdges) + numStrWtEdges));
       global_numStrWtEdges += numStrWtEdges;
-    }
+    TM_END();
 
     thread_barrier_wait();
 
@@ -74,6 +74,7 @@
 #include "getStartLists.h"
 #include "globals.h"
 #include "thread.h"
+#include "tm.h"
 #include "utility.h"
 
 static LONGINT_T global_maxWeight          = 0;
@@ -116,14 +117,14 @@ getStartLists (void* argPtr)
         }
     }
 
-    __transaction_atomic {
+    TM_BEGIN("getStartLists_maxWeight");
       //long tmp_maxWeight = (long)TM_SHARED_READ(global_maxWeight);
       //if (maxWeight > tmp_maxWeight)
       // TM_SHARED_WRITE(global_maxWeight, maxWeight);
 
       if (maxWeight > global_maxWeight)
         global_maxWeight = maxWeight;
-    }
+    TM_END();
 
     thread_barrier_wait();
 
@@ -78,6 +78,54 @@
 #include "timer.h"
 #include "thread.h"
 
+
+typedef struct kernel_arg {
+    const char* phase;
+    void (*funcPtr)(void*);
+    void* argPtr;
+} kernel_arg_t;
+
+
+/* =============================================================================
+ * runKernel
+ * -- Runs one kernel on this thread, timed as the named phase
+ * =============================================================================
+ */
+static void
+runKernel (void* argPtr)
+{
+    kernel_arg_t* kernelArgPtr = (kernel_arg_t*)argPtr;
+
+    timer_phaseBegin(kernelArgPtr->phase);
+    kernelArgPtr->funcPtr(kernelArgPtr->argPtr);
+    timer_phaseEnd(kernelArgPtr->phase);
+}
+
+
+/* =============================================================================
+ * startKernel
+ * -- Runs funcPtr(argPtr) on all threads
+ * =============================================================================
+ */
+static void
+startKernel (const char* phase, void (*funcPtr)(void*), void* argPtr)
+{
+    kernel_arg_t kernelArg;
+    kernelArg.phase   = phase;
+    kernelArg.funcPtr = funcPtr;
+    kernelArg.argPtr  = argPtr;
+
+#ifdef OTM
+#pragma omp parallel
+    {
+        runKernel((void*)&kernelArg);
+    }
+#else
+    thread_start(runKernel, (void*)&kernelArg);
+#endif
+}
+
+
 int main (int argc, char** argv)
 {
     /*
@@ -163,14 +211,7 @@ int main (int argc, char** argv)
     TIMER_READ(start);
 
 #ifdef USE_PARALLEL_DATA_GENERATION
-#ifdef OTM
-#pragma omp parallel
-    {
-        genScalData((void*)SDGdata);
-    }
-#else
-    thread_start(genScalData, (void*)SDGdata);
-#endif
+    startKernel("genScalData", genScalData, (void*)SDGdata);
 #else /* !USE_PARALLEL_DATA_GENERATION */
     genScalData_seq(SDGdata);
 #endif /* !USE_PARALLEL_DATA_GENERATION */
@@ -205,14 +246,7 @@ int main (int argc, char** argv)
 
     TIMER_READ(start);
 
-#ifdef OTM
-#pragma omp parallel
-    {
-        computeGraph((void*)&computeGraphArgs);
-    }
-#else
-    thread_start(computeGraph, (void*)&computeGraphArgs);
-#endif
+    startKernel("kernel1", computeGraph, (void*)&computeGraphArgs);
     TIMER_READ(stop);
 
     time = TIMER_DIFF_SECONDS(start, stop);
@@ -248,14 +282,7 @@ int main (int argc, char** argv)
 
     TIMER_READ(start);
 
-#ifdef OTM
-#pragma omp parallel
-    {
-        getStartLists((void*)&getStartListsArg);
-    }
-#else
-    thread_start(getStartLists, (void*)&getStartListsArg);
-#endif
+    startKernel("kernel2", getStartLists, (void*)&getStartListsArg);
 
     TIMER_READ(stop);
 
@@ -294,14 +321,7 @@ int main (int argc, char** argv)
 
         TIMER_READ(start);
 
-#ifdef OTM
-#pragma omp parallel
-        {
-            findSubGraphs0((void*)&findSubGraphs0Arg);
-        }
-#else
-        thread_start(findSubGraphs0, (void*)&findSubGraphs0Arg);
-#endif
+        startKernel("kernel3", findSubGraphs0, (void*)&findSubGraphs0Arg);
         TIMER_READ(stop);
 
     } else if (K3_DS == 1) {
@@ -322,14 +342,7 @@ int main (int argc, char** argv)
 
         TIMER_READ(start);
 
-#ifdef OTM
-#pragma omp parallel
-        {
-            findSubGraphs1((void*)&findSubGraphs1Arg);
-        }
-#else
-        thread_start(findSubGraphs1, (void*)&findSubGraphs1Arg);
-#endif
+        startKernel("kernel3", findSubGraphs1, (void*)&findSubGraphs1Arg);
 
         TIMER_READ(stop);
 
@@ -376,14 +389,7 @@ int main (int argc, char** argv)
 
         TIMER_READ(start);
 
-#ifdef OTM
-#pragma omp parallel
-        {
-            findSubGraphs2((void*)&findSubGraphs2Arg);
-        }
-#else
-        thread_start(findSubGraphs2, (void*)&findSubGraphs2Arg);
-#endif
+        startKernel("kernel3", findSubGraphs2, (void*)&findSubGraphs2Arg);
 
         TIMER_READ(stop);
 
@@ -444,14 +450,7 @@ int main (int argc, char** argv)
 
     TIMER_READ(start);
 
-#ifdef OTM
-#pragma omp parallel
-    {
-        cutClusters((void*)G);
-    }
-#else
-    thread_start(cutClusters, (void*)G);
-#endif
+    startKernel("kernel4", cutClusters, (void*)G);
 
     TIMER_READ(stop);
 
@@ -464,6 +463,7 @@ int main (int argc, char** argv)
 #endif /* ENABLE_KERNEL4 */
 
     printf("\nTime = %9.6f\n\n", totalTime);
+    timer_phasePrint();
 
     /* -------------------------------------------------------------------------
      * Cleanup
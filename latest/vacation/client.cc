@@ -5,9 +5,14 @@
 #include <assert.h>
 #include "action.h"
 #include "client.h"
+#include "distribution.h"
+#include "histogram.h"
 #include "manager.h"
 #include "reservation.h"
 #include "thread.h"
+#include "timer.h"
+#include "tm.h"
+#include "tmretry.h"
 #include "tm_transition.h"
 
 /* =============================================================================
@@ -20,7 +25,11 @@ client_t::client_t(long _id,
                    long _numOperation,
                    long _numQueryPerTransaction,
                    long _queryRange,
-                   long _percentUser)
+                   long _percentUser,
+                   distribution_t* _distributionPtr,
+                   double _arrivalRate,
+                   bool _isConstantArrival,
+                   double _duration)
 {
     id = _id;
     managerPtr = _managerPtr;
@@ -29,6 +38,28 @@ client_t::client_t(long _id,
     numQueryPerTransaction = _numQueryPerTransaction;
     queryRange = _queryRange;
     percentUser = _percentUser;
+    distributionPtr = _distributionPtr;
+    arrivalRate = _arrivalRate;
+    isConstantArrival = _isConstantArrival;
+    arrivalRandom.seed(id + 1);
+    duration = _duration;
+    for (long a = 0; a < NUM_ACTION; a++) {
+        latencyPtrs[a] = histogram_alloc();
+        assert(latencyPtrs[a] != NULL);
+        numStarts[a] = 0;
+    }
+}
+
+
+/* =============================================================================
+ * client_free
+ * =============================================================================
+ */
+client_t::~client_t()
+{
+    for (long a = 0; a < NUM_ACTION; a++) {
+        histogram_free(latencyPtrs[a]);
+    }
 }
 
 /* =============================================================================
@@ -52,6 +83,191 @@ selectAction (long r, long percentUser)
 }
 
 
+/* =============================================================================
+ * getNextArrival
+ * -- Returns the time, in ns, of the start scheduled after lastArrival
+ * =============================================================================
+ */
+static unsigned long long
+getNextArrival (client_t* clientPtr, unsigned long long lastArrival)
+{
+    double meanGap = 1000000000.0 / clientPtr->arrivalRate;
+
+    if (clientPtr->isConstantArrival) {
+        return lastArrival + (unsigned long long)meanGap;
+    }
+
+    std::exponential_distribution<double> gap(1.0 / meanGap);
+
+    return lastArrival + (unsigned long long)gap(clientPtr->arrivalRandom);
+}
+
+
+/* =============================================================================
+ * waitUntil
+ * =============================================================================
+ */
+static void
+waitUntil (unsigned long long time)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(time / 1000000000ULL);
+    ts.tv_nsec = (long)(time % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+        /* interrupted */
+    }
+}
+
+
+/*
+ * Each action runs its transaction in a function of its own, kept out of
+ * line: TM_RETRY_BEGIN returns twice, and client_run's timing locals must
+ * not be live across it.
+ */
+
+
+/* =============================================================================
+ * makeReservation
+ * -- Checks the price of each queried item and reserves the most expensive
+ *    one of each type
+ * =============================================================================
+ */
+__attribute__((noinline)) static void
+makeReservation (manager_t* managerPtr, long customerId,
+                 long numQuery, const long* types, const long* ids)
+{
+    long maxPrices[NUM_RESERVATION_TYPE] = { -1, -1, -1 };
+    long maxIds[NUM_RESERVATION_TYPE] = { -1, -1, -1 };
+    bool isFound = false;
+    bool done = true;
+
+    //[wer210] I modified here to remove _ITM_abortTransaction().
+    TM_RETRY_BEGIN("client_makeReservation");
+        for (long n = 0; n < numQuery; n++) {
+          long t = types[n];
+          long id = ids[n];
+          long price = -1;
+          switch (t) {
+           case RESERVATION_CAR:
+            if (manager_queryCar(managerPtr, id) >= 0) {
+              price = manager_queryCarPrice(managerPtr, id);
+            }
+            break;
+           case RESERVATION_FLIGHT:
+            if (manager_queryFlight(managerPtr, id) >= 0) {
+              price = manager_queryFlightPrice(managerPtr, id);
+            }
+            break;
+           case RESERVATION_ROOM:
+            if (manager_queryRoom(managerPtr, id) >= 0) {
+              price = manager_queryRoomPrice(managerPtr, id);
+            }
+            break;
+           default:
+            assert(0);
+          }
+          //[wer210] read-only above
+          if (price > maxPrices[t]) {
+            maxPrices[t] = price;
+            maxIds[t] = id;
+            isFound = true;
+          }
+        } /* for n */
+
+        if (isFound) {
+          done = done && manager_addCustomer(managerPtr, customerId);
+        }
+
+        if (maxIds[RESERVATION_CAR] > 0) {
+          done = done && manager_reserveCar(managerPtr,
+                                      customerId, maxIds[RESERVATION_CAR]);
+        }
+
+        if (maxIds[RESERVATION_FLIGHT] > 0) {
+          done = done && manager_reserveFlight(managerPtr,
+                                         customerId, maxIds[RESERVATION_FLIGHT]);
+        }
+        if (maxIds[RESERVATION_ROOM] > 0) {
+          done = done && manager_reserveRoom(managerPtr,
+                                       customerId, maxIds[RESERVATION_ROOM]);
+        }
+        if (!done) TM_RETRY_CANCEL();
+    TM_RETRY_END();
+}
+
+
+/* =============================================================================
+ * deleteCustomer
+ * =============================================================================
+ */
+__attribute__((noinline)) static void
+deleteCustomer (manager_t* managerPtr, long customerId)
+{
+    bool done = true;
+
+    TM_RETRY_BEGIN("client_deleteCustomer");
+        long bill = manager_queryCustomerBill(managerPtr, customerId);
+        if (bill >= 0) {
+          done = done && manager_deleteCustomer(managerPtr, customerId);
+        }
+        if (!done) TM_RETRY_CANCEL();
+    TM_RETRY_END();
+}
+
+
+/* =============================================================================
+ * updateTables
+ * -- Adds to or removes from each item's total
+ * =============================================================================
+ */
+__attribute__((noinline)) static void
+updateTables (manager_t* managerPtr, long numUpdate, const long* types,
+              const long* ids, const long* ops, const long* prices)
+{
+    bool done = true;
+
+    TM_RETRY_BEGIN("client_updateTables");
+        for (long n = 0; n < numUpdate; n++) {
+          long t = types[n];
+          long id = ids[n];
+          long doAdd = ops[n];
+          if (doAdd) {
+            long newPrice = prices[n];
+            switch (t) {
+             case RESERVATION_CAR:
+              done = done && manager_addCar(managerPtr, id, 100, newPrice);
+              break;
+             case RESERVATION_FLIGHT:
+              done = done && manager_addFlight(managerPtr, id, 100, newPrice);
+              break;
+             case RESERVATION_ROOM:
+              done = done && manager_addRoom(managerPtr, id, 100, newPrice);
+              break;
+             default:
+              assert(0);
+            }
+          } else { /* do delete */
+            switch (t) {
+             case RESERVATION_CAR:
+              done = done && manager_deleteCar(managerPtr, id, 100);
+              break;
+             case RESERVATION_FLIGHT:
+              done = done && manager_deleteFlight(managerPtr, id);
+              break;
+             case RESERVATION_ROOM:
+              done = done && manager_deleteRoom(managerPtr, id, 100);
+              break;
+             default:
+              assert(0);
+            }
+          }
+        }
+      if (!done) TM_RETRY_CANCEL();
+    TM_RETRY_END();
+}
+
+
 /* =============================================================================
  * client_run
  * -- Execute list operations on the database
@@ -70,157 +286,68 @@ client_run (void* argPtr)
     long numQueryPerTransaction = clientPtr->numQueryPerTransaction;
     long queryRange             = clientPtr->queryRange;
     long percentUser            = clientPtr->percentUser;
+    distribution_t* distributionPtr = clientPtr->distributionPtr;
 
     long types[numQueryPerTransaction];
     long ids[numQueryPerTransaction];
     long ops[numQueryPerTransaction];
     long prices[numQueryPerTransaction];
 
-    for (long i = 0; i < numOperation; i++) {
+    bool isOpenLoop = (clientPtr->arrivalRate > 0.0);
+    bool isTimed = (clientPtr->duration > 0.0);
+    unsigned long long now = timer_now();
+    unsigned long long stopTime =
+        now + (unsigned long long)(clientPtr->duration * 1000000000.0);
+    unsigned long long arrival = now;
+
+    for (long i = 0; (isTimed ? (now < stopTime) : (i < numOperation)); i++) {
         long r = randomPtr() % 100;
         action_t action = selectAction(r, percentUser);
+        unsigned long long startTime = 0;
+        long shift = distribution_getShift(distributionPtr);
+
+        if (isOpenLoop) {
+            arrival = getNextArrival(clientPtr, arrival);
+            if (isTimed && arrival >= stopTime) {
+                break;
+            }
+            if (arrival > timer_now()) {
+                waitUntil(arrival);
+            }
+        }
 
         switch (action) {
             case ACTION_MAKE_RESERVATION: {
-                long maxPrices[NUM_RESERVATION_TYPE] = { -1, -1, -1 };
-                long maxIds[NUM_RESERVATION_TYPE] = { -1, -1, -1 };
-                long n;
                 long numQuery = randomPtr() % numQueryPerTransaction + 1;
                 long customerId = randomPtr() % queryRange + 1;
-                for (n = 0; n < numQuery; n++) {
+                for (long n = 0; n < numQuery; n++) {
                     types[n] = randomPtr() % NUM_RESERVATION_TYPE;
-                    ids[n] = (randomPtr() % queryRange) + 1;
+                    ids[n] = distribution_sample(distributionPtr, randomPtr, shift);
                 }
-                bool isFound = false;
-                bool done = true;
-                //[wer210] I modified here to remove _ITM_abortTransaction().
-                while (1) {
-                  __transaction_atomic {
-                    for (n = 0; n < numQuery; n++) {
-                      long t = types[n];
-                      long id = ids[n];
-                      long price = -1;
-                      switch (t) {
-                       case RESERVATION_CAR:
-                        if (manager_queryCar(managerPtr, id) >= 0) {
-                          price = manager_queryCarPrice(managerPtr, id);
-                        }
-                        break;
-                       case RESERVATION_FLIGHT:
-                        if (manager_queryFlight(managerPtr, id) >= 0) {
-                          price = manager_queryFlightPrice(managerPtr, id);
-                        }
-                        break;
-                       case RESERVATION_ROOM:
-                        if (manager_queryRoom(managerPtr, id) >= 0) {
-                          price = manager_queryRoomPrice(managerPtr, id);
-                        }
-                        break;
-                       default:
-                        assert(0);
-                      }
-                      //[wer210] read-only above
-                      if (price > maxPrices[t]) {
-                        maxPrices[t] = price;
-                        maxIds[t] = id;
-                        isFound = true;
-                      }
-                    } /* for n */
-
-                    if (isFound) {
-                      done = done && manager_addCustomer(managerPtr, customerId);
-                    }
-
-                    if (maxIds[RESERVATION_CAR] > 0) {
-                      done = done && manager_reserveCar(managerPtr,
-                                                  customerId, maxIds[RESERVATION_CAR]);
-                    }
-
-                    if (maxIds[RESERVATION_FLIGHT] > 0) {
-                      done = done && manager_reserveFlight(managerPtr,
-                                                     customerId, maxIds[RESERVATION_FLIGHT]);
-                    }
-                    if (maxIds[RESERVATION_ROOM] > 0) {
-                      done = done && manager_reserveRoom(managerPtr,
-                                                   customerId, maxIds[RESERVATION_ROOM]);
-                    }
-                    if (done) break;
-                    else __transaction_cancel;
-                  } // TM_END
-            }
+                startTime = timer_now();
+                makeReservation(managerPtr, customerId, numQuery, types, ids);
                 break;
-
             }
 
             case ACTION_DELETE_CUSTOMER: {
                 long customerId = randomPtr() % queryRange + 1;
-                bool done = true;
-                while (1) {
-                  __transaction_atomic {
-                    long bill = manager_queryCustomerBill(managerPtr, customerId);
-                    if (bill >= 0) {
-                      done = done && manager_deleteCustomer(managerPtr, customerId);
-                    }
-                    if(done) break;
-                    else __transaction_cancel;
-                  }
-                }
+                startTime = timer_now();
+                deleteCustomer(managerPtr, customerId);
                 break;
             }
 
             case ACTION_UPDATE_TABLES: {
                 long numUpdate = randomPtr() % numQueryPerTransaction + 1;
-                long n;
-                for (n = 0; n < numUpdate; n++) {
+                for (long n = 0; n < numUpdate; n++) {
                     types[n] = randomPtr() % NUM_RESERVATION_TYPE;
-                    ids[n] = (randomPtr() % queryRange) + 1;
+                    ids[n] = distribution_sample(distributionPtr, randomPtr, shift);
                     ops[n] = randomPtr() % 2;
                     if (ops[n]) {
                         prices[n] = ((randomPtr() % 5) * 10) + 50;
                     }
                 }
-                bool done = true;
-                while (1) {
-                  __transaction_atomic {
-                    for (n = 0; n < numUpdate; n++) {
-                      long t = types[n];
-                      long id = ids[n];
-                      long doAdd = ops[n];
-                      if (doAdd) {
-                        long newPrice = prices[n];
-                        switch (t) {
-                         case RESERVATION_CAR:
-                          done = done && manager_addCar(managerPtr, id, 100, newPrice);
-                          break;
-                         case RESERVATION_FLIGHT:
-                          done = done && manager_addFlight(managerPtr, id, 100, newPrice);
-                          break;
-                         case RESERVATION_ROOM:
-                          done = done && manager_addRoom(managerPtr, id, 100, newPrice);
-                          break;
-                         default:
-                          assert(0);
-                        }
-                      } else { /* do delete */
-                        switch (t) {
-                         case RESERVATION_CAR:
-                          done = done && manager_deleteCar(managerPtr, id, 100);
-                          break;
-                         case RESERVATION_FLIGHT:
-                          done = done && manager_deleteFlight(managerPtr, id);
-                          break;
-                         case RESERVATION_ROOM:
-                          done = done && manager_deleteRoom(managerPtr, id, 100);
-                          break;
-                         default:
-                          assert(0);
-                        }
-                      }
-                    }
-                  if (done) break;
-                  else __transaction_cancel;
-                  } // TM_END
-                }
+                startTime = timer_now();
+                updateTables(managerPtr, numUpdate, types, ids, ops, prices);
                 break;
             }
 
@@ -229,6 +356,11 @@ client_run (void* argPtr)
 
         } /* switch (action) */
 
+        now = timer_now();
+        histogram_record(clientPtr->latencyPtrs[action],
+                         now - (isOpenLoop ? arrival : startTime));
+        clientPtr->numStarts[action] += tm_retry_getNumStart();
+
     } /* for i */
 
 }
@@ -5,6 +5,9 @@
 #pragma once
 
 #include <random>
+#include "action.h"
+#include "distribution.h"
+#include "histogram.h"
 #include "manager.h"
 
 struct client_t {
@@ -15,22 +18,47 @@ struct client_t {
     long numQueryPerTransaction;
     long queryRange;
     long percentUser;
+    distribution_t* distributionPtr; /* of item ids; shared among clients */
+
+    /*
+     * Open loop: scheduled starts per second, or 0 to run back to back.
+     * Transactions still run one at a time; one that starts late because
+     * the previous one overran keeps its scheduled start.
+     */
+    double arrivalRate;
+    bool isConstantArrival; /* else Poisson arrivals */
+    std::mt19937 arrivalRandom;
+    /* If > 0, run for this many seconds instead of numOperation */
+    double duration;
+
+    /* Per action: latency in ns of each transaction, retries included */
+    histogram_t* latencyPtrs[NUM_ACTION];
+    /* Per action: attempts begun, summed over transactions */
+    unsigned long numStarts[NUM_ACTION];
 
     client_t(long id,
              manager_t* managerPtr,
              long numOperation,
              long numQueryPerTransaction,
              long queryRange,
-             long percentUser);
+             long percentUser,
+             distribution_t* distributionPtr,
+             double arrivalRate,
+             bool isConstantArrival,
+             double duration);
 
-    // NB: no need for explicit destructor, since the managerPtr is shared
-    // among clients
+    // NB: the managerPtr and distributionPtr are shared among clients, so
+    // they are not freed here
+    ~client_t();
 };
 
 
 /*
  * client_run
  * -- Execute list operations on the database
+ * -- In open loop, latency is measured from the scheduled start, so it
+ *    includes the time spent waiting for this client's previous
+ *    transaction to finish
  */
 void
 client_run (void* argPtr);
@@ -36,8 +36,12 @@ customer_t::customer_t(long _id)
 {
     id = _id;
 
+#ifdef USE_TM_TEMPLATES
+    reservationInfoListPtr = reservation_info_list_t::alloc();
+#else
     // NB: must initialize with TM_SAFE compare function
-    reservationInfoListPtr = TMLIST_ALLOC(&compareReservationInfo);
+    reservationInfoListPtr = TMSMALLLIST_ALLOC(&compareReservationInfo);
+#endif
     assert(reservationInfoListPtr != NULL);
 }
 
@@ -66,10 +70,10 @@ customer_addReservationInfo (customer_t* customerPtr,
     reservation_info_t* reservationInfoPtr =
         new reservation_info_t(type, id, price);
 
-    list_t* reservationInfoListPtr =
+    reservation_info_list_t* reservationInfoListPtr =
         customerPtr->reservationInfoListPtr;
 
-    return TMLIST_INSERT(reservationInfoListPtr, (void*)reservationInfoPtr);
+    return TMLIST_INSERT(reservationInfoListPtr, reservationInfoPtr);
 }
 
 
@@ -87,7 +91,8 @@ customer_removeReservationInfo (customer_t* customerPtr,
     // NB: price not used to compare reservation infos
     reservation_info_t findReservationInfo(type, id, 0);
 
-    list_t* reservationInfoListPtr = customerPtr->reservationInfoListPtr;
+    reservation_info_list_t* reservationInfoListPtr =
+        customerPtr->reservationInfoListPtr;
 
     reservation_info_t* reservationInfoPtr =
         (reservation_info_t*)TMLIST_FIND(reservationInfoListPtr,
@@ -96,8 +101,7 @@ customer_removeReservationInfo (customer_t* customerPtr,
     if (reservationInfoPtr == NULL) {
         return false;
     }
-    bool status = TMLIST_REMOVE(reservationInfoListPtr,
-                                  (void*)&findReservationInfo);
+    bool status = TMLIST_REMOVE(reservationInfoListPtr, &findReservationInfo);
 
     //[wer210] get rid of restart()
     if (status == false) {
@@ -120,8 +124,9 @@ __attribute__((transaction_safe)) long
 customer_getBill (  customer_t* customerPtr)
 {
     long bill = 0;
-    list_iter_t it;
-    list_t* reservationInfoListPtr = customerPtr->reservationInfoListPtr;
+    reservation_info_list_iter_t it;
+    reservation_info_list_t* reservationInfoListPtr =
+        customerPtr->reservationInfoListPtr;
 
     TMLIST_ITER_RESET(&it, reservationInfoListPtr);
     while (TMLIST_ITER_HASNEXT(&it)) {
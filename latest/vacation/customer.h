@@ -10,10 +10,26 @@
 
 #include "list.h"
 #include "reservation.h"
+#include "smalllist.h"
+
+#ifdef USE_TM_TEMPLATES
+#  include "tmlist.h"
+struct reservation_info_cmp {
+    __attribute__((transaction_safe))
+    long operator() (reservation_info_t* aPtr, reservation_info_t* bPtr) const {
+        return reservation_info_compare(aPtr, bPtr);
+    }
+};
+typedef tmlib::list<reservation_info_t*, reservation_info_cmp> reservation_info_list_t;
+typedef reservation_info_list_t::iter_t reservation_info_list_iter_t;
+#else
+typedef smalllist_t reservation_info_list_t;
+typedef smalllist_iter_t reservation_info_list_iter_t;
+#endif
 
 struct customer_t {
     long id;
-    list_t* reservationInfoListPtr;
+    reservation_info_list_t* reservationInfoListPtr;
 
     __attribute__((transaction_safe))
     customer_t(long id);
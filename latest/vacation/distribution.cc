@@ -0,0 +1,189 @@
+/*
+ * PLEASE SEE LICENSE FILE FOR LICENSING AND COPYRIGHT INFORMATION
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "distribution.h"
+#include "timer.h"
+
+/* =============================================================================
+ * distribution_alloc
+ * -- shiftMilliseconds of 0 keeps the hot ids fixed
+ * =============================================================================
+ */
+distribution_t::distribution_t(long _numKey,
+                               double _theta,
+                               double hotPercent,
+                               double hotKeyPercent,
+                               double shiftMilliseconds)
+{
+    assert(_numKey > 0);
+    assert(!(_theta > 0.0 && hotPercent > 0.0));
+
+    numKey = _numKey;
+    theta = _theta;
+    cdf = NULL;
+    hotFraction = hotPercent / 100.0;
+    numHotKey = 0;
+    keys = NULL;
+    shiftPeriod = (unsigned long long)(shiftMilliseconds * 1000000.0);
+    shiftStep = (long)(numKey * 0.6180339887) % numKey;
+
+    if (theta > 0.0) {
+        type = DISTRIBUTION_ZIPF;
+        cdf = (double*)malloc(numKey * sizeof(double));
+        assert(cdf != NULL);
+        double sum = 0.0;
+        for (long r = 0; r < numKey; r++) {
+            sum += 1.0 / pow((double)(r + 1), theta);
+            cdf[r] = sum;
+        }
+        for (long r = 0; r < numKey; r++) {
+            cdf[r] /= sum;
+        }
+    } else if (hotPercent > 0.0) {
+        type = DISTRIBUTION_HOTSPOT;
+        numHotKey = (long)(hotKeyPercent / 100.0 * numKey + 0.5);
+        if (numHotKey < 1) {
+            numHotKey = 1;
+        }
+        if (numHotKey > numKey) {
+            numHotKey = numKey;
+        }
+    } else {
+        type = DISTRIBUTION_UNIFORM;
+        return;
+    }
+
+    /* Scatter the ranks over the ids */
+    std::mt19937 random;
+    keys = (long*)malloc(numKey * sizeof(long));
+    assert(keys != NULL);
+    for (long i = 0; i < numKey; i++) {
+        keys[i] = i;
+    }
+    for (long i = numKey - 1; i > 0; i--) {
+        long j = random() % (i + 1);
+        long tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+
+/* =============================================================================
+ * distribution_free
+ * =============================================================================
+ */
+distribution_t::~distribution_t()
+{
+    free(cdf);
+    free(keys);
+}
+
+
+/* =============================================================================
+ * distribution_getShift
+ * =============================================================================
+ */
+long
+distribution_getShift (distribution_t* distributionPtr)
+{
+    if (distributionPtr->shiftPeriod == 0) {
+        return 0;
+    }
+
+    unsigned long long numPeriod = timer_now() / distributionPtr->shiftPeriod;
+
+    return (long)((numPeriod % (unsigned long long)distributionPtr->numKey) *
+                  distributionPtr->shiftStep % distributionPtr->numKey);
+}
+
+
+/* =============================================================================
+ * distribution_sample
+ * =============================================================================
+ */
+long
+distribution_sample (distribution_t* distributionPtr,
+                     std::mt19937& random,
+                     long shift)
+{
+    long numKey = distributionPtr->numKey;
+    long rank;
+
+    switch (distributionPtr->type) {
+        case DISTRIBUTION_UNIFORM:
+            return (random() % numKey + 1);
+
+        case DISTRIBUTION_ZIPF: {
+            /* Smallest rank whose cumulative probability reaches u */
+            const double* cdf = distributionPtr->cdf;
+            double u = (random() + 0.5) / 4294967296.0;
+            long lo = 0;
+            long hi = numKey - 1;
+            while (lo < hi) {
+                long mid = (lo + hi) / 2;
+                if (cdf[mid] < u) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            rank = lo;
+            break;
+        }
+
+        case DISTRIBUTION_HOTSPOT: {
+            long numHotKey = distributionPtr->numHotKey;
+            double u = (random() + 0.5) / 4294967296.0;
+            if (u < distributionPtr->hotFraction || numHotKey == numKey) {
+                rank = random() % numHotKey;
+            } else {
+                rank = numHotKey + random() % (numKey - numHotKey);
+            }
+            break;
+        }
+
+        default:
+            assert(0);
+            return 1;
+    }
+
+    return (distributionPtr->keys[(rank + shift) % numKey] + 1);
+}
+
+
+/* =============================================================================
+ * distribution_print
+ * =============================================================================
+ */
+void
+distribution_print (distribution_t* distributionPtr)
+{
+    switch (distributionPtr->type) {
+        case DISTRIBUTION_UNIFORM:
+            printf("uniform");
+            break;
+        case DISTRIBUTION_ZIPF:
+            printf("Zipf %g", distributionPtr->theta);
+            break;
+        case DISTRIBUTION_HOTSPOT:
+            printf("%g%% on %li hot ids",
+                   distributionPtr->hotFraction * 100.0,
+                   distributionPtr->numHotKey);
+            break;
+        default:
+            assert(0);
+    }
+
+    if (distributionPtr->type != DISTRIBUTION_UNIFORM &&
+        distributionPtr->shiftPeriod != 0)
+    {
+        printf(", moving every %g ms",
+               distributionPtr->shiftPeriod / 1000000.0);
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * PLEASE SEE LICENSE FILE FOR LICENSING AND COPYRIGHT INFORMATION
+ */
+
+/*
+ * distribution.h
+ * -- Skewed choice of ids for the client queries
+ *
+ * Ids in [1, numKey] are uniform by default.  With a Zipf exponent, the
+ * i-th hottest id is chosen with probability proportional to 1/i^theta;
+ * with a hotspot, hotPercent of the choices fall on hotKeyPercent of the
+ * ids.  The hottest ids are scattered over the range by a fixed random
+ * permutation, so they do not sit next to each other in an ordered table.
+ *
+ * With a shift period, the ranking moves every period by about 0.618 of
+ * the ids, so each period has a new set of hot ids.  All clients read the
+ * same clock, so they agree on the current one.
+ *
+ * The tables are built once; sampling only reads them, so one
+ * distribution_t is shared by all clients.
+ */
+
+#pragma once
+
+#include <random>
+
+enum distribution_type_t {
+    DISTRIBUTION_UNIFORM,
+    DISTRIBUTION_ZIPF,
+    DISTRIBUTION_HOTSPOT
+};
+
+struct distribution_t {
+    distribution_type_t type;
+    long numKey;
+    double theta;                   /* Zipf exponent */
+    double* cdf;                    /* Zipf: rank -> P(rank or hotter) */
+    double hotFraction;             /* hotspot: of the choices */
+    long numHotKey;                 /* hotspot: ranks 0..numHotKey-1 */
+    long* keys;                     /* position -> id - 1 */
+    unsigned long long shiftPeriod; /* ns; 0 if the ranking is fixed */
+    long shiftStep;                 /* positions moved per period */
+
+    distribution_t(long numKey,
+                   double theta,
+                   double hotPercent,
+                   double hotKeyPercent,
+                   double shiftMilliseconds);
+
+    ~distribution_t();
+};
+
+
+/*
+ * distribution_getShift
+ * -- Returns the current offset of the ranking; reads the clock only if
+ *    the ranking moves
+ */
+long
+distribution_getShift (distribution_t* distributionPtr);
+
+
+/*
+ * distribution_sample
+ * -- Returns an id in [1, numKey]
+ * -- The uniform case draws exactly one number, as "% numKey + 1" did
+ */
+long
+distribution_sample (distribution_t* distributionPtr,
+                     std::mt19937& random,
+                     long shift);
+
+
+/*
+ * distribution_print
+ * -- Prints a one-line description, e.g., "Zipf 0.99, moving every 100 ms"
+ */
+void
+distribution_print (distribution_t* distributionPtr);
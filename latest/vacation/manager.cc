@@ -39,20 +39,63 @@ __attribute__((transaction_safe))
 bool
 addReservation (  MAP_T* tablePtr, long id, long num, long price);
 
+/* =============================================================================
+ * getCarTable, getRoomTable, getFlightTable, getCustomerTable
+ * -- Return the shard of the table that holds id
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+static inline MAP_T*
+getCarTable (manager_t* managerPtr, long id)
+{
+    return manager_getTable(managerPtr, managerPtr->carTables, id);
+}
+
+__attribute__((transaction_safe))
+static inline MAP_T*
+getRoomTable (manager_t* managerPtr, long id)
+{
+    return manager_getTable(managerPtr, managerPtr->roomTables, id);
+}
+
+__attribute__((transaction_safe))
+static inline MAP_T*
+getFlightTable (manager_t* managerPtr, long id)
+{
+    return manager_getTable(managerPtr, managerPtr->flightTables, id);
+}
+
+__attribute__((transaction_safe))
+static inline MAP_T*
+getCustomerTable (manager_t* managerPtr, long id)
+{
+    return manager_getTable(managerPtr, managerPtr->customerTables, id);
+}
+
 /**
  * Constructor for manager objects
+ * -- Each table is split by id hash into numShard maps
  */
-manager_t::manager_t()
+manager_t::manager_t(long _numShard)
 {
-    carTablePtr = MAP_ALLOC(NULL, NULL);
-    roomTablePtr = MAP_ALLOC(NULL, NULL);
-    flightTablePtr = MAP_ALLOC(NULL, NULL);
-    customerTablePtr = MAP_ALLOC(NULL, NULL);
-    // [mfs] Once map is a c++ object, these asserts are unnecessary
-    assert(carTablePtr != NULL);
-    assert(roomTablePtr != NULL);
-    assert(flightTablePtr != NULL);
-    assert(customerTablePtr != NULL);
+    numShard = _numShard;
+    assert(numShard >= 1);
+    carTables = (MAP_T**)malloc(numShard * sizeof(MAP_T*));
+    roomTables = (MAP_T**)malloc(numShard * sizeof(MAP_T*));
+    flightTables = (MAP_T**)malloc(numShard * sizeof(MAP_T*));
+    customerTables = (MAP_T**)malloc(numShard * sizeof(MAP_T*));
+    assert(carTables && roomTables && flightTables && customerTables);
+    for (long s = 0; s < numShard; s++) {
+        carTables[s] = MAP_ALLOC(NULL, NULL);
+        roomTables[s] = MAP_ALLOC(NULL, NULL);
+        flightTables[s] = MAP_ALLOC(NULL, NULL);
+        customerTables[s] = MAP_ALLOC(NULL, NULL);
+        // [mfs] Once map is a c++ object, these asserts are unnecessary
+        assert(carTables[s] != NULL);
+        assert(roomTables[s] != NULL);
+        assert(flightTables[s] != NULL);
+        assert(customerTables[s] != NULL);
+    }
 }
 
 /**
@@ -63,10 +106,16 @@ manager_t::manager_t()
  */
 manager_t::~manager_t()
 {
-    MAP_FREE(carTablePtr);
-    MAP_FREE(roomTablePtr);
-    MAP_FREE(flightTablePtr);
-    MAP_FREE(customerTablePtr);
+    for (long s = 0; s < numShard; s++) {
+        MAP_FREE(carTables[s]);
+        MAP_FREE(roomTables[s]);
+        MAP_FREE(flightTables[s]);
+        MAP_FREE(customerTables[s]);
+    }
+    free(carTables);
+    free(roomTables);
+    free(flightTables);
+    free(customerTables);
 }
 
 
@@ -146,7 +195,7 @@ addReservation (MAP_T* tablePtr, long id, long num, long price)
 __attribute__((transaction_safe)) bool
 manager_addCar (manager_t* managerPtr, long carId, long numCars, long price)
 {
-    return addReservation(  managerPtr->carTablePtr, carId, numCars, price);
+    return addReservation(  getCarTable(managerPtr, carId), carId, numCars, price);
 }
 
 
@@ -163,7 +212,7 @@ __attribute__((transaction_safe)) bool
 manager_deleteCar (  manager_t* managerPtr, long carId, long numCar)
 {
     /* -1 keeps old price */
-    return addReservation(  managerPtr->carTablePtr, carId, -numCar, -1);
+    return addReservation(  getCarTable(managerPtr, carId), carId, -numCar, -1);
 }
 
 
@@ -177,7 +226,8 @@ manager_deleteCar (  manager_t* managerPtr, long carId, long numCar)
 __attribute__((transaction_safe)) bool
 manager_addRoom (manager_t* managerPtr, long roomId, long numRoom, long price)
 {
-    return addReservation(  managerPtr->roomTablePtr, roomId, numRoom, price);
+    return addReservation(  getRoomTable(managerPtr, roomId),
+                            roomId, numRoom, price);
 }
 
 
@@ -195,7 +245,7 @@ __attribute__((transaction_safe)) bool
 manager_deleteRoom (manager_t* managerPtr, long roomId, long numRoom)
 {
     /* -1 keeps old price */
-    return addReservation(  managerPtr->roomTablePtr, roomId, -numRoom, -1);
+    return addReservation(  getRoomTable(managerPtr, roomId), roomId, -numRoom, -1);
 }
 
 
@@ -209,7 +259,8 @@ manager_deleteRoom (manager_t* managerPtr, long roomId, long numRoom)
 __attribute__((transaction_safe)) bool
 manager_addFlight (manager_t* managerPtr, long flightId, long numSeat, long price)
 {
-    return addReservation(managerPtr->flightTablePtr, flightId, numSeat, price);
+    return addReservation(getFlightTable(managerPtr, flightId),
+                          flightId, numSeat, price);
 }
 
 
@@ -227,7 +278,8 @@ manager_deleteFlight (  manager_t* managerPtr, long flightId)
 {
     reservation_t* reservationPtr;
 
-    reservationPtr = (reservation_t*)TMMAP_FIND(managerPtr->flightTablePtr, flightId);
+    reservationPtr =
+        (reservation_t*)TMMAP_FIND(getFlightTable(managerPtr, flightId), flightId);
     if (reservationPtr == NULL) {
       //return FALSE;
       return true;
@@ -238,7 +290,7 @@ manager_deleteFlight (  manager_t* managerPtr, long flightId)
       return true;
     }
 
-    return addReservation(managerPtr->flightTablePtr,
+    return addReservation(getFlightTable(managerPtr, flightId),
                           flightId,
                           -1*reservationPtr->numTotal,
                           -1 /* -1 keeps old price */);
@@ -260,7 +312,7 @@ manager_addCustomer (  manager_t* managerPtr, long customerId)
     customer_t* customerPtr;
     bool status;
 
-    if (TMMAP_CONTAINS(managerPtr->customerTablePtr, customerId)) {
+    if (TMMAP_CONTAINS(getCustomerTable(managerPtr, customerId), customerId)) {
       //return FALSE;
       return true;
     }
@@ -268,7 +320,8 @@ manager_addCustomer (  manager_t* managerPtr, long customerId)
     customerPtr = new customer_t(customerId);
     assert(customerPtr != NULL);
 
-    status = TMMAP_INSERT(managerPtr->customerTablePtr, customerId, customerPtr);
+    status = TMMAP_INSERT(getCustomerTable(managerPtr, customerId),
+                          customerId, customerPtr);
     if (status == false) {
       //_ITM_abortTransaction(2);
       return false;
@@ -292,20 +345,21 @@ __attribute__((transaction_safe)) bool
 manager_deleteCustomer (  manager_t* managerPtr, long customerId)
 {
     customer_t* customerPtr;
-    MAP_T* reservationTables[NUM_RESERVATION_TYPE];
-    list_t* reservationInfoListPtr;
-    list_iter_t it;
+    MAP_T** reservationTables[NUM_RESERVATION_TYPE];
+    reservation_info_list_t* reservationInfoListPtr;
+    reservation_info_list_iter_t it;
     bool status;
 
-    customerPtr = (customer_t*)TMMAP_FIND(managerPtr->customerTablePtr, customerId);
+    customerPtr =
+        (customer_t*)TMMAP_FIND(getCustomerTable(managerPtr, customerId), customerId);
     if (customerPtr == NULL) {
       //return FALSE;
       return true;
     }
 
-    reservationTables[RESERVATION_CAR] = managerPtr->carTablePtr;
-    reservationTables[RESERVATION_ROOM] = managerPtr->roomTablePtr;
-    reservationTables[RESERVATION_FLIGHT] = managerPtr->flightTablePtr;
+    reservationTables[RESERVATION_CAR] = managerPtr->carTables;
+    reservationTables[RESERVATION_ROOM] = managerPtr->roomTables;
+    reservationTables[RESERVATION_FLIGHT] = managerPtr->flightTables;
 
     /* Cancel this customer's reservations */
     reservationInfoListPtr = customerPtr->reservationInfoListPtr;
@@ -313,9 +367,11 @@ manager_deleteCustomer (  manager_t* managerPtr, long customerId)
     while (TMLIST_ITER_HASNEXT(&it)) {
       reservation_info_t* reservationInfoPtr =
         (reservation_info_t*)TMLIST_ITER_NEXT(&it);
+      MAP_T* tablePtr = manager_getTable(managerPtr,
+                                         reservationTables[reservationInfoPtr->type],
+                                         reservationInfoPtr->id);
       reservation_t* reservationPtr =
-        (reservation_t*)TMMAP_FIND(reservationTables[reservationInfoPtr->type],
-                                   reservationInfoPtr->id);
+        (reservation_t*)TMMAP_FIND(tablePtr, reservationInfoPtr->id);
       if (reservationPtr == NULL) {
         //_ITM_abortTransaction(2);
         return false;
@@ -329,7 +385,7 @@ manager_deleteCustomer (  manager_t* managerPtr, long customerId)
       delete reservationInfoPtr;
     }
 
-    status = TMMAP_REMOVE(managerPtr->customerTablePtr, customerId);
+    status = TMMAP_REMOVE(getCustomerTable(managerPtr, customerId), customerId);
     if (status == false) {
       //_ITM_abortTransaction(2);
       return false;
@@ -395,7 +451,7 @@ queryPrice (  MAP_T* tablePtr, long id)
 __attribute__((transaction_safe)) long
 manager_queryCar (manager_t* managerPtr, long carId)
 {
-    return queryNumFree(managerPtr->carTablePtr, carId);
+    return queryNumFree(getCarTable(managerPtr, carId), carId);
 }
 
 
@@ -408,7 +464,7 @@ manager_queryCar (manager_t* managerPtr, long carId)
 __attribute__((transaction_safe)) long
 manager_queryCarPrice (manager_t* managerPtr, long carId)
 {
-    return queryPrice(managerPtr->carTablePtr, carId);
+    return queryPrice(getCarTable(managerPtr, carId), carId);
 }
 
 
@@ -421,7 +477,7 @@ manager_queryCarPrice (manager_t* managerPtr, long carId)
 __attribute__((transaction_safe)) long
 manager_queryRoom (  manager_t* managerPtr, long roomId)
 {
-    return queryNumFree(  managerPtr->roomTablePtr, roomId);
+    return queryNumFree(  getRoomTable(managerPtr, roomId), roomId);
 }
 
 
@@ -434,7 +490,7 @@ manager_queryRoom (  manager_t* managerPtr, long roomId)
 __attribute__((transaction_safe)) long
 manager_queryRoomPrice (  manager_t* managerPtr, long roomId)
 {
-    return queryPrice(  managerPtr->roomTablePtr, roomId);
+    return queryPrice(  getRoomTable(managerPtr, roomId), roomId);
 }
 
 
@@ -447,7 +503,7 @@ manager_queryRoomPrice (  manager_t* managerPtr, long roomId)
 __attribute__((transaction_safe)) long
 manager_queryFlight (  manager_t* managerPtr, long flightId)
 {
-    return queryNumFree(  managerPtr->flightTablePtr, flightId);
+    return queryNumFree(  getFlightTable(managerPtr, flightId), flightId);
 }
 
 
@@ -460,7 +516,7 @@ manager_queryFlight (  manager_t* managerPtr, long flightId)
 __attribute__((transaction_safe)) long
 manager_queryFlightPrice (  manager_t* managerPtr, long flightId)
 {
-    return queryPrice(  managerPtr->flightTablePtr, flightId);
+    return queryPrice(  getFlightTable(managerPtr, flightId), flightId);
 }
 
 
@@ -476,7 +532,8 @@ manager_queryCustomerBill (  manager_t* managerPtr, long customerId)
     long bill = -1;
     customer_t* customerPtr;
 
-    customerPtr = (customer_t*)TMMAP_FIND(managerPtr->customerTablePtr, customerId);
+    customerPtr =
+        (customer_t*)TMMAP_FIND(getCustomerTable(managerPtr, customerId), customerId);
 
     if (customerPtr != NULL) {
         bill = customer_getBill(customerPtr);
@@ -549,8 +606,8 @@ reserve (MAP_T* tablePtr, MAP_T* customerTablePtr,
 __attribute__((transaction_safe)) bool
 manager_reserveCar (  manager_t* managerPtr, long customerId, long carId)
 {
-    return reserve(managerPtr->carTablePtr,
-                   managerPtr->customerTablePtr,
+    return reserve(getCarTable(managerPtr, carId),
+                   getCustomerTable(managerPtr, customerId),
                    customerId,
                    carId,
                    RESERVATION_CAR);
@@ -566,8 +623,8 @@ manager_reserveCar (  manager_t* managerPtr, long customerId, long carId)
 __attribute__((transaction_safe)) bool
 manager_reserveRoom (  manager_t* managerPtr, long customerId, long roomId)
 {
-    return reserve(managerPtr->roomTablePtr,
-                   managerPtr->customerTablePtr,
+    return reserve(getRoomTable(managerPtr, roomId),
+                   getCustomerTable(managerPtr, customerId),
                    customerId,
                    roomId,
                    RESERVATION_ROOM);
@@ -583,8 +640,8 @@ manager_reserveRoom (  manager_t* managerPtr, long customerId, long roomId)
 __attribute__((transaction_safe)) bool
 manager_reserveFlight (manager_t* managerPtr, long customerId, long flightId)
 {
-    return reserve(managerPtr->flightTablePtr,
-                   managerPtr->customerTablePtr,
+    return reserve(getFlightTable(managerPtr, flightId),
+                   getCustomerTable(managerPtr, customerId),
                    customerId,
                    flightId,
                    RESERVATION_FLIGHT);
@@ -643,8 +700,8 @@ cancel (MAP_T* tablePtr, MAP_T* customerTablePtr,
 __attribute__((transaction_safe)) bool
 manager_cancelCar (  manager_t* managerPtr, long customerId, long carId)
 {
-    return cancel(managerPtr->carTablePtr,
-                  managerPtr->customerTablePtr,
+    return cancel(getCarTable(managerPtr, carId),
+                  getCustomerTable(managerPtr, customerId),
                   customerId,
                   carId,
                   RESERVATION_CAR);
@@ -660,8 +717,8 @@ manager_cancelCar (  manager_t* managerPtr, long customerId, long carId)
 __attribute__((transaction_safe)) bool
 manager_cancelRoom (  manager_t* managerPtr, long customerId, long roomId)
 {
-    return cancel(managerPtr->roomTablePtr,
-                  managerPtr->customerTablePtr,
+    return cancel(getRoomTable(managerPtr, roomId),
+                  getCustomerTable(managerPtr, customerId),
                   customerId,
                   roomId,
                   RESERVATION_ROOM);
@@ -678,8 +735,8 @@ manager_cancelRoom (  manager_t* managerPtr, long customerId, long roomId)
 __attribute__((transaction_safe)) bool
 manager_cancelFlight (manager_t* managerPtr, long customerId, long flightId)
 {
-    return cancel(managerPtr->flightTablePtr,
-                  managerPtr->customerTablePtr,
+    return cancel(getFlightTable(managerPtr, flightId),
+                  getCustomerTable(managerPtr, customerId),
                   customerId,
                   flightId,
                   RESERVATION_FLIGHT);
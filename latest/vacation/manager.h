@@ -10,16 +10,49 @@
 
 #include "map.h"
 
+/*
+ * Each table is split into numShard independent maps; an id lives in the
+ * shard chosen by manager_getTable.  Transactions on ids in different
+ * shards then never touch the same map, e.g., the same top nodes of a
+ * tree.
+ */
 struct manager_t {
-    MAP_T* carTablePtr;
-    MAP_T* roomTablePtr;
-    MAP_T* flightTablePtr;
-    MAP_T* customerTablePtr;
+    long numShard;
+    MAP_T** carTables;
+    MAP_T** roomTables;
+    MAP_T** flightTables;
+    MAP_T** customerTables;
 
-    manager_t();
+    explicit manager_t(long numShard = 1);
     ~manager_t();
 };
 
+/* =============================================================================
+ * manager_getShard
+ * -- Returns the index of the shard that holds id, the same in every table
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+inline long
+manager_getShard (manager_t* managerPtr, long id)
+{
+    unsigned long hash = (unsigned long)id * 0x9e3779b97f4a7c15UL;
+
+    return (long)((hash >> 32) % (unsigned long)managerPtr->numShard);
+}
+
+/* =============================================================================
+ * manager_getTable
+ * -- Returns the shard of tables (e.g., managerPtr->carTables) that holds id
+ * =============================================================================
+ */
+__attribute__((transaction_safe))
+inline MAP_T*
+manager_getTable (manager_t* managerPtr, MAP_T** tables, long id)
+{
+    return tables[manager_getShard(managerPtr, id)];
+}
+
 /* =============================================================================
  * ADMINISTRATIVE INTERFACE
  * =============================================================================
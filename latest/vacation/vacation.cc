@@ -6,9 +6,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <getopt.h>
-#include <random>
 #include "client.h"
 #include "customer.h"
+#include "distribution.h"
+#include "histogram.h"
 #include "list.h"
 #include "manager.h"
 #include "map.h"
@@ -18,6 +19,7 @@
 #include "timer.h"
 #include "utility.h"
 #include "thread.h"
+#include "tmretry.h"
 
 enum param_types {
     PARAM_CLIENTS      = (unsigned char)'t',
@@ -25,7 +27,15 @@ enum param_types {
     PARAM_QUERIES      = (unsigned char)'q',
     PARAM_RELATIONS    = (unsigned char)'r',
     PARAM_TRANSACTIONS = (unsigned char)'T',
-    PARAM_USER         = (unsigned char)'u'
+    PARAM_USER         = (unsigned char)'u',
+    PARAM_RATE         = (unsigned char)'R',
+    PARAM_DURATION     = (unsigned char)'D',
+    PARAM_CONSTANT     = (unsigned char)'C',
+    PARAM_ZIPF         = (unsigned char)'Z',
+    PARAM_HOT          = (unsigned char)'H',
+    PARAM_HOTKEYS      = (unsigned char)'K',
+    PARAM_MOVE         = (unsigned char)'M',
+    PARAM_SHARDS       = (unsigned char)'S'
 };
 
 #define PARAM_DEFAULT_CLIENTS      (1)
@@ -34,6 +44,13 @@ enum param_types {
 #define PARAM_DEFAULT_RELATIONS    (1 << 20)
 #define PARAM_DEFAULT_TRANSACTIONS (1 << 22)
 #define PARAM_DEFAULT_USER         (90)
+#define PARAM_DEFAULT_RATE         (0)
+#define PARAM_DEFAULT_DURATION     (0)
+#define PARAM_DEFAULT_ZIPF         (0)
+#define PARAM_DEFAULT_HOT          (0)
+#define PARAM_DEFAULT_HOTKEYS      (10)
+#define PARAM_DEFAULT_MOVE         (0)
+#define PARAM_DEFAULT_SHARDS       (1)
 
 double global_params[256]; /* 256 = ascii limit */
 
@@ -60,6 +77,21 @@ displayUsage (const char* appName)
            PARAM_DEFAULT_TRANSACTIONS);
     printf("    u <UINT>   Percentage of [u]ser transactions     (%i)\n",
            PARAM_DEFAULT_USER);
+    printf("    R <FLT>    Open loop at this [R]ate, txn/s total (%i = closed loop)\n",
+           PARAM_DEFAULT_RATE);
+    puts("    C          Open loop with [C]onstant gaps        (Poisson)");
+    printf("    D <FLT>    Run for [D]uration seconds, not -T    (%i = off)\n",
+           PARAM_DEFAULT_DURATION);
+    printf("    Z <FLT>    [Z]ipf exponent of item ids           (%i = uniform)\n",
+           PARAM_DEFAULT_ZIPF);
+    printf("    H <FLT>    Percentage of item ids chosen [H]ot   (%i = uniform)\n",
+           PARAM_DEFAULT_HOT);
+    printf("    K <FLT>    Percentage of item ids that are hot   (%i)\n",
+           PARAM_DEFAULT_HOTKEYS);
+    printf("    M <FLT>    [M]ove the hot ids every M ms         (%i = fixed)\n",
+           PARAM_DEFAULT_MOVE);
+    printf("    S <UINT>   Number of [S]hards per table          (%i)\n",
+           PARAM_DEFAULT_SHARDS);
     exit(1);
 }
 
@@ -77,6 +109,14 @@ setDefaultParams ()
     global_params[PARAM_RELATIONS]    = PARAM_DEFAULT_RELATIONS;
     global_params[PARAM_TRANSACTIONS] = PARAM_DEFAULT_TRANSACTIONS;
     global_params[PARAM_USER]         = PARAM_DEFAULT_USER;
+    global_params[PARAM_RATE]         = PARAM_DEFAULT_RATE;
+    global_params[PARAM_DURATION]     = PARAM_DEFAULT_DURATION;
+    global_params[PARAM_CONSTANT]     = 0;
+    global_params[PARAM_ZIPF]         = PARAM_DEFAULT_ZIPF;
+    global_params[PARAM_HOT]          = PARAM_DEFAULT_HOT;
+    global_params[PARAM_HOTKEYS]      = PARAM_DEFAULT_HOTKEYS;
+    global_params[PARAM_MOVE]         = PARAM_DEFAULT_MOVE;
+    global_params[PARAM_SHARDS]       = PARAM_DEFAULT_SHARDS;
 }
 
 
@@ -94,7 +134,7 @@ parseArgs (long argc, char* const argv[])
 
     setDefaultParams();
 
-    while ((opt = getopt(argc, argv, "t:n:q:r:T:u:L")) != -1) {
+    while ((opt = getopt(argc, argv, "t:n:q:r:T:u:LR:D:CZ:H:K:M:S:")) != -1) {
         switch (opt) {
             case 'T':
             case 'n':
@@ -102,8 +142,20 @@ parseArgs (long argc, char* const argv[])
             case 'r':
             case 't':
             case 'u':
+            case 'S':
                 global_params[(unsigned char)opt] = atol(optarg);
                 break;
+            case 'R':
+            case 'D':
+            case 'Z':
+            case 'H':
+            case 'K':
+            case 'M':
+                global_params[(unsigned char)opt] = atof(optarg);
+                break;
+            case 'C':
+                global_params[PARAM_CONSTANT] = 1;
+                break;
             case 'L':
                 global_params[PARAM_NUMBER] = 2;
                 global_params[PARAM_QUERIES] = 90;
@@ -121,84 +173,211 @@ parseArgs (long argc, char* const argv[])
         opterr++;
     }
 
+    if (global_params[PARAM_ZIPF] > 0.0 && global_params[PARAM_HOT] > 0.0) {
+        fprintf(stderr, "Choose either -Z or -H\n");
+        opterr++;
+    }
+
+    if (global_params[PARAM_MOVE] > 0.0 &&
+        !(global_params[PARAM_ZIPF] > 0.0 || global_params[PARAM_HOT] > 0.0))
+    {
+        fprintf(stderr, "-M needs -Z or -H\n");
+        opterr++;
+    }
+
+    if (global_params[PARAM_SHARDS] < 1) {
+        fprintf(stderr, "Need at least one shard\n");
+        opterr++;
+    }
+
     if (opterr) {
         displayUsage(argv[0]);
     }
 }
 
 
+/*
+ * The tables are loaded in parallel: each thread builds the rows for an
+ * equal range of ids, laid out shard by shard and in id order within a
+ * shard, and then each shard of each table is built from its sorted rows
+ * in one pass.
+ */
+enum load_table_t {
+    LOAD_CAR,
+    LOAD_FLIGHT,
+    LOAD_ROOM,
+    LOAD_CUSTOMER,
+    NUM_LOAD_TABLE
+};
+
+struct load_t {
+    manager_t* managerPtr;
+    long numRelation;
+    long* positions;              /* [thread][shard]: count, then next slot */
+    long* shardStarts;            /* [shard]: first slot, plus one for the end */
+    long* ids;                    /* [slot] */
+    void** rows[NUM_LOAD_TABLE];  /* [table][slot] */
+};
+
+
+/* =============================================================================
+ * getRowRandom
+ * -- splitmix64 of the table and id, so the rows do not depend on how many
+ *    threads build them
+ * =============================================================================
+ */
+static unsigned long
+getRowRandom (long t, long id)
+{
+    unsigned long x =
+        (unsigned long)(id * NUM_LOAD_TABLE + t + 1) * 0x9e3779b97f4a7c15UL;
+
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9UL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebUL;
+
+    return (x ^ (x >> 31));
+}
+
+
 /* =============================================================================
- * addCustomer
- * -- Wrapper function
+ * loadTables
+ * -- Run by every thread
  * =============================================================================
  */
-static bool
-addCustomer (manager_t* managerPtr, long id, long, long)
+static void
+loadTables (void* argPtr)
 {
-    return manager_addCustomer(managerPtr, id);
+    load_t* loadPtr = (load_t*)argPtr;
+    manager_t* managerPtr = loadPtr->managerPtr;
+    long numShard = managerPtr->numShard;
+    long numRelation = loadPtr->numRelation;
+    long myId = thread_getId();
+    long numThread = thread_getNumThread();
+    long* myPositions = &loadPtr->positions[myId * numShard];
+    long minId = numRelation * myId / numThread + 1;
+    long maxId = numRelation * (myId + 1) / numThread;
+    long id;
+    long s;
+    long t;
+
+    /* Count my ids in each shard */
+    for (s = 0; s < numShard; s++) {
+        myPositions[s] = 0;
+    }
+    for (id = minId; id <= maxId; id++) {
+        myPositions[manager_getShard(managerPtr, id)]++;
+    }
+    thread_barrier_wait();
+
+    /* Slots go shard by shard, then thread by thread, so ids stay in order */
+    if (myId == 0) {
+        long numSlot = 0;
+        for (s = 0; s < numShard; s++) {
+            loadPtr->shardStarts[s] = numSlot;
+            for (t = 0; t < numThread; t++) {
+                long numId = loadPtr->positions[t * numShard + s];
+                loadPtr->positions[t * numShard + s] = numSlot;
+                numSlot += numId;
+            }
+        }
+        loadPtr->shardStarts[numShard] = numSlot;
+        assert(numSlot == numRelation);
+    }
+    thread_barrier_wait();
+
+    /* Build the rows for my ids */
+    for (id = minId; id <= maxId; id++) {
+        long slot = myPositions[manager_getShard(managerPtr, id)]++;
+        loadPtr->ids[slot] = id;
+        for (t = 0; t < LOAD_CUSTOMER; t++) {
+            unsigned long r = getRowRandom(t, id);
+            long num = ((r % 5) + 1) * 100;
+            long price = (((r >> 32) % 5) * 10) + 50;
+            bool success;
+            loadPtr->rows[t][slot] = new reservation_t(id, num, price, &success);
+            assert(success);
+        }
+        loadPtr->rows[LOAD_CUSTOMER][slot] = new customer_t(id);
+    }
+    thread_barrier_wait();
+
+    /* Build the maps, one (table, shard) at a time */
+    MAP_T** tables[NUM_LOAD_TABLE] = {
+        managerPtr->carTables,
+        managerPtr->flightTables,
+        managerPtr->roomTables,
+        managerPtr->customerTables
+    };
+    for (long w = myId; w < NUM_LOAD_TABLE * numShard; w += numThread) {
+        t = w / numShard;
+        s = w % numShard;
+        MAP_T* tablePtr = tables[t][s];
+        long start = loadPtr->shardStarts[s];
+        long numRow = loadPtr->shardStarts[s + 1] - start;
+        long* ids = &loadPtr->ids[start];
+        void** rows = &loadPtr->rows[t][start];
+        bool status;
+#ifdef MAP_BULKLOAD
+        status = MAP_BULKLOAD(tablePtr, ids, rows, numRow);
+#else
+        status = true;
+        for (long i = 0; i < numRow && status; i++) {
+            status = MAP_INSERT(tablePtr, ids[i], rows[i]);
+        }
+#endif
+        assert(status);
+    }
 }
 
 
 /* =============================================================================
  * initializeManager
+ * -- Call after thread_startup()
  * =============================================================================
  */
 static manager_t*
 initializeManager ()
 {
     manager_t* managerPtr;
-    long i;
-    long numRelation;
-    std::mt19937 randomPtr;
-    long* ids;
-    bool (*manager_add[])(manager_t*, long, long, long) = {
-        &manager_addCar,
-        &manager_addFlight,
-        &manager_addRoom,
-        &addCustomer
-    };
+    load_t load;
+    long numThread = (long)global_params[PARAM_CLIENTS];
+    long numShard = (long)global_params[PARAM_SHARDS];
+    long numRelation = (long)global_params[PARAM_RELATIONS];
     long t;
-    long numTable = sizeof(manager_add) / sizeof(manager_add[0]);
+    TIMER_T start;
+    TIMER_T stop;
 
     printf("Initializing manager... ");
     fflush(stdout);
 
-    managerPtr = new manager_t();
+    managerPtr = new manager_t(numShard);
     assert(managerPtr != NULL);
 
-    numRelation = (long)global_params[PARAM_RELATIONS];
-    ids = (long*)malloc(numRelation * sizeof(long));
-    for (i = 0; i < numRelation; i++) {
-        ids[i] = i + 1;
+    load.managerPtr = managerPtr;
+    load.numRelation = numRelation;
+    load.positions = (long*)malloc(numThread * numShard * sizeof(long));
+    load.shardStarts = (long*)malloc((numShard + 1) * sizeof(long));
+    load.ids = (long*)malloc(numRelation * sizeof(long));
+    assert(load.positions && load.shardStarts && load.ids);
+    for (t = 0; t < NUM_LOAD_TABLE; t++) {
+        load.rows[t] = (void**)malloc(numRelation * sizeof(void*));
+        assert(load.rows[t] != NULL);
     }
 
-    for (t = 0; t < numTable; t++) {
-
-        /* Shuffle ids */
-        for (i = 0; i < numRelation; i++) {
-            long x = randomPtr() % numRelation;
-            long y = randomPtr() % numRelation;
-            long tmp = ids[x];
-            ids[x] = ids[y];
-            ids[y] = tmp;
-        }
-
-        /* Populate table */
-        for (i = 0; i < numRelation; i++) {
-            bool status;
-            long id = ids[i];
-            long num = ((randomPtr() % 5) + 1) * 100;
-            long price = ((randomPtr() % 5) * 10) + 50;
-            status = manager_add[t](managerPtr, id, num, price);
-            assert(status);
-        }
-
-    } /* for t */
+    TIMER_READ(start);
+    thread_start(loadTables, (void*)&load);
+    TIMER_READ(stop);
 
     puts("done.");
+    printf("Load time = %0.6lf\n", TIMER_DIFF_SECONDS(start, stop));
     fflush(stdout);
 
-    free(ids);
+    for (t = 0; t < NUM_LOAD_TABLE; t++) {
+        free(load.rows[t]);
+    }
+    free(load.ids);
+    free(load.shardStarts);
+    free(load.positions);
 
     return managerPtr;
 }
@@ -221,6 +400,10 @@ initializeClients (manager_t* managerPtr)
     long percentQuery = (long)global_params[PARAM_QUERIES];
     long queryRange;
     long percentUser = (long)global_params[PARAM_USER];
+    double rate = global_params[PARAM_RATE];
+    bool isConstantArrival = (global_params[PARAM_CONSTANT] != 0);
+    double duration = global_params[PARAM_DURATION];
+    distribution_t* distributionPtr;
 
     printf("Initializing clients... ");
     fflush(stdout);
@@ -229,6 +412,12 @@ initializeClients (manager_t* managerPtr)
     assert(clients != NULL);
     numTransactionPerClient = (long)((double)numTransaction / (double)numClient + 0.5);
     queryRange = (long)((double)percentQuery / 100.0 * (double)numRelation + 0.5);
+    distributionPtr = new distribution_t(queryRange,
+                                         global_params[PARAM_ZIPF],
+                                         global_params[PARAM_HOT],
+                                         global_params[PARAM_HOTKEYS],
+                                         global_params[PARAM_MOVE]);
+    assert(distributionPtr != NULL);
 
     for (i = 0; i < numClient; i++) {
         clients[i] = new client_t(i,
@@ -236,7 +425,11 @@ initializeClients (manager_t* managerPtr)
                                   numTransactionPerClient,
                                   numQueryPerTransaction,
                                   queryRange,
-                                  percentUser);
+                                  percentUser,
+                                  distributionPtr,
+                                  rate / numClient,
+                                  isConstantArrival,
+                                  duration);
         assert(clients[i]  != NULL);
     }
 
@@ -246,9 +439,20 @@ initializeClients (manager_t* managerPtr)
     printf("    Transactions/client = %li\n", numTransactionPerClient);
     printf("    Queries/transaction = %li\n", numQueryPerTransaction);
     printf("    Relations           = %li\n", numRelation);
+    printf("    Shards/table        = %li\n", managerPtr->numShard);
     printf("    Query percent       = %li\n", percentQuery);
     printf("    Query range         = %li\n", queryRange);
     printf("    Percent user        = %li\n", percentUser);
+    printf("    Item ids            = ");
+    distribution_print(distributionPtr);
+    puts("");
+    if (rate > 0.0) {
+        printf("    Offered rate        = %0.1lf txn/s, %s\n",
+               rate, (isConstantArrival ? "constant" : "Poisson"));
+    }
+    if (duration > 0.0) {
+        printf("    Duration            = %0.3lf s\n", duration);
+    }
     fflush(stdout);
 
     return clients;
@@ -258,6 +462,8 @@ initializeClients (manager_t* managerPtr)
  * checkTables
  * -- some simple checks (not comprehensive)
  * -- dependent on tasks generated for clients in initializeClients()
+ * -- Runs once, after the timed run, so it can afford to look each id up
+ *    in every shard
  * =============================================================================
  */
 static void
@@ -265,11 +471,12 @@ checkTables (manager_t* managerPtr)
 {
     long i;
     long numRelation = (long)global_params[PARAM_RELATIONS];
-    MAP_T* customerTablePtr = managerPtr->customerTablePtr;
-    MAP_T* tables[] = {
-        managerPtr->carTablePtr,
-        managerPtr->flightTablePtr,
-        managerPtr->roomTablePtr,
+    long numShard = managerPtr->numShard;
+    MAP_T** customerTables = managerPtr->customerTables;
+    MAP_T** tables[] = {
+        managerPtr->carTables,
+        managerPtr->flightTables,
+        managerPtr->roomTables,
     };
     long numTable = sizeof(tables) / sizeof(tables[0]);
     bool (*manager_add[])(manager_t*, long, long, long) = {
@@ -278,15 +485,21 @@ checkTables (manager_t* managerPtr)
         &manager_addRoom
     };
     long t;
+    long s;
 
     printf("Checking tables... ");
     fflush(stdout);
 
-    /* Check for unique customer IDs */
+    /* Check for unique customer IDs, each in its own shard only */
     long percentQuery = (long)global_params[PARAM_QUERIES];
     long queryRange = (long)((double)percentQuery / 100.0 * (double)numRelation + 0.5);
     long maxCustomerId = queryRange + 1;
     for (i = 1; i <= maxCustomerId; i++) {
+        MAP_T* customerTablePtr = manager_getTable(managerPtr, customerTables, i);
+        for (s = 0; s < numShard; s++) {
+            assert(customerTables[s] == customerTablePtr ||
+                   !MAP_FIND(customerTables[s], i));
+        }
         if (MAP_FIND(customerTablePtr, i)) {
             if (MAP_REMOVE(customerTablePtr, i)) {
                 assert(!MAP_FIND(customerTablePtr, i));
@@ -296,8 +509,11 @@ checkTables (manager_t* managerPtr)
 
     /* Check reservation tables for consistency and unique ids */
     for (t = 0; t < numTable; t++) {
-        MAP_T* tablePtr = tables[t];
         for (i = 1; i <= numRelation; i++) {
+            MAP_T* tablePtr = manager_getTable(managerPtr, tables[t], i);
+            for (s = 0; s < numShard; s++) {
+                assert(tables[t][s] == tablePtr || !MAP_FIND(tables[t][s], i));
+            }
             if (MAP_FIND(tablePtr, i)) {
                 assert(manager_add[t](managerPtr, i, 0, 0)); /* validate entry */
                 if (MAP_REMOVE(tablePtr, i)) {
@@ -311,6 +527,83 @@ checkTables (manager_t* managerPtr)
     fflush(stdout);
 }
 
+/* =============================================================================
+ * printRate
+ * -- Prints the transactions completed per second and, in open loop, the
+ *    rate that was offered
+ * =============================================================================
+ */
+static void
+printRate (client_t** clients, double seconds)
+{
+    long numClient = (long)global_params[PARAM_CLIENTS];
+    double rate = global_params[PARAM_RATE];
+    unsigned long numTransaction = 0;
+
+    for (long i = 0; i < numClient; i++) {
+        for (long a = 0; a < NUM_ACTION; a++) {
+            numTransaction += clients[i]->latencyPtrs[a]->count;
+        }
+    }
+
+    double achieved = numTransaction / seconds;
+    printf("Achieved rate = %0.1lf txn/s\n", achieved);
+    if (rate > 0.0) {
+        printf("Offered rate = %0.1lf txn/s (achieved %0.1lf%%)\n",
+               rate, 100.0 * achieved / rate);
+    }
+}
+
+
+/* =============================================================================
+ * printLatency
+ * -- Merges the clients' histograms and prints, per action, the latency
+ *    percentiles in microseconds and the attempts begun per commit
+ * =============================================================================
+ */
+static void
+printLatency (client_t** clients)
+{
+    long numClient = (long)global_params[PARAM_CLIENTS];
+    const char* actionNames[NUM_ACTION] = {
+        "make_reservation",
+        "delete_customer",
+        "update_tables"
+    };
+
+    histogram_t* totalPtr = histogram_alloc();
+    assert(totalPtr != NULL);
+
+    puts("\nLatency per action (us)");
+    printf("%-18s %9s %9s %9s %9s %9s %9s %13s\n",
+           "Action", "Count", "Mean", "p50", "p99", "p99.9", "Max",
+           "Attempts/txn");
+
+    for (long a = 0; a < NUM_ACTION; a++) {
+        unsigned long numStart = 0;
+        histogram_clear(totalPtr);
+        for (long i = 0; i < numClient; i++) {
+            histogram_merge(totalPtr, clients[i]->latencyPtrs[a]);
+            numStart += clients[i]->numStarts[a];
+        }
+        if (totalPtr->count == 0) {
+            continue;
+        }
+        printf("%-18s %9lu %9.2f %9.2f %9.2f %9.2f %9.2f %13.4f\n",
+               actionNames[a],
+               totalPtr->count,
+               histogram_getMean(totalPtr) / 1000.0,
+               histogram_getPercentile(totalPtr, 50.0) / 1000.0,
+               histogram_getPercentile(totalPtr, 99.0) / 1000.0,
+               histogram_getPercentile(totalPtr, 99.9) / 1000.0,
+               totalPtr->max / 1000.0,
+               (double)numStart / totalPtr->count);
+    }
+
+    histogram_free(totalPtr);
+}
+
+
 /* =============================================================================
  * freeClients
  * =============================================================================
@@ -320,6 +613,7 @@ freeClients (client_t** clients)
 {
     long numClient = (long)global_params[PARAM_CLIENTS];
 
+    delete clients[0]->distributionPtr; /* shared */
     for (long i = 0; i < numClient; i++) {
         client_t* clientPtr = clients[i];
         delete clientPtr;
@@ -340,12 +634,12 @@ int main (int argc, char** argv)
 
     /* Initialization */
     parseArgs(argc, (char** const)argv);
+    long numThread = global_params[PARAM_CLIENTS];
+    thread_startup(numThread);
     managerPtr = initializeManager();
     assert(managerPtr != NULL);
     clients = initializeClients(managerPtr);
     assert(clients != NULL);
-    long numThread = global_params[PARAM_CLIENTS];
-    thread_startup(numThread);
 
     /* Run transactions */
     printf("Running clients... ");
@@ -356,6 +650,9 @@ int main (int argc, char** argv)
     puts("done.");
     printf("Time = %0.6lf\n",
            TIMER_DIFF_SECONDS(start, stop));
+    printRate(clients, TIMER_DIFF_SECONDS(start, stop));
+    tm_retry_print();
+    printLatency(clients);
     fflush(stdout);
     checkTables(managerPtr);
 
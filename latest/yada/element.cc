@@ -76,6 +76,7 @@
 #include <stdlib.h>
 #include "coordinate.h"
 #include "element.h"
+#include "memory.h"
 #include "pair.h"
 #include "tm_transition.h"
 
@@ -372,7 +373,7 @@ TMelement_alloc (  coordinate_t* coordinates, long numCoordinate)
 {
     element_t* elementPtr;
 
-    elementPtr = (element_t*)malloc(sizeof(element_t));
+    elementPtr = (element_t*)memory_alloc(sizeof(element_t));
     if (elementPtr) {
         long i;
         for (i = 0; i < numCoordinate; i++) {
@@ -383,7 +384,7 @@ TMelement_alloc (  coordinate_t* coordinates, long numCoordinate)
         checkAngles(elementPtr);
         calculateCircumCircle(elementPtr);
         initEdges(elementPtr, numCoordinate);
-        elementPtr->neighborListPtr = TMLIST_ALLOC(element_listCompare);
+        elementPtr->neighborListPtr = ELEMENT_LIST_ALLOC();
         assert(elementPtr->neighborListPtr);
         elementPtr->isGarbage = false;
         elementPtr->isReferenced = false;
@@ -403,7 +404,7 @@ void
 TMelement_free (  element_t* elementPtr)
 {
     TMLIST_FREE(elementPtr->neighborListPtr);
-    free(elementPtr);
+    memory_free(elementPtr);
 }
 
 
@@ -490,32 +491,17 @@ element_mapCompareEdge (const pair_t* aPtr, const pair_t* bPtr)
 
 
 /* =============================================================================
- * element_heapCompare
+ * element_getHeapKey
  *
- * For use in heap_t. Consider using minAngle instead of "do not care".
+ * For use in heap_t: encroached elements first. Consider using minAngle
+ * to order the rest, which are "do not care".
  * =============================================================================
  */
-//[wer] should be a __attribute__((transaction_safe)) comparator
 __attribute__((transaction_safe))
 long
-element_heapCompare (const void* aPtr, const void* bPtr)
+element_getHeapKey (element_t* elementPtr)
 {
-    element_t* aElementPtr = (element_t*)aPtr;
-    element_t* bElementPtr = (element_t*)bPtr;
-
-    if (aElementPtr->encroachedEdgePtr) {
-        if (bElementPtr->encroachedEdgePtr) {
-            return 0; /* do not care */
-        } else {
-            return 1;
-        }
-    }
-
-    if (bElementPtr->encroachedEdgePtr) {
-        return -1;
-    }
-
-    return 0; /* do not care */
+    return ((elementPtr->encroachedEdgePtr != NULL) ? 1 : 0);
 }
 
 
@@ -655,7 +641,7 @@ __attribute__((transaction_safe))
 void
 TMelement_addNeighbor (element_t* elementPtr, element_t* neighborPtr)
 {
-    TMLIST_INSERT(elementPtr->neighborListPtr, (void*)neighborPtr);
+    TMLIST_INSERT(elementPtr->neighborListPtr, neighborPtr);
 }
 
 
@@ -664,7 +650,7 @@ TMelement_addNeighbor (element_t* elementPtr, element_t* neighborPtr)
  * =============================================================================
  */
 __attribute__((transaction_safe))
-list_t*
+element_list_t*
 element_getNeighborListPtr (element_t* elementPtr)
 {
     return elementPtr->neighborListPtr;
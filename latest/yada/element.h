@@ -73,8 +73,49 @@
 #include "coordinate.h"
 #include "list.h"
 #include "pair.h"
+#include "smalllist.h"
 
 typedef pair_t         edge_t;
+struct element_t;
+
+#ifdef USE_TM_TEMPLATES
+#  include "tmlist.h"
+
+__attribute__((transaction_safe))
+long
+element_compare (element_t* aElementPtr, element_t* bElementPtr);
+
+__attribute__((transaction_safe))
+long
+element_listCompareEdge (const void* aPtr, const void* bPtr);
+
+struct element_list_cmp {
+    __attribute__((transaction_safe))
+    long operator() (element_t* aPtr, element_t* bPtr) const {
+        return element_compare(aPtr, bPtr);
+    }
+};
+struct element_edge_list_cmp {
+    __attribute__((transaction_safe))
+    long operator() (edge_t* aPtr, edge_t* bPtr) const {
+        return element_listCompareEdge(aPtr, bPtr);
+    }
+};
+typedef tmlib::list<element_t*, element_list_cmp> element_list_t;
+typedef tmlib::list<edge_t*, element_edge_list_cmp> element_edge_list_t;
+typedef element_list_t::iter_t element_list_iter_t;
+typedef element_edge_list_t::iter_t element_edge_list_iter_t;
+#  define ELEMENT_LIST_ALLOC()          element_list_t::alloc()
+#  define ELEMENT_EDGE_LIST_ALLOC()     element_edge_list_t::alloc()
+#else
+typedef smalllist_t element_list_t;
+typedef smalllist_t element_edge_list_t;
+typedef smalllist_iter_t element_list_iter_t;
+typedef smalllist_iter_t element_edge_list_iter_t;
+#  define ELEMENT_LIST_ALLOC()          TMSMALLLIST_ALLOC(&element_listCompare)
+#  define ELEMENT_EDGE_LIST_ALLOC()     TMSMALLLIST_ALLOC(&element_listCompareEdge)
+#endif
+
 struct element_t {
     coordinate_t coordinates[3];
     long numCoordinate;
@@ -87,7 +128,7 @@ struct element_t {
     double radii[3];           /* half of edge length */
     edge_t* encroachedEdgePtr; /* opposite obtuse angle */
     bool isSkinny;
-    list_t* neighborListPtr;
+    element_list_t* neighborListPtr;
     bool isGarbage;
     bool isReferenced;
 };
@@ -189,14 +230,14 @@ element_mapCompareEdge (const pair_t* aPtr, const pair_t* bPtr);
 
 
 /* =============================================================================
- * element_heapCompare
+ * element_getHeapKey
  *
- * For use in heap_t
+ * For use in heap_t and multiqueue_t: larger keys are refined first
  * =============================================================================
  */
 __attribute__((transaction_safe))
 long
-element_heapCompare (const void* aPtr, const void* bPtr);
+element_getHeapKey (element_t* elementPtr);
 
 
 /* =============================================================================
@@ -233,6 +274,7 @@ element_getEncroachedPtr (element_t* elementPtr);
  * element_isSkinny
  * =============================================================================
  */
+__attribute__((transaction_safe))
 bool
 element_isSkinny (element_t* elementPtr);
 
@@ -305,7 +347,7 @@ TMelement_addNeighbor (  element_t* elementPtr, element_t* neighborPtr);
  */
 //TM_PURE
 __attribute__((transaction_safe))
-list_t*
+element_list_t*
 element_getNeighborListPtr (element_t* elementPtr);
 
 
@@ -208,21 +208,16 @@ TMmesh_remove (mesh_t* meshPtr, element_t* elementPtr)
     /*
      * Remove from neighbors
      */
-    list_iter_t it;
+    element_list_iter_t it;
     //list_t* neighborListPtr = element_getNeighborListPtr(elementPtr);
-    list_t* neighborListPtr = elementPtr->neighborListPtr;
-    //TMLIST_ITER_RESET(&it, neighborListPtr);
-    it = &(neighborListPtr->head);
+    element_list_t* neighborListPtr = elementPtr->neighborListPtr;
+    TMLIST_ITER_RESET(&it, neighborListPtr);
 
-    while (it->nextPtr != NULL) {
-    //while (TMLIST_ITER_HASNEXT(&it)) {
-      //element_t* neighborPtr =
-      //      (element_t*)TMLIST_ITER_NEXT(&it, neighborListPtr);
-      it = it->nextPtr;
-      element_t * neighborPtr = (element_t*)it->dataPtr;
+    while (TMLIST_ITER_HASNEXT(&it)) {
+      element_t* neighborPtr = (element_t*)TMLIST_ITER_NEXT(&it);
 
       //list_t* neighborNeighborListPtr = element_getNeighborListPtr(neighborPtr);
-      list_t* neighborNeighborListPtr = neighborPtr->neighborListPtr;
+      element_list_t* neighborNeighborListPtr = neighborPtr->neighborListPtr;
         bool status = TMLIST_REMOVE(neighborNeighborListPtr, elementPtr);
         assert(status);
     }
@@ -471,8 +466,8 @@ mesh_check (mesh_t* meshPtr, long expectedNumElement)
     while (!queue_isEmpty(searchQueuePtr)) {
 
         element_t* currentElementPtr;
-        list_iter_t it;
-        list_t* neighborListPtr;
+        element_list_iter_t it;
+        element_list_t* neighborListPtr;
         bool isSuccess;
 
         currentElementPtr = (element_t*)queue_pop(searchQueuePtr);
@@ -83,8 +83,8 @@
 struct region_t {
     coordinate_t centerCoordinate;
     queue_t*     expandQueuePtr;
-    list_t*   beforeListPtr; /* before retriangulation; list to avoid duplicates */
-    list_t* borderListPtr; /* edges adjacent to region; list to avoid duplicates */
+    element_list_t* beforeListPtr; /* before retriangulation; list to avoid duplicates */
+    element_edge_list_t* borderListPtr; /* edges adjacent to region; list to avoid duplicates */
     vector_t*    badVectorPtr;
 };
 
@@ -126,10 +126,10 @@ Pregion_alloc ()
         assert(regionPtr->expandQueuePtr);
 
         //[wer210] note the following compare functions should be TM_SAFE...
-        regionPtr->beforeListPtr = TMLIST_ALLOC(&element_listCompare);
+        regionPtr->beforeListPtr = ELEMENT_LIST_ALLOC();
         assert(regionPtr->beforeListPtr);
 
-        regionPtr->borderListPtr = TMLIST_ALLOC(&element_listCompareEdge);
+        regionPtr->borderListPtr = ELEMENT_EDGE_LIST_ALLOC();
         assert(regionPtr->borderListPtr);
 
         regionPtr->badVectorPtr = PVECTOR_ALLOC(1);
@@ -183,9 +183,10 @@ TMretriangulate (element_t* elementPtr,
                  MAP_T* edgeMapPtr)
 {
     vector_t* badVectorPtr = regionPtr->badVectorPtr; /* private */
-    list_t* beforeListPtr = regionPtr->beforeListPtr; /* private */
-    list_t* borderListPtr = regionPtr->borderListPtr; /* private */
-    list_iter_t it;
+    element_list_t* beforeListPtr = regionPtr->beforeListPtr; /* private */
+    element_edge_list_t* borderListPtr = regionPtr->borderListPtr; /* private */
+    element_list_iter_t it;
+    element_edge_list_iter_t edgeIt;
     long numDelta = 0L;
     assert(edgeMapPtr);
 
@@ -197,11 +198,10 @@ TMretriangulate (element_t* elementPtr,
      * Remove the old triangles
      */
 
-    it = &(beforeListPtr->head);
+    TMLIST_ITER_RESET(&it, beforeListPtr);
 
-    while (it ->nextPtr != NULL) {
-      element_t* beforeElementPtr = (element_t*)it->nextPtr->dataPtr;
-      it = it->nextPtr;
+    while (TMLIST_ITER_HASNEXT(&it)) {
+      element_t* beforeElementPtr = (element_t*)TMLIST_ITER_NEXT(&it);
 
       TMMESH_REMOVE(meshPtr, beforeElementPtr);
     }
@@ -245,17 +245,13 @@ TMretriangulate (element_t* elementPtr,
      * Insert the new triangles. These are contructed using the new
      * point and the two points from the border segment.
      */
-    it = &(borderListPtr->head);
-    //list_iter_reset(&it, borderListPtr);
+    TMLIST_ITER_RESET(&edgeIt, borderListPtr);
 
-    while (it->nextPtr != NULL) {
-   //while (list_iter_hasNext(&it, borderListPtr)) {
+    while (TMLIST_ITER_HASNEXT(&edgeIt)) {
       element_t* afterElementPtr;
       coordinate_t coordinates[3];
 
-      //edge_t* borderEdgePtr = (edge_t*)list_iter_next(&it, borderListPtr);
-      edge_t* borderEdgePtr = (edge_t*) it->nextPtr->dataPtr;
-      it = it->nextPtr;
+      edge_t* borderEdgePtr = (edge_t*)TMLIST_ITER_NEXT(&edgeIt);
 
       assert(borderEdgePtr);
       coordinates[0] = centerCoordinate;
@@ -297,8 +293,8 @@ TMgrowRegion (element_t* centerElementPtr,
         //TMprints("enter here\n");
     }
 
-    list_t* beforeListPtr = regionPtr->beforeListPtr;
-    list_t* borderListPtr = regionPtr->borderListPtr;
+    element_list_t* beforeListPtr = regionPtr->beforeListPtr;
+    element_edge_list_t* borderListPtr = regionPtr->borderListPtr;
     queue_t* expandQueuePtr = regionPtr->expandQueuePtr;
 
     list_clear(beforeListPtr);
@@ -317,19 +313,18 @@ TMgrowRegion (element_t* centerElementPtr,
 
         element_t* currentElementPtr = (element_t*)TMQUEUE_POP(expandQueuePtr);
 
-        TMLIST_INSERT(beforeListPtr, (void*)currentElementPtr); /* no duplicates */
+        TMLIST_INSERT(beforeListPtr, currentElementPtr); /* no duplicates */
         // __attribute__((transaction_safe))
-        list_t* neighborListPtr = element_getNeighborListPtr(currentElementPtr);
+        element_list_t* neighborListPtr = element_getNeighborListPtr(currentElementPtr);
 
-        list_iter_t it;
-        it = &(neighborListPtr->head);
+        element_list_iter_t it;
+        TMLIST_ITER_RESET(&it, neighborListPtr);
 
-        while (it->nextPtr != NULL) {
-          element_t* neighborElementPtr = (element_t*)it->nextPtr->dataPtr;
-          it = it->nextPtr;
+        while (TMLIST_ITER_HASNEXT(&it)) {
+          element_t* neighborElementPtr = (element_t*)TMLIST_ITER_NEXT(&it);
 
             TMELEMENT_ISGARBAGE(neighborElementPtr); /* so we can detect conflicts */
-            if (!list_find(beforeListPtr, (void*)neighborElementPtr)) {
+            if (!list_find(beforeListPtr, neighborElementPtr)) {
               //[wer210] below function includes acos() and sqrt(), now safe
               if (element_isInCircumCircle(neighborElementPtr, centerCoordinatePtr)) {
                   /* This is part of the region */
@@ -351,7 +346,7 @@ TMgrowRegion (element_t* centerElementPtr,
                       *success = false;
                       return NULL;
                     }
-                    TMLIST_INSERT(borderListPtr,(void*)borderEdgePtr); /* no duplicates */
+                    TMLIST_INSERT(borderListPtr, borderEdgePtr); /* no duplicates */
                     if (!MAP_CONTAINS(edgeMapPtr, borderEdgePtr)) {
                         MAP_INSERT(edgeMapPtr, borderEdgePtr, neighborElementPtr);
                     }
@@ -438,13 +433,24 @@ Pregion_clearBad (region_t* regionPtr)
 }
 
 
+/* =============================================================================
+ * Pregion_getBadVector
+ * =============================================================================
+ */
+vector_t*
+Pregion_getBadVector (region_t* regionPtr)
+{
+    return regionPtr->badVectorPtr;
+}
+
+
 /* =============================================================================
  * TMregion_transferBad
  * =============================================================================
  */
 __attribute__((transaction_safe))
 void
-TMregion_transferBad (region_t* regionPtr, heap_t* workHeapPtr)
+TMregion_transferBad (region_t* regionPtr, multiqueue_t* workQueuePtr)
 {
     vector_t* badVectorPtr = regionPtr->badVectorPtr;
     long numBad = PVECTOR_GETSIZE(badVectorPtr);
@@ -455,7 +461,9 @@ TMregion_transferBad (region_t* regionPtr, heap_t* workHeapPtr)
         if (TMELEMENT_ISGARBAGE(badElementPtr)) {
             TMELEMENT_FREE(badElementPtr);
         } else {
-            bool status = TMHEAP_INSERT(workHeapPtr, (void*)badElementPtr);
+            bool status = TMMULTIQUEUE_INSERT(workQueuePtr,
+                                              element_getHeapKey(badElementPtr),
+                                              badElementPtr);
             assert(status);
         }
     }
@@ -71,7 +71,7 @@
 #pragma once
 
 #include "element.h"
-#include "heap.h"
+#include "multiqueue.h"
 #include "mesh.h"
 
 struct region_t;
@@ -119,17 +119,27 @@ void
 Pregion_clearBad (region_t* regionPtr);
 
 
+/* =============================================================================
+ * Pregion_getBadVector
+ * -- Bad elements found by the last refinement; private to the region owner
+ * =============================================================================
+ */
+vector_t*
+Pregion_getBadVector (region_t* regionPtr);
+
+
 /* =============================================================================
  * TMregion_transferBad
  * =============================================================================
  */
 __attribute__((transaction_safe))
 void
-TMregion_transferBad (region_t* regionPtr, heap_t* workHeapPtr);
+TMregion_transferBad (region_t* regionPtr, multiqueue_t* workQueuePtr);
 
 
 #define PREGION_ALLOC()                 Pregion_alloc()
 #define PREGION_FREE(r)                 Pregion_free(r)
 #define PREGION_CLEARBAD(r)             Pregion_clearBad(r)
+#define PREGION_GETBADVECTOR(r)         Pregion_getBadVector(r)
 #define TMREGION_REFINE(r, e, m, s)        TMregion_refine(r, e, m, s)
 #define TMREGION_TRANSFERBAD(r, q)      TMregion_transferBad(r, q)
@@ -76,9 +76,11 @@
 #include "region.h"
 #include "list.h"
 #include "mesh.h"
-#include "heap.h"
+#include "multiqueue.h"
 #include "thread.h"
 #include "timer.h"
+#include "tm.h"
+#include "tmretry.h"
 
 #define PARAM_DEFAULT_INPUTPREFIX ("inputs/ttimeu1000000.2")
 #define PARAM_DEFAULT_NUMTHREAD   (1L)
@@ -89,10 +91,25 @@ const char*    global_inputPrefix     = PARAM_DEFAULT_INPUTPREFIX;
 long     global_numThread       = PARAM_DEFAULT_NUMTHREAD;
 double   global_angleConstraint = PARAM_DEFAULT_ANGLE;
 mesh_t*  global_meshPtr;
-heap_t*  global_workHeapPtr;
+multiqueue_t* global_workQueuePtr;
 long     global_totalNumAdded = 0;
 long     global_numProcess    = 0;
 
+typedef struct process_local {
+    mesh_t*   meshPtr;
+    region_t* regionPtr;
+    long      totalNumAdded;
+    long      numProcess;
+} process_local_t;
+
+#ifdef USE_TASKS
+/* Per-thread state of the thread currently running process() */
+static __thread process_local_t* process_myLocalPtr;
+
+static void
+processTask (void* argPtr);
+#endif
+
 
 /* =============================================================================
  * displayUsage
@@ -156,7 +173,7 @@ parseArgs (long argc, char* const argv[])
  * =============================================================================
  */
 static long
-initializeWork (heap_t* workHeapPtr, mesh_t* meshPtr)
+initializeWork (multiqueue_t* workQueuePtr, mesh_t* meshPtr)
 {
     std::mt19937* randomPtr = new std::mt19937();
     randomPtr->seed(0);
@@ -164,6 +181,9 @@ initializeWork (heap_t* workHeapPtr, mesh_t* meshPtr)
     delete randomPtr;
 
     long numBad = 0;
+#ifdef USE_TASKS
+    (void)workQueuePtr; /* bad elements are seeded as tasks instead */
+#endif
 
     while (1) {
         element_t* elementPtr = mesh_getBad(meshPtr);
@@ -171,14 +191,94 @@ initializeWork (heap_t* workHeapPtr, mesh_t* meshPtr)
             break;
         }
         numBad++;
-        bool status = heap_insert(workHeapPtr, (void*)elementPtr);
+#ifdef USE_TASKS
+        thread_spawnTask(&processTask, (void*)elementPtr);
+#else
+        bool status = multiqueue_insert(workQueuePtr,
+                                        element_getHeapKey(elementPtr),
+                                        (void*)elementPtr);
         assert(status);
+#endif
         TMelement_setIsReferenced(elementPtr, true);
     }
 
     return numBad;
 }
 
+/* =============================================================================
+ * processElement
+ * -- Refine one bad element; new bad elements are left in the region
+ * =============================================================================
+ */
+static void
+processElement (process_local_t* localPtr, element_t* elementPtr)
+{
+    region_t* regionPtr = localPtr->regionPtr;
+    mesh_t* meshPtr = localPtr->meshPtr;
+
+    bool isGarbage;
+    TM_BEGIN("yada_checkGarbage");
+      isGarbage = TMELEMENT_ISGARBAGE(elementPtr);
+    TM_END();
+    if (isGarbage) {
+        /*
+         * Handle delayed deallocation
+         */
+        TMELEMENT_FREE(elementPtr);
+        return;
+    }
+
+    long numAdded;
+    //[wer210] changed the control flow to get rid of self-abort
+    bool success = true;
+    TM_RETRY_BEGIN("yada_refineRegion");
+        // TM_SAFE: PVECTOR_CLEAR (regionPtr->badVectorPtr);
+        PREGION_CLEARBAD(regionPtr);
+        //[wer210] problematic function!
+        numAdded = TMREGION_REFINE(regionPtr, elementPtr, meshPtr, &success);
+        if (!success) TM_RETRY_CANCEL();
+    TM_RETRY_END();
+
+    TM_BEGIN("yada_clearReferenced");
+      TMELEMENT_SETISREFERENCED(elementPtr, false);
+      isGarbage = TMELEMENT_ISGARBAGE(elementPtr);
+    TM_END();
+    if (isGarbage) {
+        /*
+         * Handle delayed deallocation
+         */
+        TMELEMENT_FREE(elementPtr);
+    }
+
+    localPtr->totalNumAdded += numAdded;
+    localPtr->numProcess++;
+}
+
+
+#ifdef USE_TASKS
+/* =============================================================================
+ * processTask
+ * -- Each new bad element becomes a task of its own; garbage ones are freed
+ *    when their task runs
+ * =============================================================================
+ */
+static void
+processTask (void* argPtr)
+{
+    process_local_t* localPtr = process_myLocalPtr;
+
+    processElement(localPtr, (element_t*)argPtr);
+
+    vector_t* badVectorPtr = PREGION_GETBADVECTOR(localPtr->regionPtr);
+    long numBad = vector_getSize(badVectorPtr);
+    for (long i = 0; i < numBad; i++) {
+        thread_spawnTask(&processTask, vector_at(badVectorPtr, i));
+    }
+    PREGION_CLEARBAD(localPtr->regionPtr);
+}
+#endif /* USE_TASKS */
+
+
 /* =============================================================================
  * process
  * =============================================================================
@@ -186,80 +286,51 @@ initializeWork (heap_t* workHeapPtr, mesh_t* meshPtr)
 static void
 process (void*)
 {
-    heap_t* workHeapPtr = global_workHeapPtr;
-    mesh_t* meshPtr = global_meshPtr;
-    region_t* regionPtr;
-    long totalNumAdded = 0;
-    long numProcess = 0;
-
-    regionPtr = PREGION_ALLOC();
-    assert(regionPtr);
+    process_local_t local;
+    local.meshPtr       = global_meshPtr;
+    local.totalNumAdded = 0;
+    local.numProcess    = 0;
+
+    local.regionPtr = PREGION_ALLOC();
+    assert(local.regionPtr);
+
+#ifdef USE_TASKS
+    process_myLocalPtr = &local;
+    thread_waitAll();
+    process_myLocalPtr = NULL;
+#else
+    multiqueue_t* workQueuePtr = global_workQueuePtr;
 
     while (1) {
 
         element_t* elementPtr;
 
-        __transaction_atomic {
-          elementPtr = (element_t*)TMHEAP_REMOVE(workHeapPtr);
-        }
+        TM_BEGIN("yada_popWork");
+          elementPtr = (element_t*)TMMULTIQUEUE_REMOVE(workQueuePtr);
+        TM_END();
 
         if (elementPtr == NULL) {
             break;
         }
 
-        bool isGarbage;
-        __transaction_atomic {
-          isGarbage = TMELEMENT_ISGARBAGE(elementPtr);
-        }
-        if (isGarbage) {
-            /*
-             * Handle delayed deallocation
-             */
-            TMELEMENT_FREE(elementPtr);
-            continue;
-        }
-
-        long numAdded;
-        //[wer210] changed the control flow to get rid of self-abort
-        bool success = true;
-        while (1) {
-          __transaction_atomic {
-            // TM_SAFE: PVECTOR_CLEAR (regionPtr->badVectorPtr);
-            PREGION_CLEARBAD(regionPtr);
-            //[wer210] problematic function!
-            numAdded = TMREGION_REFINE(regionPtr, elementPtr, meshPtr, &success);
-            if (success) break;
-            else __transaction_cancel;
-          }
-        }
+        PREGION_CLEARBAD(local.regionPtr);
+        processElement(&local, elementPtr);
 
-        __transaction_atomic {
-          TMELEMENT_SETISREFERENCED(elementPtr, false);
-          isGarbage = TMELEMENT_ISGARBAGE(elementPtr);
-        }
-        if (isGarbage) {
-            /*
-             * Handle delayed deallocation
-             */
-            TMELEMENT_FREE(elementPtr);
-        }
-
-        totalNumAdded += numAdded;
-
-        __transaction_atomic {
-          TMREGION_TRANSFERBAD(regionPtr, workHeapPtr);
-        }
-
-        numProcess++;
+        TM_BEGIN("yada_transferBad");
+          TMREGION_TRANSFERBAD(local.regionPtr, workQueuePtr);
+        TM_END();
 
     }
+#endif /* USE_TASKS */
 
-    __transaction_atomic {
-        global_totalNumAdded += totalNumAdded;
-        global_numProcess += numProcess;
+    long totalNumAdded = thread_reduce_sum(local.totalNumAdded);
+    long numProcess = thread_reduce_sum(local.numProcess);
+    if (thread_getId() == 0) {
+        global_totalNumAdded = totalNumAdded;
+        global_numProcess = numProcess;
     }
 
-    PREGION_FREE(regionPtr);
+    PREGION_FREE(local.regionPtr);
 }
 
 
@@ -282,9 +353,9 @@ int main (int argc, char** argv)
     printf("Reading input... ");
     long initNumElement = mesh_read(global_meshPtr, global_inputPrefix);
     puts("done.");
-    global_workHeapPtr = heap_alloc(1, &element_heapCompare);
-    assert(global_workHeapPtr);
-    long initNumBadElement = initializeWork(global_workHeapPtr, global_meshPtr);
+    global_workQueuePtr = multiqueue_alloc(MULTIQUEUE_FACTOR * global_numThread);
+    assert(global_workQueuePtr);
+    long initNumBadElement = initializeWork(global_workQueuePtr, global_meshPtr);
 
     printf("Initial number of mesh elements = %li\n", initNumElement);
     printf("Initial number of bad elements  = %li\n", initNumBadElement);
@@ -320,6 +391,7 @@ int main (int argc, char** argv)
     long finalNumElement = initNumElement + global_totalNumAdded;
     printf("Final mesh size                 = %li\n", finalNumElement);
     printf("Number of elements processed    = %li\n", global_numProcess);
+    tm_retry_print();
     fflush(stdout);
 
 #if 0
@@ -332,9 +404,11 @@ int main (int argc, char** argv)
     assert(isSuccess);
 
     /*
-     * TODO: deallocate mesh and work heap
+     * TODO: deallocate mesh
      */
 
+    multiqueue_free(global_workQueuePtr);
+
     thread_shutdown();
 
     return 0;